@@ -87,6 +87,12 @@ struct ParameterInfo
     float           max_range;
 };
 
+struct ParameterValue
+{
+    int         parameter_id;
+    float       value;
+};
+
 struct ProcessorInfo
 {
     int         id;
@@ -114,6 +120,24 @@ struct TrackInfo
     int         processor_count;
 };
 
+enum class RecordingSource
+{
+    ENGINE_INPUT,
+    ENGINE_OUTPUT,
+    PROCESSOR_OUTPUT
+};
+
+struct RecordingTapInfo
+{
+    int             id;
+    RecordingSource source;
+    int             processor_id;
+    int             channels;
+    bool            armed;
+    int             overruns;
+    std::string     filename;
+};
+
 class SushiControl
 {
 public:
@@ -177,6 +201,13 @@ public:
     virtual ControlStatus                              set_parameter_value(int processor_id, int parameter_id, float value) = 0;
     virtual ControlStatus                              set_parameter_value_normalised(int processor_id, int parameter_id, float value) = 0;
     virtual ControlStatus                              set_string_property_value(int processor_id, int parameter_id, const std::string& value) = 0;
+    virtual ControlStatus                              set_parameter_values(int processor_id, const std::vector<ParameterValue>& values) = 0;
+
+    // Recording controls
+    virtual std::pair<ControlStatus, int>              create_recording_tap(RecordingSource source, int processor_id) = 0;
+    virtual std::vector<RecordingTapInfo>              get_recording_taps() const = 0;
+    virtual ControlStatus                              arm_recording_tap(int tap_id, const std::string& filename) = 0;
+    virtual ControlStatus                              disarm_recording_tap(int tap_id) = 0;
 
 
 protected:
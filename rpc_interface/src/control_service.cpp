@@ -80,6 +80,28 @@ inline sushi::ext::SyncMode to_sushi_ext(const sushi_rpc::SyncMode::Mode mode)
     }
 }
 
+inline sushi_rpc::RecordingSource::Source to_grpc(const sushi::ext::RecordingSource source)
+{
+    switch (source)
+    {
+        case sushi::ext::RecordingSource::ENGINE_INPUT:      return sushi_rpc::RecordingSource::ENGINE_INPUT;
+        case sushi::ext::RecordingSource::ENGINE_OUTPUT:     return sushi_rpc::RecordingSource::ENGINE_OUTPUT;
+        case sushi::ext::RecordingSource::PROCESSOR_OUTPUT:  return sushi_rpc::RecordingSource::PROCESSOR_OUTPUT;
+        default:                                             return sushi_rpc::RecordingSource::ENGINE_OUTPUT;
+    }
+}
+
+inline sushi::ext::RecordingSource to_sushi_ext(const sushi_rpc::RecordingSource::Source source)
+{
+    switch (source)
+    {
+        case sushi_rpc::RecordingSource::ENGINE_INPUT:      return sushi::ext::RecordingSource::ENGINE_INPUT;
+        case sushi_rpc::RecordingSource::ENGINE_OUTPUT:     return sushi::ext::RecordingSource::ENGINE_OUTPUT;
+        case sushi_rpc::RecordingSource::PROCESSOR_OUTPUT:  return sushi::ext::RecordingSource::PROCESSOR_OUTPUT;
+        default:                                            return sushi::ext::RecordingSource::ENGINE_OUTPUT;
+    }
+}
+
 inline const char* to_string(const sushi::ext::ControlStatus status)
 {
    switch (status)
@@ -165,6 +187,17 @@ inline void to_grpc(sushi_rpc::CpuTimings& dest, const sushi::ext::CpuTimings& s
     dest.set_max(src.max);
 }
 
+inline void to_grpc(sushi_rpc::RecordingTapInfo& dest, const sushi::ext::RecordingTapInfo& src)
+{
+    dest.set_id(src.id);
+    dest.mutable_source()->set_source(to_grpc(src.source));
+    dest.set_processor_id(src.processor_id);
+    dest.set_channels(src.channels);
+    dest.set_armed(src.armed);
+    dest.set_overruns(src.overruns);
+    dest.set_filename(src.filename);
+}
+
 grpc::Status SushiControlService::GetSamplerate(grpc::ServerContext* /*context*/,
                                                 const sushi_rpc::GenericVoidValue* /*request*/,
                                                 sushi_rpc::GenericFloatValue* response)
@@ -649,4 +682,61 @@ grpc::Status SushiControlService::SetStringPropertyValue(grpc::ServerContext* /*
     return to_grpc_status(status);
 }
 
+grpc::Status SushiControlService::SetParameterValues(grpc::ServerContext* /*context*/,
+                                                     const sushi_rpc::ParameterBatchSetRequest* request,
+                                                     sushi_rpc::GenericVoidValue* /*response*/)
+{
+    std::vector<sushi::ext::ParameterValue> values;
+    values.reserve(request->values_size());
+    for (const auto& value : request->values())
+    {
+        values.push_back({value.parameter_id(), value.value()});
+    }
+    auto status = _controller->set_parameter_values(request->processor().id(), values);
+    return to_grpc_status(status);
+}
+
+grpc::Status SushiControlService::CreateRecordingTap(grpc::ServerContext* /*context*/,
+                                                     const sushi_rpc::RecordingTapCreateRequest* request,
+                                                     sushi_rpc::RecordingTapIdentifier* response)
+{
+    auto [status, id] = _controller->create_recording_tap(to_sushi_ext(request->source().source()),
+                                                           request->processor().id());
+    if (status != sushi::ext::ControlStatus::OK)
+    {
+        return to_grpc_status(status);
+    }
+    response->set_id(id);
+    return grpc::Status::OK;
+}
+
+grpc::Status SushiControlService::GetRecordingTaps(grpc::ServerContext* /*context*/,
+                                                   const sushi_rpc::GenericVoidValue* /*request*/,
+                                                   sushi_rpc::RecordingTapInfoList* response)
+{
+    auto taps = _controller->get_recording_taps();
+    for (const auto& tap : taps)
+    {
+        auto info = response->add_taps();
+        to_grpc(*info, tap);
+    }
+    return grpc::Status::OK;
+}
+
+grpc::Status SushiControlService::ArmRecordingTap(grpc::ServerContext* /*context*/,
+                                                  const sushi_rpc::RecordingTapArmRequest* request,
+                                                  sushi_rpc::GenericVoidValue* /*response*/)
+{
+    auto status = _controller->arm_recording_tap(request->tap().id(), request->filename());
+    return to_grpc_status(status);
+}
+
+grpc::Status SushiControlService::DisarmRecordingTap(grpc::ServerContext* /*context*/,
+                                                     const sushi_rpc::RecordingTapIdentifier* request,
+                                                     sushi_rpc::GenericVoidValue* /*response*/)
+{
+    auto status = _controller->disarm_recording_tap(request->id());
+    return to_grpc_status(status);
+}
+
 } // sushi_rpc
@@ -90,6 +90,13 @@ public:
      grpc::Status SetParameterValue(grpc::ServerContext* context, const sushi_rpc::ParameterSetRequest* request, sushi_rpc::GenericVoidValue* response) override;
      grpc::Status SetParameterValueNormalised(grpc::ServerContext* context, const sushi_rpc::ParameterSetRequest* request, sushi_rpc::GenericVoidValue* response) override;
      grpc::Status SetStringPropertyValue(grpc::ServerContext* context, const sushi_rpc::StringPropertySetRequest* request, sushi_rpc::GenericVoidValue* response) override;
+     grpc::Status SetParameterValues(grpc::ServerContext* context, const sushi_rpc::ParameterBatchSetRequest* request, sushi_rpc::GenericVoidValue* response) override;
+
+     // Recording control
+     grpc::Status CreateRecordingTap(grpc::ServerContext* context, const sushi_rpc::RecordingTapCreateRequest* request, sushi_rpc::RecordingTapIdentifier* response) override;
+     grpc::Status GetRecordingTaps(grpc::ServerContext* context, const sushi_rpc::GenericVoidValue* request, sushi_rpc::RecordingTapInfoList* response) override;
+     grpc::Status ArmRecordingTap(grpc::ServerContext* context, const sushi_rpc::RecordingTapArmRequest* request, sushi_rpc::GenericVoidValue* response) override;
+     grpc::Status DisarmRecordingTap(grpc::ServerContext* context, const sushi_rpc::RecordingTapIdentifier* request, sushi_rpc::GenericVoidValue* response) override;
 
 private:
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief C client for exchanging audio with Sushi's shared memory frontend
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * Typical usage, one chunk at a time:
+ *
+ *     SushiShmClient* client = sushi_shm_client_open(SUSHI_SHM_DEFAULT_NAME);
+ *     while (...)
+ *     {
+ *         fill sushi_shm_client_input(client, channel) with chunk_size samples
+ *         sushi_shm_client_process(client, 1000);
+ *         read sushi_shm_client_output(client, channel)
+ *     }
+ *     sushi_shm_client_close(client);
+ *
+ * Up to SUSHI_SHM_SLOT_COUNT chunks can be queued with sushi_shm_client_send()
+ * before their outputs are collected with sushi_shm_client_receive(), which
+ * allows the client to run ahead of Sushi when latency is not critical.
+ */
+
+#ifndef SUSHI_SHM_CLIENT_H
+#define SUSHI_SHM_CLIENT_H
+
+#include "sushi_shm_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SushiShmClient SushiShmClient;
+
+/**
+ * @brief Connect to a running Sushi instance. Only one client can be connected at a time.
+ * @param name Name of the shared memory segment, as given to Sushi with --shm-name
+ * @return A client, or NULL with errno set on failure. EBUSY if another client is
+ *         connected, EPROTO if the segment is not from a compatible Sushi version.
+ */
+SushiShmClient* sushi_shm_client_open(const char* name);
+
+/**
+ * @brief Disconnect from Sushi and free the client
+ */
+void sushi_shm_client_close(SushiShmClient* client);
+
+int sushi_shm_client_sample_rate(const SushiShmClient* client);
+
+int sushi_shm_client_chunk_size(const SushiShmClient* client);
+
+int sushi_shm_client_input_channels(const SushiShmClient* client);
+
+int sushi_shm_client_output_channels(const SushiShmClient* client);
+
+int sushi_shm_client_cv_inputs(const SushiShmClient* client);
+
+int sushi_shm_client_cv_outputs(const SushiShmClient* client);
+
+int sushi_shm_client_gate_inputs(const SushiShmClient* client);
+
+int sushi_shm_client_gate_outputs(const SushiShmClient* client);
+
+/**
+ * @brief Buffers of the next chunk to send, valid until sushi_shm_client_send() is called.
+ *        Must not be written to while SUSHI_SHM_SLOT_COUNT chunks are queued.
+ * @return A pointer to chunk_size samples for the given channel
+ */
+float* sushi_shm_client_input(SushiShmClient* client, int channel);
+
+/* One value per cv input */
+float* sushi_shm_client_cv_input(SushiShmClient* client);
+
+/* Gate n is bit n % 32 of word n / 32 */
+uint32_t* sushi_shm_client_gate_input(SushiShmClient* client);
+
+/**
+ * @brief Buffers of the last received chunk, valid until the next call to sushi_shm_client_send()
+ * @return A pointer to chunk_size samples for the given channel
+ */
+const float* sushi_shm_client_output(SushiShmClient* client, int channel);
+
+const float* sushi_shm_client_cv_output(SushiShmClient* client);
+
+const uint32_t* sushi_shm_client_gate_output(SushiShmClient* client);
+
+/**
+ * @brief Pass the input chunk to Sushi for processing
+ * @return 0 on success, -1 with errno set to EAGAIN if SUSHI_SHM_SLOT_COUNT chunks are
+ *         already queued and sushi_shm_client_receive() must be called first
+ */
+int sushi_shm_client_send(SushiShmClient* client);
+
+/**
+ * @brief Wait for Sushi to return the oldest queued chunk
+ * @param timeout_ms Max time to wait
+ * @return 0 on success, -1 with errno set to ETIMEDOUT on timeout, or EAGAIN if no
+ *         chunk was queued
+ */
+int sushi_shm_client_receive(SushiShmClient* client, int timeout_ms);
+
+/**
+ * @brief Send one chunk and wait for it to be processed
+ * @param timeout_ms Max time to wait
+ * @return 0 on success, -1 with errno set on failure
+ */
+int sushi_shm_client_process(SushiShmClient* client, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SUSHI_SHM_CLIENT_H
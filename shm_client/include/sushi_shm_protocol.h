@@ -0,0 +1,160 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Layout of the shared memory segment used to exchange audio between Sushi
+ *        and a client process. Shared between the Sushi frontend and the C client.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ *
+ * The segment starts with a SushiShmHeader followed by slot_count input slots,
+ * written by the client, and slot_count output slots, written by Sushi. Each slot
+ * holds one chunk of non-interleaved audio, followed by cv_ports cv values and
+ * gate_words 32 bit words of gate bits, where gate n is bit n % 32 of word n / 32.
+ *
+ * Two counters drive the exchange. The client writes input slot n % slot_count and
+ * increments input_count. Sushi processes it, writes output slot n % slot_count and
+ * increments output_count. Both sides sleep on the other side's counter with a futex.
+ * The client must never be more than slot_count chunks ahead of the outputs it has
+ * read, which guarantees that Sushi never overwrites an output that is being read.
+ */
+
+#ifndef SUSHI_SHM_PROTOCOL_H
+#define SUSHI_SHM_PROTOCOL_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SUSHI_SHM_MAGIC         0x53555348u
+#define SUSHI_SHM_VERSION       2u
+#define SUSHI_SHM_DEFAULT_NAME  "/sushi"
+/* Must be a power of 2 so that slot indexes stay consistent when the counters wrap */
+#define SUSHI_SHM_SLOT_COUNT    4u
+#define SUSHI_SHM_MAX_CHANNELS  8u
+#define SUSHI_SHM_HEADER_SIZE   256u
+#define SUSHI_SHM_ALIGNMENT     64u
+
+typedef struct
+{
+    /* Written once by Sushi before the segment is made available */
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sample_rate;
+    uint32_t chunk_size;
+    uint32_t input_channels;
+    uint32_t output_channels;
+    uint32_t cv_inputs;
+    uint32_t cv_outputs;
+    uint32_t gate_inputs;
+    uint32_t gate_outputs;
+    /* Room for cv values and gate words in every slot, enough for both inputs and outputs */
+    uint32_t cv_ports;
+    uint32_t gate_words;
+    uint32_t slot_count;
+    uint32_t slot_size;
+
+    /* Updated at runtime, only accessed through the functions below */
+    uint32_t server_running;
+    uint32_t client_pid;
+    uint32_t input_count;
+    uint32_t output_count;
+} SushiShmHeader;
+
+static inline uint32_t sushi_shm_gate_words(uint32_t gates)
+{
+    return (gates + 31u) / 32u;
+}
+
+/* Size in bytes of one slot, rounded up to a cache line */
+static inline uint32_t sushi_shm_slot_size(uint32_t chunk_size, uint32_t channels, uint32_t cv_ports, uint32_t gate_words)
+{
+    uint32_t bytes = (channels * chunk_size + cv_ports) * sizeof(float) + gate_words * sizeof(uint32_t);
+    return (bytes + SUSHI_SHM_ALIGNMENT - 1) & ~(SUSHI_SHM_ALIGNMENT - 1);
+}
+
+static inline uint32_t sushi_shm_segment_size(uint32_t slot_size)
+{
+    return SUSHI_SHM_HEADER_SIZE + 2 * SUSHI_SHM_SLOT_COUNT * slot_size;
+}
+
+static inline char* sushi_shm_input_slot(SushiShmHeader* header, uint32_t count)
+{
+    return (char*)header + SUSHI_SHM_HEADER_SIZE + (count % header->slot_count) * header->slot_size;
+}
+
+static inline char* sushi_shm_output_slot(SushiShmHeader* header, uint32_t count)
+{
+    return sushi_shm_input_slot(header, count) + header->slot_count * header->slot_size;
+}
+
+/* Audio is stored as one chunk_size block per channel, then cv values, then gate bits */
+static inline float* sushi_shm_slot_audio(const SushiShmHeader* header, char* slot, uint32_t channel)
+{
+    return (float*)slot + channel * header->chunk_size;
+}
+
+static inline float* sushi_shm_slot_cv(const SushiShmHeader* header, char* slot, uint32_t channels)
+{
+    return (float*)slot + channels * header->chunk_size;
+}
+
+static inline uint32_t* sushi_shm_slot_gates(const SushiShmHeader* header, char* slot, uint32_t channels)
+{
+    return (uint32_t*)(sushi_shm_slot_cv(header, slot, channels) + header->cv_ports);
+}
+
+static inline uint32_t sushi_shm_load(const uint32_t* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static inline void sushi_shm_store(uint32_t* value, uint32_t new_value)
+{
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+/* Increment a counter and wake any process waiting on it */
+static inline void sushi_shm_signal(uint32_t* counter)
+{
+    __atomic_add_fetch(counter, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, counter, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+/* Wait until a counter differs from value, returns 0 if it did and -1 on timeout */
+static inline int sushi_shm_wait(uint32_t* counter, uint32_t value, int timeout_ms)
+{
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    while (sushi_shm_load(counter) == value)
+    {
+        if (syscall(SYS_futex, counter, FUTEX_WAIT, value, &timeout, NULL, 0) != 0 && errno == ETIMEDOUT)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SUSHI_SHM_PROTOCOL_H
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief C client for exchanging audio with Sushi's shared memory frontend
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sushi_shm_client.h"
+
+/* Max time to wait for Sushi to finish chunks queued by a previous client */
+#define CONNECT_TIMEOUT_MS 1000
+
+struct SushiShmClient
+{
+    SushiShmHeader* header;
+    size_t          size;
+    uint32_t        sent;
+    uint32_t        received;
+    char*           output_slot;
+};
+
+static int attach(SushiShmHeader* header)
+{
+    uint32_t expected = 0;
+    uint32_t pid = (uint32_t)getpid();
+    if (__atomic_compare_exchange_n(&header->client_pid, &expected, pid, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+    /* Take over from a client that exited without disconnecting */
+    if (kill((pid_t)expected, 0) != 0 && errno == ESRCH &&
+        __atomic_compare_exchange_n(&header->client_pid, &expected, pid, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+    errno = EBUSY;
+    return -1;
+}
+
+SushiShmClient* sushi_shm_client_open(const char* name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < SUSHI_SHM_HEADER_SIZE)
+    {
+        close(fd);
+        errno = EPROTO;
+        return NULL;
+    }
+    void* segment = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    SushiShmHeader* header = (SushiShmHeader*)segment;
+    if (header->magic != SUSHI_SHM_MAGIC || header->version != SUSHI_SHM_VERSION ||
+        sushi_shm_segment_size(header->slot_size) > (size_t)info.st_size)
+    {
+        munmap(segment, (size_t)info.st_size);
+        errno = EPROTO;
+        return NULL;
+    }
+    if (attach(header) != 0)
+    {
+        munmap(segment, (size_t)info.st_size);
+        return NULL;
+    }
+
+    uint32_t count = sushi_shm_load(&header->input_count);
+    uint32_t processed = sushi_shm_load(&header->output_count);
+    while (processed != count && sushi_shm_load(&header->server_running))
+    {
+        if (sushi_shm_wait(&header->output_count, processed, CONNECT_TIMEOUT_MS) != 0)
+        {
+            sushi_shm_store(&header->client_pid, 0);
+            munmap(segment, (size_t)info.st_size);
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+        processed = sushi_shm_load(&header->output_count);
+    }
+
+    SushiShmClient* client = (SushiShmClient*)malloc(sizeof(SushiShmClient));
+    if (client == NULL)
+    {
+        sushi_shm_store(&header->client_pid, 0);
+        munmap(segment, (size_t)info.st_size);
+        return NULL;
+    }
+    client->header = header;
+    client->size = (size_t)info.st_size;
+    client->sent = count;
+    client->received = count;
+    client->output_slot = sushi_shm_output_slot(header, count);
+    return client;
+}
+
+void sushi_shm_client_close(SushiShmClient* client)
+{
+    if (client == NULL)
+    {
+        return;
+    }
+    sushi_shm_store(&client->header->client_pid, 0);
+    munmap(client->header, client->size);
+    free(client);
+}
+
+int sushi_shm_client_sample_rate(const SushiShmClient* client)
+{
+    return (int)client->header->sample_rate;
+}
+
+int sushi_shm_client_chunk_size(const SushiShmClient* client)
+{
+    return (int)client->header->chunk_size;
+}
+
+int sushi_shm_client_input_channels(const SushiShmClient* client)
+{
+    return (int)client->header->input_channels;
+}
+
+int sushi_shm_client_output_channels(const SushiShmClient* client)
+{
+    return (int)client->header->output_channels;
+}
+
+int sushi_shm_client_cv_inputs(const SushiShmClient* client)
+{
+    return (int)client->header->cv_inputs;
+}
+
+int sushi_shm_client_cv_outputs(const SushiShmClient* client)
+{
+    return (int)client->header->cv_outputs;
+}
+
+int sushi_shm_client_gate_inputs(const SushiShmClient* client)
+{
+    return (int)client->header->gate_inputs;
+}
+
+int sushi_shm_client_gate_outputs(const SushiShmClient* client)
+{
+    return (int)client->header->gate_outputs;
+}
+
+float* sushi_shm_client_input(SushiShmClient* client, int channel)
+{
+    char* slot = sushi_shm_input_slot(client->header, client->sent);
+    return sushi_shm_slot_audio(client->header, slot, (uint32_t)channel);
+}
+
+float* sushi_shm_client_cv_input(SushiShmClient* client)
+{
+    char* slot = sushi_shm_input_slot(client->header, client->sent);
+    return sushi_shm_slot_cv(client->header, slot, client->header->input_channels);
+}
+
+uint32_t* sushi_shm_client_gate_input(SushiShmClient* client)
+{
+    char* slot = sushi_shm_input_slot(client->header, client->sent);
+    return sushi_shm_slot_gates(client->header, slot, client->header->input_channels);
+}
+
+const float* sushi_shm_client_output(SushiShmClient* client, int channel)
+{
+    return sushi_shm_slot_audio(client->header, client->output_slot, (uint32_t)channel);
+}
+
+const float* sushi_shm_client_cv_output(SushiShmClient* client)
+{
+    return sushi_shm_slot_cv(client->header, client->output_slot, client->header->output_channels);
+}
+
+const uint32_t* sushi_shm_client_gate_output(SushiShmClient* client)
+{
+    return sushi_shm_slot_gates(client->header, client->output_slot, client->header->output_channels);
+}
+
+int sushi_shm_client_send(SushiShmClient* client)
+{
+    if (client->sent - client->received >= client->header->slot_count)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+    client->sent++;
+    sushi_shm_signal(&client->header->input_count);
+    return 0;
+}
+
+int sushi_shm_client_receive(SushiShmClient* client, int timeout_ms)
+{
+    if (client->received == client->sent)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (sushi_shm_wait(&client->header->output_count, client->received, timeout_ms) != 0)
+    {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    client->output_slot = sushi_shm_output_slot(client->header, client->received);
+    client->received++;
+    return 0;
+}
+
+int sushi_shm_client_process(SushiShmClient* client, int timeout_ms)
+{
+    if (sushi_shm_client_send(client) != 0)
+    {
+        return -1;
+    }
+    return sushi_shm_client_receive(client, timeout_ms);
+}
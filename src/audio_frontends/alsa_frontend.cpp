@@ -0,0 +1,527 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Realtime audio frontend using Alsa PCM devices directly
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifdef SUSHI_BUILD_WITH_ALSA
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+
+#include "logging.h"
+#include "alsa_frontend.h"
+#include "audio_frontend_internals.h"
+
+namespace sushi {
+namespace audio_frontend {
+
+SUSHI_GET_LOGGER_WITH_MODULE_NAME("alsa audio");
+
+constexpr int ALSA_WAIT_TIMEOUT_MS = 1000;
+
+/* Sample formats in order of preference, the engine format first to avoid conversion */
+constexpr snd_pcm_format_t SUPPORTED_FORMATS[] = {SND_PCM_FORMAT_FLOAT_LE,
+                                                  SND_PCM_FORMAT_S32_LE,
+                                                  SND_PCM_FORMAT_S16_LE};
+
+constexpr float S32_TO_FLOAT = 1.0f / 2147483648.0f;
+constexpr float FLOAT_TO_S32 = 2147483647.0f;
+constexpr float S16_TO_FLOAT = 1.0f / 32768.0f;
+constexpr float FLOAT_TO_S16 = 32767.0f;
+
+/* Pointer to the first sample of a channel area at the given frame offset */
+inline char* area_data(const snd_pcm_channel_area_t& area, snd_pcm_uframes_t offset)
+{
+    return static_cast<char*>(area.addr) + (area.first + offset * area.step) / 8;
+}
+
+AudioFrontendStatus AlsaFrontend::init(BaseAudioFrontendConfiguration* config)
+{
+    auto ret_code = BaseAudioFrontend::init(config);
+    if (ret_code != AudioFrontendStatus::OK)
+    {
+        return ret_code;
+    }
+    auto alsa_config = static_cast<const AlsaFrontendConfiguration*>(_config);
+    if (alsa_config->period_size < AUDIO_CHUNK_SIZE || alsa_config->period_size % AUDIO_CHUNK_SIZE != 0)
+    {
+        SUSHI_LOG_ERROR("Period size {} is not a multiple of {}", alsa_config->period_size, AUDIO_CHUNK_SIZE);
+        return AudioFrontendStatus::INVALID_CHUNK_SIZE;
+    }
+    if (alsa_config->cv_inputs > 0 || alsa_config->cv_outputs > 0)
+    {
+        SUSHI_LOG_WARNING("Cv inputs and outputs are not supported by the Alsa frontend");
+    }
+
+    auto status = _open_stream(_capture, SND_PCM_STREAM_CAPTURE, alsa_config);
+    if (status != AudioFrontendStatus::OK)
+    {
+        cleanup();
+        return status;
+    }
+    status = _open_stream(_playback, SND_PCM_STREAM_PLAYBACK, alsa_config);
+    if (status != AudioFrontendStatus::OK)
+    {
+        cleanup();
+        return status;
+    }
+    if (_capture.period_size != _playback.period_size)
+    {
+        SUSHI_LOG_ERROR("Capture and playback period sizes differ ({} and {})", _capture.period_size, _playback.period_size);
+        cleanup();
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+
+    _linked = snd_pcm_link(_capture.handle, _playback.handle) == 0;
+    if (_linked == false)
+    {
+        SUSHI_LOG_WARNING("Failed to link capture and playback, they will be started separately");
+    }
+
+    int inputs = std::min(_capture.channels, MAX_FRONTEND_CHANNELS);
+    int outputs = std::min(_playback.channels, MAX_FRONTEND_CHANNELS);
+    _in_buffer = ChunkSampleBuffer(inputs);
+    _out_buffer = ChunkSampleBuffer(outputs);
+    _engine->set_audio_input_channels(inputs);
+    _engine->set_audio_output_channels(outputs);
+    _engine->set_cv_input_channels(0);
+    _engine->set_cv_output_channels(0);
+    _in_controls.resize(0, alsa_config->gate_inputs);
+    _out_controls.resize(0, alsa_config->gate_outputs);
+
+    /* The playback buffer is kept full, so the output latency is the full buffer */
+    Time latency = std::chrono::microseconds((_playback.buffer_size * 1'000'000) / static_cast<int>(_engine->sample_rate()));
+    _engine->set_output_latency(latency);
+    SUSHI_LOG_INFO("Opened Alsa device {}, {} inputs, {} outputs, period size {}, buffer size {}",
+                   alsa_config->device, inputs, outputs, _playback.period_size, _playback.buffer_size);
+    return AudioFrontendStatus::OK;
+}
+
+void AlsaFrontend::cleanup()
+{
+    _running = false;
+    if (_rt_thread.joinable())
+    {
+        _rt_thread.join();
+        SUSHI_LOG_INFO("Alsa frontend stopped, {} xruns", _xrun_count.load());
+    }
+    if (_linked)
+    {
+        snd_pcm_unlink(_capture.handle);
+        _linked = false;
+    }
+    for (auto stream : {&_capture, &_playback})
+    {
+        if (stream->handle)
+        {
+            snd_pcm_close(stream->handle);
+            stream->handle = nullptr;
+        }
+    }
+}
+
+void AlsaFrontend::run()
+{
+    _engine->enable_realtime(true);
+    _running = true;
+    _rt_thread = std::thread(&AlsaFrontend::_rt_loop, this);
+}
+
+AudioFrontendStatus AlsaFrontend::_open_stream(StreamSetup& stream,
+                                               snd_pcm_stream_t direction,
+                                               const AlsaFrontendConfiguration* config)
+{
+    int ret = snd_pcm_open(&stream.handle, config->device.c_str(), direction, 0);
+    if (ret < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to open Alsa device {} for {}: {}", config->device,
+                        direction == SND_PCM_STREAM_CAPTURE ? "capture" : "playback", snd_strerror(ret));
+        stream.handle = nullptr;
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    return _configure_stream(stream, config);
+}
+
+AudioFrontendStatus AlsaFrontend::_configure_stream(StreamSetup& stream, const AlsaFrontendConfiguration* config)
+{
+    snd_pcm_hw_params_t* hw_params;
+    snd_pcm_hw_params_alloca(&hw_params);
+    snd_pcm_hw_params_any(stream.handle, hw_params);
+
+    /* Non-interleaved access lets float devices be copied straight into the chunk buffers */
+    if (snd_pcm_hw_params_set_access(stream.handle, hw_params, SND_PCM_ACCESS_MMAP_NONINTERLEAVED) < 0 &&
+        snd_pcm_hw_params_set_access(stream.handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0)
+    {
+        SUSHI_LOG_ERROR("Device does not support mmap access");
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    stream.format = SND_PCM_FORMAT_UNKNOWN;
+    for (auto format : SUPPORTED_FORMATS)
+    {
+        if (snd_pcm_hw_params_set_format(stream.handle, hw_params, format) == 0)
+        {
+            stream.format = format;
+            break;
+        }
+    }
+    if (stream.format == SND_PCM_FORMAT_UNKNOWN)
+    {
+        SUSHI_LOG_ERROR("Device does not support any of the supported sample formats");
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+
+    unsigned int channels;
+    snd_pcm_hw_params_get_channels_max(hw_params, &channels);
+    channels = std::min(channels, static_cast<unsigned int>(MAX_FRONTEND_CHANNELS));
+    if (snd_pcm_hw_params_set_channels_near(stream.handle, hw_params, &channels) < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to set channel count");
+        return AudioFrontendStatus::INVALID_N_CHANNELS;
+    }
+    stream.channels = static_cast<int>(channels);
+
+    auto rate = static_cast<unsigned int>(_engine->sample_rate());
+    if (snd_pcm_hw_params_set_rate_near(stream.handle, hw_params, &rate, nullptr) < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to set sample rate");
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    if (rate != static_cast<unsigned int>(_engine->sample_rate()))
+    {
+        SUSHI_LOG_WARNING("Sample rate mismatch between engine ({}) and Alsa ({})", _engine->sample_rate(), rate);
+        _engine->set_sample_rate(rate);
+    }
+
+    auto period_size = static_cast<snd_pcm_uframes_t>(config->period_size);
+    auto periods = static_cast<unsigned int>(config->periods);
+    if (snd_pcm_hw_params_set_period_size_near(stream.handle, hw_params, &period_size, nullptr) < 0 ||
+        snd_pcm_hw_params_set_periods_near(stream.handle, hw_params, &periods, nullptr) < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to set period size {} with {} periods", config->period_size, config->periods);
+        return AudioFrontendStatus::INVALID_CHUNK_SIZE;
+    }
+    int ret = snd_pcm_hw_params(stream.handle, hw_params);
+    if (ret < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to apply hardware parameters: {}", snd_strerror(ret));
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    snd_pcm_hw_params_get_period_size(hw_params, &stream.period_size, nullptr);
+    snd_pcm_hw_params_get_buffer_size(hw_params, &stream.buffer_size);
+    /* Chunks are read and written in place, which requires them to never wrap around the buffer */
+    if (stream.period_size % AUDIO_CHUNK_SIZE != 0 || stream.buffer_size % AUDIO_CHUNK_SIZE != 0)
+    {
+        SUSHI_LOG_ERROR("Device period size {} and buffer size {} are not multiples of {}",
+                        stream.period_size, stream.buffer_size, AUDIO_CHUNK_SIZE);
+        return AudioFrontendStatus::INVALID_CHUNK_SIZE;
+    }
+
+    /* Wake up once every period and only start when explicitly told to */
+    snd_pcm_sw_params_t* sw_params;
+    snd_pcm_sw_params_alloca(&sw_params);
+    snd_pcm_uframes_t boundary;
+    snd_pcm_sw_params_current(stream.handle, sw_params);
+    snd_pcm_sw_params_get_boundary(sw_params, &boundary);
+    snd_pcm_sw_params_set_avail_min(stream.handle, sw_params, stream.period_size);
+    snd_pcm_sw_params_set_start_threshold(stream.handle, sw_params, boundary);
+    ret = snd_pcm_sw_params(stream.handle, sw_params);
+    if (ret < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to apply software parameters: {}", snd_strerror(ret));
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    return AudioFrontendStatus::OK;
+}
+
+void AlsaFrontend::_rt_loop()
+{
+    sched_param param;
+    param.sched_priority = ALSA_RT_PRIORITY;
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0)
+    {
+        SUSHI_LOG_WARNING("Failed to set realtime priority of audio thread: {}", strerror(ret));
+    }
+    set_flush_denormals_to_zero();
+
+    if (_start_streams() == false)
+    {
+        return;
+    }
+    while (_running)
+    {
+        ret = snd_pcm_wait(_capture.handle, ALSA_WAIT_TIMEOUT_MS);
+        if (ret == 0)
+        {
+            SUSHI_LOG_WARNING("Timeout waiting for Alsa device");
+            continue;
+        }
+        auto chunks = ret < 0 ? ret : _available_chunks();
+        if (chunks < 0)
+        {
+            _recover(static_cast<int>(chunks));
+            continue;
+        }
+        if (chunks == 0 && _linked == false)
+        {
+            /* Capture is ready but playback is not yet, wait for it instead of spinning */
+            snd_pcm_wait(_playback.handle, ALSA_WAIT_TIMEOUT_MS);
+        }
+        /* Process all complete chunks available, normally exactly one period */
+        for (; chunks > 0; --chunks)
+        {
+            if (_process_chunk() == false)
+            {
+                break;
+            }
+        }
+    }
+    snd_pcm_drop(_capture.handle);
+    snd_pcm_drop(_playback.handle);
+}
+
+bool AlsaFrontend::_start_streams()
+{
+    int ret = snd_pcm_prepare(_capture.handle);
+    if (ret == 0 && _linked == false)
+    {
+        ret = snd_pcm_prepare(_playback.handle);
+    }
+    if (ret < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to prepare Alsa device: {}", snd_strerror(ret));
+        return false;
+    }
+    /* Fill the playback buffer with silence, which sets the output latency */
+    snd_pcm_uframes_t remaining = _playback.buffer_size;
+    while (remaining > 0)
+    {
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = remaining;
+        snd_pcm_avail_update(_playback.handle);
+        ret = snd_pcm_mmap_begin(_playback.handle, &areas, &offset, &frames);
+        if (ret < 0 || frames == 0)
+        {
+            break;
+        }
+        snd_pcm_areas_silence(areas, offset, _playback.channels, frames, _playback.format);
+        snd_pcm_mmap_commit(_playback.handle, offset, frames);
+        remaining -= frames;
+    }
+    if (_linked == false)
+    {
+        snd_pcm_start(_playback.handle);
+    }
+    ret = snd_pcm_start(_capture.handle);
+    if (ret < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to start Alsa device: {}", snd_strerror(ret));
+        return false;
+    }
+    _start_time = get_current_time() - std::chrono::microseconds((_sample_count * 1'000'000) / static_cast<int>(_engine->sample_rate()));
+    return true;
+}
+
+void AlsaFrontend::_recover([[maybe_unused]] int error)
+{
+    [[maybe_unused]] int xruns = ++_xrun_count;
+    SUSHI_LOG_WARNING("Alsa xrun: {}, {} in total", snd_strerror(error), xruns);
+    snd_pcm_drop(_capture.handle);
+    if (_linked == false)
+    {
+        snd_pcm_drop(_playback.handle);
+    }
+    if (_start_streams() == false)
+    {
+        SUSHI_LOG_ERROR("Failed to recover from xrun, stopping audio");
+        _running = false;
+    }
+}
+
+snd_pcm_sframes_t AlsaFrontend::_available_chunks()
+{
+    /* Both directions are checked before anything is processed, as unlinked streams
+     * can be slightly out of phase without that being an xrun */
+    auto capture_avail = snd_pcm_avail_update(_capture.handle);
+    if (capture_avail < 0)
+    {
+        return capture_avail;
+    }
+    auto playback_avail = snd_pcm_avail_update(_playback.handle);
+    if (playback_avail < 0)
+    {
+        return playback_avail;
+    }
+    return std::min(capture_avail, playback_avail) / AUDIO_CHUNK_SIZE;
+}
+
+bool AlsaFrontend::_process_chunk()
+{
+    const snd_pcm_channel_area_t* areas;
+    snd_pcm_uframes_t offset;
+    snd_pcm_uframes_t frames = AUDIO_CHUNK_SIZE;
+    /* The buffer size is a multiple of the chunk size, so chunks never wrap around the buffer */
+    int ret = snd_pcm_mmap_begin(_capture.handle, &areas, &offset, &frames);
+    if (ret < 0 || frames != AUDIO_CHUNK_SIZE)
+    {
+        _recover(ret < 0 ? ret : -EPIPE);
+        return false;
+    }
+    _read_chunk(areas, offset);
+    auto committed = snd_pcm_mmap_commit(_capture.handle, offset, frames);
+    if (committed < 0 || static_cast<snd_pcm_uframes_t>(committed) != frames)
+    {
+        _recover(committed < 0 ? static_cast<int>(committed) : -EPIPE);
+        return false;
+    }
+
+    Time timestamp = _start_time + std::chrono::microseconds((_sample_count * 1'000'000) / static_cast<int>(_engine->sample_rate()));
+    _engine->update_time(timestamp, _sample_count);
+    _engine->process_chunk(&_in_buffer, &_out_buffer, &_in_controls, &_out_controls);
+    _sample_count += AUDIO_CHUNK_SIZE;
+
+    frames = AUDIO_CHUNK_SIZE;
+    ret = snd_pcm_mmap_begin(_playback.handle, &areas, &offset, &frames);
+    if (ret < 0 || frames != AUDIO_CHUNK_SIZE)
+    {
+        _recover(ret < 0 ? ret : -EPIPE);
+        return false;
+    }
+    _write_chunk(areas, offset);
+    committed = snd_pcm_mmap_commit(_playback.handle, offset, frames);
+    if (committed < 0 || static_cast<snd_pcm_uframes_t>(committed) != frames)
+    {
+        _recover(committed < 0 ? static_cast<int>(committed) : -EPIPE);
+        return false;
+    }
+    return true;
+}
+
+void AlsaFrontend::_read_chunk(const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset)
+{
+    for (int c = 0; c < _in_buffer.channel_count(); ++c)
+    {
+        const auto& area = areas[c];
+        const char* src = area_data(area, offset);
+        int stride = area.step / 8;
+        float* dest = _in_buffer.channel(c);
+        switch (_capture.format)
+        {
+            case SND_PCM_FORMAT_FLOAT_LE:
+                if (stride == sizeof(float))
+                {
+                    std::copy_n(reinterpret_cast<const float*>(src), AUDIO_CHUNK_SIZE, dest);
+                    break;
+                }
+                for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+                {
+                    dest[i] = *reinterpret_cast<const float*>(src + i * stride);
+                }
+                break;
+
+            case SND_PCM_FORMAT_S32_LE:
+                for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+                {
+                    dest[i] = *reinterpret_cast<const int32_t*>(src + i * stride) * S32_TO_FLOAT;
+                }
+                break;
+
+            case SND_PCM_FORMAT_S16_LE:
+                for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+                {
+                    dest[i] = *reinterpret_cast<const int16_t*>(src + i * stride) * S16_TO_FLOAT;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void AlsaFrontend::_write_chunk(const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset)
+{
+    int channels = _out_buffer.channel_count();
+    for (int c = 0; c < channels; ++c)
+    {
+        const auto& area = areas[c];
+        char* dest = area_data(area, offset);
+        int stride = area.step / 8;
+        const float* src = _out_buffer.channel(c);
+        switch (_playback.format)
+        {
+            case SND_PCM_FORMAT_FLOAT_LE:
+                if (stride == sizeof(float))
+                {
+                    std::copy_n(src, AUDIO_CHUNK_SIZE, reinterpret_cast<float*>(dest));
+                    break;
+                }
+                for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+                {
+                    *reinterpret_cast<float*>(dest + i * stride) = src[i];
+                }
+                break;
+
+            case SND_PCM_FORMAT_S32_LE:
+                for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+                {
+                    float sample = std::clamp(src[i], -1.0f, 1.0f);
+                    *reinterpret_cast<int32_t*>(dest + i * stride) = static_cast<int32_t>(sample * FLOAT_TO_S32);
+                }
+                break;
+
+            case SND_PCM_FORMAT_S16_LE:
+                for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+                {
+                    float sample = std::clamp(src[i], -1.0f, 1.0f);
+                    *reinterpret_cast<int16_t*>(dest + i * stride) = static_cast<int16_t>(sample * FLOAT_TO_S16);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+    /* Device channels not used by the engine are kept silent */
+    if (_playback.channels > channels)
+    {
+        snd_pcm_areas_silence(areas + channels, offset, _playback.channels - channels, AUDIO_CHUNK_SIZE, _playback.format);
+    }
+}
+
+}; // end namespace audio_frontend
+}; // end namespace sushi
+
+#endif // SUSHI_BUILD_WITH_ALSA
+#ifndef SUSHI_BUILD_WITH_ALSA
+#include <cassert>
+#include "audio_frontends/alsa_frontend.h"
+#include "logging.h"
+namespace sushi {
+namespace audio_frontend {
+SUSHI_GET_LOGGER;
+AlsaFrontend::AlsaFrontend(engine::BaseEngine* engine) : BaseAudioFrontend(engine)
+{
+    /* The log print needs to be in a cpp file for initialisation order reasons */
+    SUSHI_LOG_ERROR("Sushi was not built with Alsa support!");
+    assert(false);
+}}}
+#endif
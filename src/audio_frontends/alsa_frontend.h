@@ -0,0 +1,172 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Realtime audio frontend using Alsa PCM devices directly
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_ALSA_FRONTEND_H
+#define SUSHI_ALSA_FRONTEND_H
+#ifdef SUSHI_BUILD_WITH_ALSA
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <alsa/asoundlib.h>
+
+#include "base_audio_frontend.h"
+
+namespace sushi {
+namespace audio_frontend {
+
+constexpr int ALSA_RT_PRIORITY = 75;
+
+struct AlsaFrontendConfiguration : public BaseAudioFrontendConfiguration
+{
+    AlsaFrontendConfiguration(const std::string& device,
+                              int period_size,
+                              int periods,
+                              int cv_inputs,
+                              int cv_outputs) : BaseAudioFrontendConfiguration(cv_inputs, cv_outputs),
+                                                device(device),
+                                                period_size(period_size),
+                                                periods(periods)
+    {}
+
+    virtual ~AlsaFrontendConfiguration() = default;
+
+    std::string device;
+    int period_size;
+    int periods;
+};
+
+/**
+ * @brief Audio frontend that reads and writes an Alsa PCM device through mmap access from
+ *        its own SCHED_FIFO thread, without going through a sound server. Capture and
+ *        playback are linked so that they start, and restart after an xrun, in sync.
+ */
+class AlsaFrontend : public BaseAudioFrontend
+{
+public:
+    explicit AlsaFrontend(engine::BaseEngine* engine) : BaseAudioFrontend(engine) {}
+
+    virtual ~AlsaFrontend()
+    {
+        cleanup();
+    }
+
+    /**
+     * @brief Initialize the frontend and open and configure the Alsa device.
+     * @param config Configuration struct
+     * @return OK on successful initialization, error otherwise.
+     */
+    AudioFrontendStatus init(BaseAudioFrontendConfiguration* config) override;
+
+    /**
+     * @brief Stop the audio thread and close the Alsa device
+     */
+    void cleanup() override;
+
+    /**
+     * @brief Start the audio thread, returns immediately.
+     */
+    void run() override;
+
+    /**
+     * @brief Number of over- and underruns since the frontend was started
+     */
+    int xruns() const {return _xrun_count.load();}
+
+private:
+    /* Hardware configuration of one direction of the device */
+    struct StreamSetup
+    {
+        snd_pcm_t*        handle{nullptr};
+        snd_pcm_format_t  format{SND_PCM_FORMAT_UNKNOWN};
+        int               channels{0};
+        snd_pcm_uframes_t period_size{0};
+        snd_pcm_uframes_t buffer_size{0};
+    };
+
+    AudioFrontendStatus _open_stream(StreamSetup& stream, snd_pcm_stream_t direction, const AlsaFrontendConfiguration* config);
+
+    AudioFrontendStatus _configure_stream(StreamSetup& stream, const AlsaFrontendConfiguration* config);
+
+    /* Audio thread function */
+    void _rt_loop();
+
+    bool _start_streams();
+
+    void _recover(int error);
+
+    /* Number of chunks that can be both read and written, negative on errors */
+    snd_pcm_sframes_t _available_chunks();
+
+    /* Process one chunk, returns false on errors */
+    bool _process_chunk();
+
+    void _read_chunk(const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset);
+
+    void _write_chunk(const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset);
+
+    StreamSetup _capture;
+    StreamSetup _playback;
+    bool _linked{false};
+
+    std::thread       _rt_thread;
+    std::atomic<bool> _running{false};
+    std::atomic<int>  _xrun_count{0};
+
+    Time    _start_time{0};
+    int64_t _sample_count{0};
+
+    ChunkSampleBuffer     _in_buffer;
+    ChunkSampleBuffer     _out_buffer;
+    engine::ControlBuffer _in_controls;
+    engine::ControlBuffer _out_controls;
+};
+
+}; // end namespace audio_frontend
+}; // end namespace sushi
+
+#endif // SUSHI_BUILD_WITH_ALSA
+#ifndef SUSHI_BUILD_WITH_ALSA
+/* If Alsa is disabled in the build config, the Alsa frontend is replaced with
+   this dummy frontend whose only purpose is to assert if you try to use it */
+#include <string>
+#include "base_audio_frontend.h"
+namespace sushi {
+namespace audio_frontend {
+
+struct AlsaFrontendConfiguration : public BaseAudioFrontendConfiguration
+{
+    AlsaFrontendConfiguration(const std::string&, int, int, int, int) : BaseAudioFrontendConfiguration(0, 0) {}
+};
+
+class AlsaFrontend : public BaseAudioFrontend
+{
+public:
+    AlsaFrontend(engine::BaseEngine* engine);
+    AudioFrontendStatus init(BaseAudioFrontendConfiguration*) override {return AudioFrontendStatus::OK;}
+    void cleanup() override {}
+    void run() override {}
+};
+}; // end namespace audio_frontend
+}; // end namespace sushi
+#endif
+
+#endif //SUSHI_ALSA_FRONTEND_H
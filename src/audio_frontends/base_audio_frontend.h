@@ -53,6 +53,8 @@ struct BaseAudioFrontendConfiguration
     virtual ~BaseAudioFrontendConfiguration() = default;
     int cv_inputs;
     int cv_outputs;
+    int gate_inputs{DEFAULT_ENGINE_GATE_PORTS};
+    int gate_outputs{DEFAULT_ENGINE_GATE_PORTS};
 };
 
 /**
@@ -77,6 +79,11 @@ public:
     virtual AudioFrontendStatus init(BaseAudioFrontendConfiguration* config)
     {
         _config = config;
+        if (_engine->set_gate_input_channels(config->gate_inputs) != engine::EngineReturnStatus::OK ||
+            _engine->set_gate_output_channels(config->gate_outputs) != engine::EngineReturnStatus::OK)
+        {
+            return AudioFrontendStatus::INVALID_N_CHANNELS;
+        }
         return AudioFrontendStatus::OK;
     };
 
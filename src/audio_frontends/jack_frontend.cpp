@@ -19,12 +19,15 @@
  */
 
 #ifdef SUSHI_BUILD_WITH_JACK
+#include <algorithm>
+
 #include <jack/midiport.h>
 
 #include "logging.h"
 #include "jack_frontend.h"
 #include "audio_frontend_internals.h"
-#include "control_frontends/alsa_midi_frontend.h"
+#include "library/midi_decoder.h"
+#include "engine/recorder.h"
 
 namespace sushi {
 namespace audio_frontend {
@@ -56,7 +59,18 @@ AudioFrontendStatus JackFrontend::init(BaseAudioFrontendConfiguration* config)
         return AudioFrontendStatus::AUDIO_HW_ERROR;
     }
     _no_cv_output_ports = jack_config->cv_outputs;
-    return setup_client(jack_config->client_name, jack_config->server_name);
+    _cv_input_ports.resize(_no_cv_input_ports, nullptr);
+    _cv_output_ports.resize(_no_cv_output_ports, nullptr);
+    _cv_output_hist.resize(_no_cv_output_ports, 0.0f);
+    _cv_out_buffer = SampleBuffer<AUDIO_CHUNK_SIZE>(_no_cv_output_ports);
+    _in_controls.resize(_no_cv_input_ports, jack_config->gate_inputs);
+    _out_controls.resize(_no_cv_output_ports, jack_config->gate_outputs);
+    auto client_status = setup_client(jack_config->client_name, jack_config->server_name);
+    if (client_status != AudioFrontendStatus::OK)
+    {
+        return client_status;
+    }
+    return setup_midi_ports(jack_config->midi_inputs, jack_config->midi_outputs);
 }
 
 
@@ -72,6 +86,13 @@ void JackFrontend::cleanup()
 
 void JackFrontend::run()
 {
+    /* Engine routing can not change while running, so it only needs to be checked once */
+    for (int i = 0; i < MAX_FRONTEND_CHANNELS; ++i)
+    {
+        _engine_input_routed[i] = _engine->audio_input_channel_connected(i);
+        _engine_output_routed[i] = _engine->audio_output_channel_connected(i);
+    }
+    internal_buffer_size_callback(jack_get_buffer_size(_client));
     _engine->enable_realtime(true);
     int status = jack_activate(_client);
     if (status != 0)
@@ -84,6 +105,16 @@ void JackFrontend::run()
     }
 }
 
+bool JackFrontend::set_midi_frontend(JackMidiFrontend* midi_frontend)
+{
+    if (_midi_input_ports.empty() && _midi_output_ports.empty())
+    {
+        return false;
+    }
+    _midi_frontend = midi_frontend;
+    return true;
+}
+
 
 AudioFrontendStatus JackFrontend::setup_client(const std::string& client_name,
                                                const std::string& server_name)
@@ -108,6 +139,12 @@ AudioFrontendStatus JackFrontend::setup_client(const std::string& client_name,
         SUSHI_LOG_ERROR("Failed to set Jack callback function, error: {}.", ret);
         return AudioFrontendStatus::AUDIO_HW_ERROR;
     }
+    ret = jack_set_buffer_size_callback(_client, buffer_size_callback, this);
+    if (ret != 0)
+    {
+        SUSHI_LOG_ERROR("Failed to set buffer size callback function, error: {}.", ret);
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
     ret = jack_set_latency_callback(_client, latency_callback, this);
     if (ret != 0)
     {
@@ -217,6 +254,41 @@ AudioFrontendStatus JackFrontend::setup_cv_ports()
     return AudioFrontendStatus::OK;
 }
 
+AudioFrontendStatus JackFrontend::setup_midi_ports(int inputs, int outputs)
+{
+    for (int i = 0; i < inputs; ++i)
+    {
+        auto port = jack_port_register(_client,
+                                       std::string("midi_input_" + std::to_string(i)).c_str(),
+                                       JACK_DEFAULT_MIDI_TYPE,
+                                       JackPortIsInput,
+                                       0);
+        if (port == nullptr)
+        {
+            SUSHI_LOG_ERROR("Failed to open Jack midi input port {}.", i);
+            return AudioFrontendStatus::AUDIO_HW_ERROR;
+        }
+        _midi_input_ports.push_back(port);
+    }
+    for (int i = 0; i < outputs; ++i)
+    {
+        auto port = jack_port_register(_client,
+                                       std::string("midi_output_" + std::to_string(i)).c_str(),
+                                       JACK_DEFAULT_MIDI_TYPE,
+                                       JackPortIsOutput,
+                                       0);
+        if (port == nullptr)
+        {
+            SUSHI_LOG_ERROR("Failed to open Jack midi output port {}.", i);
+            return AudioFrontendStatus::AUDIO_HW_ERROR;
+        }
+        _midi_output_ports.push_back(port);
+    }
+    _midi_input_read_index.resize(_midi_input_ports.size(), 0);
+    _midi_output_last_frame.resize(_midi_output_ports.size(), 0);
+    return AudioFrontendStatus::OK;
+}
+
 /*
  * Searches for external ports and tries to autoconnect them with sushis ports.
  */
@@ -268,11 +340,6 @@ AudioFrontendStatus JackFrontend::connect_ports()
 int JackFrontend::internal_process_callback(jack_nframes_t framecount)
 {
     set_flush_denormals_to_zero();
-    if (framecount < 64 || framecount % 64)
-    {
-        SUSHI_LOG_CRITICAL("Chunk size not a multiple of AUDIO_CHUNK_SIZE. Skipping.");
-        return 0;
-    }
     jack_nframes_t 	current_frames{0};
     jack_time_t 	current_usecs{0};
     jack_time_t 	next_usecs{0};
@@ -281,17 +348,43 @@ int JackFrontend::internal_process_callback(jack_nframes_t framecount)
     {
         SUSHI_LOG_ERROR("Error getting time from jack frontend");
     }
-    /* Process in chunks of AUDIO_CHUNK_SIZE */
     Time start_time = std::chrono::microseconds(current_usecs);
+    process_midi_output(framecount, start_time);
+    update_active_ports();
+    std::fill(_midi_input_read_index.begin(), _midi_input_read_index.end(), 0);
+    if (_reblocking)
+    {
+        process_reblocked(framecount, start_time, current_frames);
+        return 0;
+    }
+    /* Process in chunks of AUDIO_CHUNK_SIZE */
     for (jack_nframes_t frame = 0; frame < framecount; frame += AUDIO_CHUNK_SIZE)
     {
-        Time delta_time = std::chrono::microseconds((frame * 1'000'000) / _sample_rate);
-        _engine->update_time(start_time + delta_time, current_frames + frame);
-        process_audio(frame, AUDIO_CHUNK_SIZE);
+        Time chunk_time = start_time + frames_to_time(frame);
+        _engine->update_time(chunk_time, current_frames + frame);
+        process_midi_input(frame, frame + AUDIO_CHUNK_SIZE, framecount, chunk_time);
+        process_audio(frame, framecount);
     }
     return 0;
 }
 
+int JackFrontend::internal_buffer_size_callback(jack_nframes_t buffer_size)
+{
+    /* Periods that are not a multiple of the chunk size are passed through an
+     * intermediate buffer, which delays the audio by one chunk */
+    bool reblocking = buffer_size % AUDIO_CHUNK_SIZE != 0;
+    if (reblocking)
+    {
+        SUSHI_LOG_INFO("Jack period of {} frames is not a multiple of {}, adding {} frames of latency",
+                       buffer_size, AUDIO_CHUNK_SIZE, AUDIO_CHUNK_SIZE);
+    }
+    _reblocking = reblocking;
+    _reblock_position = 0;
+    _out_buffer.clear();
+    _cv_out_buffer.clear();
+    return 0;
+}
+
 int JackFrontend::internal_samplerate_callback(jack_nframes_t sample_rate)
 {
     /* It's not fully clear if this is needed since the sample rate can't
@@ -322,37 +415,290 @@ void JackFrontend::internal_latency_callback(jack_latency_callback_mode_t mode)
             jack_port_get_latency_range(port, JackPlaybackLatency, &range);
             sample_latency = std::max(sample_latency, static_cast<int>(range.max));
         }
+        sample_latency += extra_latency();
         Time latency = std::chrono::microseconds((sample_latency * 1'000'000) / _sample_rate);
         _engine->set_output_latency(latency);
         SUSHI_LOG_INFO("Updated output latency: {} samples, {} ms", sample_latency, latency.count() / 1000.0f);
     }
+    /* Let Jack know about the latency added by re-blocking, so that other clients can
+     * compensate for it. Every input is assumed to be routed to every output. */
+    if (_reblocking)
+    {
+        auto& from_ports = mode == JackPlaybackLatency ? _output_ports : _input_ports;
+        auto& to_ports = mode == JackPlaybackLatency ? _input_ports : _output_ports;
+        jack_latency_range_t range{0, 0};
+        jack_latency_range_t port_range;
+        for (auto& port : from_ports)
+        {
+            jack_port_get_latency_range(port, mode, &port_range);
+            range.min = std::max(range.min, port_range.min);
+            range.max = std::max(range.max, port_range.max);
+        }
+        range.min += extra_latency();
+        range.max += extra_latency();
+        for (auto& port : to_ports)
+        {
+            jack_port_set_latency_range(port, mode, &range);
+        }
+    }
+}
+
+void JackFrontend::update_active_ports()
+{
+    /* Recorder taps can be added while running, unlike track connections */
+    auto recorder = _engine->recorder();
+    int recorded_inputs = recorder != nullptr ? recorder->engine_input_channels() : 0;
+    for (size_t i = 0; i < _input_ports.size(); ++i)
+    {
+        bool routed = _engine_input_routed[i] || static_cast<int>(i) < recorded_inputs;
+        bool active = routed && jack_port_connected(_input_ports[i]) > 0;
+        if (active == false && _input_port_active[i])
+        {
+            /* Port was disconnected, silence the channel once instead of copying silence */
+            std::fill(_in_buffer.channel(i), _in_buffer.channel(i) + AUDIO_CHUNK_SIZE, 0.0f);
+        }
+        _input_port_active[i] = active;
+    }
+    for (size_t i = 0; i < _output_ports.size(); ++i)
+    {
+        _output_port_active[i] = jack_port_connected(_output_ports[i]) > 0;
+    }
 }
 
 void inline JackFrontend::process_audio(jack_nframes_t start_frame, jack_nframes_t frame_count)
 {
-    /* Copy jack buffer data to internal buffers */
+    copy_from_ports(start_frame, 0, AUDIO_CHUNK_SIZE, frame_count);
+    process_chunk();
+    copy_to_ports(start_frame, 0, AUDIO_CHUNK_SIZE, frame_count);
+}
+
+void JackFrontend::process_reblocked(jack_nframes_t frame_count, Time start_time, int64_t start_samples)
+{
+    /* Input is accumulated and output drained one chunk behind, so a chunk is
+     * processed whenever enough input has been collected, independent of how the
+     * chunks line up with the Jack periods */
+    jack_nframes_t frame = 0;
+    while (frame < frame_count)
+    {
+        int samples = std::min(AUDIO_CHUNK_SIZE - _reblock_position, static_cast<int>(frame_count - frame));
+        copy_to_ports(frame, _reblock_position, samples, frame_count);
+        copy_from_ports(frame, _reblock_position, samples, frame_count);
+        frame += samples;
+        _reblock_position += samples;
+        if (_reblock_position == AUDIO_CHUNK_SIZE)
+        {
+            int chunk_start = static_cast<int>(frame) - AUDIO_CHUNK_SIZE;
+            Time chunk_time = start_time + frames_to_time(chunk_start);
+            _engine->update_time(chunk_time, start_samples + chunk_start);
+            process_midi_input(chunk_start, frame, frame_count, chunk_time);
+            process_chunk();
+            _reblock_position = 0;
+        }
+    }
+    /* Midi events after the last chunk boundary belong to the next chunk. The engine
+     * queues them until then, while the Jack buffers are only valid during this period */
+    int chunk_start = static_cast<int>(frame_count) - _reblock_position;
+    process_midi_input(chunk_start, frame_count, frame_count, start_time + frames_to_time(chunk_start));
+}
+
+void JackFrontend::process_chunk()
+{
+    /* The engine clears the output buffer before writing to it */
+    _engine->process_chunk(&_in_buffer, &_out_buffer, &_in_controls, &_out_controls);
+    /* The jack frontend both inputs and outputs cv in audio range [-1, 1] */
+    for (int i = 0; i < _no_cv_output_ports; ++i)
+    {
+        if (_engine->audio_rate_cv())
+        {
+            const auto& cv_data = _out_controls.cv_samples[i];
+            std::transform(cv_data.begin(), cv_data.end(), _cv_out_buffer.channel(i), map_cv_to_audio);
+            _cv_output_hist[i] = map_cv_to_audio(cv_data.back());
+        }
+        else
+        {
+            _cv_output_hist[i] = ramp_cv_output(_cv_out_buffer.channel(i), _cv_output_hist[i], map_cv_to_audio(_out_controls.cv_values[i]));
+        }
+    }
+}
+
+void JackFrontend::copy_from_ports(jack_nframes_t start_frame, int chunk_offset, int samples, jack_nframes_t frame_count)
+{
+    /* Ports that are either not connected in Jack or not routed in the engine are skipped */
     for (size_t i = 0; i < _input_ports.size(); ++i)
     {
-        float* in_data = static_cast<float*>(jack_port_get_buffer(_input_ports[i], frame_count)) + start_frame;
-        std::copy(in_data, in_data + AUDIO_CHUNK_SIZE, _in_buffer.channel(i));
+        if (_input_port_active[i])
+        {
+            float* in_data = static_cast<float*>(jack_port_get_buffer(_input_ports[i], frame_count)) + start_frame;
+            std::copy(in_data, in_data + samples, _in_buffer.channel(i) + chunk_offset);
+        }
     }
     for (int i = 0; i < _no_cv_input_ports; ++i)
     {
         float* in_data = static_cast<float*>(jack_port_get_buffer(_cv_input_ports[i], frame_count)) + start_frame;
-        _in_controls.cv_values[i] = map_audio_to_cv(in_data[AUDIO_CHUNK_SIZE - 1]);
+        _in_controls.cv_values[i] = map_audio_to_cv(in_data[samples - 1]);
+        if (_engine->audio_rate_cv())
+        {
+            std::transform(in_data, in_data + samples, _in_controls.cv_samples[i].begin() + chunk_offset, map_audio_to_cv);
+        }
     }
-    _out_buffer.clear();
-    _engine->process_chunk(&_in_buffer, &_out_buffer, &_in_controls, &_out_controls);
-    for (size_t i = 0; i < _input_ports.size(); ++i)
+}
+
+void JackFrontend::copy_to_ports(jack_nframes_t start_frame, int chunk_offset, int samples, jack_nframes_t frame_count)
+{
+    for (size_t i = 0; i < _output_ports.size(); ++i)
     {
+        if (_output_port_active[i] == false)
+        {
+            continue;
+        }
         float* out_data = static_cast<float*>(jack_port_get_buffer(_output_ports[i], frame_count)) + start_frame;
-        std::copy(_out_buffer.channel(i), _out_buffer.channel(i) + AUDIO_CHUNK_SIZE, out_data);
+        if (_engine_output_routed[i])
+        {
+            const float* chunk_data = _out_buffer.channel(i) + chunk_offset;
+            std::copy(chunk_data, chunk_data + samples, out_data);
+        }
+        else
+        {
+            std::fill(out_data, out_data + samples, 0.0f);
+        }
     }
-    /* The jack frontend both inputs and outputs cv in audio range [-1, 1] */
     for (int i = 0; i < _no_cv_output_ports; ++i)
     {
         float* out_data = static_cast<float*>(jack_port_get_buffer(_cv_output_ports[i], frame_count)) + start_frame;
-        _cv_output_hist[i] = ramp_cv_output(out_data, _cv_output_hist[i], map_cv_to_audio(_out_controls.cv_values[i]));
+        const float* chunk_data = _cv_out_buffer.channel(i) + chunk_offset;
+        std::copy(chunk_data, chunk_data + samples, out_data);
+    }
+}
+
+void JackFrontend::process_midi_input(int chunk_start, jack_nframes_t end_frame, jack_nframes_t frame_count, Time chunk_time)
+{
+    if (_midi_frontend == nullptr)
+    {
+        return;
+    }
+    for (size_t i = 0; i < _midi_input_ports.size(); ++i)
+    {
+        void* buffer = jack_port_get_buffer(_midi_input_ports[i], frame_count);
+        uint32_t event_count = jack_midi_get_event_count(buffer);
+        auto& index = _midi_input_read_index[i];
+        jack_midi_event_t event;
+        /* Only the events belonging to this chunk, the rest are picked up on the following calls */
+        for (; index < event_count && jack_midi_event_get(&event, buffer, index) == 0; ++index)
+        {
+            if (event.time >= end_frame)
+            {
+                break;
+            }
+            if (event.size == 0)
+            {
+                continue;
+            }
+            int offset = std::max(0, static_cast<int>(event.time) - chunk_start);
+            if (event.size >= MidiDataByte().size())
+            {
+                _defer_sysex(static_cast<int>(i), event, chunk_time + frames_to_time(offset));
+                continue;
+            }
+            auto data = midi::to_midi_data_byte(event.buffer, static_cast<int>(event.size));
+            if (_midi_frontend->_receiver->send_midi_rt(static_cast<int>(i), data, offset) == false)
+            {
+                Time timestamp = chunk_time + frames_to_time(offset);
+                _midi_frontend->_deferred_input_queue.push({static_cast<int>(i), data, timestamp});
+            }
+        }
+    }
+}
+
+void JackFrontend::process_midi_output(jack_nframes_t frame_count, Time cycle_time)
+{
+    for (size_t i = 0; i < _midi_output_ports.size(); ++i)
+    {
+        jack_midi_clear_buffer(jack_port_get_buffer(_midi_output_ports[i], frame_count));
+        _midi_output_last_frame[i] = 0;
+    }
+    if (_midi_frontend == nullptr)
+    {
+        return;
+    }
+    /* Outgoing events are timestamped from a previous cycle, delaying them by one period
+     * keeps their relative timing sample accurate */
+    Time period = std::chrono::microseconds((frame_count * 1'000'000) / _sample_rate);
+    JackMidiMessage message;
+    while (_pending_midi_output || _midi_frontend->_output_queue.pop(message))
+    {
+        if (_pending_midi_output)
+        {
+            message = *_pending_midi_output;
+            _pending_midi_output.reset();
+        }
+        auto offset = ((message.timestamp + period - cycle_time).count() * static_cast<int64_t>(_sample_rate)) / 1'000'000;
+        if (offset >= static_cast<int64_t>(frame_count))
+        {
+            /* Due in a later cycle */
+            _pending_midi_output = message;
+            break;
+        }
+        int size = midi::message_size(message.data);
+        if (message.port < 0 || message.port >= static_cast<int>(_midi_output_ports.size()) || size == 0)
+        {
+            continue;
+        }
+        /* Jack requires events to be written in order */
+        auto frame = std::max(static_cast<jack_nframes_t>(std::max<int64_t>(offset, 0)), _midi_output_last_frame[message.port]);
+        void* buffer = jack_port_get_buffer(_midi_output_ports[message.port], frame_count);
+        jack_midi_event_write(buffer, frame, message.data.data(), size);
+        _midi_output_last_frame[message.port] = frame;
+    }
+}
+
+void JackFrontend::_defer_sysex(int port, const jack_midi_event_t& event, Time timestamp)
+{
+    if (event.buffer[0] != midi::SYSEX_START || static_cast<int>(event.size) > midi::MAX_SYSEX_SIZE)
+    {
+        return;
+    }
+    auto data = _midi_frontend->_sysex_ring.allocate(static_cast<int>(event.size));
+    if (data == nullptr)
+    {
+        return;
+    }
+    std::copy(event.buffer, event.buffer + event.size, data);
+    if (_midi_frontend->_deferred_sysex_queue.push({port, data, static_cast<int>(event.size), timestamp}) == false)
+    {
+        RtTransferRing::release(data);
+    }
+}
+
+JackMidiFrontend::JackMidiFrontend(midi_receiver::MidiReceiver* receiver,
+                                   JackFrontend* audio_frontend) : BaseMidiFrontend(receiver),
+                                                                   _audio_frontend(audio_frontend)
+{}
+
+bool JackMidiFrontend::init()
+{
+    return _audio_frontend->set_midi_frontend(this);
+}
+
+void JackMidiFrontend::send_midi(int output, MidiDataByte data, Time timestamp)
+{
+    if (_output_queue.push({output, data, timestamp}) == false)
+    {
+        SUSHI_LOG_WARNING("Jack midi output queue full, dropping message");
+    }
+}
+
+void JackMidiFrontend::process_deferred_input()
+{
+    JackMidiMessage message;
+    while (_deferred_input_queue.pop(message))
+    {
+        _receiver->send_deferred_midi(message.port, message.data, message.timestamp);
+    }
+    JackSysexMessage sysex;
+    while (_deferred_sysex_queue.pop(sysex))
+    {
+        _receiver->send_sysex(sysex.port, sysex.data, sysex.size, sysex.timestamp);
+        RtTransferRing::release(sysex.data);
     }
 }
 
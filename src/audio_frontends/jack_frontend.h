@@ -22,12 +22,20 @@
 #define SUSHI_JACK_FRONTEND_H
 #ifdef SUSHI_BUILD_WITH_JACK
 
+#include <atomic>
 #include <string>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include <jack/jack.h>
+#include <jack/midiport.h>
+
+#include "fifo/circularfifo_memory_relaxed_aquire_release.h"
+#include "library/rt_transfer_ring.h"
 
 #include "base_audio_frontend.h"
+#include "control_frontends/base_midi_frontend.h"
 
 namespace sushi {
 namespace audio_frontend {
@@ -38,11 +46,15 @@ struct JackFrontendConfiguration : public BaseAudioFrontendConfiguration
                               const std::string& server_name,
                               bool autoconnect_ports,
                               int cv_inputs,
-                              int cv_outputs) :
+                              int cv_outputs,
+                              int midi_inputs = 0,
+                              int midi_outputs = 0) :
             BaseAudioFrontendConfiguration(cv_inputs, cv_outputs),
             client_name(client_name),
             server_name(server_name),
-            autoconnect_ports(autoconnect_ports)
+            autoconnect_ports(autoconnect_ports),
+            midi_inputs(midi_inputs),
+            midi_outputs(midi_outputs)
     {}
 
     virtual ~JackFrontendConfiguration() = default;
@@ -50,6 +62,65 @@ struct JackFrontendConfiguration : public BaseAudioFrontendConfiguration
     std::string client_name;
     std::string server_name;
     bool autoconnect_ports;
+    int midi_inputs;
+    int midi_outputs;
+};
+
+constexpr int JACK_MIDI_QUEUE_SIZE = 256;
+
+struct JackMidiMessage
+{
+    int port;
+    MidiDataByte data;
+    Time timestamp;
+};
+
+/* Sysex messages are copied from the Jack buffers to slices of a transfer ring */
+struct JackSysexMessage
+{
+    int port;
+    uint8_t* data;
+    int size;
+    Time timestamp;
+};
+
+class JackFrontend;
+
+/**
+ * @brief Midi frontend for the midi ports of the Jack frontend. The ports are read
+ *        and written from the Jack process callback, so that incoming midi is sent
+ *        to the engine with sample accurate offsets and without an extra thread.
+ */
+class JackMidiFrontend : public midi_frontend::BaseMidiFrontend
+{
+public:
+    JackMidiFrontend(midi_receiver::MidiReceiver* receiver, JackFrontend* audio_frontend);
+
+    /**
+     * @brief Attach to the audio frontend, must be called before the audio frontend is started
+     * @return true if the audio frontend has midi ports configured
+     */
+    bool init() override;
+
+    void run() override {}
+
+    void stop() override {}
+
+    void send_midi(int output, MidiDataByte data, Time timestamp) override;
+
+    void process_deferred_input() override;
+
+private:
+    friend class JackFrontend;
+
+    JackFrontend* _audio_frontend;
+    /* Outgoing messages from the midi dispatcher to the process callback */
+    memory_relaxed_aquire_release::CircularFifo<JackMidiMessage, JACK_MIDI_QUEUE_SIZE> _output_queue;
+    /* Incoming messages that could not be dispatched from the process callback */
+    memory_relaxed_aquire_release::CircularFifo<JackMidiMessage, JACK_MIDI_QUEUE_SIZE> _deferred_input_queue;
+    /* Incoming sysex messages, here the process callback is the producer of the ring */
+    memory_relaxed_aquire_release::CircularFifo<JackSysexMessage, JACK_MIDI_QUEUE_SIZE> _deferred_sysex_queue;
+    RtTransferRing _sysex_ring;
 };
 
 class JackFrontend : public BaseAudioFrontend
@@ -85,6 +156,17 @@ public:
         return static_cast<JackFrontend*>(arg)->internal_samplerate_callback(nframes);
     }
 
+    /**
+     * @brief Callback for changes of the Jack period size
+     * @param nframes New period size in frames
+     * @param arg Pointer to the JackFrontend instance.
+     * @return
+     */
+    static int buffer_size_callback(jack_nframes_t nframes, void *arg)
+    {
+        return static_cast<JackFrontend*>(arg)->internal_buffer_size_callback(nframes);
+    }
+
     static void latency_callback(jack_latency_callback_mode_t mode, void *arg)
     {
         return static_cast<JackFrontend*>(arg)->internal_latency_callback(mode);
@@ -107,36 +189,93 @@ public:
      */
     void run() override;
 
+    /**
+     * @brief Attach a midi frontend that reads and writes the Jack midi ports.
+     *        Must be called before run().
+     * @return false if no midi ports are configured
+     */
+    bool set_midi_frontend(JackMidiFrontend* midi_frontend);
+
 private:
     /* Set up the jack client and associated ports */
     AudioFrontendStatus setup_client(const std::string& client_name, const std::string& server_name);
     AudioFrontendStatus setup_sample_rate();
     AudioFrontendStatus setup_ports();
     AudioFrontendStatus setup_cv_ports();
+    AudioFrontendStatus setup_midi_ports(int inputs, int outputs);
     /* Call after activation to connect the frontend ports to system ports */
     AudioFrontendStatus connect_ports();
 
     /* Internal process callback function */
     int internal_process_callback(jack_nframes_t framecount);
     int internal_samplerate_callback(jack_nframes_t sample_rate);
+    int internal_buffer_size_callback(jack_nframes_t buffer_size);
     void internal_latency_callback(jack_latency_callback_mode_t mode);
 
+    /* Check which audio ports need to be copied this period */
+    void update_active_ports();
+
     void process_audio(jack_nframes_t start_frame, jack_nframes_t frame_count);
 
+    /* Process periods that are not a multiple of AUDIO_CHUNK_SIZE */
+    void process_reblocked(jack_nframes_t frame_count, Time start_time, int64_t start_samples);
+
+    void process_chunk();
+
+    /* Copy samples between the Jack ports and the chunk buffers, starting at chunk_offset in the chunk */
+    void copy_from_ports(jack_nframes_t start_frame, int chunk_offset, int samples, jack_nframes_t frame_count);
+
+    void copy_to_ports(jack_nframes_t start_frame, int chunk_offset, int samples, jack_nframes_t frame_count);
+
+    /* chunk_start is relative to the start of the period and negative if the chunk
+     * started in a previous period. Events up until end_frame are processed */
+    void process_midi_input(int chunk_start, jack_nframes_t end_frame, jack_nframes_t frame_count, Time chunk_time);
+
+    void process_midi_output(jack_nframes_t frame_count, Time cycle_time);
+
+    void _defer_sysex(int port, const jack_midi_event_t& event, Time timestamp);
+
+    Time frames_to_time(int frames) const
+    {
+        return std::chrono::microseconds((frames * int64_t(1'000'000)) / _sample_rate);
+    }
+
+    /* Latency in frames added on top of the Jack period */
+    int extra_latency() const
+    {
+        return _reblocking ? AUDIO_CHUNK_SIZE : 0;
+    }
+
     std::array<jack_port_t*, MAX_FRONTEND_CHANNELS> _input_ports;
     std::array<jack_port_t*, MAX_FRONTEND_CHANNELS> _output_ports;
-    std::array<jack_port_t*, MAX_ENGINE_CV_IO_PORTS> _cv_input_ports;
-    std::array<jack_port_t*, MAX_ENGINE_CV_IO_PORTS> _cv_output_ports;
-    std::array<float, MAX_ENGINE_CV_IO_PORTS> _cv_output_hist{0};
+    std::vector<jack_port_t*> _cv_input_ports;
+    std::vector<jack_port_t*> _cv_output_ports;
+    std::vector<float> _cv_output_hist;
+    std::array<bool, MAX_FRONTEND_CHANNELS> _engine_input_routed{false};
+    std::array<bool, MAX_FRONTEND_CHANNELS> _engine_output_routed{false};
+    std::array<bool, MAX_FRONTEND_CHANNELS> _input_port_active{false};
+    std::array<bool, MAX_FRONTEND_CHANNELS> _output_port_active{false};
     int _no_cv_input_ports;
     int _no_cv_output_ports;
 
+    std::vector<jack_port_t*> _midi_input_ports;
+    std::vector<jack_port_t*> _midi_output_ports;
+    std::vector<uint32_t>     _midi_input_read_index;
+    std::vector<jack_nframes_t> _midi_output_last_frame;
+    std::optional<JackMidiMessage> _pending_midi_output;
+    JackMidiFrontend*         _midi_frontend{nullptr};
+
     jack_client_t* _client{nullptr};
     jack_nframes_t _sample_rate;
     bool _autoconnect_ports{false};
 
+    /* Set if the Jack period is not a multiple of AUDIO_CHUNK_SIZE */
+    std::atomic<bool> _reblocking{false};
+    int _reblock_position{0};
+
     SampleBuffer<AUDIO_CHUNK_SIZE> _in_buffer{MAX_FRONTEND_CHANNELS};
     SampleBuffer<AUDIO_CHUNK_SIZE> _out_buffer{MAX_FRONTEND_CHANNELS};
+    SampleBuffer<AUDIO_CHUNK_SIZE> _cv_out_buffer;
     engine::ControlBuffer          _in_controls;
     engine::ControlBuffer          _out_controls;
 };
@@ -150,6 +289,7 @@ private:
    this dummy frontend whose only purpose is to assert if you try to use it */
 #include <string>
 #include "base_audio_frontend.h"
+#include "control_frontends/base_midi_frontend.h"
 #include "engine/midi_dispatcher.h"
 namespace sushi {
 namespace audio_frontend {
@@ -157,7 +297,7 @@ struct JackFrontendConfiguration : public BaseAudioFrontendConfiguration
 {
     JackFrontendConfiguration(const std::string&,
                               const std::string&,
-                              bool, int, int) : BaseAudioFrontendConfiguration(0, 0) {}
+                              bool, int, int, int = 0, int = 0) : BaseAudioFrontendConfiguration(0, 0) {}
 };
 
 class JackFrontend : public BaseAudioFrontend
@@ -169,6 +309,16 @@ public:
     void cleanup() override {}
     void run() override {}
 };
+
+class JackMidiFrontend : public midi_frontend::BaseMidiFrontend
+{
+public:
+    JackMidiFrontend(midi_receiver::MidiReceiver* receiver, JackFrontend*) : BaseMidiFrontend(receiver) {}
+    bool init() override {return false;}
+    void run() override {}
+    void stop() override {}
+    void send_midi(int, MidiDataByte, Time) override {}
+};
 }; // end namespace jack_frontend
 }; // end namespace sushi
 #endif
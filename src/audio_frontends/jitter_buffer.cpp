@@ -0,0 +1,288 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Adaptive jitter buffer for audio chunks received over a network
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "jitter_buffer.h"
+
+namespace sushi {
+namespace audio_frontend {
+
+JitterBuffer::JitterBuffer(int channels, int min_latency) : _channels(channels),
+                                                            _min_latency((std::clamp(min_latency, 1, JITTER_BUFFER_MAX_CHUNKS / 2) + 1) * AUDIO_CHUNK_SIZE),
+                                                            _max_latency((JITTER_BUFFER_MAX_CHUNKS - 2) * AUDIO_CHUNK_SIZE),
+                                                            _target(_min_latency)
+{
+    for (auto& chunk : _chunks)
+    {
+        chunk.data.resize(channels * AUDIO_CHUNK_SIZE, 0.0f);
+    }
+    _last_output.resize(channels * AUDIO_CHUNK_SIZE, 0.0f);
+}
+
+void JitterBuffer::push(uint32_t sequence, int64_t timestamp, double arrival_time, const float* data, int channels)
+{
+    int64_t extended = _extend(sequence);
+    int64_t first_storable = _prepared + 1;
+    if (_playing == false)
+    {
+        first_storable = std::max(first_storable, _newest - JITTER_BUFFER_MAX_CHUNKS + 1);
+    }
+    if (extended < first_storable)
+    {
+        if (first_storable - extended <= JITTER_BUFFER_MAX_CHUNKS)
+        {
+            _late_chunks++;
+            return;
+        }
+        /* Far behind anything played so far, the sender has most likely restarted */
+        reset();
+        extended = sequence;
+    }
+    if (_has_chunk(extended))
+    {
+        return;
+    }
+    if (_playing && extended - _prepared >= JITTER_BUFFER_MAX_CHUNKS)
+    {
+        /* The sender is too far ahead to fit in the buffer, skip forward */
+        _stop();
+        _has_transit = false;
+    }
+
+    _update_jitter(timestamp, arrival_time);
+    auto& chunk = _chunk(extended);
+    chunk.sequence = extended;
+    for (int c = 0; c < _channels; ++c)
+    {
+        float* dest = chunk.data.data() + c * AUDIO_CHUNK_SIZE;
+        if (c < channels)
+        {
+            std::copy(data + c * AUDIO_CHUNK_SIZE, data + (c + 1) * AUDIO_CHUNK_SIZE, dest);
+        }
+        else
+        {
+            std::fill(dest, dest + AUDIO_CHUNK_SIZE, 0.0f);
+        }
+    }
+    _newest = std::max(_newest, extended);
+    if (_playing == false)
+    {
+        _oldest = _oldest < 0 ? extended : std::min(_oldest, extended);
+        _oldest = std::max(_oldest, _newest - JITTER_BUFFER_MAX_CHUNKS + 1);
+    }
+    _received_chunks++;
+}
+
+void JitterBuffer::pop(ChunkSampleBuffer& buffer)
+{
+    int channels = std::min(_channels, buffer.channel_count());
+    if (_playing == false)
+    {
+        _maybe_start();
+    }
+    if (_playing == false)
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            std::fill(buffer.channel(c), buffer.channel(c) + AUDIO_CHUNK_SIZE, 0.0f);
+        }
+        return;
+    }
+
+    _update_rate();
+    int64_t end_position = _read_position + static_cast<int64_t>(std::ceil(_read_fraction + AUDIO_CHUNK_SIZE * _rate));
+    if (end_position > (_newest + 1) * AUDIO_CHUNK_SIZE)
+    {
+        _conceal_underrun(buffer, channels);
+        return;
+    }
+
+    for (int n = 0; n < AUDIO_CHUNK_SIZE; ++n)
+    {
+        if (_read_position / AUDIO_CHUNK_SIZE > _prepared)
+        {
+            _prepare(_read_position / AUDIO_CHUNK_SIZE);
+        }
+        /* Interpolate towards the next sample if it's available, otherwise hold the current one */
+        int64_t next_position = _read_position + 1;
+        int64_t next_chunk = next_position / AUDIO_CHUNK_SIZE;
+        if (next_chunk > _prepared && _has_chunk(next_chunk))
+        {
+            _prepare(next_chunk);
+        }
+        if (next_chunk > _prepared)
+        {
+            next_position = _read_position;
+        }
+        float fraction = static_cast<float>(_read_fraction);
+        for (int c = 0; c < channels; ++c)
+        {
+            float current = _sample(_read_position, c);
+            buffer.channel(c)[n] = current + fraction * (_sample(next_position, c) - current);
+        }
+        _read_fraction += _rate;
+        auto step = static_cast<int64_t>(_read_fraction);
+        _read_position += step;
+        _read_fraction -= step;
+    }
+    for (int c = 0; c < channels; ++c)
+    {
+        std::copy(buffer.channel(c), buffer.channel(c) + AUDIO_CHUNK_SIZE, _last_output.data() + c * AUDIO_CHUNK_SIZE);
+    }
+}
+
+void JitterBuffer::reset()
+{
+    for (auto& chunk : _chunks)
+    {
+        chunk.sequence = -1;
+    }
+    _playing = false;
+    _newest = -1;
+    _oldest = -1;
+    _prepared = -1;
+    _read_position = 0;
+    _read_fraction = 0;
+    _consecutive_concealed = 0;
+    _has_transit = false;
+    _jitter = 0;
+    _target = _min_latency;
+    _fill_average = 0;
+    _drift = 0;
+    _rate = 1.0;
+    std::fill(_last_output.begin(), _last_output.end(), 0.0f);
+}
+
+int64_t JitterBuffer::_extend(uint32_t sequence) const
+{
+    if (_newest < 0)
+    {
+        return sequence;
+    }
+    return _newest + static_cast<int32_t>(sequence - static_cast<uint32_t>(_newest));
+}
+
+void JitterBuffer::_update_jitter(int64_t timestamp, double arrival_time)
+{
+    /* Interarrival jitter estimate as described in RFC 3550 */
+    double transit = arrival_time - static_cast<double>(timestamp);
+    if (_has_transit)
+    {
+        _jitter += (std::abs(transit - _last_transit) - _jitter) / 16.0;
+    }
+    _last_transit = transit;
+    _has_transit = true;
+    _target = std::clamp(_min_latency + JITTER_BUFFER_JITTER_MARGIN * _jitter, _min_latency, _max_latency);
+}
+
+void JitterBuffer::_update_rate()
+{
+    double fill = static_cast<double>((_newest + 1) * AUDIO_CHUNK_SIZE - _read_position) - _read_fraction;
+    _fill_average += JITTER_BUFFER_FILL_SMOOTHING * (fill - _fill_average);
+    /* PI control of the latency, the integral part converges to the clock drift between sender and receiver */
+    double error = _fill_average - _target;
+    _drift = std::clamp(_drift + JITTER_BUFFER_DRIFT_INTEGRAL_GAIN * error,
+                        -JITTER_BUFFER_MAX_DRIFT_CORRECTION,
+                        JITTER_BUFFER_MAX_DRIFT_CORRECTION);
+    _rate = 1.0 + std::clamp(_drift + JITTER_BUFFER_DRIFT_PROPORTIONAL_GAIN * error,
+                             -JITTER_BUFFER_MAX_DRIFT_CORRECTION,
+                             JITTER_BUFFER_MAX_DRIFT_CORRECTION);
+}
+
+void JitterBuffer::_conceal_underrun(ChunkSampleBuffer& buffer, int channels)
+{
+    for (int c = 0; c < _channels; ++c)
+    {
+        float* data = _last_output.data() + c * AUDIO_CHUNK_SIZE;
+        for (int n = 0; n < AUDIO_CHUNK_SIZE; ++n)
+        {
+            data[n] *= 1.0f + (JITTER_BUFFER_CONCEALMENT_DECAY - 1.0f) * n / AUDIO_CHUNK_SIZE;
+        }
+        if (c < channels)
+        {
+            std::copy(data, data + AUDIO_CHUNK_SIZE, buffer.channel(c));
+        }
+    }
+    _concealed_chunks++;
+    if (++_consecutive_concealed >= JITTER_BUFFER_MAX_CONCEALED_CHUNKS)
+    {
+        /* Nothing is being received, wait until the buffer is filled up again */
+        _stop();
+    }
+}
+
+void JitterBuffer::_maybe_start()
+{
+    if (_oldest < 0 || (_newest + 1 - _oldest) * AUDIO_CHUNK_SIZE < _target)
+    {
+        return;
+    }
+    _read_position = (_newest + 1) * AUDIO_CHUNK_SIZE - static_cast<int64_t>(std::ceil(_target));
+    _read_fraction = 0;
+    _prepared = _read_position / AUDIO_CHUNK_SIZE - 1;
+    _fill_average = _target;
+    _rate = 1.0;
+    _consecutive_concealed = 0;
+    _playing = true;
+}
+
+void JitterBuffer::_stop()
+{
+    _playing = false;
+    _oldest = -1;
+    _consecutive_concealed = 0;
+}
+
+void JitterBuffer::_prepare(int64_t sequence)
+{
+    auto& chunk = _chunk(sequence);
+    if (chunk.sequence == sequence)
+    {
+        _consecutive_concealed = 0;
+    }
+    else
+    {
+        if (sequence > 0 && _has_chunk(sequence - 1))
+        {
+            const auto& previous = _chunk(sequence - 1);
+            for (int c = 0; c < _channels; ++c)
+            {
+                for (int n = 0; n < AUDIO_CHUNK_SIZE; ++n)
+                {
+                    float gain = 1.0f + (JITTER_BUFFER_CONCEALMENT_DECAY - 1.0f) * n / AUDIO_CHUNK_SIZE;
+                    chunk.data[c * AUDIO_CHUNK_SIZE + n] = previous.data[c * AUDIO_CHUNK_SIZE + n] * gain;
+                }
+            }
+        }
+        else
+        {
+            std::fill(chunk.data.begin(), chunk.data.end(), 0.0f);
+        }
+        chunk.sequence = sequence;
+        _concealed_chunks++;
+        _consecutive_concealed++;
+    }
+    _prepared = sequence;
+}
+
+}; // end namespace audio_frontend
+}; // end namespace sushi
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Adaptive jitter buffer for audio chunks received over a network
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_JITTER_BUFFER_H
+#define SUSHI_JITTER_BUFFER_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "library/sample_buffer.h"
+
+namespace sushi {
+namespace audio_frontend {
+
+/* Number of chunks the buffer can hold, this also sets the upper bound of the latency */
+constexpr int JITTER_BUFFER_MAX_CHUNKS = 32;
+/* Consecutive chunks concealed before playback stops and waits for the buffer to fill up again */
+constexpr int JITTER_BUFFER_MAX_CONCEALED_CHUNKS = 8;
+/* Gain at the end of a concealed chunk, relative to the chunk it repeats */
+constexpr float JITTER_BUFFER_CONCEALMENT_DECAY = 0.5f;
+/* Latency added per sample of estimated jitter */
+constexpr double JITTER_BUFFER_JITTER_MARGIN = 3.0;
+/* Max deviation from the nominal playback rate when compensating for clock drift */
+constexpr double JITTER_BUFFER_MAX_DRIFT_CORRECTION = 0.005;
+/* Playback rate correction per sample of deviation from the target latency */
+constexpr double JITTER_BUFFER_DRIFT_PROPORTIONAL_GAIN = 0.0001;
+/* Per chunk change of the drift estimate per sample of deviation from the target latency */
+constexpr double JITTER_BUFFER_DRIFT_INTEGRAL_GAIN = 0.0000001;
+/* Smoothing coefficient of the buffer fill level, applied once per chunk */
+constexpr double JITTER_BUFFER_FILL_SMOOTHING = 0.05;
+
+/**
+ * @brief Reorders audio chunks received from a remote sender and plays them back
+ *        with a latency adapted to the measured network jitter.
+ *        Lost chunks are concealed by repeating the previous chunk while fading out.
+ *        If the buffer runs empty, the last output is repeated the same way while
+ *        waiting for more data, which increases the latency rather than skipping
+ *        ahead. The playback rate is continuously adjusted with linear interpolation
+ *        to keep the latency at its target despite clock drift between the sender
+ *        and the receiver. All memory is allocated on construction, so both push()
+ *        and pop() are safe to call from the rt thread, though not concurrently.
+ */
+class JitterBuffer
+{
+public:
+    /**
+     * @brief Create a jitter buffer
+     * @param channels The number of audio channels
+     * @param min_latency The lowest latency in chunks, not counting the chunk being played.
+     *                    The latency is increased above this when jitter is detected.
+     */
+    JitterBuffer(int channels, int min_latency);
+
+    /**
+     * @brief Add a received chunk. Chunks can arrive in any order, duplicates and chunks
+     *        that arrive too late to be played are discarded.
+     * @param sequence Sequence number of the chunk, incremented by 1 for every chunk sent
+     * @param timestamp Position of the chunk in samples in the sender's timeline
+     * @param arrival_time Time the chunk was received, in samples in the receiver's timeline
+     * @param data Non-interleaved audio data, AUDIO_CHUNK_SIZE samples per channel
+     * @param channels The number of channels in data, missing channels are set to 0
+     */
+    void push(uint32_t sequence, int64_t timestamp, double arrival_time, const float* data, int channels);
+
+    /**
+     * @brief Read one chunk of audio. Outputs silence until enough data is buffered.
+     * @param buffer Output buffer, channels not covered by the jitter buffer are left untouched
+     */
+    void pop(ChunkSampleBuffer& buffer);
+
+    /**
+     * @brief Discard all buffered data and start over from the next chunk received
+     */
+    void reset();
+
+    /**
+     * @brief Returns true if audio is played back, false if buffering
+     */
+    bool playing() const {return _playing;}
+
+    /**
+     * @brief Returns the current target latency in samples, including the chunk being played
+     */
+    double latency() const {return _target;}
+
+    /**
+     * @brief Returns the smoothed number of samples buffered ahead of the playback position
+     */
+    double fill() const {return _fill_average;}
+
+    /**
+     * @brief Returns the rate at which received audio is played back, 1.0 for no drift correction
+     */
+    double playback_rate() const {return _rate;}
+
+    int64_t received_chunks() const {return _received_chunks;}
+    int64_t concealed_chunks() const {return _concealed_chunks;}
+    int64_t late_chunks() const {return _late_chunks;}
+
+private:
+    struct Chunk
+    {
+        int64_t            sequence{-1};
+        std::vector<float> data;
+    };
+
+    /* Extend a wrapping 32 bit sequence number to 64 bits, relative to the newest chunk */
+    int64_t _extend(uint32_t sequence) const;
+
+    Chunk& _chunk(int64_t sequence) {return _chunks[sequence % JITTER_BUFFER_MAX_CHUNKS];}
+
+    bool _has_chunk(int64_t sequence) {return _chunk(sequence).sequence == sequence;}
+
+    float _sample(int64_t position, int channel)
+    {
+        return _chunk(position / AUDIO_CHUNK_SIZE).data[channel * AUDIO_CHUNK_SIZE + position % AUDIO_CHUNK_SIZE];
+    }
+
+    void _update_jitter(int64_t timestamp, double arrival_time);
+
+    void _update_rate();
+
+    /* Repeat the last output while fading out */
+    void _conceal_underrun(ChunkSampleBuffer& buffer, int channels);
+
+    void _maybe_start();
+
+    void _stop();
+
+    /* Make a chunk available for reading, concealing it if it hasn't been received */
+    void _prepare(int64_t sequence);
+
+    int     _channels;
+    double  _min_latency;
+    double  _max_latency;
+    std::array<Chunk, JITTER_BUFFER_MAX_CHUNKS> _chunks;
+    std::vector<float> _last_output;
+
+    bool    _playing{false};
+    int64_t _newest{-1};
+    int64_t _oldest{-1};
+    int64_t _prepared{-1};
+    int64_t _read_position{0};
+    double  _read_fraction{0};
+    int     _consecutive_concealed{0};
+
+    bool    _has_transit{false};
+    double  _last_transit{0};
+    double  _jitter{0};
+    double  _target;
+    double  _fill_average{0};
+    double  _drift{0};
+    double  _rate{1.0};
+
+    int64_t _received_chunks{0};
+    int64_t _concealed_chunks{0};
+    int64_t _late_chunks{0};
+};
+
+}; // end namespace audio_frontend
+}; // end namespace sushi
+
+#endif //SUSHI_JITTER_BUFFER_H
@@ -0,0 +1,358 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Audio frontend streaming audio to and from other hosts over UDP
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "logging.h"
+#include "network_frontend.h"
+#include "audio_frontend_internals.h"
+
+namespace sushi {
+namespace audio_frontend {
+
+SUSHI_GET_LOGGER_WITH_MODULE_NAME("network audio");
+
+/* Parse an ipv4 address on the form "address:port", or only "port" for any address */
+bool parse_socket_address(const std::string& address, sockaddr_in& socket_address)
+{
+    std::string host = "0.0.0.0";
+    std::string port = address;
+    auto separator = address.rfind(':');
+    if (separator != std::string::npos)
+    {
+        host = address.substr(0, separator);
+        port = address.substr(separator + 1);
+    }
+    std::memset(&socket_address, 0, sizeof(socket_address));
+    socket_address.sin_family = AF_INET;
+    if (inet_pton(AF_INET, host.c_str(), &socket_address.sin_addr) != 1)
+    {
+        return false;
+    }
+    char* end;
+    long port_no = std::strtol(port.c_str(), &end, 10);
+    if (port.empty() || *end != '\0' || port_no < 0 || port_no > 65535)
+    {
+        return false;
+    }
+    socket_address.sin_port = htons(static_cast<uint16_t>(port_no));
+    return true;
+}
+
+AudioFrontendStatus NetworkFrontend::init(BaseAudioFrontendConfiguration* config)
+{
+    auto ret_code = BaseAudioFrontend::init(config);
+    if (ret_code != AudioFrontendStatus::OK)
+    {
+        return ret_code;
+    }
+    auto net_config = static_cast<const NetworkFrontendConfiguration*>(_config);
+    if (net_config->channels < 1 || net_config->channels > MAX_FRONTEND_CHANNELS)
+    {
+        SUSHI_LOG_ERROR("Invalid number of channels: {}", net_config->channels);
+        return AudioFrontendStatus::INVALID_N_CHANNELS;
+    }
+    if (net_config->buffer_chunks < 1 || net_config->buffer_chunks > JITTER_BUFFER_MAX_CHUNKS / 2)
+    {
+        SUSHI_LOG_ERROR("Invalid jitter buffer size: {} chunks", net_config->buffer_chunks);
+        return AudioFrontendStatus::INVALID_CHUNK_SIZE;
+    }
+    if (net_config->listen_address.empty() == false)
+    {
+        ret_code = _open_receive_socket(net_config->listen_address);
+        if (ret_code != AudioFrontendStatus::OK)
+        {
+            cleanup();
+            return ret_code;
+        }
+    }
+    if (net_config->send_address.empty() == false)
+    {
+        ret_code = _open_send_socket(net_config->send_address);
+        if (ret_code != AudioFrontendStatus::OK)
+        {
+            cleanup();
+            return ret_code;
+        }
+    }
+
+    _channels = net_config->channels;
+    _engine->set_audio_input_channels(_channels);
+    _engine->set_audio_output_channels(_channels);
+    _in_buffer = ChunkSampleBuffer(_channels);
+    _out_buffer = ChunkSampleBuffer(_channels);
+    _in_controls.resize(0, net_config->gate_inputs);
+    _out_controls.resize(0, net_config->gate_outputs);
+    _jitter_buffer = std::make_unique<JitterBuffer>(_channels, net_config->buffer_chunks);
+    for (auto& packet : _packets)
+    {
+        _free_packets.push(&packet);
+    }
+
+    auto header = reinterpret_cast<NetworkAudioHeader*>(_send_packet.data.data());
+    header->magic = NETWORK_AUDIO_MAGIC;
+    header->version = NETWORK_AUDIO_VERSION;
+    header->channels = static_cast<uint16_t>(_channels);
+    header->chunk_size = AUDIO_CHUNK_SIZE;
+    header->sample_rate = static_cast<uint32_t>(_engine->sample_rate());
+    header->reserved = 0;
+
+    /* Audio is sent as soon as it's processed, latency on the receiving side is set by its jitter buffer */
+    _engine->set_output_latency(std::chrono::microseconds((AUDIO_CHUNK_SIZE * 1'000'000) / static_cast<int>(_engine->sample_rate())));
+    return AudioFrontendStatus::OK;
+}
+
+void NetworkFrontend::cleanup()
+{
+    _running = false;
+    if (_rt_thread.joinable())
+    {
+        _rt_thread.join();
+    }
+    if (_receive_thread.joinable())
+    {
+        _receive_thread.join();
+    }
+    if (_jitter_buffer && _receive_socket >= 0)
+    {
+        SUSHI_LOG_INFO("Network frontend received {} chunks, {} concealed, {} late, {} dropped",
+                       _jitter_buffer->received_chunks(), _jitter_buffer->concealed_chunks(),
+                       _jitter_buffer->late_chunks(), _dropped_packets);
+    }
+    if (_receive_socket >= 0)
+    {
+        close(_receive_socket);
+        _receive_socket = -1;
+    }
+    if (_send_socket >= 0)
+    {
+        close(_send_socket);
+        _send_socket = -1;
+    }
+}
+
+void NetworkFrontend::run()
+{
+    _engine->enable_realtime(true);
+    _running = true;
+    _rt_thread = std::thread(&NetworkFrontend::_rt_loop, this);
+    if (_receive_socket >= 0)
+    {
+        _receive_thread = std::thread(&NetworkFrontend::_receive_loop, this);
+    }
+}
+
+AudioFrontendStatus NetworkFrontend::_open_receive_socket(const std::string& address)
+{
+    sockaddr_in socket_address;
+    if (parse_socket_address(address, socket_address) == false)
+    {
+        SUSHI_LOG_ERROR("Invalid listening address: {}", address);
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    _receive_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_receive_socket < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to create socket: {}", strerror(errno));
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    /* Lets several instances on the same host listen to the same multicast group */
+    int enable = 1;
+    setsockopt(_receive_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    bool multicast = IN_MULTICAST(ntohl(socket_address.sin_addr.s_addr));
+    sockaddr_in bind_address = socket_address;
+    if (multicast)
+    {
+        bind_address.sin_addr.s_addr = htonl(INADDR_ANY);
+    }
+    if (bind(_receive_socket, reinterpret_cast<sockaddr*>(&bind_address), sizeof(bind_address)) != 0)
+    {
+        SUSHI_LOG_ERROR("Failed to bind socket to {}: {}", address, strerror(errno));
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    if (multicast)
+    {
+        ip_mreq request;
+        request.imr_multiaddr = socket_address.sin_addr;
+        request.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(_receive_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) != 0)
+        {
+            SUSHI_LOG_ERROR("Failed to join multicast group {}: {}", address, strerror(errno));
+            return AudioFrontendStatus::AUDIO_HW_ERROR;
+        }
+    }
+    timeval timeout{0, NETWORK_RECEIVE_TIMEOUT_MS * 1000};
+    setsockopt(_receive_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    socklen_t length = sizeof(bind_address);
+    getsockname(_receive_socket, reinterpret_cast<sockaddr*>(&bind_address), &length);
+    _listen_port = ntohs(bind_address.sin_port);
+    SUSHI_LOG_INFO("Receiving audio on {}, port {}", address, _listen_port);
+    return AudioFrontendStatus::OK;
+}
+
+AudioFrontendStatus NetworkFrontend::_open_send_socket(const std::string& address)
+{
+    if (parse_socket_address(address, _send_address) == false || _send_address.sin_port == 0)
+    {
+        SUSHI_LOG_ERROR("Invalid destination address: {}", address);
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    _send_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_send_socket < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to create socket: {}", strerror(errno));
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    if (IN_MULTICAST(ntohl(_send_address.sin_addr.s_addr)))
+    {
+        /* So that other instances on the same host receive the audio too */
+        unsigned char loop = 1;
+        setsockopt(_send_socket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+    SUSHI_LOG_INFO("Sending audio to {}", address);
+    return AudioFrontendStatus::OK;
+}
+
+void NetworkFrontend::_rt_loop()
+{
+    sched_param param;
+    param.sched_priority = NETWORK_RT_PRIORITY;
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0)
+    {
+        SUSHI_LOG_WARNING("Failed to set realtime priority of audio thread: {}", strerror(ret));
+    }
+    set_flush_denormals_to_zero();
+
+    auto chunk_period = std::chrono::nanoseconds(static_cast<int64_t>(AUDIO_CHUNK_SIZE * 1'000'000'000.0 / _engine->sample_rate()));
+    _start_time = get_current_time();
+    _clock_start = std::chrono::steady_clock::now();
+    auto next_chunk_start = _clock_start;
+    while (_running)
+    {
+        _process_chunk();
+        next_chunk_start += chunk_period;
+        std::this_thread::sleep_until(next_chunk_start);
+    }
+}
+
+void NetworkFrontend::_receive_loop()
+{
+    Packet* packet = nullptr;
+    Packet discarded;
+    while (_running)
+    {
+        if (packet == nullptr)
+        {
+            _free_packets.pop(packet);
+        }
+        /* If the audio thread has fallen behind, keep emptying the socket but drop the data */
+        Packet* target = packet ? packet : &discarded;
+        auto size = recv(_receive_socket, target->data.data(), target->data.size(), 0);
+        if (size < 0)
+        {
+            continue;
+        }
+        target->arrival_time = std::chrono::steady_clock::now();
+        if (packet == nullptr)
+        {
+            _dropped_packets++;
+            continue;
+        }
+        if (_valid_packet(*packet, static_cast<int>(size)))
+        {
+            _received_packets.push(packet);
+            packet = nullptr;
+        }
+    }
+}
+
+bool NetworkFrontend::_valid_packet(const Packet& packet, int size)
+{
+    auto header = reinterpret_cast<const NetworkAudioHeader*>(packet.data.data());
+    bool valid = size >= static_cast<int>(sizeof(NetworkAudioHeader)) &&
+                 header->magic == NETWORK_AUDIO_MAGIC &&
+                 header->version == NETWORK_AUDIO_VERSION &&
+                 header->chunk_size == AUDIO_CHUNK_SIZE &&
+                 header->sample_rate == static_cast<uint32_t>(_engine->sample_rate()) &&
+                 header->channels > 0 && header->channels <= MAX_FRONTEND_CHANNELS &&
+                 size == static_cast<int>(sizeof(NetworkAudioHeader) + header->channels * AUDIO_CHUNK_SIZE * sizeof(float));
+    if (valid == false && _invalid_packet_logged == false)
+    {
+        SUSHI_LOG_WARNING("Discarding packets not matching the audio format, check the chunk size and "
+                          "sample rate of the sender");
+        _invalid_packet_logged = true;
+    }
+    return valid;
+}
+
+void NetworkFrontend::_process_chunk()
+{
+    Packet* packet;
+    while (_received_packets.pop(packet))
+    {
+        auto header = reinterpret_cast<const NetworkAudioHeader*>(packet->data.data());
+        std::chrono::duration<double> arrival_time = packet->arrival_time - _clock_start;
+        _jitter_buffer->push(header->sequence,
+                             static_cast<int64_t>(header->timestamp),
+                             arrival_time.count() * _engine->sample_rate(),
+                             reinterpret_cast<const float*>(packet->data.data() + sizeof(NetworkAudioHeader)),
+                             header->channels);
+        _free_packets.push(packet);
+    }
+    _jitter_buffer->pop(_in_buffer);
+
+    Time timestamp = _start_time + std::chrono::microseconds((_sample_count * 1'000'000) / static_cast<int>(_engine->sample_rate()));
+    _engine->update_time(timestamp, _sample_count);
+    _out_buffer.clear();
+    _engine->process_chunk(&_in_buffer, &_out_buffer, &_in_controls, &_out_controls);
+    if (_send_socket >= 0)
+    {
+        _send_chunk();
+    }
+    _sample_count += AUDIO_CHUNK_SIZE;
+}
+
+void NetworkFrontend::_send_chunk()
+{
+    auto header = reinterpret_cast<NetworkAudioHeader*>(_send_packet.data.data());
+    header->sequence = _send_sequence++;
+    header->timestamp = static_cast<uint64_t>(_sample_count);
+    auto data = reinterpret_cast<float*>(_send_packet.data.data() + sizeof(NetworkAudioHeader));
+    for (int c = 0; c < _channels; ++c)
+    {
+        std::copy(_out_buffer.channel(c), _out_buffer.channel(c) + AUDIO_CHUNK_SIZE, data + c * AUDIO_CHUNK_SIZE);
+    }
+    size_t size = sizeof(NetworkAudioHeader) + _channels * AUDIO_CHUNK_SIZE * sizeof(float);
+    /* Never block the audio thread, a packet that doesn't fit in the socket buffer is lost */
+    sendto(_send_socket, _send_packet.data.data(), size, MSG_DONTWAIT,
+           reinterpret_cast<const sockaddr*>(&_send_address), sizeof(_send_address));
+}
+
+}; // end namespace audio_frontend
+}; // end namespace sushi
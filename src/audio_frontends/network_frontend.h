@@ -0,0 +1,185 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Audio frontend streaming audio to and from other hosts over UDP
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_NETWORK_FRONTEND_H
+#define SUSHI_NETWORK_FRONTEND_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+
+#include "fifo/circularfifo_memory_relaxed_aquire_release.h"
+
+#include "base_audio_frontend.h"
+#include "jitter_buffer.h"
+
+namespace sushi {
+namespace audio_frontend {
+
+constexpr int NETWORK_RT_PRIORITY = 75;
+/* How often the receiver thread wakes up to check if it should stop when nothing is received */
+constexpr int NETWORK_RECEIVE_TIMEOUT_MS = 100;
+/* Number of packets that can be queued between the receiver thread and the audio thread */
+constexpr int NETWORK_RECEIVE_QUEUE_SIZE = 16;
+
+constexpr uint32_t NETWORK_AUDIO_MAGIC = 0x53555341; // "SUSA"
+constexpr uint16_t NETWORK_AUDIO_VERSION = 1;
+
+/**
+ * @brief Header of the audio packets. Every packet carries one chunk of audio, with
+ *        sequence number and timestamp as in RTP. The header is followed by chunk_size
+ *        32 bit float samples for each channel, one channel after another. All fields
+ *        are in host byte order, so sender and receiver need to share endianness.
+ */
+struct NetworkAudioHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t channels;
+    uint32_t chunk_size;
+    uint32_t sample_rate;
+    /* Incremented by 1 for every packet sent, wraps around */
+    uint32_t sequence;
+    uint32_t reserved;
+    /* Position of the first sample in the sender's timeline */
+    uint64_t timestamp;
+};
+
+static_assert(sizeof(NetworkAudioHeader) == 32);
+
+constexpr int NETWORK_AUDIO_MAX_PACKET_SIZE = sizeof(NetworkAudioHeader) + MAX_FRONTEND_CHANNELS * AUDIO_CHUNK_SIZE * sizeof(float);
+
+struct NetworkFrontendConfiguration : public BaseAudioFrontendConfiguration
+{
+    NetworkFrontendConfiguration(const std::string& listen_address,
+                                 const std::string& send_address,
+                                 int channels,
+                                 int buffer_chunks) : BaseAudioFrontendConfiguration(0, 0),
+                                                      listen_address(listen_address),
+                                                      send_address(send_address),
+                                                      channels(channels),
+                                                      buffer_chunks(buffer_chunks)
+    {}
+
+    virtual ~NetworkFrontendConfiguration() = default;
+
+    /* "[address:]port" to receive audio on, multicast groups are joined. Empty for no input */
+    std::string listen_address;
+    /* "address:port" to send audio to, unicast or multicast. Empty for no output */
+    std::string send_address;
+    int channels;
+    /* Minimum latency of the jitter buffer in chunks */
+    int buffer_chunks;
+};
+
+/**
+ * @brief Audio frontend that receives its input from and sends its output to other
+ *        hosts, or other instances on the same host, as UDP packets. The audio thread
+ *        is paced by the system clock. Received audio passes through a jitter buffer
+ *        that absorbs network jitter, conceals lost packets and resamples to follow
+ *        the clock of the sender. Cv and gates are not transmitted.
+ */
+class NetworkFrontend : public BaseAudioFrontend
+{
+public:
+    explicit NetworkFrontend(engine::BaseEngine* engine) : BaseAudioFrontend(engine) {}
+
+    virtual ~NetworkFrontend()
+    {
+        cleanup();
+    }
+
+    /**
+     * @brief Initialize the frontend and open the sockets.
+     * @param config Configuration struct
+     * @return OK on successful initialization, error otherwise.
+     */
+    AudioFrontendStatus init(BaseAudioFrontendConfiguration* config) override;
+
+    /**
+     * @brief Stop the audio and receiver threads and close the sockets
+     */
+    void cleanup() override;
+
+    /**
+     * @brief Start the audio and receiver threads, returns immediately.
+     */
+    void run() override;
+
+private:
+    struct Packet
+    {
+        std::chrono::steady_clock::time_point arrival_time;
+        alignas(NetworkAudioHeader) std::array<uint8_t, NETWORK_AUDIO_MAX_PACKET_SIZE> data;
+    };
+    using PacketQueue = memory_relaxed_aquire_release::CircularFifo<Packet*, NETWORK_RECEIVE_QUEUE_SIZE + 1>;
+
+    AudioFrontendStatus _open_receive_socket(const std::string& address);
+    AudioFrontendStatus _open_send_socket(const std::string& address);
+
+    /* Audio thread function */
+    void _rt_loop();
+
+    /* Receiver thread function */
+    void _receive_loop();
+
+    bool _valid_packet(const Packet& packet, int size);
+
+    void _process_chunk();
+
+    void _send_chunk();
+
+    int         _receive_socket{-1};
+    int         _send_socket{-1};
+    sockaddr_in _send_address;
+    int         _listen_port{0};
+    int         _channels{0};
+
+    std::unique_ptr<JitterBuffer> _jitter_buffer;
+    std::array<Packet, NETWORK_RECEIVE_QUEUE_SIZE> _packets;
+    PacketQueue _free_packets;
+    PacketQueue _received_packets;
+    Packet      _send_packet;
+    uint32_t    _send_sequence{0};
+    int64_t     _dropped_packets{0};
+    bool        _invalid_packet_logged{false};
+
+    std::thread       _rt_thread;
+    std::thread       _receive_thread;
+    std::atomic<bool> _running{false};
+
+    Time    _start_time{0};
+    std::chrono::steady_clock::time_point _clock_start;
+    int64_t _sample_count{0};
+
+    ChunkSampleBuffer     _in_buffer;
+    ChunkSampleBuffer     _out_buffer;
+    engine::ControlBuffer _in_controls;
+    engine::ControlBuffer _out_controls;
+};
+
+}; // end namespace audio_frontend
+}; // end namespace sushi
+
+#endif //SUSHI_NETWORK_FRONTEND_H
@@ -18,8 +18,10 @@
 * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <map>
 #include <random>
 
 #include "logging.h"
@@ -48,12 +50,92 @@ void fill_buffer_with_noise(ChunkSampleBuffer& buffer, random_device& dev, rando
 }
 
 template<class random_device, class random_dist>
-void fill_cv_buffer_with_noise(engine::ControlBuffer& buffer, random_device& dev, random_dist& dist)
+void fill_cv_buffer_with_noise(engine::ControlBuffer& buffer, random_device& dev, random_dist& dist, bool audio_rate)
 {
     for (auto& cv : buffer.cv_values)
     {
         cv = map_audio_to_cv(dist(dev));
     }
+    if (audio_rate)
+    {
+        for (auto& samples : buffer.cv_samples)
+        {
+            for (auto& cv : samples)
+            {
+                cv = map_audio_to_cv(dist(dev));
+            }
+        }
+    }
+}
+
+int sndfile_format_from_names(int base_format, const std::string& file_type, const std::string& sample_format)
+{
+    static const std::map<std::string, int> file_types = {{"wav",  SF_FORMAT_WAV},
+                                                          {"aiff", SF_FORMAT_AIFF},
+                                                          {"flac", SF_FORMAT_FLAC},
+                                                          {"caf",  SF_FORMAT_CAF},
+                                                          {"w64",  SF_FORMAT_W64},
+                                                          {"rf64", SF_FORMAT_RF64}};
+
+    static const std::map<std::string, int> sample_formats = {{"int16",  SF_FORMAT_PCM_16},
+                                                              {"int24",  SF_FORMAT_PCM_24},
+                                                              {"int32",  SF_FORMAT_PCM_32},
+                                                              {"float",  SF_FORMAT_FLOAT},
+                                                              {"double", SF_FORMAT_DOUBLE}};
+    int type = base_format & SF_FORMAT_TYPEMASK;
+    int subtype = base_format & SF_FORMAT_SUBMASK;
+    if (!file_type.empty())
+    {
+        auto found = file_types.find(file_type);
+        if (found == file_types.end())
+        {
+            return 0;
+        }
+        type = found->second;
+    }
+    if (!sample_format.empty())
+    {
+        auto found = sample_formats.find(sample_format);
+        if (found == sample_formats.end())
+        {
+            return 0;
+        }
+        subtype = found->second;
+    }
+    return type | subtype;
+}
+
+BenchmarkResults calculate_benchmark_results(std::vector<float>& chunk_latencies, double process_time, float sample_rate)
+{
+    BenchmarkResults results;
+    results.chunks = static_cast<int>(chunk_latencies.size());
+    results.sample_rate = sample_rate;
+    results.process_time = process_time;
+    if (chunk_latencies.empty() || process_time <= 0)
+    {
+        return results;
+    }
+    results.chunks_per_second = results.chunks / process_time;
+    results.realtime_factor = results.chunks_per_second * AUDIO_CHUNK_SIZE / sample_rate;
+
+    std::sort(chunk_latencies.begin(), chunk_latencies.end());
+    auto percentile = [&](double fraction)
+    {
+        auto index = static_cast<size_t>(fraction * chunk_latencies.size());
+        return chunk_latencies[std::min(index, chunk_latencies.size() - 1)];
+    };
+    double sum = 0;
+    for (auto latency : chunk_latencies)
+    {
+        sum += latency;
+    }
+    results.latency_avg = static_cast<float>(sum / chunk_latencies.size());
+    results.latency_p50 = percentile(0.5);
+    results.latency_p90 = percentile(0.9);
+    results.latency_p99 = percentile(0.99);
+    results.latency_p999 = percentile(0.999);
+    results.latency_max = chunk_latencies.back();
+    return results;
 }
 
 AudioFrontendStatus OfflineFrontend::init(BaseAudioFrontendConfiguration* config)
@@ -66,6 +148,9 @@ AudioFrontendStatus OfflineFrontend::init(BaseAudioFrontendConfiguration* config
 
     auto off_config = static_cast<OfflineFrontendConfiguration*>(_config);
     _dummy_mode = off_config->dummy_mode;
+    _benchmark_duration = std::max(off_config->benchmark_duration, 0.0f);
+    _benchmark_warmup = std::max(off_config->benchmark_warmup, 0.0f);
+    _realtime_pacing = off_config->realtime_pacing;
 
     if (_dummy_mode == false)
     {
@@ -77,7 +162,6 @@ AudioFrontendStatus OfflineFrontend::init(BaseAudioFrontendConfiguration* config
             SUSHI_LOG_ERROR("Unable to open input file {}", off_config->input_filename);
             return AudioFrontendStatus::INVALID_INPUT_FILE;
         }
-        _mono = _soundfile_info.channels == 1;
         auto sample_rate_file = _soundfile_info.samplerate;
         if (sample_rate_file != _engine->sample_rate())
         {
@@ -86,15 +170,12 @@ AudioFrontendStatus OfflineFrontend::init(BaseAudioFrontendConfiguration* config
                               _engine->sample_rate());
         }
 
-        // Open output file with same format as input file
-        if (!(_output_file = sf_open(off_config->output_filename.c_str(), SFM_WRITE, &_soundfile_info)))
+        auto status = _setup_output_file(off_config);
+        if (status != AudioFrontendStatus::OK)
         {
             cleanup();
-            SUSHI_LOG_ERROR("Unable to open output file {}", off_config->output_filename);
-            return AudioFrontendStatus::INVALID_OUTPUT_FILE;
+            return status;
         }
-        _engine->set_audio_input_channels(OFFLINE_FRONTEND_CHANNELS);
-        _engine->set_audio_output_channels(OFFLINE_FRONTEND_CHANNELS);
     }
     else
     {
@@ -114,11 +195,78 @@ AudioFrontendStatus OfflineFrontend::init(BaseAudioFrontendConfiguration* config
         SUSHI_LOG_ERROR("Setting {} cv outputs failed", off_config->cv_outputs);
         return AudioFrontendStatus::AUDIO_HW_ERROR;
     }
+    _in_controls.resize(off_config->cv_inputs, off_config->gate_inputs);
+    _out_controls.resize(off_config->cv_outputs, off_config->gate_outputs);
     _engine->set_output_latency(std::chrono::microseconds(0));
 
     return ret_code;
 }
 
+AudioFrontendStatus OfflineFrontend::_setup_output_file(const OfflineFrontendConfiguration* config)
+{
+    int output_channels = config->output_channels;
+    if (output_channels == 0)
+    {
+        output_channels = config->output_channel_map.empty() ? _soundfile_info.channels :
+                                                               static_cast<int>(config->output_channel_map.size());
+    }
+    if (output_channels < 1)
+    {
+        SUSHI_LOG_ERROR("Invalid number of output channels: {}", output_channels);
+        return AudioFrontendStatus::INVALID_N_CHANNELS;
+    }
+    if (!config->output_channel_map.empty() &&
+        static_cast<int>(config->output_channel_map.size()) != output_channels)
+    {
+        SUSHI_LOG_ERROR("Output channel map has {} channels, expected {}", config->output_channel_map.size(), output_channels);
+        return AudioFrontendStatus::INVALID_N_CHANNELS;
+    }
+
+    _channel_map.resize(output_channels);
+    _identity_map = config->output_channel_map.empty();
+    for (int c = 0; c < output_channels; ++c)
+    {
+        _channel_map[c] = _identity_map ? c : config->output_channel_map[c];
+        if (_channel_map[c] < 0)
+        {
+            SUSHI_LOG_ERROR("Invalid engine channel {} in output channel map", _channel_map[c]);
+            return AudioFrontendStatus::INVALID_N_CHANNELS;
+        }
+    }
+
+    memset(&_output_info, 0, sizeof(_output_info));
+    _output_info.samplerate = _soundfile_info.samplerate;
+    _output_info.channels = output_channels;
+    _output_info.format = sndfile_format_from_names(_soundfile_info.format, config->output_format, config->output_sample_format);
+    if (_output_info.format == 0 || sf_format_check(&_output_info) == SF_FALSE)
+    {
+        SUSHI_LOG_ERROR("Unsupported output format: {} {}", config->output_format, config->output_sample_format);
+        return AudioFrontendStatus::INVALID_OUTPUT_FILE;
+    }
+    if (!(_output_file = sf_open(config->output_filename.c_str(), SFM_WRITE, &_output_info)))
+    {
+        SUSHI_LOG_ERROR("Unable to open output file {}", config->output_filename);
+        return AudioFrontendStatus::INVALID_OUTPUT_FILE;
+    }
+
+    int engine_inputs = std::max(_soundfile_info.channels, OFFLINE_FRONTEND_MIN_CHANNELS);
+    int engine_outputs = std::max(*std::max_element(_channel_map.begin(), _channel_map.end()) + 1,
+                                  OFFLINE_FRONTEND_MIN_CHANNELS);
+    _engine->set_audio_input_channels(engine_inputs);
+    _engine->set_audio_output_channels(engine_outputs);
+    _buffer = ChunkSampleBuffer(std::max(engine_inputs, engine_outputs));
+
+    for (auto& block : _input_blocks)
+    {
+        block.data.resize(OFFLINE_FRONTEND_BLOCK_SIZE * _soundfile_info.channels);
+    }
+    for (auto& block : _output_blocks)
+    {
+        block.data.resize(OFFLINE_FRONTEND_BLOCK_SIZE * output_channels);
+    }
+    return AudioFrontendStatus::OK;
+}
+
 void OfflineFrontend::add_sequencer_events(std::vector<Event*> events)
 {
     // Sort events by reverse time
@@ -136,6 +284,14 @@ void OfflineFrontend::cleanup()
     {
         _worker.join();
     }
+    if (_reader.joinable())
+    {
+        _reader.join();
+    }
+    if (_writer.joinable())
+    {
+        _writer.join();
+    }
     if (_input_file)
     {
         sf_close(_input_file);
@@ -148,6 +304,16 @@ void OfflineFrontend::cleanup()
     }
 }
 
+/* Pop an element from a fifo, waiting for one to become available if it is empty */
+template<class FifoType, class ElementType>
+void wait_and_pop(FifoType& fifo, ElementType& element)
+{
+    while (fifo.pop(element) == false)
+    {
+        std::this_thread::sleep_for(OFFLINE_FRONTEND_IO_WAIT_TIME);
+    }
+}
+
 int time_to_sample_offset(Time chunk_end_time, Time event_time, float samplerate)
 {
     Time chunktime = std::chrono::microseconds(static_cast<uint64_t>(1'000'000.f * AUDIO_CHUNK_SIZE / samplerate));
@@ -156,7 +322,11 @@ int time_to_sample_offset(Time chunk_end_time, Time event_time, float samplerate
 
 void OfflineFrontend::run()
 {
-    if (_dummy_mode)
+    if (_dummy_mode && _benchmark_duration > 0)
+    {
+        _process_dummy();
+    }
+    else if (_dummy_mode)
     {
         _worker = std::thread(&OfflineFrontend::_process_dummy, this);
     }
@@ -194,8 +364,33 @@ void OfflineFrontend::_process_dummy()
     rand_gen.seed(NOISE_SEED);
     std::normal_distribution<float> normal_dist(0.0f, INPUT_NOISE_LEVEL);
 
-    while (_running)
+    // Chunk counts are calculated here as the samplerate might not be known at init()
+    float sample_rate = _engine->sample_rate();
+    int64_t warmup_chunks = 0;
+    int64_t total_chunks = 0;
+    std::vector<float> chunk_latencies;
+    if (_benchmark_duration > 0)
+    {
+        warmup_chunks = static_cast<int64_t>(_benchmark_warmup * sample_rate / AUDIO_CHUNK_SIZE);
+        total_chunks = warmup_chunks + std::max(static_cast<int64_t>(_benchmark_duration * sample_rate / AUDIO_CHUNK_SIZE), int64_t(1));
+        chunk_latencies.reserve(total_chunks - warmup_chunks);
+    }
+    auto chunk_period = std::chrono::nanoseconds(static_cast<int64_t>(AUDIO_CHUNK_SIZE * 1'000'000'000.0 / sample_rate));
+    auto benchmark_start = std::chrono::steady_clock::now();
+    auto next_chunk_start = benchmark_start;
+
+    for (int64_t chunk = 0; _running && (total_chunks == 0 || chunk < total_chunks); ++chunk)
     {
+        if (chunk == warmup_chunks && total_chunks > 0)
+        {
+            auto timer = _engine->performance_timer();
+            if (timer)
+            {
+                timer->clear_all_timings();
+            }
+            benchmark_start = std::chrono::steady_clock::now();
+        }
+
         // Update time and sample counter
         _engine->update_time(start_time + std::chrono::microseconds(static_cast<uint64_t>(usec_time)), samplecount);
 
@@ -206,61 +401,141 @@ void OfflineFrontend::_process_dummy()
         _process_events(chunk_end_time);
 
         fill_buffer_with_noise(_buffer, rand_gen, normal_dist);
-        fill_cv_buffer_with_noise(_control_buffer, rand_gen, normal_dist);
-        _engine->process_chunk(&_buffer, &_buffer, &_control_buffer, &_control_buffer);
+        fill_cv_buffer_with_noise(_in_controls, rand_gen, normal_dist, _engine->audio_rate_cv());
+
+        auto process_start = std::chrono::steady_clock::now();
+        _engine->process_chunk(&_buffer, &_buffer, &_in_controls, &_out_controls);
+        if (chunk >= warmup_chunks && total_chunks > 0)
+        {
+            std::chrono::duration<float, std::micro> latency = std::chrono::steady_clock::now() - process_start;
+            chunk_latencies.push_back(latency.count());
+        }
+
+        if (_realtime_pacing)
+        {
+            next_chunk_start += chunk_period;
+            std::this_thread::sleep_until(next_chunk_start);
+        }
+    }
+
+    if (total_chunks > 0)
+    {
+        std::chrono::duration<double> process_time = std::chrono::steady_clock::now() - benchmark_start;
+        _benchmark_results = calculate_benchmark_results(chunk_latencies, process_time.count(), sample_rate);
     }
 }
 
 void OfflineFrontend::_run_blocking()
 {
     set_flush_denormals_to_zero();
-    int readcount;
     int samplecount = 0;
     double usec_time = 0.0f;
     Time start_time = std::chrono::microseconds(0);
 
-    float file_buffer[OFFLINE_FRONTEND_CHANNELS * AUDIO_CHUNK_SIZE];
-    while ( (readcount = static_cast<int>(sf_readf_float(_input_file,
-                                                         file_buffer,
-                                                         static_cast<sf_count_t>(AUDIO_CHUNK_SIZE)))) )
-    {
-        // Update time and sample counter
-        _engine->update_time(start_time + std::chrono::microseconds(static_cast<uint64_t>(usec_time)), samplecount);
-
-        samplecount += readcount;
-        usec_time += readcount * 1'000'000.f / _engine->sample_rate();
-
-        Time chunk_end_time = start_time + std::chrono::microseconds(static_cast<uint64_t>(usec_time));
-        _process_events(chunk_end_time);
+    int input_channels = _soundfile_info.channels;
+    int output_channels = _output_info.channels;
+    auto input_buffer = ChunkSampleBuffer::create_non_owning_buffer(_buffer, 0, input_channels);
 
-        _buffer.clear();
+    // File access is done in separate threads so that disk access and processing overlap
+    for (int i = 0; i < OFFLINE_FRONTEND_IO_BLOCKS; ++i)
+    {
+        _free_input_blocks.push(&_input_blocks[i]);
+        _free_output_blocks.push(&_output_blocks[i]);
+    }
+    _reader = std::thread(&OfflineFrontend::_read_file, this);
+    _writer = std::thread(&OfflineFrontend::_write_file, this);
 
-        if (_mono)
+    while (true)
+    {
+        FileBlock* input_block;
+        FileBlock* output_block;
+        wait_and_pop(_read_blocks, input_block);
+        wait_and_pop(_free_output_blocks, output_block);
+        sf_count_t readcount = input_block->frames;
+        output_block->frames = readcount;
+        if (readcount == 0)
         {
-            std::copy(file_buffer, file_buffer + AUDIO_CHUNK_SIZE, _buffer.channel(0));
+            _processed_blocks.push(output_block);
+            break;
         }
-        else
+
+        for (sf_count_t frame = 0; frame < readcount; frame += AUDIO_CHUNK_SIZE)
         {
-            auto buffer = ChunkSampleBuffer::create_non_owning_buffer(_buffer, 0, 2);
-            buffer.from_interleaved(file_buffer);
+            auto chunk_frames = std::min(readcount - frame, static_cast<sf_count_t>(AUDIO_CHUNK_SIZE));
+
+            // Update time and sample counter
+            _engine->update_time(start_time + std::chrono::microseconds(static_cast<uint64_t>(usec_time)), samplecount);
+
+            samplecount += chunk_frames;
+            usec_time += chunk_frames * 1'000'000.f / _engine->sample_rate();
+
+            Time chunk_end_time = start_time + std::chrono::microseconds(static_cast<uint64_t>(usec_time));
+            _process_events(chunk_end_time);
+
+            _buffer.clear();
+            input_buffer.from_interleaved(input_block->data.data() + frame * input_channels);
+
+            /* Gate and CV are ignored when using file frontend */
+            _engine->process_chunk(&_buffer, &_buffer, &_in_controls, &_out_controls);
+
+            _write_output_chunk(output_block->data.data() + frame * output_channels);
         }
-        /* Gate and CV are ignored when using file frontend */
-        _engine->process_chunk(&_buffer, &_buffer, &_control_buffer, &_control_buffer);
+        _free_input_blocks.push(input_block);
+        _processed_blocks.push(output_block);
+    }
+    _reader.join();
+    _writer.join();
+}
 
-        if (_mono)
+void OfflineFrontend::_read_file()
+{
+    int channels = _soundfile_info.channels;
+    FileBlock* block;
+    do
+    {
+        wait_and_pop(_free_input_blocks, block);
+        block->frames = std::max(sf_readf_float(_input_file, block->data.data(), OFFLINE_FRONTEND_BLOCK_SIZE),
+                                 static_cast<sf_count_t>(0));
+        // Pad the last chunk of the file with silence
+        std::fill(block->data.begin() + block->frames * channels, block->data.end(), 0.0f);
+        _read_blocks.push(block);
+    }
+    while (block->frames > 0);
+}
+
+void OfflineFrontend::_write_file()
+{
+    FileBlock* block;
+    while (true)
+    {
+        wait_and_pop(_processed_blocks, block);
+        if (block->frames == 0)
         {
-            std::copy(_buffer.channel(0), _buffer.channel(0) + AUDIO_CHUNK_SIZE, file_buffer );
+            break;
         }
-        else
+        if (sf_writef_float(_output_file, block->data.data(), block->frames) != block->frames)
         {
-            auto buffer = ChunkSampleBuffer::create_non_owning_buffer(_buffer, 0, 2);
-            buffer.to_interleaved(file_buffer);
+            SUSHI_LOG_ERROR("Error writing to output file: {}", sf_strerror(_output_file));
         }
+        _free_output_blocks.push(block);
+    }
+}
 
-        // Write to file
-        // Should we check the number of samples effectively written?
-        // Not done in libsndfile's example
-        sf_writef_float(_output_file, file_buffer, static_cast<sf_count_t>(readcount));
+void OfflineFrontend::_write_output_chunk(float* interleaved_buffer)
+{
+    int output_channels = static_cast<int>(_channel_map.size());
+    if (_identity_map)
+    {
+        auto buffer = ChunkSampleBuffer::create_non_owning_buffer(_buffer, 0, output_channels);
+        buffer.to_interleaved(interleaved_buffer);
+        return;
+    }
+    for (int n = 0; n < AUDIO_CHUNK_SIZE; ++n)
+    {
+        for (int c = 0; c < output_channels; ++c)
+        {
+            *interleaved_buffer++ = _buffer.channel(_channel_map[c])[n];
+        }
     }
 }
 
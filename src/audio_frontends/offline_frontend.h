@@ -23,11 +23,14 @@
 
 #include <string>
 #include <vector>
+#include <array>
 #include <atomic>
 #include <thread>
 
 #include <sndfile.h>
 
+#include "fifo/circularfifo_memory_relaxed_aquire_release.h"
+
 #include "base_audio_frontend.h"
 #include "library/rt_event.h"
 
@@ -35,8 +38,14 @@ namespace sushi {
 
 namespace audio_frontend {
 
-constexpr int OFFLINE_FRONTEND_CHANNELS = 2;
+/* Minimum number of engine channels, so that mono files can be used with stereo configurations */
+constexpr int OFFLINE_FRONTEND_MIN_CHANNELS = 2;
 constexpr int DUMMY_FRONTEND_CHANNELS = 10;
+/* Number of frames read from and written to file at a time */
+constexpr int OFFLINE_FRONTEND_BLOCK_SIZE = 64 * AUDIO_CHUNK_SIZE;
+/* Number of blocks buffered between the file reader and writer threads and the processing */
+constexpr int OFFLINE_FRONTEND_IO_BLOCKS = 8;
+constexpr auto OFFLINE_FRONTEND_IO_WAIT_TIME = std::chrono::microseconds(200);
 
 struct OfflineFrontendConfiguration : public BaseAudioFrontendConfiguration
 {
@@ -45,19 +54,85 @@ struct OfflineFrontendConfiguration : public BaseAudioFrontendConfiguration
                                  const std::string output_filename,
                                  bool dummy_mode,
                                  int cv_inputs,
-                                 int cv_outputs) :
+                                 int cv_outputs,
+                                 const std::string output_format = "",
+                                 const std::string output_sample_format = "",
+                                 int output_channels = 0,
+                                 const std::vector<int>& output_channel_map = {}) :
             BaseAudioFrontendConfiguration(cv_inputs, cv_outputs),
             input_filename(input_filename),
             output_filename(output_filename),
-            dummy_mode(dummy_mode)
+            dummy_mode(dummy_mode),
+            output_format(output_format),
+            output_sample_format(output_sample_format),
+            output_channels(output_channels),
+            output_channel_map(output_channel_map)
     {}
 
     virtual ~OfflineFrontendConfiguration() = default;
     std::string input_filename;
     std::string output_filename;
     bool dummy_mode;
+    /* File type of the output, i.e. "wav" or "flac", empty for the same as the input file */
+    std::string output_format;
+    /* Sample format of the output, i.e. "int24" or "float", empty for the same as the input file */
+    std::string output_sample_format;
+    /* Number of channels in the output file, 0 for the same as the input file
+     * or the size of output_channel_map if that is set */
+    int output_channels;
+    /* Engine output channel to write to each channel of the output file, empty for a 1 to 1 mapping */
+    std::vector<int> output_channel_map;
+
+    /* Dummy mode only. If set, run for this many seconds of audio plus the warmup time
+     * and collect BenchmarkResults, instead of running until stopped */
+    float benchmark_duration{0};
+    float benchmark_warmup{0};
+    /* Dummy mode only. Process chunks at the rate of a realtime audio frontend instead
+     * of as fast as possible */
+    bool realtime_pacing{false};
+};
+
+/**
+ * @brief Results from running the dummy frontend in benchmark mode. Timings of
+ *        individual processors are collected separately by the engine's PerformanceTimer.
+ */
+struct BenchmarkResults
+{
+    int    chunks{0};
+    float  sample_rate{0};
+    /* Total wall clock time in seconds */
+    double process_time{0};
+    double chunks_per_second{0};
+    /* Seconds of audio processed per wall clock second */
+    double realtime_factor{0};
+    /* Processing time of a single chunk in microseconds */
+    float  latency_avg{0};
+    float  latency_p50{0};
+    float  latency_p90{0};
+    float  latency_p99{0};
+    float  latency_p999{0};
+    float  latency_max{0};
 };
 
+/**
+ * @brief Calculate benchmark statistics from recorded chunk processing times.
+ * @param chunk_latencies Processing time in microseconds of every measured chunk. Will be sorted.
+ * @param process_time Total wall clock time of the measurement in seconds
+ * @param sample_rate The engine sample rate
+ * @return A populated BenchmarkResults object
+ */
+BenchmarkResults calculate_benchmark_results(std::vector<float>& chunk_latencies, double process_time, float sample_rate);
+
+/**
+ * @brief Get a libsndfile format from file type and sample format names.
+ * @param base_format The format to use for the parts that are not given, i.e. the input file format
+ * @param file_type File type name, i.e. "wav", "aiff" or "flac". If empty the type of base_format is used.
+ * @param sample_format Sample format name, i.e. "int16", "int24" or "float". If empty the
+ *        sample format of base_format is used.
+ * @return A libsndfile format, or 0 if any of the names is not recognised.
+ */
+int sndfile_format_from_names(int base_format, const std::string& file_type, const std::string& sample_format);
+
 class OfflineFrontend : public BaseAudioFrontend
 {
 public:
@@ -84,23 +159,64 @@ public:
 
     void cleanup() override;
 
+    /**
+     * @brief Start processing. Returns when the input file is processed in offline mode,
+     *        or when the benchmark is completed in dummy mode with benchmark enabled.
+     *        Otherwise the dummy mode runs in a separate thread and returns immediately.
+     */
     void run() override;
 
+    /**
+     * @brief Get the results of a completed benchmark run
+     * @return A BenchmarkResults object, empty if no benchmark was run
+     */
+    const BenchmarkResults& benchmark_results() const {return _benchmark_results;}
+
 private:
+    /* Interleaved audio passed between the processing and the file threads.
+     * A block with 0 frames marks the end of the file. */
+    struct FileBlock
+    {
+        std::vector<float> data;
+        sf_count_t         frames{0};
+    };
+    using BlockQueue = memory_relaxed_aquire_release::CircularFifo<FileBlock*, OFFLINE_FRONTEND_IO_BLOCKS + 1>;
+
+    AudioFrontendStatus _setup_output_file(const OfflineFrontendConfiguration* config);
     void _process_events(Time end_time);
     void _process_dummy();
     void _run_blocking();
+    void _read_file();
+    void _write_file();
+    void _write_output_chunk(float* interleaved_buffer);
 
     SNDFILE*            _input_file;
     SNDFILE*            _output_file;
     SF_INFO             _soundfile_info;
-    bool                _mono;
+    SF_INFO             _output_info;
     bool                _dummy_mode;
+    float               _benchmark_duration{0};
+    float               _benchmark_warmup{0};
+    bool                _realtime_pacing{false};
+    BenchmarkResults    _benchmark_results;
     std::atomic_bool    _running;
     std::thread         _worker;
+    std::thread         _reader;
+    std::thread         _writer;
 
     SampleBuffer<AUDIO_CHUNK_SIZE> _buffer{DUMMY_FRONTEND_CHANNELS};
-    engine::ControlBuffer _control_buffer;
+    engine::ControlBuffer _in_controls;
+    engine::ControlBuffer _out_controls;
+
+    std::array<FileBlock, OFFLINE_FRONTEND_IO_BLOCKS> _input_blocks;
+    std::array<FileBlock, OFFLINE_FRONTEND_IO_BLOCKS> _output_blocks;
+    BlockQueue _free_input_blocks;
+    BlockQueue _read_blocks;
+    BlockQueue _free_output_blocks;
+    BlockQueue _processed_blocks;
+
+    std::vector<int>   _channel_map;
+    bool               _identity_map{true};
 
     std::vector<Event*> _event_queue;
 };
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Audio frontend exchanging audio with another process through shared memory
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "logging.h"
+#include "shm_frontend.h"
+#include "audio_frontend_internals.h"
+
+namespace sushi {
+namespace audio_frontend {
+
+SUSHI_GET_LOGGER_WITH_MODULE_NAME("shm audio");
+
+static_assert(SUSHI_SHM_MAX_CHANNELS == MAX_FRONTEND_CHANNELS);
+
+/* Checks if there is a segment with the given name that a running server is using */
+bool segment_in_use(const std::string& name)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool in_use = false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(SushiShmHeader)))
+    {
+        void* segment = mmap(nullptr, sizeof(SushiShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (segment != MAP_FAILED)
+        {
+            auto header = static_cast<SushiShmHeader*>(segment);
+            in_use = sushi_shm_load(&header->magic) == SUSHI_SHM_MAGIC && sushi_shm_load(&header->server_running) != 0;
+            munmap(segment, sizeof(SushiShmHeader));
+        }
+    }
+    close(fd);
+    return in_use;
+}
+
+AudioFrontendStatus ShmFrontend::init(BaseAudioFrontendConfiguration* config)
+{
+    auto ret_code = BaseAudioFrontend::init(config);
+    if (ret_code != AudioFrontendStatus::OK)
+    {
+        return ret_code;
+    }
+    auto shm_config = static_cast<const ShmFrontendConfiguration*>(_config);
+    if (shm_config->channels < 1 || shm_config->channels > MAX_FRONTEND_CHANNELS)
+    {
+        SUSHI_LOG_ERROR("Invalid number of channels: {}", shm_config->channels);
+        return AudioFrontendStatus::INVALID_N_CHANNELS;
+    }
+    if (_engine->set_cv_input_channels(shm_config->cv_inputs) != engine::EngineReturnStatus::OK ||
+        _engine->set_cv_output_channels(shm_config->cv_outputs) != engine::EngineReturnStatus::OK)
+    {
+        SUSHI_LOG_ERROR("Invalid number of cv channels: {} inputs, {} outputs", shm_config->cv_inputs, shm_config->cv_outputs);
+        return AudioFrontendStatus::INVALID_N_CHANNELS;
+    }
+
+    if (segment_in_use(shm_config->name))
+    {
+        SUSHI_LOG_ERROR("Shared memory segment {} is used by another running instance", shm_config->name);
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    /* A segment left from a previous instance that didn't exit cleanly is replaced */
+    if (shm_unlink(shm_config->name.c_str()) == 0)
+    {
+        SUSHI_LOG_WARNING("Removed existing shared memory segment {}", shm_config->name);
+    }
+    int fd = shm_open(shm_config->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0)
+    {
+        SUSHI_LOG_ERROR("Failed to create shared memory segment {}: {}", shm_config->name, strerror(errno));
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    _name = shm_config->name;
+    uint32_t cv_ports = std::max(shm_config->cv_inputs, shm_config->cv_outputs);
+    uint32_t gate_words = sushi_shm_gate_words(std::max(shm_config->gate_inputs, shm_config->gate_outputs));
+    uint32_t slot_size = sushi_shm_slot_size(AUDIO_CHUNK_SIZE, shm_config->channels, cv_ports, gate_words);
+    _segment_size = sushi_shm_segment_size(slot_size);
+    void* segment = MAP_FAILED;
+    if (ftruncate(fd, _segment_size) == 0)
+    {
+        segment = mmap(nullptr, _segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (segment == MAP_FAILED)
+    {
+        SUSHI_LOG_ERROR("Failed to map shared memory segment {}: {}", _name, strerror(errno));
+        shm_unlink(_name.c_str());
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
+    if (mlock(segment, _segment_size) != 0)
+    {
+        SUSHI_LOG_WARNING("Failed to lock shared memory segment in memory: {}", strerror(errno));
+    }
+
+    _layout.version = SUSHI_SHM_VERSION;
+    _layout.sample_rate = static_cast<uint32_t>(_engine->sample_rate());
+    _layout.chunk_size = AUDIO_CHUNK_SIZE;
+    _layout.input_channels = shm_config->channels;
+    _layout.output_channels = shm_config->channels;
+    _layout.cv_inputs = shm_config->cv_inputs;
+    _layout.cv_outputs = shm_config->cv_outputs;
+    _layout.gate_inputs = shm_config->gate_inputs;
+    _layout.gate_outputs = shm_config->gate_outputs;
+    _layout.cv_ports = cv_ports;
+    _layout.gate_words = gate_words;
+    _layout.slot_count = SUSHI_SHM_SLOT_COUNT;
+    _layout.slot_size = slot_size;
+
+    _header = static_cast<SushiShmHeader*>(segment);
+    *_header = _layout;
+    /* Clients check the magic number first, so it's written last */
+    sushi_shm_store(&_header->magic, SUSHI_SHM_MAGIC);
+
+    _engine->set_audio_input_channels(shm_config->channels);
+    _engine->set_audio_output_channels(shm_config->channels);
+    _in_controls.resize(shm_config->cv_inputs, shm_config->gate_inputs);
+    _out_controls.resize(shm_config->cv_outputs, shm_config->gate_outputs);
+    /* Clients get their output back one chunk after sending it */
+    _engine->set_output_latency(std::chrono::microseconds((AUDIO_CHUNK_SIZE * 1'000'000) / static_cast<int>(_engine->sample_rate())));
+    SUSHI_LOG_INFO("Created shared memory segment {} with {} channels", _name, shm_config->channels);
+    return AudioFrontendStatus::OK;
+}
+
+void ShmFrontend::cleanup()
+{
+    _running = false;
+    if (_rt_thread.joinable())
+    {
+        _rt_thread.join();
+        SUSHI_LOG_INFO("Shared memory frontend stopped after {} samples", _sample_count);
+    }
+    if (_header)
+    {
+        munmap(_header, _segment_size);
+        shm_unlink(_name.c_str());
+        _header = nullptr;
+    }
+}
+
+void ShmFrontend::run()
+{
+    _engine->enable_realtime(true);
+    _running = true;
+    _rt_thread = std::thread(&ShmFrontend::_rt_loop, this);
+}
+
+void ShmFrontend::_rt_loop()
+{
+    sched_param param;
+    param.sched_priority = SHM_RT_PRIORITY;
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0)
+    {
+        SUSHI_LOG_WARNING("Failed to set realtime priority of audio thread: {}", strerror(ret));
+    }
+    set_flush_denormals_to_zero();
+
+    _start_time = get_current_time();
+    uint32_t processed = sushi_shm_load(&_header->output_count);
+    sushi_shm_store(&_header->server_running, 1);
+    while (_running)
+    {
+        if (sushi_shm_wait(&_header->input_count, processed, SHM_WAIT_TIMEOUT_MS) != 0)
+        {
+            continue;
+        }
+        /* Process everything the client has queued, counters can wrap around. A client
+         * can never queue more than a ring of chunks, so don't trust it to do so */
+        uint32_t queued = std::min(sushi_shm_load(&_header->input_count) - processed, SUSHI_SHM_SLOT_COUNT);
+        for (uint32_t i = 0; i < queued; ++i, ++processed)
+        {
+            _process_chunk(processed);
+        }
+    }
+    sushi_shm_store(&_header->server_running, 0);
+}
+
+void ShmFrontend::_process_chunk(uint32_t count)
+{
+    char* in_slot = _input_slot(count);
+    char* out_slot = _output_slot(count);
+    auto in_buffer = ChunkSampleBuffer::create_from_raw_pointer(sushi_shm_slot_audio(&_layout, in_slot, 0),
+                                                                0, _layout.input_channels);
+    auto out_buffer = ChunkSampleBuffer::create_from_raw_pointer(sushi_shm_slot_audio(&_layout, out_slot, 0),
+                                                                 0, _layout.output_channels);
+
+    const float* cv_in = sushi_shm_slot_cv(&_layout, in_slot, _layout.input_channels);
+    std::copy(cv_in, cv_in + _layout.cv_inputs, _in_controls.cv_values.begin());
+    if (_engine->audio_rate_cv())
+    {
+        /* The protocol only carries one cv value per chunk, which is held for the entire chunk */
+        for (uint32_t i = 0; i < _layout.cv_inputs; ++i)
+        {
+            _in_controls.cv_samples[i].fill(cv_in[i]);
+        }
+    }
+    const uint32_t* gates_in = sushi_shm_slot_gates(&_layout, in_slot, _layout.input_channels);
+    for (int i = 0; i < _in_controls.gate_values.words(); ++i)
+    {
+        _in_controls.gate_values.set_word(i, gates_in[i]);
+    }
+
+    Time timestamp = _start_time + std::chrono::microseconds((_sample_count * 1'000'000) / static_cast<int>(_engine->sample_rate()));
+    _engine->update_time(timestamp, _sample_count);
+    _engine->process_chunk(&in_buffer, &out_buffer, &_in_controls, &_out_controls);
+    _sample_count += AUDIO_CHUNK_SIZE;
+
+    float* cv_out = sushi_shm_slot_cv(&_layout, out_slot, _layout.output_channels);
+    std::copy(_out_controls.cv_values.begin(), _out_controls.cv_values.begin() + _layout.cv_outputs, cv_out);
+    uint32_t* gates_out = sushi_shm_slot_gates(&_layout, out_slot, _layout.output_channels);
+    for (int i = 0; i < _out_controls.gate_values.words(); ++i)
+    {
+        gates_out[i] = _out_controls.gate_values.word(i);
+    }
+
+    sushi_shm_signal(&_header->output_count);
+}
+
+char* ShmFrontend::_input_slot(uint32_t count)
+{
+    return reinterpret_cast<char*>(_header) + SUSHI_SHM_HEADER_SIZE + (count % _layout.slot_count) * _layout.slot_size;
+}
+
+char* ShmFrontend::_output_slot(uint32_t count)
+{
+    return _input_slot(count) + _layout.slot_count * _layout.slot_size;
+}
+
+}; // end namespace audio_frontend
+}; // end namespace sushi
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Audio frontend exchanging audio with another process through shared memory
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_SHM_FRONTEND_H
+#define SUSHI_SHM_FRONTEND_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "sushi_shm_protocol.h"
+
+#include "base_audio_frontend.h"
+
+namespace sushi {
+namespace audio_frontend {
+
+constexpr int SHM_RT_PRIORITY = 75;
+/* How often the audio thread wakes up to check if it should stop when no client is sending */
+constexpr int SHM_WAIT_TIMEOUT_MS = 100;
+
+struct ShmFrontendConfiguration : public BaseAudioFrontendConfiguration
+{
+    ShmFrontendConfiguration(const std::string& name,
+                             int channels,
+                             int cv_inputs,
+                             int cv_outputs) : BaseAudioFrontendConfiguration(cv_inputs, cv_outputs),
+                                               name(name),
+                                               channels(channels)
+    {}
+
+    virtual ~ShmFrontendConfiguration() = default;
+
+    std::string name;
+    int channels;
+};
+
+/**
+ * @brief Audio frontend that is driven by a client process on the same machine.
+ *        Audio, cv and gate data is exchanged through a POSIX shared memory segment
+ *        with a ring of chunk slots in each direction, see sushi_shm_protocol.h.
+ *        Every chunk the client sends is processed by the engine in place in the
+ *        shared memory, so the client sets the pace and no data is ever dropped.
+ *        Engine time follows the number of processed samples, which makes the
+ *        processing deterministic when used from test harnesses.
+ */
+class ShmFrontend : public BaseAudioFrontend
+{
+public:
+    explicit ShmFrontend(engine::BaseEngine* engine) : BaseAudioFrontend(engine) {}
+
+    virtual ~ShmFrontend()
+    {
+        cleanup();
+    }
+
+    /**
+     * @brief Initialize the frontend and create the shared memory segment.
+     * @param config Configuration struct
+     * @return OK on successful initialization, error otherwise.
+     */
+    AudioFrontendStatus init(BaseAudioFrontendConfiguration* config) override;
+
+    /**
+     * @brief Stop the audio thread and remove the shared memory segment
+     */
+    void cleanup() override;
+
+    /**
+     * @brief Start the audio thread, returns immediately.
+     */
+    void run() override;
+
+private:
+    /* Audio thread function */
+    void _rt_loop();
+
+    void _process_chunk(uint32_t count);
+
+    char* _input_slot(uint32_t count);
+
+    char* _output_slot(uint32_t count);
+
+    std::string     _name;
+    SushiShmHeader* _header{nullptr};
+    size_t          _segment_size{0};
+    /* Private copy of the geometry written to the header at init, as the client
+     * can write to the entire segment, only this copy is used when processing */
+    SushiShmHeader  _layout{};
+
+    std::thread       _rt_thread;
+    std::atomic<bool> _running{false};
+
+    Time    _start_time{0};
+    int64_t _sample_count{0};
+
+    engine::ControlBuffer _in_controls;
+    engine::ControlBuffer _out_controls;
+};
+
+}; // end namespace audio_frontend
+}; // end namespace sushi
+
+#endif //SUSHI_SHM_FRONTEND_H
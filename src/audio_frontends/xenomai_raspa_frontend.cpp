@@ -38,6 +38,9 @@ constexpr int REQUIRED_RASPA_VER_MIN = 1;
 static_assert(REQUIRED_RASPA_VER_MAJ == RASPA_VERSION_MAJ, "Raspa major version mismatch");
 static_assert(REQUIRED_RASPA_VER_MIN == RASPA_VERSION_MIN, "Raspa minor version mismatch");
 
+/* Gates are exchanged with the driver as a single 32 bit word */
+constexpr int RASPA_MAX_GATE_PORTS = 32;
+
 SUSHI_GET_LOGGER_WITH_MODULE_NAME("raspa audio");
 
 bool XenomaiRaspaFrontend::_raspa_initialised = false;
@@ -113,22 +116,44 @@ void XenomaiRaspaFrontend::_internal_process_callback(float* input, float* outpu
     _engine->update_time(timestamp, samplecount);
 
     // Gate in signals from the Sika board are inverted, hence invert all bits
-    _in_controls.gate_values = ~engine::BitSet32(raspa_get_gate_values());
+    if (_in_controls.gate_values.words() > 0)
+    {
+        _in_controls.gate_values.set_word(0, ~raspa_get_gate_values());
+    }
 
     ChunkSampleBuffer in_buffer = ChunkSampleBuffer::create_from_raw_pointer(input, 0, _audio_input_channels);
     ChunkSampleBuffer out_buffer = ChunkSampleBuffer::create_from_raw_pointer(output, 0, _audio_output_channels);
     for (int i = 0; i < _cv_input_channels; ++i)
     {
-        _in_controls.cv_values[i] = map_audio_to_cv(input[(_audio_input_channels + i + 1) * AUDIO_CHUNK_SIZE - 1] * CV_IN_CORR);
+        const float* in_data = input + (_audio_input_channels + i) * AUDIO_CHUNK_SIZE;
+        _in_controls.cv_values[i] = map_audio_to_cv(in_data[AUDIO_CHUNK_SIZE - 1] * CV_IN_CORR);
+        if (_engine->audio_rate_cv())
+        {
+            for (int s = 0; s < AUDIO_CHUNK_SIZE; ++s)
+            {
+                _in_controls.cv_samples[i][s] = map_audio_to_cv(in_data[s] * CV_IN_CORR);
+            }
+        }
     }
     out_buffer.clear();
     _engine->process_chunk(&in_buffer, &out_buffer, &_in_controls, &_out_controls);
-    raspa_set_gate_values(static_cast<uint32_t>(_out_controls.gate_values.to_ulong()));
+    raspa_set_gate_values(_out_controls.gate_values.words() > 0 ? _out_controls.gate_values.word(0) : 0);
     /* Sika board outputs only positive cv */
     for (int i = 0; i < _cv_output_channels; ++i)
     {
         float* out_data = output + (_audio_output_channels + i) * AUDIO_CHUNK_SIZE;
-        _cv_output_hist[i] = ramp_cv_output(out_data, _cv_output_hist[i], _out_controls.cv_values[i] * CV_OUT_CORR);
+        if (_engine->audio_rate_cv())
+        {
+            for (int s = 0; s < AUDIO_CHUNK_SIZE; ++s)
+            {
+                out_data[s] = _out_controls.cv_samples[i][s] * CV_OUT_CORR;
+            }
+            _cv_output_hist[i] = out_data[AUDIO_CHUNK_SIZE - 1];
+        }
+        else
+        {
+            _cv_output_hist[i] = ramp_cv_output(out_data, _cv_output_hist[i], _out_controls.cv_values[i] * CV_OUT_CORR);
+        }
     }
 }
 
@@ -147,6 +172,10 @@ AudioFrontendStatus XenomaiRaspaFrontend::config_audio_channels(const XenomaiRas
     {
         return AudioFrontendStatus::AUDIO_HW_ERROR;
     }
+    if (config->gate_inputs > RASPA_MAX_GATE_PORTS || config->gate_outputs > RASPA_MAX_GATE_PORTS)
+    {
+        return AudioFrontendStatus::AUDIO_HW_ERROR;
+    }
     _cv_input_channels = config->cv_inputs;
     _cv_output_channels = config->cv_outputs;
     _audio_input_channels = raspa_get_num_input_channels() - _cv_input_channels;
@@ -163,6 +192,8 @@ AudioFrontendStatus XenomaiRaspaFrontend::config_audio_channels(const XenomaiRas
     {
         return AudioFrontendStatus::AUDIO_HW_ERROR;
     }
+    _in_controls.resize(_cv_input_channels, config->gate_inputs);
+    _out_controls.resize(_cv_output_channels, config->gate_outputs);
     return AudioFrontendStatus::OK;
 }
 
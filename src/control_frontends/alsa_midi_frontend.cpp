@@ -19,6 +19,7 @@
  */
 
 #include <cstdlib>
+#include <string>
 
 #include <alsa/seq_event.h>
 
@@ -33,15 +34,24 @@ namespace midi_frontend {
 
 constexpr int ALSA_POLL_TIMEOUT_MS = 200;
 
-AlsaMidiFrontend::AlsaMidiFrontend(midi_receiver::MidiReceiver* dispatcher)
-        : BaseMidiFrontend(dispatcher)
+AlsaMidiFrontend::AlsaMidiFrontend(int inputs, int outputs, midi_receiver::MidiReceiver* dispatcher)
+        : BaseMidiFrontend(dispatcher),
+          _inputs(inputs),
+          _outputs(outputs),
+          _sysex_buffers(inputs)
 {}
 
 AlsaMidiFrontend::~AlsaMidiFrontend()
 {
     stop();
-    snd_midi_event_free(_input_parser);
-    snd_midi_event_free(_output_parser);
+    for (auto parser : _input_parsers)
+    {
+        snd_midi_event_free(parser);
+    }
+    for (auto parser : _output_parsers)
+    {
+        snd_midi_event_free(parser);
+    }
     snd_seq_free_queue(_seq_handle, _queue);
     snd_seq_close(_seq_handle);
 }
@@ -76,18 +86,11 @@ bool AlsaMidiFrontend::init()
         return false;
     }
 
-    alsamidi_ret = snd_midi_event_new(ALSA_EVENT_MAX_SIZE, &_input_parser);
-    if (alsamidi_ret < 0)
+    if (_init_parsers() == false)
     {
-        SUSHI_LOG_ERROR("Error creating MIDI Input RtEvent Parser: {}", strerror(-alsamidi_ret));
-        return false;
-    }
-    alsamidi_ret = snd_midi_event_new(ALSA_EVENT_MAX_SIZE, &_output_parser);
-    if (alsamidi_ret < 0)
-    {
-        SUSHI_LOG_ERROR("Error creating MIDI Output RtEvent Parser: {}", strerror(-alsamidi_ret));
         return false;
     }
+
     alsamidi_ret = snd_seq_nonblock(_seq_handle, 1);
     if (alsamidi_ret < 0)
     {
@@ -95,15 +98,6 @@ bool AlsaMidiFrontend::init()
         return false;
     }
 
-    snd_midi_event_no_status(_input_parser, 1); /* Disable running status in the decoder */
-    snd_midi_event_no_status(_output_parser, 1); /* Disable running status in the encoder */
-
-    if (alsamidi_ret < 0 )
-    {
-        SUSHI_LOG_ERROR("Failed to set sequencer to use queue: {}", strerror(-alsamidi_ret));
-        return false;
-    }
-
     snd_seq_drain_output(_seq_handle);
 
     return _init_time();
@@ -129,6 +123,7 @@ void AlsaMidiFrontend::_poll_function()
 {
     nfds_t descr_count = static_cast<nfds_t>(snd_seq_poll_descriptors_count(_seq_handle, POLLIN));
     auto descriptors = std::make_unique<pollfd[]>(descr_count);
+    /* All ports share the same sequencer client, so the descriptors cover all inputs */
     snd_seq_poll_descriptors(_seq_handle, descriptors.get(), static_cast<unsigned int>(descr_count), POLLIN);
     while (_running)
     {
@@ -138,21 +133,39 @@ void AlsaMidiFrontend::_poll_function()
             uint8_t data_buffer[ALSA_EVENT_MAX_SIZE]{0};
             while (snd_seq_event_input(_seq_handle, &ev) > 0)
             {
+                if (ev->type == SND_SEQ_EVENT_SYSEX)
+                {
+                    auto input = _port_to_input_map.find(ev->dest.port);
+                    if (input != _port_to_input_map.end())
+                    {
+                        _handle_sysex(input->second, ev);
+                    }
+                }
                 // TODO - Consider if we should be filtering at all here or in the dispatcher instead
-                if ((ev->type == SND_SEQ_EVENT_NOTEON)
+                else if ((ev->type == SND_SEQ_EVENT_NOTEON)
                     || (ev->type == SND_SEQ_EVENT_NOTEOFF)
                     || (ev->type == SND_SEQ_EVENT_CONTROLLER)
                     || (ev->type == SND_SEQ_EVENT_PGMCHANGE)
-                    || (ev->type == SND_SEQ_EVENT_PITCHBEND))
+                    || (ev->type == SND_SEQ_EVENT_PITCHBEND)
+                    || (ev->type == SND_SEQ_EVENT_CLOCK)
+                    || (ev->type == SND_SEQ_EVENT_START)
+                    || (ev->type == SND_SEQ_EVENT_CONTINUE)
+                    || (ev->type == SND_SEQ_EVENT_STOP))
                 {
-                    auto byte_count = snd_midi_event_decode(_input_parser, data_buffer, sizeof(data_buffer), ev);
+                    auto input = _port_to_input_map.find(ev->dest.port);
+                    if (input == _port_to_input_map.end())
+                    {
+                        snd_seq_free_event(ev);
+                        continue;
+                    }
+                    auto byte_count = snd_midi_event_decode(_input_parsers[input->second], data_buffer, sizeof(data_buffer), ev);
                     if (byte_count > 0)
                     {
                         bool timestamped = (ev->flags | (SND_SEQ_TIME_STAMP_REAL & SND_SEQ_TIME_MODE_ABS)) == 1;
                         Time timestamp = timestamped? _to_sushi_time(&ev->time.time) : IMMEDIATE_PROCESS;
-                        _receiver->send_midi(0, midi::to_midi_data_byte(data_buffer, byte_count), timestamp);
+                        _receiver->send_midi(input->second, midi::to_midi_data_byte(data_buffer, byte_count), timestamp);
 
-                        SUSHI_LOG_DEBUG("Received midi message: [{:x} {:x} {:x} {:x}] timestamp: {}",
+                        SUSHI_LOG_DEBUG("Received midi message on input {}: [{:x} {:x} {:x} {:x}] timestamp: {}", input->second,
                                         data_buffer[0], data_buffer[1], data_buffer[2], data_buffer[3], timestamp.count());
 
                     }
@@ -164,24 +177,93 @@ void AlsaMidiFrontend::_poll_function()
     }
 }
 
-void AlsaMidiFrontend::send_midi(int /*output*/, MidiDataByte data, Time timestamp)
+void AlsaMidiFrontend::_handle_sysex(int input, const snd_seq_event_t* ev)
 {
+    /* Long sysex messages may be split over several sequencer events */
+    auto data = static_cast<const uint8_t*>(ev->data.ext.ptr);
+    int size = static_cast<int>(ev->data.ext.len);
+    auto& buffer = _sysex_buffers[input];
+    if (size == 0)
+    {
+        return;
+    }
+    if (data[0] == midi::SYSEX_START)
+    {
+        buffer.clear();
+    }
+    else if (buffer.empty())
+    {
+        /* Continuation of a message that was dropped */
+        return;
+    }
+    if (static_cast<int>(buffer.size()) + size > midi::MAX_SYSEX_SIZE)
+    {
+        SUSHI_LOG_WARNING("Sysex message on input {} exceeds {} bytes, dropping", input, midi::MAX_SYSEX_SIZE);
+        buffer.clear();
+        return;
+    }
+    buffer.insert(buffer.end(), data, data + size);
+    if (buffer.back() == midi::SYSEX_END)
+    {
+        bool timestamped = (ev->flags | (SND_SEQ_TIME_STAMP_REAL & SND_SEQ_TIME_MODE_ABS)) == 1;
+        Time timestamp = timestamped? _to_sushi_time(&ev->time.time) : IMMEDIATE_PROCESS;
+        _receiver->send_sysex(input, buffer.data(), static_cast<int>(buffer.size()), timestamp);
+        SUSHI_LOG_DEBUG("Received sysex message on input {}, {} bytes", input, buffer.size());
+        buffer.clear();
+    }
+}
+
+void AlsaMidiFrontend::send_midi(int output, MidiDataByte data, Time timestamp)
+{
+    if (output < 0 || output >= static_cast<int>(_output_midi_ports.size()))
+    {
+        SUSHI_LOG_WARNING("Midi output {} out of range", output);
+        return;
+    }
     snd_seq_event ev;
     snd_seq_ev_clear(&ev);
-    auto bytes = snd_midi_event_encode(_output_parser, data.data(), data.size(), &ev);
+    auto bytes = snd_midi_event_encode(_output_parsers[output], data.data(), data.size(), &ev);
     if (bytes <= 0 )
     {
         SUSHI_LOG_INFO("Failed to encode event: {} {}", strerror(-bytes), ev.type);
     }
-    snd_seq_ev_set_source(&ev, _output_midi_port);
+    snd_seq_ev_set_source(&ev, _output_midi_ports[output]);
     snd_seq_ev_set_subs(&ev);
     snd_seq_real_time_t ev_time = _to_alsa_time(timestamp);
     snd_seq_ev_schedule_real(&ev, _queue, false, &ev_time);
-    bytes = snd_seq_event_output(_seq_handle, &ev);
-    snd_seq_drain_output(_seq_handle);
-    if (bytes <= 0)
+    /* Events are only buffered here, the alsa queue takes care of delivering them
+     * on time and the buffer is drained once per batch in flush() */
+    bytes = snd_seq_event_output_buffer(_seq_handle, &ev);
+    if (bytes < 0)
+    {
+        /* Buffer full, drain it and try again */
+        snd_seq_drain_output(_seq_handle);
+        bytes = snd_seq_event_output_buffer(_seq_handle, &ev);
+    }
+    if (bytes < 0)
     {
         SUSHI_LOG_WARNING("Event output returned: {}, type {}", strerror(-bytes), ev.type);
+        return;
+    }
+    _output_pending = true;
+}
+
+void AlsaMidiFrontend::flush()
+{
+    if (_output_pending)
+    {
+        /* Returns the number of bytes left in the buffer, or -EAGAIN if the sequencer is busy */
+        auto ret = snd_seq_drain_output(_seq_handle);
+        if (ret < 0 && ret != -EAGAIN && _drain_error_logged == false)
+        {
+            SUSHI_LOG_WARNING("Failed to drain midi output: {}", strerror(-ret));
+            _drain_error_logged = true;
+        }
+        else if (ret >= 0)
+        {
+            _drain_error_logged = false;
+        }
+        _output_pending = ret != 0;
     }
 }
 
@@ -206,49 +288,90 @@ bool AlsaMidiFrontend::_init_time()
 
 bool AlsaMidiFrontend::_init_ports()
 {
-    _input_midi_port = snd_seq_create_simple_port(_seq_handle, "listen:in",
-                                                  SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE,
-                                                  SND_SEQ_PORT_TYPE_APPLICATION);
-
-    if (_input_midi_port < 0)
+    for (int i = 0; i < _inputs; ++i)
     {
-        SUSHI_LOG_ERROR("Error opening ALSA MIDI port: {}", strerror(-_input_midi_port));
-        return false;
+        /* A single port keeps the plain name for compatibility with existing connection scripts */
+        auto name = _inputs == 1 ? std::string("listen:in") : "listen:in_" + std::to_string(i + 1);
+        int port = snd_seq_create_simple_port(_seq_handle, name.c_str(),
+                                              SND_SEQ_PORT_CAP_WRITE|SND_SEQ_PORT_CAP_SUBS_WRITE,
+                                              SND_SEQ_PORT_TYPE_APPLICATION);
+        if (port < 0)
+        {
+            SUSHI_LOG_ERROR("Error opening ALSA MIDI port: {}", strerror(-port));
+            return false;
+        }
+        if (_set_port_timestamping(port) == false)
+        {
+            return false;
+        }
+        _input_midi_ports.push_back(port);
+        _port_to_input_map[port] = i;
     }
 
-    _output_midi_port = snd_seq_create_simple_port(_seq_handle, "write:out",
-                                                   SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ,
-                                                   SND_SEQ_PORT_TYPE_APPLICATION);
-
-    if (_output_midi_port < 0)
+    for (int i = 0; i < _outputs; ++i)
     {
-        SUSHI_LOG_ERROR("Error opening ALSA MIDI port: {}", strerror(-_output_midi_port));
-        return false;
+        auto name = _outputs == 1 ? std::string("write:out") : "write:out_" + std::to_string(i + 1);
+        int port = snd_seq_create_simple_port(_seq_handle, name.c_str(),
+                                              SND_SEQ_PORT_CAP_READ|SND_SEQ_PORT_CAP_SUBS_READ,
+                                              SND_SEQ_PORT_TYPE_APPLICATION);
+        if (port < 0)
+        {
+            SUSHI_LOG_ERROR("Error opening ALSA MIDI port: {}", strerror(-port));
+            return false;
+        }
+        if (_set_port_timestamping(port) == false)
+        {
+            return false;
+        }
+        _output_midi_ports.push_back(port);
     }
+    return true;
+}
+
+bool AlsaMidiFrontend::_set_port_timestamping(int port)
+{
     /* For some weird reason directly creating the port with the specific timestamping
      * doesn't work, but we can set them once the port has been created */
     snd_seq_port_info_t* port_info;
     snd_seq_port_info_alloca(&port_info);
-    snd_seq_get_port_info(_seq_handle, _output_midi_port, port_info);
+    snd_seq_get_port_info(_seq_handle, port, port_info);
     snd_seq_port_info_set_timestamp_queue(port_info, _queue);
     snd_seq_port_info_set_timestamping(port_info, 1);
     snd_seq_port_info_set_timestamp_real(port_info, 1);
-    int alsamidi_ret = snd_seq_set_port_info(_seq_handle, _output_midi_port, port_info);
+    int alsamidi_ret = snd_seq_set_port_info(_seq_handle, port, port_info);
     if (alsamidi_ret < 0)
     {
-        SUSHI_LOG_ERROR("Couldn't set output port time configuration{}", strerror(-alsamidi_ret));
+        SUSHI_LOG_ERROR("Couldn't set port time configuration {}", strerror(-alsamidi_ret));
         return false;
     }
+    return true;
+}
 
-    snd_seq_get_port_info(_seq_handle, _input_midi_port, port_info);
-    snd_seq_port_info_set_timestamp_queue(port_info, _queue);
-    snd_seq_port_info_set_timestamping(port_info, 1);
-    snd_seq_port_info_set_timestamp_real(port_info, 1);
-    alsamidi_ret = snd_seq_set_port_info(_seq_handle, _input_midi_port, port_info);
-    if (alsamidi_ret < 0)
+bool AlsaMidiFrontend::_init_parsers()
+{
+    for (int i = 0; i < _inputs; ++i)
     {
-        SUSHI_LOG_ERROR("Couldn't set inpput port time configuration {}", strerror(-alsamidi_ret));
-        return false;
+        snd_midi_event_t* parser;
+        auto alsamidi_ret = snd_midi_event_new(ALSA_EVENT_MAX_SIZE, &parser);
+        if (alsamidi_ret < 0)
+        {
+            SUSHI_LOG_ERROR("Error creating MIDI Input RtEvent Parser: {}", strerror(-alsamidi_ret));
+            return false;
+        }
+        snd_midi_event_no_status(parser, 1); /* Disable running status in the decoder */
+        _input_parsers.push_back(parser);
+    }
+    for (int i = 0; i < _outputs; ++i)
+    {
+        snd_midi_event_t* parser;
+        auto alsamidi_ret = snd_midi_event_new(ALSA_EVENT_MAX_SIZE, &parser);
+        if (alsamidi_ret < 0)
+        {
+            SUSHI_LOG_ERROR("Error creating MIDI Output RtEvent Parser: {}", strerror(-alsamidi_ret));
+            return false;
+        }
+        snd_midi_event_no_status(parser, 1); /* Disable running status in the encoder */
+        _output_parsers.push_back(parser);
     }
     return true;
 }
@@ -23,6 +23,8 @@
 
 #include <thread>
 #include <atomic>
+#include <map>
+#include <vector>
 
 #include <alsa/asoundlib.h>
 
@@ -37,7 +39,7 @@ constexpr int ALSA_EVENT_MAX_SIZE = 12;
 class AlsaMidiFrontend : public BaseMidiFrontend
 {
 public:
-    AlsaMidiFrontend(midi_receiver::MidiReceiver* dispatcher);
+    AlsaMidiFrontend(int inputs, int outputs, midi_receiver::MidiReceiver* dispatcher);
 
     ~AlsaMidiFrontend();
 
@@ -49,10 +51,15 @@ public:
 
     void send_midi(int input, MidiDataByte data, Time timestamp) override;
 
+    void flush() override;
+
 private:
 
     bool _init_ports();
+    bool _init_parsers();
     bool _init_time();
+    bool _set_port_timestamping(int port);
+    void _handle_sysex(int input, const snd_seq_event_t* ev);
     Time _to_sushi_time(const snd_seq_real_time_t* alsa_time);
     snd_seq_real_time_t _to_alsa_time(Time timestamp);
 
@@ -60,12 +67,21 @@ private:
     std::thread                 _worker;
     std::atomic<bool>           _running{false};
     snd_seq_t*                  _seq_handle{nullptr};
-    int                         _input_midi_port;
-    int                         _output_midi_port;
+    int                         _inputs;
+    int                         _outputs;
+    std::vector<int>            _input_midi_ports;
+    std::vector<int>            _output_midi_ports;
+    std::map<int, int>          _port_to_input_map;
     int                         _queue;
-
-    snd_midi_event_t*           _input_parser{nullptr};
-    snd_midi_event_t*           _output_parser{nullptr};
+    bool                        _output_pending{false};
+    /* Drain errors are only logged when they first occur, not on every flush */
+    bool                        _drain_error_logged{false};
+
+    /* One parser per port, as they keep state between messages */
+    std::vector<snd_midi_event_t*> _input_parsers;
+    std::vector<snd_midi_event_t*> _output_parsers;
+    /* For assembling sysex messages split over several events */
+    std::vector<std::vector<uint8_t>> _sysex_buffers;
     Time                        _time_offset;
 };
 
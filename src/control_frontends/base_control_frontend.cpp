@@ -51,6 +51,14 @@ void BaseControlFrontend::send_string_parameter_change_event(ObjectId processor,
     auto e = new StringPropertyChangeEvent(processor, parameter, value, timestamp);
     _event_dispatcher->post_event(e);}
 
+void BaseControlFrontend::send_parameter_batch_change_event(ObjectId processor,
+                                                            const std::vector<BatchParameterValue>& values)
+{
+    Time timestamp = IMMEDIATE_PROCESS;
+    auto e = new ParameterBatchChangeEvent(processor, values, timestamp);
+    _event_dispatcher->post_event(e);
+}
+
 
 void BaseControlFrontend::send_keyboard_event(ObjectId processor,
                                               KeyboardEvent::Subtype type,
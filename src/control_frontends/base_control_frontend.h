@@ -68,6 +68,8 @@ public:
 
     void send_string_parameter_change_event(ObjectId processor, ObjectId parameter, const std::string& value);
 
+    void send_parameter_batch_change_event(ObjectId processor, const std::vector<BatchParameterValue>& values);
+
     void send_keyboard_event(ObjectId processor, KeyboardEvent::Subtype type, int channel, int note, float velocity);
 
     void send_note_on_event(ObjectId processor, int channel, int note, float velocity);
@@ -44,6 +44,18 @@ public:
 
     virtual void send_midi(int input, MidiDataByte data, Time timestamp) = 0;
 
+    /**
+     * @brief Send any midi buffered by send_midi(). Frontends that output
+     *        every message directly do not need to override this.
+     */
+    virtual void flush() {}
+
+    /**
+     * @brief Called periodically from a non rt thread. Frontends that read input in
+     *        the rt thread pass on messages here that could not be handled there.
+     */
+    virtual void process_deferred_input() {}
+
 protected:
     midi_receiver::MidiReceiver* _receiver;
 };
@@ -69,6 +69,35 @@ static int osc_send_string_parameter_change_event(const char* /*path*/,
     return 0;
 }
 
+static int osc_send_parameter_batch_change_event(const char* /*path*/,
+                                                 const char* types,
+                                                 lo_arg** argv,
+                                                 int argc,
+                                                 void* /*data*/,
+                                                 void* user_data)
+{
+    auto connection = static_cast<OscConnection*>(user_data);
+    if (argc % 2 != 0)
+    {
+        SUSHI_LOG_WARNING("Parameter batch to processor {} must have an even number of arguments", connection->processor);
+        return 0;
+    }
+    std::vector<BatchParameterValue> values;
+    values.reserve(argc / 2);
+    for (int i = 0; i < argc; i += 2)
+    {
+        if (types[i] != LO_INT32 || types[i + 1] != LO_FLOAT)
+        {
+            SUSHI_LOG_WARNING("Parameter batch to processor {} must consist of (int, float) pairs", connection->processor);
+            return 0;
+        }
+        values.push_back({static_cast<ObjectId>(argv[i]->i), argv[i + 1]->f});
+    }
+    connection->instance->send_parameter_batch_change_event(connection->processor, values);
+    SUSHI_LOG_DEBUG("Sending {} parameter changes to processor {}.", values.size(), connection->processor);
+    return 0;
+}
+
 static int osc_send_keyboard_event(const char* /*path*/,
                                    const char* /*types*/,
                                    lo_arg** argv,
@@ -379,6 +408,26 @@ bool OSCFrontend::connect_to_string_parameter(const std::string& processor_name,
     return true;
 }
 
+bool OSCFrontend::connect_to_parameter_batch(const std::string& processor_name)
+{
+    std::string osc_path = "/parameters/";
+    auto [processor_status, processor_id] = _engine->processor_id_from_name(processor_name);
+    if (processor_status != engine::EngineReturnStatus::OK)
+    {
+        return false;
+    }
+    osc_path = osc_path + osc::make_safe_path(processor_name);
+    OscConnection* connection = new OscConnection;
+    connection->processor = processor_id;
+    connection->parameter = 0;
+    connection->instance = this;
+    _connections.push_back(std::unique_ptr<OscConnection>(connection));
+    /* Null typespec since the number of arguments varies, types are checked in the callback */
+    lo_server_thread_add_method(_osc_server, osc_path.c_str(), nullptr, osc_send_parameter_batch_change_event, connection);
+    SUSHI_LOG_INFO("Added osc callback {}", osc_path);
+    return true;
+}
+
 bool OSCFrontend::connect_from_parameter(const std::string& processor_name, const std::string& parameter_name)
 {
     auto [processor_status, processor_id] = _engine->processor_id_from_name(processor_name);
@@ -458,6 +507,7 @@ void OSCFrontend::connect_all()
         {
             connect_to_program_change(processor.second->name());
         }
+        connect_to_parameter_batch(processor.second->name());
     }
     auto& tracks = _engine->all_tracks();
     for (auto& track : tracks)
@@ -64,6 +64,16 @@ public:
     bool connect_to_string_parameter(const std::string &processor_name,
                                      const std::string &parameter_name);
 
+    /**
+     * @brief Connect osc to setting several parameters of a given processor at once.
+     *        All values are applied within the same audio chunk.
+     *        The resulting osc path will be:
+     *        "/parameters/processor_name,ifif...(parameter_id, value, parameter_id, value...)"
+     * @param processor_name Name of the processor
+     * @return
+     */
+    bool connect_to_parameter_batch(const std::string& processor_name);
+
     /**
      * @brief Connect program change messages to a specific processor.
      *        The resulting osc path will be;
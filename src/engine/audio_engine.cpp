@@ -18,14 +18,18 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <cassert>
 #include <fstream>
 #include <iomanip>
 #include <functional>
+#include <algorithm>
+#include <cmath>
 
 #include "twine/src/twine_internal.h"
 
 #include "audio_engine.h"
 #include "logging.h"
+#include "library/midi_encoder.h"
 #include "plugins/passthrough_plugin.h"
 #include "plugins/gain_plugin.h"
 #include "plugins/lfo_plugin.h"
@@ -49,6 +53,22 @@ constexpr auto CLIPPING_DETECTION_INTERVAL = std::chrono::milliseconds(500);
 
 SUSHI_GET_LOGGER_WITH_MODULE_NAME("engine");
 
+/* Completion callback for graph edits that don't wait for the rt thread */
+void log_failed_graph_edit(void* /*arg*/, EventId id, bool status)
+{
+    if (status == false)
+    {
+        SUSHI_LOG_ERROR("Graph edit event {} failed in processing part", id);
+    }
+}
+
+/* Events whose data is only valid until the end of the chunk they are processed in */
+bool carries_payload(const RtEvent& event)
+{
+    return event.type() == RtEventType::SYSEX_EVENT ||
+           event.type() == RtEventType::STRING_PROPERTY_CHANGE ||
+           event.type() == RtEventType::DATA_PROPERTY_CHANGE;
+}
 
 void ClipDetector::set_sample_rate(float samplerate)
 {
@@ -90,6 +110,8 @@ AudioEngine::AudioEngine(float sample_rate, int rt_cpu_cores) : BaseEngine::Base
                                                                 _clip_detector(sample_rate)
 {
     this->set_sample_rate(sample_rate);
+    this->set_gate_input_channels(_gate_inputs);
+    this->set_gate_output_channels(_gate_outputs);
     _event_dispatcher.run();
     if (_multicore_processing)
     {
@@ -117,6 +139,7 @@ void AudioEngine::set_sample_rate(float sample_rate)
     _transport.set_sample_rate(sample_rate);
     _process_timer.set_timing_period(sample_rate, AUDIO_CHUNK_SIZE);
     _clip_detector.set_sample_rate(sample_rate);
+    _recorder.set_sample_rate(sample_rate);
 }
 
 void AudioEngine::set_audio_input_channels(int channels)
@@ -149,6 +172,28 @@ EngineReturnStatus AudioEngine::set_cv_output_channels(int channels)
     return BaseEngine::set_cv_output_channels(channels);
 }
 
+EngineReturnStatus AudioEngine::set_gate_input_channels(int channels)
+{
+    if (channels < 0 || channels > MAX_ENGINE_GATE_PORTS)
+    {
+        return EngineReturnStatus::INVALID_N_CHANNELS;
+    }
+    _gate_in_routes.resize(channels);
+    _prev_gate_values.resize(channels);
+    _gate_diffs.resize(channels);
+    return BaseEngine::set_gate_input_channels(channels);
+}
+
+EngineReturnStatus AudioEngine::set_gate_output_channels(int channels)
+{
+    if (channels < 0 || channels > MAX_ENGINE_GATE_PORTS)
+    {
+        return EngineReturnStatus::INVALID_N_CHANNELS;
+    }
+    _outgoing_gate_values.resize(channels);
+    return BaseEngine::set_gate_output_channels(channels);
+}
+
 EngineReturnStatus AudioEngine::connect_audio_input_channel(int input_channel, int track_channel, const std::string& track_name)
 {
     auto processor_node = _processors.find(track_name);
@@ -186,6 +231,23 @@ EngineReturnStatus AudioEngine::connect_audio_output_channel(int output_channel,
     return EngineReturnStatus::OK;
 }
 
+bool AudioEngine::audio_input_channel_connected(int input_channel)
+{
+    /* Inputs recorded by a tap are consumed even if no track is connected to them */
+    if (input_channel < _recorder.engine_input_channels())
+    {
+        return true;
+    }
+    return std::any_of(_in_audio_connections.begin(), _in_audio_connections.end(),
+                       [&](const auto& c) {return c.engine_channel == input_channel;});
+}
+
+bool AudioEngine::audio_output_channel_connected(int output_channel)
+{
+    return std::any_of(_out_audio_connections.begin(), _out_audio_connections.end(),
+                       [&](const auto& c) {return c.engine_channel == output_channel;});
+}
+
 EngineReturnStatus AudioEngine::connect_audio_input_bus(int input_bus, int track_bus, const std::string& track_name)
 {
     auto status = connect_audio_input_channel(input_bus * 2, track_bus * 2, track_name);
@@ -265,7 +327,7 @@ EngineReturnStatus AudioEngine::connect_gate_to_processor(const std::string& pro
                                                           int note_no,
                                                           int channel)
 {
-    if (gate_input_id >= MAX_ENGINE_GATE_PORTS || note_no > MAX_ENGINE_GATE_NOTE_NO)
+    if (gate_input_id < 0 || gate_input_id >= _gate_inputs || note_no > MAX_ENGINE_GATE_NOTE_NO)
     {
         return EngineReturnStatus::ERROR;
     }
@@ -279,7 +341,7 @@ EngineReturnStatus AudioEngine::connect_gate_to_processor(const std::string& pro
     con.note_no = note_no;
     con.channel = channel;
     con.gate_id = gate_input_id;
-    _gate_in_routes.push_back(con);
+    _gate_in_routes[gate_input_id].push_back(con);
     SUSHI_LOG_INFO("Connected gate input {} to processor {} on channel {}", gate_input_id, processor_name, channel);
     return EngineReturnStatus::OK;
 }
@@ -289,7 +351,7 @@ EngineReturnStatus AudioEngine::connect_gate_from_processor(const std::string& p
                                                             int note_no,
                                                             int channel)
 {
-    if (gate_output_id >= MAX_ENGINE_GATE_PORTS || note_no > MAX_ENGINE_GATE_NOTE_NO)
+    if (gate_output_id < 0 || gate_output_id >= _gate_outputs || note_no > MAX_ENGINE_GATE_NOTE_NO)
     {
         return EngineReturnStatus::ERROR;
     }
@@ -307,15 +369,26 @@ EngineReturnStatus AudioEngine::connect_gate_from_processor(const std::string& p
     return EngineReturnStatus::OK;
 }
 
-EngineReturnStatus AudioEngine::connect_gate_to_sync(int /*gate_input_id*/, int /*ppq_ticks*/)
+EngineReturnStatus AudioEngine::connect_gate_to_sync(int gate_input_id, int ppq_ticks)
 {
-    // TODO -  Needs implementing
+    if (gate_input_id < 0 || gate_input_id >= _gate_inputs || ppq_ticks <= 0)
+    {
+        return EngineReturnStatus::ERROR;
+    }
+    _sync_gate_in = SyncGateConnection{gate_input_id, ppq_ticks};
+    _gate_tempo_estimator.set_ticks_per_quarter_note(ppq_ticks);
+    SUSHI_LOG_INFO("Connected gate input {} as sync input with {} ppq", gate_input_id, ppq_ticks);
     return EngineReturnStatus::OK;
 }
 
-EngineReturnStatus AudioEngine::connect_sync_to_gate(int /*gate_output_id*/, int /*ppq_ticks*/)
+EngineReturnStatus AudioEngine::connect_sync_to_gate(int gate_output_id, int ppq_ticks)
 {
-    // TODO -  Needs implementing
+    if (gate_output_id < 0 || gate_output_id >= _gate_outputs || ppq_ticks <= 0)
+    {
+        return EngineReturnStatus::ERROR;
+    }
+    _sync_gate_out = SyncGateConnection{gate_output_id, ppq_ticks};
+    SUSHI_LOG_INFO("Connected sync output to gate {} with {} ppq", gate_output_id, ppq_ticks);
     return EngineReturnStatus::OK;
 }
 
@@ -427,6 +500,7 @@ EngineReturnStatus AudioEngine::_deregister_processor(const std::string &name)
     {
         return EngineReturnStatus::INVALID_PLUGIN_NAME;
     }
+    _recorder.remove_source(processor_node->second->id());
     _processors.erase(processor_node);
     return EngineReturnStatus::OK;
 }
@@ -493,13 +567,26 @@ void AudioEngine::process_chunk(SampleBuffer<AUDIO_CHUNK_SIZE>* in_buffer,
     {
         send_rt_event(in_event);
     }
+    while (_input_event_queue.pop(in_event))
+    {
+        send_rt_event(in_event);
+    }
     while (_main_in_queue.pop(in_event))
     {
+        if (carries_payload(in_event) && _hold_payload(in_event) == false)
+        {
+            continue;
+        }
         send_rt_event(in_event);
     }
 
-    if (_cv_inputs > 0)
+    /* Control buffers must be dimensioned by the frontend after the cv and gate channels are set */
+    assert(static_cast<int>(out_controls->cv_values.size()) >= _cv_outputs);
+    assert(out_controls->gate_values.size() == _gate_outputs);
+    if (_cv_inputs > 0 || _gate_inputs > 0)
     {
+        assert(static_cast<int>(in_controls->cv_values.size()) >= _cv_inputs);
+        assert(in_controls->gate_values.size() == _gate_inputs);
         _route_cv_gate_ins(*in_controls);
     }
 
@@ -510,7 +597,17 @@ void AudioEngine::process_chunk(SampleBuffer<AUDIO_CHUNK_SIZE>* in_buffer,
     {
         _clip_detector.detect_clipped_samples(*in_buffer, _main_out_queue, true);
     }
+    _recorder.record_engine_input(*in_buffer);
     _copy_audio_to_tracks(in_buffer);
+    _output_sync_signals();
+    if (_audio_rate_cv)
+    {
+        /* Cv outputs hold their previous value until a processor sends a new one */
+        for (int i = 0; i < _cv_outputs; ++i)
+        {
+            out_controls->cv_samples[i].fill(out_controls->cv_values[i]);
+        }
+    }
 
     if (_multicore_processing)
     {
@@ -539,6 +636,8 @@ void AudioEngine::process_chunk(SampleBuffer<AUDIO_CHUNK_SIZE>* in_buffer,
     {
         _clip_detector.detect_clipped_samples(*out_buffer, _main_out_queue, false);
     }
+    _recorder.record_engine_output(*out_buffer);
+    _release_payloads();
     _process_timer.stop_timer(engine_timestamp, ENGINE_TIMING_ID);
 }
 
@@ -600,12 +699,15 @@ EngineReturnStatus AudioEngine::send_rt_event(RtEvent& event)
     {
         return EngineReturnStatus::OK;
     }
-    if (event.processor_id() > _realtime_processors.size())
+    Processor* processor_node = nullptr;
+    if (event.processor_id() < _realtime_processors.size())
     {
-        SUSHI_LOG_WARNING("Invalid processor id {}.", event.processor_id());
-        return EngineReturnStatus::INVALID_PROCESSOR;
+        processor_node = _realtime_processors[event.processor_id()];
+    }
+    if (event.type() == RtEventType::PARAMETER_CHANGE_BATCH)
+    {
+        return _apply_parameter_batch(processor_node, event);
     }
-    auto processor_node = _realtime_processors[event.processor_id()];
     if (processor_node == nullptr)
     {
         SUSHI_LOG_WARNING("Invalid processor id {}.", event.processor_id());
@@ -625,6 +727,37 @@ EngineReturnStatus AudioEngine::send_async_event(RtEvent& event)
     return EngineReturnStatus::QUEUE_FULL;
 }
 
+EngineReturnStatus AudioEngine::send_input_event(const RtEvent& event)
+{
+    if (_input_event_queue.push(event))
+    {
+        return EngineReturnStatus::OK;
+    }
+    return EngineReturnStatus::QUEUE_FULL;
+}
+
+EngineReturnStatus AudioEngine::send_async_event_with_callback(RtEvent& event,
+                                                               receiver::AsyncResponseCallback callback,
+                                                               void* callback_arg)
+{
+    if (event.type() < RtEventType::STOP_ENGINE)
+    {
+        return EngineReturnStatus::ERROR;
+    }
+    auto status = send_async_event(event);
+    if (status == EngineReturnStatus::OK)
+    {
+        /* If the response has already been drained, the callback is called directly */
+        _event_receiver.wait_for_response_async(event.returnable_event()->event_id(), callback, callback_arg);
+    }
+    return status;
+}
+
+void AudioEngine::process_async_responses()
+{
+    _event_receiver.process_responses();
+}
+
 
 std::pair<EngineReturnStatus, ObjectId> AudioEngine::processor_id_from_name(const std::string& name)
 {
@@ -685,6 +818,7 @@ EngineReturnStatus AudioEngine::create_multibus_track(const std::string& name, i
         return EngineReturnStatus::INVALID_N_CHANNELS;
     }
     Track* track = new Track(_host_control, input_busses, output_busses, &_process_timer);
+    track->set_recorder(&_recorder);
     return _register_new_track(name, track);
 }
 
@@ -696,6 +830,7 @@ EngineReturnStatus AudioEngine::create_track(const std::string &name, int channe
         return EngineReturnStatus::INVALID_N_CHANNELS;
     }
     Track* track = new Track(_host_control, channel_count, &_process_timer);
+    track->set_recorder(&_recorder);
     return _register_new_track(name, track);
 }
 
@@ -791,15 +926,14 @@ EngineReturnStatus AudioEngine::add_plugin_to_track(const std::string &track_nam
     if (realtime())
     {
         // In realtime mode we need to handle this in the audio thread
+        // Events are handled in order, so there is no need to wait for the rt thread here
         auto insert_event = RtEvent::make_insert_processor_event(plugin);
         auto add_event = RtEvent::make_add_processor_to_track_event(plugin->id(), track->id());
-        send_async_event(insert_event);
-        send_async_event(add_event);
-        bool inserted = _event_receiver.wait_for_response(insert_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
-        bool added = _event_receiver.wait_for_response(add_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
-        if (!inserted || !added)
+        auto inserted = send_async_event_with_callback(insert_event, log_failed_graph_edit, nullptr);
+        auto added = send_async_event_with_callback(add_event, log_failed_graph_edit, nullptr);
+        if (inserted != EngineReturnStatus::OK || added != EngineReturnStatus::OK)
         {
-            SUSHI_LOG_ERROR("Failed to insert/add processor {} to processing part", plugin_name);
+            SUSHI_LOG_ERROR("Failed to send insert/add events for processor {} to processing part", plugin_name);
             return EngineReturnStatus::INVALID_PROCESSOR;
         }
     }
@@ -893,13 +1027,11 @@ EngineReturnStatus AudioEngine::_register_new_track(const std::string& name, Tra
     {
         auto insert_event = RtEvent::make_insert_processor_event(track);
         auto add_event = RtEvent::make_add_track_event(track->id());
-        send_async_event(insert_event);
-        send_async_event(add_event);
-        bool inserted = _event_receiver.wait_for_response(insert_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
-        bool added = _event_receiver.wait_for_response(add_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
-        if (!inserted || !added)
+        auto inserted = send_async_event_with_callback(insert_event, log_failed_graph_edit, nullptr);
+        auto added = send_async_event_with_callback(add_event, log_failed_graph_edit, nullptr);
+        if (inserted != EngineReturnStatus::OK || added != EngineReturnStatus::OK)
         {
-            SUSHI_LOG_ERROR("Failed to insert/add track {} to processing part", name);
+            SUSHI_LOG_ERROR("Failed to send insert/add events for track {} to processing part", name);
             return EngineReturnStatus::INVALID_PROCESSOR;
         }
     } else
@@ -915,6 +1047,40 @@ EngineReturnStatus AudioEngine::_register_new_track(const std::string& name, Tra
     return EngineReturnStatus::OK;
 }
 
+EngineReturnStatus AudioEngine::_apply_parameter_batch(Processor* processor, RtEvent& event)
+{
+    /* Split the batch into regular parameter change events so that processors
+     * don't need to know about it, then hand back the value array */
+    auto typed_event = event.parameter_batch_event();
+    auto values = typed_event->values();
+    auto status = EngineReturnStatus::OK;
+    if (processor == nullptr)
+    {
+        SUSHI_LOG_WARNING("Invalid processor id {}.", event.processor_id());
+        status = EngineReturnStatus::INVALID_PROCESSOR;
+    }
+    else
+    {
+        for (int i = 0; i < typed_event->count(); ++i)
+        {
+            auto param_event = RtEvent::make_parameter_change_event(typed_event->processor_id(),
+                                                                    typed_event->sample_offset(),
+                                                                    values[i].parameter_id,
+                                                                    values[i].value);
+            processor->process_event(param_event);
+        }
+    }
+    if (typed_event->in_transfer_ring())
+    {
+        RtTransferRing::release(values);
+    }
+    else
+    {
+        _main_out_queue.push(RtEvent::make_delete_parameter_batch_event(values));
+    }
+    return status;
+}
+
 bool AudioEngine::_handle_internal_events(RtEvent& event)
 {
     switch (event.type())
@@ -1140,32 +1306,154 @@ void AudioEngine::_route_cv_gate_ins(ControlBuffer& buffer)
         float value = buffer.cv_values[r.cv_id];
         auto ev = RtEvent::make_parameter_change_event(r.processor_id, 0, r.parameter_id, value);
         send_rt_event(ev);
+        /* Parameters that don't support modulation still follow the cv at chunk rate */
+        if (_audio_rate_cv && r.processor_id < _realtime_processors.size())
+        {
+            auto processor = _realtime_processors[r.processor_id];
+            if (processor)
+            {
+                processor->set_parameter_modulation(r.parameter_id, buffer.cv_samples[r.cv_id].data());
+            }
+        }
     }
     // Get gate state changes by xor:ing with previous states
-    auto gate_diffs = _prev_gate_values ^ buffer.gate_values;
-    if (gate_diffs.any())
+    _gate_diffs = _prev_gate_values;
+    _gate_diffs ^= buffer.gate_values;
+    if (_gate_diffs.any())
     {
-        for (const auto& r : _gate_in_routes)
+        /* Only the routes of gates that changed are visited, one word of gates at a time */
+        for (int w = 0; w < _gate_diffs.words(); ++w)
         {
-            if (gate_diffs[r.gate_id])
+            uint32_t changed = _gate_diffs.word(w);
+            while (changed)
             {
-                auto gate_high = buffer.gate_values[r.gate_id];
-                if (gate_high)
+                int gate_id = w * DynamicBitSet::BITS_PER_WORD + __builtin_ctz(changed);
+                changed &= changed - 1;
+                bool gate_high = buffer.gate_values[gate_id];
+                for (const auto& r : _gate_in_routes[gate_id])
                 {
-                    auto ev = RtEvent::make_note_on_event(r.processor_id, 0, r.channel, r.note_no, 1.0f);
-                    send_rt_event(ev);
-                }
-                else
-                {
-                    auto ev = RtEvent::make_note_off_event(r.processor_id, 0, r.channel, r.note_no, 1.0f);
+                    auto ev = gate_high ? RtEvent::make_note_on_event(r.processor_id, 0, r.channel, r.note_no, 1.0f) :
+                                          RtEvent::make_note_off_event(r.processor_id, 0, r.channel, r.note_no, 1.0f);
                     send_rt_event(ev);
                 }
             }
         }
+        /* Sync pulses are only registered with chunk resolution, the estimator takes care of the jitter */
+        if (_sync_gate_in && _gate_diffs[_sync_gate_in->gate_id] && buffer.gate_values[_sync_gate_in->gate_id] &&
+            _transport.sync_mode() == SyncMode::GATE_INPUT)
+        {
+            if (_gate_tempo_estimator.tick(_transport.current_process_time()))
+            {
+                _transport.set_tempo(_gate_tempo_estimator.tempo());
+            }
+        }
     }
     _prev_gate_values = buffer.gate_values;
 }
 
+bool AudioEngine::_hold_payload(const RtEvent& event)
+{
+    if (_held_payload_events < static_cast<int>(_held_payloads.size()))
+    {
+        _held_payloads[_held_payload_events++] = event;
+        return true;
+    }
+    /* No room to keep track of the payload, release it straight away instead of processing it */
+    _release_payload(event);
+    return false;
+}
+
+void AudioEngine::_release_payload(const RtEvent& event)
+{
+    BlobData payload;
+    bool in_transfer_ring;
+    switch (event.type())
+    {
+        case RtEventType::SYSEX_EVENT:
+        {
+            auto typed_event = event.sysex_event();
+            payload = {typed_event->size(), const_cast<uint8_t*>(typed_event->data())};
+            in_transfer_ring = typed_event->in_transfer_ring();
+            break;
+        }
+        case RtEventType::STRING_PROPERTY_CHANGE:
+        {
+            auto typed_event = event.string_parameter_change_event();
+            auto value = typed_event->value();
+            payload = {static_cast<int>(value.size()), reinterpret_cast<uint8_t*>(const_cast<char*>(value.data()))};
+            in_transfer_ring = typed_event->in_transfer_ring();
+            break;
+        }
+        case RtEventType::DATA_PROPERTY_CHANGE:
+        {
+            auto typed_event = event.data_parameter_change_event();
+            payload = typed_event->value();
+            in_transfer_ring = typed_event->in_transfer_ring();
+            break;
+        }
+        default:
+            return;
+    }
+    if (in_transfer_ring)
+    {
+        RtTransferRing::release(payload.data);
+    }
+    else
+    {
+        _main_out_queue.push(RtEvent::make_delete_blob_event(payload));
+    }
+}
+
+void AudioEngine::_release_payloads()
+{
+    for (int i = 0; i < _held_payload_events; ++i)
+    {
+        _release_payload(_held_payloads[i]);
+    }
+    _held_payload_events = 0;
+}
+
+void AudioEngine::_output_sync_signals()
+{
+    if (_midi_clock_output_enabled == false && !_sync_gate_out)
+    {
+        return;
+    }
+    bool playing = _transport.playing();
+    if (_midi_clock_output_enabled && playing != _sync_output_playing)
+    {
+        auto msg = playing ? midi::encode_start_message() : midi::encode_stop_message();
+        _main_out_queue.push(RtEvent::make_wrapped_midi_event(MIDI_CLOCK_SOURCE_ID, 0, msg));
+    }
+    _sync_output_playing = playing;
+    double chunk_start = _transport.current_beats();
+    double chunk_end = _transport.current_beats(AUDIO_CHUNK_SIZE);
+
+    if (_midi_clock_output_enabled && playing)
+    {
+        /* Clock ticks are placed on the exact sample where they occur */
+        double start_tick = chunk_start * midi::CLOCK_TICKS_PER_QUARTER_NOTE;
+        double end_tick = chunk_end * midi::CLOCK_TICKS_PER_QUARTER_NOTE;
+        double ticks_per_sample = (end_tick - start_tick) / AUDIO_CHUNK_SIZE;
+        for (auto tick = std::ceil(start_tick); tick < end_tick; tick += 1.0)
+        {
+            int offset = std::clamp(static_cast<int>((tick - start_tick) / ticks_per_sample), 0, AUDIO_CHUNK_SIZE - 1);
+            _main_out_queue.push(RtEvent::make_wrapped_midi_event(MIDI_CLOCK_SOURCE_ID, offset,
+                                                                  midi::encode_timing_clock()));
+        }
+    }
+
+    if (_sync_gate_out)
+    {
+        /* Gate outputs only have chunk resolution, so the gate goes high in the chunk where
+         * a pulse starts and stays high for the first half of the pulse period */
+        double start_pulse = chunk_start * _sync_gate_out->ppq_ticks;
+        double end_pulse = chunk_end * _sync_gate_out->ppq_ticks;
+        bool gate_high = std::floor(end_pulse) > std::floor(start_pulse) || start_pulse - std::floor(start_pulse) < 0.5;
+        _outgoing_gate_values.set(_sync_gate_out->gate_id, playing && gate_high);
+    }
+}
+
 void AudioEngine::_process_outgoing_events(ControlBuffer& buffer, RtSafeRtEventFifo& source_queue)
 {
     RtEvent event;
@@ -1177,13 +1465,18 @@ void AudioEngine::_process_outgoing_events(ControlBuffer& buffer, RtSafeRtEventF
             {
                 auto typed_event = event.cv_event();
                 buffer.cv_values[typed_event->cv_id()] = typed_event->value();
+                if (_audio_rate_cv)
+                {
+                    auto& samples = buffer.cv_samples[typed_event->cv_id()];
+                    std::fill(samples.begin() + typed_event->sample_offset(), samples.end(), typed_event->value());
+                }
                 break;
             }
 
             case RtEventType::GATE_EVENT:
             {
                 auto typed_event = event.gate_event();
-                _outgoing_gate_values[typed_event->gate_no()] = typed_event->value();
+                _outgoing_gate_values.set(typed_event->gate_no(), typed_event->value());
                 break;
             }
 
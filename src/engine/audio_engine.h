@@ -21,11 +21,13 @@
 #ifndef SUSHI_ENGINE_H
 #define SUSHI_ENGINE_H
 
+#include <array>
 #include <memory>
 #include <map>
 #include <vector>
 #include <utility>
 #include <mutex>
+#include <optional>
 
 #include "twine/twine.h"
 
@@ -36,14 +38,17 @@
 #include "engine/transport.h"
 #include "engine/host_control.h"
 #include "engine/controller.h"
+#include "engine/recorder.h"
 #include "library/time.h"
 #include "library/sample_buffer.h"
 #include "library/elk_allocator.h"
 #include "library/internal_plugin.h"
 #include "library/midi_decoder.h"
 #include "library/rt_event_fifo.h"
+#include "library/rt_transfer_ring.h"
 #include "library/types.h"
 #include "library/performance_timer.h"
+#include "library/tempo_estimator.h"
 
 namespace sushi {
 namespace engine {
@@ -132,6 +137,22 @@ public:
      */
     EngineReturnStatus set_cv_output_channels(int channels) override;
 
+    /**
+     * @brief Set the number of gate inputs, set by the audio frontend before
+     *        starting processing
+     * @param channels The number of gate input channels to use
+     * @return EngineReturnStatus::OK if successful, error status otherwise
+     */
+    EngineReturnStatus set_gate_input_channels(int channels) override;
+
+    /**
+     * @brief Set the number of gate outputs, set by the audio frontend before
+     *        starting processing
+     * @param channels The number of gate output channels to use
+     * @return EngineReturnStatus::OK if successful, error status otherwise
+     */
+    EngineReturnStatus set_gate_output_channels(int channels) override;
+
     /**
      * @brief Connect an engine input channel to an input channel of a given track.
      *        Not safe to call while the engine is running.
@@ -156,6 +177,22 @@ public:
                                                     int track_channel,
                                                     const std::string& track_name) override;
 
+    /**
+     * @brief Query whether an engine input channel is connected to any track. Lets
+     *        frontends skip copying audio that would never be read.
+     * @param input_channel Index of the engine input channel
+     * @return true if the channel is connected to at least one track
+     */
+    bool audio_input_channel_connected(int input_channel) override;
+
+    /**
+     * @brief Query whether any track is connected to an engine output channel.
+     *        Unconnected output channels are always silent.
+     * @param output_channel Index of the engine output channel
+     * @return true if at least one track is connected to the channel
+     */
+    bool audio_output_channel_connected(int output_channel) override;
+
     /**
      * @brief Connect a stereo pair (bus) from an engine input bus to an input bus of
      *        given track. Not safe to use while the engine in running.
@@ -235,7 +272,8 @@ public:
                                                    int channel) override;
 
     /**
-     * @brief Use a selected gate input as sync input.
+     * @brief Use a selected gate input as sync input. Sync pulses only affect the
+     *        tempo when the sync mode is set to SyncMode::GATE_INPUT.
      * @param gate_input_id The gate input port to use as sync input.
      * @param ppq_ticks Number of ticks per quarternote.
      * @return EngineReturnStatus::OK if successful, error status otherwise
@@ -347,6 +385,35 @@ public:
      * @return EngineReturnStatus::OK if the event was properly processed, error code otherwise
      */
     EngineReturnStatus send_async_event(RtEvent& event) override;
+
+    /**
+     * @brief Called from a non-realtime input thread, i.e. a midi frontend, to send an
+     *        event directly to the realtime thread, bypassing the event dispatcher.
+     *        Must only be called from one thread.
+     * @param event The event to process, with its sample offset set
+     * @return EngineReturnStatus::OK if the event was queued, error code otherwise
+     */
+    EngineReturnStatus send_input_event(const RtEvent& event) override;
+
+    /**
+     * @brief Called from a non-realtime thread to process a returnable event in the
+     *        realtime thread without blocking. The callback is called from the thread
+     *        calling process_async_responses() once the event has been handled.
+     * @param event The event to process, must be a returnable event
+     * @param callback Function to call on completion
+     * @param callback_arg Data passed to the callback
+     * @return EngineReturnStatus::OK if the event was queued, error code otherwise
+     */
+    EngineReturnStatus send_async_event_with_callback(RtEvent& event,
+                                                      receiver::AsyncResponseCallback callback,
+                                                      void* callback_arg) override;
+
+    /**
+     * @brief Call completion callbacks and wake up threads waiting for responses
+     *        from the realtime thread. Called periodically from the event dispatcher.
+     */
+    void process_async_responses() override;
+
     /**
      * @brief Get the unique id of a processor given its name
      * @param unique_name The unique name of a processor
@@ -479,6 +546,16 @@ public:
         _output_clip_detection_enabled = enabled;
     }
 
+    /**
+     * @brief Generate midi clock, start and stop messages from the transport. Messages
+     *        are sent with MIDI_CLOCK_SOURCE_ID as processor id.
+     * @param enabled Enable if true, disable if false
+     */
+    void enable_midi_clock_output(bool enabled) override
+    {
+        _midi_clock_output_enabled = enabled;
+    }
+
     sushi::dispatcher::BaseEventDispatcher* event_dispatcher() override
     {
         return &_event_dispatcher;
@@ -499,6 +576,11 @@ public:
         return &_process_timer;
     }
 
+    Recorder* recorder() override
+    {
+        return &_recorder;
+    }
+
     /**
      * @brief Print the current processor timings (in enabled) in the log
      */
@@ -570,6 +652,8 @@ private:
      */
     bool _handle_internal_events(RtEvent &event);
 
+    EngineReturnStatus _apply_parameter_batch(Processor* processor, RtEvent& event);
+
     inline void _retrieve_events_from_tracks(ControlBuffer& buffer);
 
     inline void _copy_audio_to_tracks(ChunkSampleBuffer* input);
@@ -582,6 +666,14 @@ private:
 
     void _process_outgoing_events(ControlBuffer& buffer, RtSafeRtEventFifo& source_queue);
 
+    void _output_sync_signals();
+
+    bool _hold_payload(const RtEvent& event);
+
+    void _release_payload(const RtEvent& event);
+
+    void _release_payloads();
+
     const bool _multicore_processing;
     const int  _rt_cores;
 
@@ -621,14 +713,33 @@ private:
     };
 
     std::vector<CvConnection> _cv_in_routes;
-    std::vector<GateConnection> _gate_in_routes;
-    BitSet32 _prev_gate_values{0};
-    BitSet32 _outgoing_gate_values{0};
+    /* Indexed by gate input */
+    std::vector<std::vector<GateConnection>> _gate_in_routes;
+    DynamicBitSet _prev_gate_values;
+    DynamicBitSet _gate_diffs;
+    DynamicBitSet _outgoing_gate_values;
+
+    struct SyncGateConnection
+    {
+        int gate_id;
+        int ppq_ticks;
+    };
+
+    std::optional<SyncGateConnection> _sync_gate_in;
+    std::optional<SyncGateConnection> _sync_gate_out;
+    TempoEstimator _gate_tempo_estimator{1};
+    bool _midi_clock_output_enabled{false};
+    bool _sync_output_playing{false};
+
+    // Sysex, string and blob events received this chunk, their payloads are released at the end of the chunk
+    std::array<RtEvent, MAX_EVENTS_IN_QUEUE> _held_payloads;
+    int _held_payload_events{0};
 
     std::atomic<RealtimeState> _state{RealtimeState::STOPPED};
 
     RtSafeRtEventFifo _internal_control_queue;
     RtSafeRtEventFifo _main_in_queue;
+    RtSafeRtEventFifo _input_event_queue;
     RtSafeRtEventFifo _processor_out_queue;
     RtSafeRtEventFifo _main_out_queue;
     RtSafeRtEventFifo _control_queue_out;
@@ -646,6 +757,7 @@ private:
     bool _input_clip_detection_enabled{false};
     bool _output_clip_detection_enabled{false};
     ClipDetector _clip_detector;
+    Recorder _recorder;
 };
 
 /**
@@ -25,12 +25,13 @@
 #include <map>
 #include <vector>
 #include <utility>
-#include <bitset>
 #include <limits>
 
 #include "library/constants.h"
+#include "library/dynamic_bitset.h"
 #include "base_event_dispatcher.h"
 #include "engine/track.h"
+#include "engine/receiver.h"
 #include "library/base_performance_timer.h"
 #include "library/time.h"
 #include "library/sample_buffer.h"
@@ -40,14 +41,34 @@
 namespace sushi {
 namespace engine {
 
-using BitSet32 = std::bitset<std::numeric_limits<uint32_t>::digits>;
-
+/**
+ * @brief Cv and gate data passed between the engine and the audio frontend every chunk.
+ *        Dimensioned at startup to the number of cv and gate ports in use.
+ */
 struct ControlBuffer
 {
-    ControlBuffer() : cv_values{0}, gate_values{0} {}
+    ControlBuffer() : ControlBuffer(DEFAULT_ENGINE_CV_IO_PORTS, DEFAULT_ENGINE_GATE_PORTS) {}
+
+    ControlBuffer(int cv_ports, int gate_ports)
+    {
+        resize(cv_ports, gate_ports);
+    }
+
+    /**
+     * @brief Set the number of cv and gate ports. Allocates, so not safe to call from the rt thread.
+     */
+    void resize(int cv_ports, int gate_ports)
+    {
+        cv_values.resize(cv_ports, 0.0f);
+        cv_samples.resize(cv_ports, std::array<float, AUDIO_CHUNK_SIZE>{});
+        gate_values.resize(gate_ports);
+    }
 
-    std::array<float, MAX_ENGINE_CV_IO_PORTS> cv_values;
-    BitSet32 gate_values;
+    std::vector<float> cv_values;
+    DynamicBitSet gate_values;
+    /* Full chunks of cv data, only used when audio rate cv is enabled. cv_values
+     * should then hold the last sample of every chunk. */
+    std::vector<std::array<float, AUDIO_CHUNK_SIZE>> cv_samples;
 };
 
 enum class EngineReturnStatus
@@ -83,6 +104,9 @@ enum class RealtimeState
 
 constexpr int ENGINE_TIMING_ID = -1;
 
+/* Reserved processor id used as source of midi clock messages generated by the engine */
+constexpr ObjectId MIDI_CLOCK_SOURCE_ID = std::numeric_limits<ObjectId>::max();
+
 class BaseEngine
 {
 public:
@@ -112,6 +136,16 @@ public:
         _audio_outputs = channels;
     }
 
+    int audio_input_channels() const
+    {
+        return _audio_inputs;
+    }
+
+    int audio_output_channels() const
+    {
+        return _audio_outputs;
+    }
+
     virtual EngineReturnStatus set_cv_input_channels(int channels)
     {
         _cv_inputs = channels;
@@ -125,6 +159,38 @@ public:
         return EngineReturnStatus::OK;
     }
 
+    virtual EngineReturnStatus set_gate_input_channels(int channels)
+    {
+        _gate_inputs = channels;
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus set_gate_output_channels(int channels)
+    {
+        _gate_outputs = channels;
+        return EngineReturnStatus::OK;
+    }
+
+    int cv_input_channels() const
+    {
+        return _cv_inputs;
+    }
+
+    int cv_output_channels() const
+    {
+        return _cv_outputs;
+    }
+
+    int gate_input_channels() const
+    {
+        return _gate_inputs;
+    }
+
+    int gate_output_channels() const
+    {
+        return _gate_outputs;
+    }
+
     virtual EngineReturnStatus connect_audio_input_channel(int /*engine_channel*/,
                                                            int /*track_channel*/,
                                                            const std::string& /*track_name*/)
@@ -201,6 +267,16 @@ public:
         return 2;
     }
 
+    virtual bool audio_input_channel_connected(int /*input_channel*/)
+    {
+        return true;
+    }
+
+    virtual bool audio_output_channel_connected(int /*output_channel*/)
+    {
+        return true;
+    }
+
     virtual bool realtime()
     {
         return true;
@@ -229,6 +305,20 @@ public:
 
     virtual EngineReturnStatus send_async_event(RtEvent& event) = 0;
 
+    virtual EngineReturnStatus send_input_event(const RtEvent& /*event*/)
+    {
+        return EngineReturnStatus::ERROR;
+    }
+
+    virtual EngineReturnStatus send_async_event_with_callback(RtEvent& /*event*/,
+                                                              receiver::AsyncResponseCallback /*callback*/,
+                                                              void* /*callback_arg*/)
+    {
+        return EngineReturnStatus::ERROR;
+    }
+
+    virtual void process_async_responses() {}
+
     virtual std::pair<EngineReturnStatus, ObjectId> processor_id_from_name(const std::string& /*name*/)
     {
         return std::make_pair(EngineReturnStatus::OK, 0);
@@ -317,10 +407,32 @@ public:
         return nullptr;
     }
 
+    virtual Recorder* recorder()
+    {
+        return nullptr;
+    }
+
     virtual void enable_input_clip_detection(bool /*enabled*/) {}
 
     virtual void enable_output_clip_detection(bool /*enabled*/) {}
 
+    virtual void enable_midi_clock_output(bool /*enabled*/) {}
+
+    /**
+     * @brief Exchange cv data with the frontend as full chunks in ControlBuffer::cv_samples
+     *        instead of as one value per chunk. Should be set before the frontend is initialised.
+     * @param enabled If true, cv inputs are passed on sample accurately to parameters that support it
+     */
+    void enable_audio_rate_cv(bool enabled)
+    {
+        _audio_rate_cv = enabled;
+    }
+
+    bool audio_rate_cv() const
+    {
+        return _audio_rate_cv;
+    }
+
     virtual void print_timings_to_log() {}
 
 protected:
@@ -329,6 +441,9 @@ protected:
     int _audio_outputs{0};
     int _cv_inputs{0};
     int _cv_outputs{0};
+    int _gate_inputs{DEFAULT_ENGINE_GATE_PORTS};
+    int _gate_outputs{DEFAULT_ENGINE_GATE_PORTS};
+    bool _audio_rate_cv{false};
 };
 
 } // namespace engine
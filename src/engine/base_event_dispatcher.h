@@ -22,6 +22,8 @@
 #ifndef SUSHI_BASE_EVENT_DISPATCHER_H
 #define SUSHI_BASE_EVENT_DISPATCHER_H
 
+#include <utility>
+
 #include "library/event.h"
 #include "library/event_interface.h"
 
@@ -59,6 +61,10 @@ public:
 
     virtual void set_sample_rate(float /*sample_rate*/) {}
     virtual void set_time(Time /*timestamp*/) {}
+
+    /* Returns true and the sample offset if an event with the given timestamp
+     * should be processed in the next audio chunk. Safe to call from any thread */
+    virtual std::pair<bool, int> sample_offset_from_realtime(Time /*timestamp*/) {return {false, 0};}
 };
 
 
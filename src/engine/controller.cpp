@@ -18,8 +18,11 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <cmath>
+
 #include "engine/controller.h"
 #include "engine/base_engine.h"
+#include "engine/recorder.h"
 
 #include "logging.h"
 
@@ -44,6 +47,28 @@ inline ext::ParameterType to_external(const sushi::ParameterType type)
     }
 }
 
+inline ext::RecordingSource to_external(const engine::RecordSource source)
+{
+    switch (source)
+    {
+        case engine::RecordSource::ENGINE_INPUT:      return ext::RecordingSource::ENGINE_INPUT;
+        case engine::RecordSource::ENGINE_OUTPUT:     return ext::RecordingSource::ENGINE_OUTPUT;
+        case engine::RecordSource::PROCESSOR_OUTPUT:  return ext::RecordingSource::PROCESSOR_OUTPUT;
+        default:                                      return ext::RecordingSource::ENGINE_OUTPUT;
+    }
+}
+
+inline engine::RecordSource to_internal(const ext::RecordingSource source)
+{
+    switch (source)
+    {
+        case ext::RecordingSource::ENGINE_INPUT:      return engine::RecordSource::ENGINE_INPUT;
+        case ext::RecordingSource::ENGINE_OUTPUT:     return engine::RecordSource::ENGINE_OUTPUT;
+        case ext::RecordingSource::PROCESSOR_OUTPUT:  return engine::RecordSource::PROCESSOR_OUTPUT;
+        default:                                      return engine::RecordSource::ENGINE_OUTPUT;
+    }
+}
+
 inline ext::PlayingMode to_external(const sushi::PlayingMode mode)
 {
     switch (mode)
@@ -105,6 +130,35 @@ inline ext::CpuTimings to_external(sushi::performance::ProcessTimings& internal)
     return {internal.avg_case, internal.min_case, internal.max_case};
 }
 
+/* Check that a value can be sent as a parameter change to the given processor */
+inline ext::ControlStatus check_parameter_value(const Processor* processor, int parameter_id, float value)
+{
+    if (processor == nullptr)
+    {
+        return ext::ControlStatus::NOT_FOUND;
+    }
+    auto descriptor = processor->parameter_from_id(static_cast<ObjectId>(parameter_id));
+    if (descriptor == nullptr)
+    {
+        return ext::ControlStatus::NOT_FOUND;
+    }
+    switch (descriptor->type())
+    {
+        case ParameterType::FLOAT:
+        case ParameterType::INT:
+        case ParameterType::BOOL:
+            break;
+
+        default:
+            return ext::ControlStatus::INVALID_ARGUMENTS;
+    }
+    if (std::isfinite(value) == false || value < descriptor->min_range() || value > descriptor->max_range())
+    {
+        return ext::ControlStatus::OUT_OF_RANGE;
+    }
+    return ext::ControlStatus::OK;
+}
+
 Controller::Controller(engine::BaseEngine* engine) : _engine{engine}
 {
     _event_dispatcher = _engine->event_dispatcher();
@@ -661,6 +715,119 @@ ext::ControlStatus Controller::set_string_property_value(int /*processor_id*/, i
     return ext::ControlStatus::UNSUPPORTED_OPERATION;
 }
 
+ext::ControlStatus Controller::set_parameter_values(int processor_id, const std::vector<ext::ParameterValue>& values)
+{
+    SUSHI_LOG_DEBUG("set_parameter_values called with processor {} and {} values", processor_id, values.size());
+    auto processor = _engine->processor(static_cast<ObjectId>(processor_id));
+    if (processor == nullptr)
+    {
+        return ext::ControlStatus::NOT_FOUND;
+    }
+    /* The whole batch is rejected if any value is invalid, so it's never partially applied */
+    std::vector<BatchParameterValue> batch;
+    batch.reserve(values.size());
+    for (const auto& value : values)
+    {
+        auto status = check_parameter_value(processor, value.parameter_id, value.value);
+        if (status != ext::ControlStatus::OK)
+        {
+            return status;
+        }
+        batch.push_back({static_cast<ObjectId>(value.parameter_id), value.value});
+    }
+    auto event = new ParameterBatchChangeEvent(static_cast<ObjectId>(processor_id), batch, IMMEDIATE_PROCESS);
+    _event_dispatcher->post_event(event);
+    return ext::ControlStatus::OK;
+}
+
+std::pair<ext::ControlStatus, int> Controller::create_recording_tap(ext::RecordingSource source, int processor_id)
+{
+    SUSHI_LOG_DEBUG("create_recording_tap called with processor {}", processor_id);
+    auto recorder = _engine->recorder();
+    if (recorder == nullptr)
+    {
+        return {ext::ControlStatus::UNSUPPORTED_OPERATION, 0};
+    }
+    int channels;
+    switch (source)
+    {
+        case ext::RecordingSource::ENGINE_INPUT:
+            channels = _engine->audio_input_channels();
+            break;
+
+        case ext::RecordingSource::ENGINE_OUTPUT:
+            channels = _engine->audio_output_channels();
+            break;
+
+        default:
+        {
+            auto processor = _engine->mutable_processor(static_cast<ObjectId>(processor_id));
+            if (processor == nullptr)
+            {
+                return {ext::ControlStatus::NOT_FOUND, 0};
+            }
+            channels = processor->output_channels();
+        }
+    }
+    int id = recorder->add_tap(to_internal(source), static_cast<ObjectId>(processor_id), channels);
+    if (id < 0)
+    {
+        return {ext::ControlStatus::ERROR, 0};
+    }
+    return {ext::ControlStatus::OK, id};
+}
+
+std::vector<ext::RecordingTapInfo> Controller::get_recording_taps() const
+{
+    SUSHI_LOG_DEBUG("get_recording_taps called");
+    std::vector<ext::RecordingTapInfo> returns;
+    auto recorder = _engine->recorder();
+    if (recorder == nullptr)
+    {
+        return returns;
+    }
+    int id = 0;
+    for (const auto& tap : recorder->tap_info())
+    {
+        ext::RecordingTapInfo info;
+        info.id = id++;
+        info.source = to_external(tap.source);
+        info.processor_id = static_cast<int>(tap.processor_id);
+        info.channels = tap.channels;
+        info.armed = tap.armed;
+        info.overruns = tap.overruns;
+        info.filename = tap.filename;
+        returns.push_back(info);
+    }
+    return returns;
+}
+
+ext::ControlStatus Controller::arm_recording_tap(int tap_id, const std::string& filename)
+{
+    SUSHI_LOG_DEBUG("arm_recording_tap called with tap {} and file {}", tap_id, filename);
+    auto recorder = _engine->recorder();
+    if (recorder == nullptr)
+    {
+        return ext::ControlStatus::UNSUPPORTED_OPERATION;
+    }
+    if (recorder->tap(tap_id) == nullptr)
+    {
+        return ext::ControlStatus::NOT_FOUND;
+    }
+    return recorder->arm(tap_id, filename) ? ext::ControlStatus::OK : ext::ControlStatus::ERROR;
+}
+
+ext::ControlStatus Controller::disarm_recording_tap(int tap_id)
+{
+    SUSHI_LOG_DEBUG("disarm_recording_tap called with tap {}", tap_id);
+    auto recorder = _engine->recorder();
+    if (recorder == nullptr)
+    {
+        return ext::ControlStatus::UNSUPPORTED_OPERATION;
+    }
+    return recorder->disarm(tap_id, _engine->realtime()) ? ext::ControlStatus::OK : ext::ControlStatus::NOT_FOUND;
+}
+
 std::pair<ext::ControlStatus, ext::CpuTimings> Controller::_get_timings(int node) const
 {
     if (_performance_timer->enabled())
@@ -89,6 +89,12 @@ public:
     ext::ControlStatus                                  set_parameter_value(int processor_id, int parameter_id, float value) override;
     ext::ControlStatus                                  set_parameter_value_normalised(int processor_id, int parameter_id, float value) override;
     ext::ControlStatus                                  set_string_property_value(int processor_id, int parameter_id, const std::string& value) override;
+    ext::ControlStatus                                  set_parameter_values(int processor_id, const std::vector<ext::ParameterValue>& values) override;
+
+    std::pair<ext::ControlStatus, int>                  create_recording_tap(ext::RecordingSource source, int processor_id) override;
+    std::vector<ext::RecordingTapInfo>                  get_recording_taps() const override;
+    ext::ControlStatus                                  arm_recording_tap(int tap_id, const std::string& filename) override;
+    ext::ControlStatus                                  disarm_recording_tap(int tap_id) override;
 
 protected:
     std::pair<ext::ControlStatus, ext::CpuTimings> _get_timings(int node) const;
@@ -18,6 +18,8 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <algorithm>
+
 #include "event_dispatcher.h"
 #include "engine/base_engine.h"
 #include "logging.h"
@@ -29,6 +31,35 @@ constexpr auto PRINT_TIMING_INTERVAL = std::chrono::seconds(5);
 
 SUSHI_GET_LOGGER_WITH_MODULE_NAME("event dispatcher");
 
+/* Returns the event as a parameter change if it is of a type that is coalesced, nullptr otherwise */
+inline ParameterChangeEvent* coalesced_parameter_change(Event* event)
+{
+    if (event->is_parameter_change_event() == false)
+    {
+        return nullptr;
+    }
+    auto typed_event = static_cast<ParameterChangeEvent*>(event);
+    switch (typed_event->subtype())
+    {
+        case ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE:
+        case ParameterChangeEvent::Subtype::INT_PARAMETER_CHANGE:
+        case ParameterChangeEvent::Subtype::BOOL_PARAMETER_CHANGE:
+            return typed_event;
+
+        default:
+            return nullptr;
+    }
+}
+
+inline void complete_event(Event* event, int status)
+{
+    if (event->completion_cb() != nullptr)
+    {
+        event->completion_cb()(event->callback_arg(), event, status);
+    }
+    delete event;
+}
+
 EventDispatcher::EventDispatcher(engine::BaseEngine* engine,
                                  RtSafeRtEventFifo* in_rt_queue,
                                  RtSafeRtEventFifo* out_rt_queue) : _running{false},
@@ -115,14 +146,26 @@ int EventDispatcher::process(Event* event)
     if (event->maps_to_rt_event())
     {
         auto [send_now, sample_offset] = _event_timer.sample_offset_from_realtime(event->time());
-        if (send_now)
+        if (send_now == false)
         {
-            if (_out_rt_queue->push(event->to_rt_event(sample_offset)))
-            {
-                return EventStatus::HANDLED_OK;
-            }
+            _add_to_waiting_list(event);
+            return EventStatus::QUEUED_HANDLING;
         }
-        _waiting_list.push_front(event);
+        if (_coalesce_parameter_change(event))
+        {
+            return EventStatus::QUEUED_HANDLING;
+        }
+        if (_pending_rt_events.empty() == false)
+        {
+            /* Keep the order relative to coalesced parameter changes that are not sent yet */
+            _pending_rt_events.push(event);
+            return EventStatus::QUEUED_HANDLING;
+        }
+        if (_send_to_rt(event, sample_offset))
+        {
+            return EventStatus::HANDLED_OK;
+        }
+        _add_to_waiting_list(event);
         return EventStatus::QUEUED_HANDLING;
     }
     if (event->is_parameter_change_notification())
@@ -139,6 +182,9 @@ void EventDispatcher::_event_loop()
     {
         auto start_time = std::chrono::system_clock::now();
 
+        /* Send queued events that are now due to the rt domain */
+        _process_waiting_events();
+
         /* Handle incoming Events */
         while (Event* event = _next_event())
         {
@@ -160,6 +206,8 @@ void EventDispatcher::_event_loop()
             }
             delete(event);
         }
+        _flush_rt_events();
+
         /* Handle incoming RtEvents */
         while (!_in_rt_queue->empty())
         {
@@ -167,6 +215,12 @@ void EventDispatcher::_event_loop()
             _in_rt_queue->pop(rt_event);
             _process_rt_event(rt_event);
         }
+        _flush_parameter_notifications();
+        _flush_keyboard_events();
+        _process_deferred_input();
+
+        /* Deliver completion notifications for returnable RtEvents */
+        _engine->process_async_responses();
         std::this_thread::sleep_until(start_time + THREAD_PERIODICITY);
     }
     while (_running);
@@ -196,7 +250,16 @@ int EventDispatcher::_process_rt_event(RtEvent &rt_event)
     }
     if (event->is_parameter_change_notification())
     {
-        _publish_parameter_events(event);
+        /* Only the last notification for each parameter is published */
+        auto typed_event = static_cast<ParameterChangeNotificationEvent*>(event);
+        auto replaced = _pending_parameter_notifications.insert(typed_event->processor_id(),
+                                                                typed_event->parameter_id(),
+                                                                typed_event);
+        if (replaced)
+        {
+            delete replaced.value();
+        }
+        return EventStatus::QUEUED_HANDLING;
     }
     if (event->is_engine_notification())
     {
@@ -211,15 +274,132 @@ int EventDispatcher::_process_rt_event(RtEvent &rt_event)
     return EventStatus::HANDLED_OK;
 }
 
-Event*EventDispatcher::_next_event()
+void EventDispatcher::_process_waiting_events()
 {
-    Event* event = nullptr;
-    if (!_waiting_list.empty())
+    /* Events are sorted on timestamp so we can stop at the first event
+     * that is not due yet, or if the rt queue is full */
+    while (!_waiting_list.empty())
+    {
+        Event* event = _waiting_list.top().event;
+        auto [send_now, sample_offset] = _event_timer.sample_offset_from_realtime(event->time());
+        if (send_now == false || _send_to_rt(event, sample_offset) == false)
+        {
+            break;
+        }
+        _waiting_list.pop();
+        auto typed_event = _waiting_parameter_changes.empty() ? nullptr : coalesced_parameter_change(event);
+        if (typed_event != nullptr)
+        {
+            auto slot = _waiting_parameter_changes.find(parameter_key(typed_event->processor_id(), typed_event->parameter_id()));
+            if (slot != _waiting_parameter_changes.end() && slot->second == typed_event)
+            {
+                _waiting_parameter_changes.erase(slot);
+            }
+        }
+        complete_event(event, EventStatus::HANDLED_OK);
+    }
+}
+
+bool EventDispatcher::_send_to_rt(Event* event, int sample_offset)
+{
+    /* The dispatcher is the only producer to the rt queue, so checking for room
+     * first guarantees that payloads put in the transfer ring are always consumed */
+    if (_out_rt_queue->full())
     {
-        event = _waiting_list.back();
-        _waiting_list.pop_back();
+        return false;
     }
-    else if (!_in_queue.empty())
+    return _out_rt_queue->push(event->to_rt_event_in_ring(sample_offset, _transfer_ring));
+}
+
+bool EventDispatcher::_coalesce_parameter_change(Event* event)
+{
+    auto typed_event = coalesced_parameter_change(event);
+    if (typed_event == nullptr)
+    {
+        return false;
+    }
+    /* Only changes that would be sent in the next chunk are coalesced,
+     * future events are still applied at their set time */
+    if (_replace_waiting_parameter_change(typed_event))
+    {
+        complete_event(event, EventStatus::HANDLED_OK);
+        return true;
+    }
+    auto replaced = _pending_rt_events.insert(typed_event->processor_id(), typed_event->parameter_id(), event);
+    if (replaced)
+    {
+        complete_event(replaced.value(), EventStatus::HANDLED_OK);
+    }
+    return true;
+}
+
+bool EventDispatcher::_replace_waiting_parameter_change(ParameterChangeEvent* event)
+{
+    /* A value of the same parameter that is already due but still waiting for room
+     * in the rt queue is stale, the new value is written to its slot in place */
+    auto slot = _waiting_parameter_changes.find(parameter_key(event->processor_id(), event->parameter_id()));
+    if (slot == _waiting_parameter_changes.end())
+    {
+        return false;
+    }
+    slot->second->set_value(event->float_value());
+    return true;
+}
+
+void EventDispatcher::_flush_rt_events()
+{
+    /* The sample offset of the last change for each parameter is kept, any
+     * smoothing between the old and new value is left to the processor */
+    bool blocked = false;
+    for (auto event : _pending_rt_events.values())
+    {
+        if (event == nullptr)
+        {
+            continue;
+        }
+        auto [send_now, sample_offset] = _event_timer.sample_offset_from_realtime(event->time());
+        /* Once an event has to wait, all following events wait too so that they stay in order */
+        blocked = blocked || send_now == false || _send_to_rt(event, sample_offset) == false;
+        if (blocked)
+        {
+            _add_to_waiting_list(event);
+            /* All pending events are due, so the value can be replaced until it is sent */
+            if (auto typed_event = coalesced_parameter_change(event); typed_event != nullptr)
+            {
+                _waiting_parameter_changes[parameter_key(typed_event->processor_id(), typed_event->parameter_id())] = typed_event;
+            }
+        }
+        else
+        {
+            complete_event(event, EventStatus::HANDLED_OK);
+        }
+    }
+    _pending_rt_events.clear();
+}
+
+void EventDispatcher::_flush_parameter_notifications()
+{
+    for (auto event : _pending_parameter_notifications.values())
+    {
+        if (event == nullptr)
+        {
+            continue;
+        }
+        _publish_parameter_events(event);
+        delete event;
+    }
+    _pending_parameter_notifications.clear();
+}
+
+void EventDispatcher::_add_to_waiting_list(Event* event)
+{
+    _waiting_list.push({event->time(), _waiting_sequence_no++, event});
+}
+
+Event*EventDispatcher::_next_event()
+{
+    Event* event = nullptr;
+    if (!_in_queue.empty())
     {
         event = _in_queue.pop();
     }
@@ -232,6 +412,27 @@ void EventDispatcher::_publish_keyboard_events(Event* event)
     {
         listener->process(event);
     }
+    _keyboard_events_published = true;
+}
+
+void EventDispatcher::_flush_keyboard_events()
+{
+    if (_keyboard_events_published)
+    {
+        for (auto& listener : _keyboard_event_listeners)
+        {
+            listener->flush();
+        }
+        _keyboard_events_published = false;
+    }
+}
+
+void EventDispatcher::_process_deferred_input()
+{
+    for (auto& listener : _keyboard_event_listeners)
+    {
+        listener->process_deferred_input();
+    }
 }
 
 void EventDispatcher::_publish_parameter_events(Event* event)
@@ -299,68 +500,228 @@ EventDispatcherStatus EventDispatcher::unsubscribe_from_engine_notifications(Eve
     return EventDispatcherStatus::UNKNOWN_POSTER;
 }
 
+/* Ordering keys for work that is not tied to a single processor */
+constexpr uint64_t ENGINE_ORDERING_KEY = uint64_t(1) << 32;
+constexpr uint64_t NO_ORDERING_KEY = uint64_t(1) << 33;
+
 void Worker::run()
 {
     _running = true;
-    _worker_thread = std::thread(&Worker::_worker, this);
+    for (int i = 0; i < _pool_size; ++i)
+    {
+        _worker_threads.emplace_back(&Worker::_worker, this);
+    }
 }
 
 void Worker::stop()
 {
     _running = false;
-    if (_worker_thread.joinable())
+    _notifier.notify_all();
+    for (auto& thread : _worker_threads)
     {
-        _worker_thread.join();
+        if (thread.joinable())
+        {
+            thread.join();
+        }
     }
+    _worker_threads.clear();
 }
 
 int Worker::process(Event*event)
 {
-    _queue.push(event);
+    Task task{event, WorkPriority::NORMAL, NO_ORDERING_KEY, NO_ORDERING_KEY, false};
+    if (event->is_engine_event())
+    {
+        /* The engine is not thread safe, so engine events are always serialized */
+        auto typed_event = static_cast<EngineEvent*>(event);
+        task.ordering_key = ENGINE_ORDERING_KEY;
+        task.exclusive = typed_event->exclusive();
+        auto processor = typed_event->ordering_processor();
+        if (processor.has_value())
+        {
+            task.processor_key = processor.value();
+        }
+    }
+    else if (event->is_async_work_event())
+    {
+        auto typed_event = static_cast<AsynchronousWorkEvent*>(event);
+        task.priority = typed_event->priority();
+        auto processor = typed_event->ordering_processor();
+        if (processor.has_value())
+        {
+            task.ordering_key = processor.value();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(_queue_lock);
+        _queue.push_back(task);
+        int& depth = _statistics.queue_depth[static_cast<int>(task.priority)];
+        depth++;
+        int& max_depth = _statistics.max_queue_depth[static_cast<int>(task.priority)];
+        max_depth = std::max(max_depth, depth);
+    }
+    _notifier.notify_one();
     return EventStatus::QUEUED_HANDLING;
 }
 
+WorkerStatistics Worker::statistics()
+{
+    std::lock_guard<std::mutex> lock(_queue_lock);
+    return _statistics;
+}
+
 void Worker::_worker()
 {
-    std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds> print_timing_counter;
+    std::unique_lock<std::mutex> lock(_queue_lock);
     do
     {
-        auto start_time = std::chrono::system_clock::now();
-        while (!_queue.empty())
+        Task task{};
+        while (_next_task(task))
+        {
+            lock.unlock();
+            _execute(task.event);
+            lock.lock();
+            _finish_task(task);
+        }
+
+        auto now = std::chrono::system_clock::now();
+        if (now > _print_timing_counter + PRINT_TIMING_INTERVAL)
+        {
+            _print_timing_counter = now;
+            lock.unlock();
+            _print_statistics();
+            _engine->print_timings_to_log();
+            lock.lock();
+        }
+        if (_running)
+        {
+            _notifier.wait_for(lock, WORKER_THREAD_PERIODICITY);
+        }
+    }
+    while (_running);
+}
+
+bool Worker::_next_task(Task& task)
+{
+    if (_exclusive_running)
+    {
+        return false;
+    }
+    /* Work with the same key, running or posted earlier, must finish first. Work
+     * without an ordering key can always run. */
+    auto is_blocked = [&](uint64_t key)
+    {
+        if (key == NO_ORDERING_KEY)
         {
-            int status = EventStatus::UNRECOGNIZED_EVENT;
-            Event* event = _queue.pop();
+            return false;
+        }
+        return _busy_keys.count(key) > 0 ||
+               std::find(_blocked_keys.begin(), _blocked_keys.end(), key) != _blocked_keys.end();
+    };
 
-            if (event->is_engine_event())
+    _blocked_keys.clear();
+    auto selected = _queue.end();
+    for (auto i = _queue.begin(); i != _queue.end(); ++i)
+    {
+        if (i->exclusive)
+        {
+            /* Exclusive work waits for all previously posted work to finish
+             * and no work posted after it can start before it has finished */
+            if (i == _queue.begin() && _active_workers == 0)
             {
-                auto typed_event = static_cast<EngineEvent*>(event);
-                status = typed_event->execute(_engine);
+                selected = i;
             }
-            if (event->is_async_work_event())
+            break;
+        }
+        bool blocked = is_blocked(i->ordering_key) || is_blocked(i->processor_key);
+        /* Later conflicting work must wait for this one */
+        for (auto key : {i->ordering_key, i->processor_key})
+        {
+            if (key != NO_ORDERING_KEY)
             {
-                auto typed_event = static_cast<AsynchronousWorkEvent*>(event);
-                Event* response_event = typed_event->execute();
-                if (response_event != nullptr)
-                {
-                    _dispatcher->post_event(response_event);
-                }
+                _blocked_keys.push_back(key);
             }
+        }
+        if (blocked)
+        {
+            continue;
+        }
+        if (selected == _queue.end() || i->priority < selected->priority)
+        {
+            selected = i;
+        }
+    }
+    if (selected == _queue.end())
+    {
+        return false;
+    }
 
-            if (event->completion_cb() != nullptr)
-            {
-                event->completion_cb()(event->callback_arg(), event, status);
-            }
-            delete (event);
+    task = *selected;
+    _queue.erase(selected);
+    _statistics.queue_depth[static_cast<int>(task.priority)]--;
+    for (auto key : {task.ordering_key, task.processor_key})
+    {
+        if (key != NO_ORDERING_KEY)
+        {
+            _busy_keys.insert(key);
         }
-        if (start_time > print_timing_counter + PRINT_TIMING_INTERVAL)
+    }
+    _exclusive_running = task.exclusive;
+    _active_workers++;
+    _statistics.active_workers = _active_workers;
+    return true;
+}
+
+void Worker::_finish_task(const Task& task)
+{
+    _busy_keys.erase(task.ordering_key);
+    _busy_keys.erase(task.processor_key);
+    if (task.exclusive)
+    {
+        _exclusive_running = false;
+    }
+    _active_workers--;
+    _statistics.active_workers = _active_workers;
+    _statistics.completed++;
+    if (!_queue.empty())
+    {
+        /* Finishing may have unblocked work that other workers can pick up */
+        _notifier.notify_all();
+    }
+}
+
+void Worker::_execute(Event* event)
+{
+    int status = EventStatus::UNRECOGNIZED_EVENT;
+    if (event->is_engine_event())
+    {
+        auto typed_event = static_cast<EngineEvent*>(event);
+        status = typed_event->execute(_engine);
+    }
+    if (event->is_async_work_event())
+    {
+        auto typed_event = static_cast<AsynchronousWorkEvent*>(event);
+        Event* response_event = typed_event->execute();
+        if (response_event != nullptr)
         {
-            print_timing_counter = start_time;
-            _engine->print_timings_to_log();
+            _dispatcher->post_event(response_event);
         }
+    }
 
-        std::this_thread::sleep_until(start_time + WORKER_THREAD_PERIODICITY);
+    if (event->completion_cb() != nullptr)
+    {
+        event->completion_cb()(event->callback_arg(), event, status);
     }
-    while (_running);
+    delete (event);
+}
+
+void Worker::_print_statistics()
+{
+    [[maybe_unused]] auto stats = statistics();
+    SUSHI_LOG_DEBUG("Worker queue depth (high/normal/low): {}/{}/{}, max: {}/{}/{}, completed: {}",
+                    stats.queue_depth[0], stats.queue_depth[1], stats.queue_depth[2],
+                    stats.max_queue_depth[0], stats.max_queue_depth[1], stats.max_queue_depth[2],
+                    stats.completed);
 }
 
 
@@ -21,7 +21,14 @@
 #ifndef SUSHI_EVENT_DISPATCHER_H
 #define SUSHI_EVENT_DISPATCHER_H
 
+#include <array>
+#include <condition_variable>
 #include <deque>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <thread>
 
@@ -30,6 +37,7 @@
 #include "engine/event_timer.h"
 #include "library/synchronised_fifo.h"
 #include "library/rt_event_fifo.h"
+#include "library/rt_transfer_ring.h"
 #include "library/event_interface.h"
 
 namespace sushi {
@@ -38,20 +46,121 @@ namespace dispatcher {
 
 class BaseEventDispatcher;
 
+/**
+ * @brief Entry in the list of events waiting to be sent to the rt domain. Entries are
+ *        ordered on timestamp, and on arrival order for equal timestamps, so that the
+ *        waiting list can be kept as a min-heap and only due events need to be examined.
+ */
+struct WaitingEvent
+{
+    Time     time;
+    uint64_t sequence_no;
+    Event*   event;
+};
+
+struct WaitingEventLater
+{
+    bool operator()(const WaitingEvent& lhs, const WaitingEvent& rhs) const
+    {
+        if (lhs.time == rhs.time)
+        {
+            return lhs.sequence_no > rhs.sequence_no;
+        }
+        return lhs.time > rhs.time;
+    }
+};
+
+using WaitingEventQueue = std::priority_queue<WaitingEvent, std::vector<WaitingEvent>, WaitingEventLater>;
+
+inline uint64_t parameter_key(ObjectId processor_id, ObjectId parameter_id)
+{
+    return (static_cast<uint64_t>(processor_id) << 32) | parameter_id;
+}
+
+/**
+ * @brief Ordered list of events with one slot per processor and parameter pair where only
+ *        the latest parameter change event is kept. Used to coalesce parameter changes that
+ *        arrive within the same iteration of the event loop. A new value for a parameter is
+ *        placed last and its previous slot is emptied, so the kept values stay in the order
+ *        they arrived relative to other events.
+ */
+class ParameterChangeSlots
+{
+public:
+    /**
+     * @brief Store a value in the slot for the given processor and parameter
+     * @return The value that was replaced, if any
+     */
+    std::optional<Event*> insert(ObjectId processor_id, ObjectId parameter_id, Event* event)
+    {
+        auto [slot, inserted] = _index.insert({parameter_key(processor_id, parameter_id), _values.size()});
+        _values.push_back(event);
+        if (inserted)
+        {
+            return std::nullopt;
+        }
+        auto replaced = _values[slot->second];
+        _values[slot->second] = nullptr;
+        slot->second = _values.size() - 1;
+        return replaced;
+    }
+
+    /**
+     * @brief Store an event that is not coalesced, only to keep its order relative to the other values
+     */
+    void push(Event* event) {_values.push_back(event);}
+
+    /* Emptied slots are set to nullptr */
+    const std::vector<Event*>& values() const {return _values;}
+
+    bool empty() const {return _values.empty();}
+
+    void clear()
+    {
+        _index.clear();
+        _values.clear();
+    }
+
+private:
+    std::unordered_map<uint64_t, size_t> _index;
+    std::vector<Event*>                  _values;
+};
+
 constexpr int AUDIO_ENGINE_ID = 0;
 constexpr std::chrono::milliseconds THREAD_PERIODICITY = std::chrono::milliseconds(1);
 constexpr auto WORKER_THREAD_PERIODICITY = std::chrono::milliseconds(1);
+constexpr int WORKER_POOL_SIZE = 3;
 
 /**
- * @brief Low priority worker for handling possibly time consuming tasks like
- * instantiating plugins or do asynchronous work from processors.
+ * @brief Queue depth metrics for the worker pool, indexed by WorkPriority
+ */
+struct WorkerStatistics
+{
+    std::array<int, WORK_PRIORITY_LEVELS> queue_depth;
+    std::array<int, WORK_PRIORITY_LEVELS> max_queue_depth;
+    int                                   active_workers;
+    uint64_t                              completed;
+};
+
+/**
+ * @brief Pool of low priority workers for handling possibly time consuming tasks like
+ * instantiating plugins or do asynchronous work from processors. Work is picked in
+ * priority order, engine events are executed one at a time and work for the same
+ * processor is executed in the order it was posted. Engine events acting on an existing
+ * processor are ordered with the work for that processor only, and exclusive engine
+ * events with all work. So processors only need to synchronize their async callbacks
+ * with the rt thread, as was the case with a single worker thread, while long running
+ * work like sample loading doesn't hold up e.g. plugin instantiation.
  */
 class Worker : public EventPoster
 {
 public:
-    Worker(engine::BaseEngine* engine, BaseEventDispatcher* dispatcher) : _engine(engine),
-                                                                          _dispatcher(dispatcher),
-                                                                          _running(false) {}
+    Worker(engine::BaseEngine* engine,
+           BaseEventDispatcher* dispatcher,
+           int pool_size = WORKER_POOL_SIZE) : _engine(engine),
+                                               _dispatcher(dispatcher),
+                                               _pool_size(pool_size),
+                                               _running(false) {}
 
     virtual ~Worker() = default;
 
@@ -61,15 +170,44 @@ public:
     int process(Event* event) override;
     int poster_id() override {return EventPosterId::WORKER;}
 
+    WorkerStatistics statistics();
+
 private:
+    struct Task
+    {
+        Event*       event;
+        WorkPriority priority;
+        uint64_t     ordering_key;
+        /* Processor an engine event acts on, ordered with the work for that processor */
+        uint64_t     processor_key;
+        bool         exclusive;
+    };
+
     engine::BaseEngine*         _engine;
     BaseEventDispatcher*        _dispatcher;
 
     void                        _worker();
-    std::thread                 _worker_thread;
+    /* Must be called with _queue_lock held */
+    bool                        _next_task(Task& task);
+    /* Must be called with _queue_lock held */
+    void                        _finish_task(const Task& task);
+    void                        _execute(Event* event);
+    void                        _print_statistics();
+
+    int                         _pool_size;
+    std::vector<std::thread>    _worker_threads;
     std::atomic<bool>           _running;
 
-    SynchronizedQueue<Event*>   _queue;
+    std::mutex                  _queue_lock;
+    std::condition_variable     _notifier;
+    std::deque<Task>            _queue;
+    std::unordered_set<uint64_t> _busy_keys;
+    /* Scratch buffer for _next_task(), kept as a member to avoid allocations */
+    std::vector<uint64_t>       _blocked_keys;
+    int                         _active_workers{0};
+    bool                        _exclusive_running{false};
+    WorkerStatistics            _statistics{};
+    std::chrono::system_clock::time_point _print_timing_counter;
 };
 
 class EventDispatcher : public BaseEventDispatcher
@@ -96,6 +234,11 @@ public:
     void set_sample_rate(float sample_rate) override {_event_timer.set_sample_rate(sample_rate);}
     void set_time(Time timestamp) override {_event_timer.set_incoming_time(timestamp);}
 
+    std::pair<bool, int> sample_offset_from_realtime(Time timestamp) override
+    {
+        return _event_timer.sample_offset_from_realtime(timestamp);
+    }
+
     int process(Event* event) override;
     int poster_id() override {return AUDIO_ENGINE_ID;}
 
@@ -105,6 +248,24 @@ private:
 
     int _process_rt_event(RtEvent& rt_event);
 
+    void _process_waiting_events();
+
+    bool _coalesce_parameter_change(Event* event);
+
+    bool _replace_waiting_parameter_change(ParameterChangeEvent* event);
+
+    void _flush_rt_events();
+
+    void _flush_parameter_notifications();
+
+    void _flush_keyboard_events();
+
+    void _process_deferred_input();
+
+    void _add_to_waiting_list(Event* event);
+
+    bool _send_to_rt(Event* event, int sample_offset);
+
     Event* _next_event();
 
     void _publish_keyboard_events(Event* event);
@@ -119,13 +280,21 @@ private:
     SynchronizedQueue<Event*>   _in_queue;
     RtSafeRtEventFifo*          _in_rt_queue;
     RtSafeRtEventFifo*          _out_rt_queue;
-    std::deque<Event*>          _waiting_list;
+    WaitingEventQueue           _waiting_list;
+    uint64_t                    _waiting_sequence_no{0};
+    /* Due parameter changes in the waiting list, by processor and parameter */
+    std::unordered_map<uint64_t, ParameterChangeEvent*> _waiting_parameter_changes;
+    RtTransferRing              _transfer_ring;
+
+    ParameterChangeSlots        _pending_rt_events;
+    ParameterChangeSlots        _pending_parameter_notifications;
 
     Worker                      _worker;
     event_timer::EventTimer     _event_timer;
 
     std::array<EventPoster*, EventPosterId::MAX_POSTERS> _posters;
     std::vector<EventPoster*> _keyboard_event_listeners;
+    bool                      _keyboard_events_published{false};
     std::vector<EventPoster*> _parameter_change_listeners;
     std::vector<EventPoster*> _engine_notification_listeners;
 };
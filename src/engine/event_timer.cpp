@@ -18,7 +18,8 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
- #include <cmath>
+#include <algorithm>
+#include <cmath>
 #include <cassert>
 
 #include "event_timer.h"
@@ -35,19 +36,28 @@ inline Time calc_chunk_time(float samplerate)
      return std::chrono::microseconds(static_cast<int64_t>(std::round(MICROSECONDS / samplerate * AUDIO_CHUNK_SIZE)));
 }
 
+inline float calc_chunk_period(float samplerate)
+{
+    return MICROSECONDS / samplerate * AUDIO_CHUNK_SIZE;
+}
+
 EventTimer::EventTimer(float default_sample_rate) : _sample_rate{default_sample_rate},
-                                                    _chunk_time{calc_chunk_time(default_sample_rate)}
+                                                    _chunk_time{calc_chunk_time(default_sample_rate)},
+                                                    _chunk_period{calc_chunk_period(default_sample_rate)}
 {
     assert(EventTimer::_incoming_chunk_time.is_lock_free());
+    assert(EventTimer::_chunk_period.is_lock_free());
+    set_sample_rate(default_sample_rate);
 }
 
 std::pair<bool, int> EventTimer::sample_offset_from_realtime(Time timestamp)
 {
     auto diff = timestamp - _incoming_chunk_time.load();
-    if (diff < _chunk_time)
+    float chunk_period = _chunk_period.load();
+    if (diff.count() < chunk_period)
     {
-        int64_t offset = (AUDIO_CHUNK_SIZE * diff) / _chunk_time;
-        return std::make_pair(true, static_cast<int>(std::max(int64_t{0}, offset)));
+        auto offset = static_cast<int>(AUDIO_CHUNK_SIZE * diff.count() / chunk_period);
+        return std::make_pair(true, std::clamp(offset, 0, AUDIO_CHUNK_SIZE - 1));
     }
     else
     {
@@ -57,13 +67,53 @@ std::pair<bool, int> EventTimer::sample_offset_from_realtime(Time timestamp)
 
 Time EventTimer::real_time_from_sample_offset(int offset)
 {
-    return _outgoing_chunk_time + offset * _chunk_time / AUDIO_CHUNK_SIZE;
+    float chunk_period = _chunk_period.load();
+    return _outgoing_chunk_time + Time(static_cast<int64_t>(offset * chunk_period / AUDIO_CHUNK_SIZE));
 }
 
 void EventTimer::set_sample_rate(float sample_rate)
 {
     _sample_rate = sample_rate;
     _chunk_time = calc_chunk_time(sample_rate);
+    _chunk_period.store(calc_chunk_period(sample_rate));
+
+    /* DLL coefficients, critically damped 2nd order loop */
+    double omega = 2.0 * M_PI * DLL_BANDWIDTH * AUDIO_CHUNK_SIZE / sample_rate;
+    _filter_b = std::sqrt(2.0) * omega;
+    _filter_c = omega * omega;
+    _filter_locked = false;
+}
+
+void EventTimer::set_incoming_time(Time timestamp)
+{
+    auto time = static_cast<double>(timestamp.count());
+    double error = time - _predicted_time;
+    if (_filter_locked == false || std::abs(error) > DLL_MAX_CHUNK_ERROR * _filtered_period)
+    {
+        _reset_filter(time);
+    }
+    else
+    {
+        _predicted_time += _filter_b * error + _filtered_period;
+        _filtered_period += _filter_c * error;
+    }
+    /* The predicted time of the next callback is the time when the chunk currently being
+     * processed is outputted + 1 chunk, i.e. the start of the window for incoming events */
+    _chunk_period.store(static_cast<float>(_filtered_period));
+    _incoming_chunk_time.store(Time(static_cast<int64_t>(_predicted_time)));
+}
+
+void EventTimer::set_outgoing_time(Time timestamp)
+{
+    /* Use the filtered period so that outgoing events follow the actual sample rate too */
+    _outgoing_chunk_time = timestamp + Time(static_cast<int64_t>(std::round(_chunk_period.load())));
+}
+
+void EventTimer::_reset_filter(double timestamp)
+{
+    _filtered_period = calc_chunk_period(_sample_rate);
+    _predicted_time = timestamp + _filtered_period;
+    _filter_locked = true;
 }
 
 } // end event_timer
@@ -15,6 +15,9 @@
 
 /**
  * @Brief Object to map between rt time and real time
+ *        Timestamps from the audio callback are filtered through a delay-locked
+ *        loop (DLL) to remove jitter and to track the actual sample rate of the
+ *        audio hardware, see F. Adriaensen, "Using a DLL to filter time", 2005.
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
@@ -29,6 +32,14 @@
 namespace sushi {
 namespace event_timer {
 
+/* Bandwidth of the time filter in Hz, lower values give better jitter
+ * rejection but makes the filter slower to lock to the audio clock */
+constexpr double DLL_BANDWIDTH = 1.0;
+/* If a timestamp deviates more than this many chunks from the predicted
+ * time, the filter is considered unlocked (i.e. xrun or discontinuous
+ * time) and is reset to the incoming timestamp */
+constexpr double DLL_MAX_CHUNK_ERROR = 4.0;
+
 class EventTimer
 {
 public:
@@ -61,23 +72,35 @@ public:
 
     /**
      * @brief Called from the rt part when all rt events have been processed, essentially
-     *        closing the window for events for this chunk
+     *        closing the window for events for this chunk. The timestamp is run through
+     *        the DLL before it is used for calculating sample offsets.
      * @param timestamp The time when the currently processed chunk is outputted
      */
-    void set_incoming_time(Time timestamp) {_incoming_chunk_time.store(timestamp + _chunk_time);}
+    void set_incoming_time(Time timestamp);
 
     /**
      * @brief Called from the event thread when all outgoing events from a chunk have
      *        been processed
      * @param timestamp of the previously processed audio chunk
      */
-    void set_outgoing_time(Time timestamp) {_outgoing_chunk_time = timestamp + _chunk_time;}
+    void set_outgoing_time(Time timestamp);
 
 private:
+    void _reset_filter(double timestamp);
+
     float               _sample_rate;
     Time                _chunk_time;
     Time                _outgoing_chunk_time{IMMEDIATE_PROCESS};
     std::atomic<Time>   _incoming_chunk_time{IMMEDIATE_PROCESS};
+    /* Filtered chunk period in microseconds */
+    std::atomic<float>  _chunk_period;
+
+    /* DLL state, only accessed from the rt thread */
+    bool                _filter_locked{false};
+    double              _filter_b;
+    double              _filter_c;
+    double              _predicted_time{0};
+    double              _filtered_period;
 };
 
 } // end event_timer
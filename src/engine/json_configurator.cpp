@@ -54,6 +54,22 @@ std::pair<JsonConfigReturnStatus, AudioConfig> JsonConfigurator::load_audio_conf
     {
         audio_config.cv_outputs = host_config["cv_outputs"].GetInt();
     }
+    if (host_config.HasMember("gate_inputs"))
+    {
+        audio_config.gate_inputs = host_config["gate_inputs"].GetInt();
+    }
+    if (host_config.HasMember("gate_outputs"))
+    {
+        audio_config.gate_outputs = host_config["gate_outputs"].GetInt();
+    }
+    if (host_config.HasMember("midi_inputs"))
+    {
+        audio_config.midi_inputs = host_config["midi_inputs"].GetInt();
+    }
+    if (host_config.HasMember("midi_outputs"))
+    {
+        audio_config.midi_outputs = host_config["midi_outputs"].GetInt();
+    }
 
     return {JsonConfigReturnStatus::OK, audio_config};
 }
@@ -227,6 +243,20 @@ JsonConfigReturnStatus JsonConfigurator::load_midi()
         }
     }
 
+    if(midi.HasMember("clock_out_connections"))
+    {
+        for (const auto& con : midi["clock_out_connections"].GetArray())
+        {
+            auto res = _midi_dispatcher->connect_clock_to_output(con["port"].GetInt());
+            if (res != MidiDispatcherStatus::OK)
+            {
+                SUSHI_LOG_ERROR("Invalid port \"{}\" specified for midi "
+                                "clock connections in Json Config file.", con["port"].GetInt());
+                return JsonConfigReturnStatus::INVALID_MIDI_PORT;
+            }
+        }
+    }
+
     if(midi.HasMember("program_change_connections"))
     {
         for (const auto& con : midi["program_change_connections"].GetArray())
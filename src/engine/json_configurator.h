@@ -63,6 +63,10 @@ struct AudioConfig
 {
     std::optional<int> cv_inputs;
     std::optional<int> cv_outputs;
+    std::optional<int> gate_inputs;
+    std::optional<int> gate_outputs;
+    std::optional<int> midi_inputs;
+    std::optional<int> midi_outputs;
 };
 
 class JsonConfigurator
@@ -19,8 +19,13 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <thread>
+#include <tuple>
 
 #include "engine/midi_dispatcher.h"
+#include "engine/transport.h"
 #include "library/midi_encoder.h"
 #include "logging.h"
 
@@ -29,72 +34,74 @@ namespace midi_dispatcher {
 
 SUSHI_GET_LOGGER_WITH_MODULE_NAME("midi dispatcher");
 
-inline Event* make_note_on_event(const InputConnection &c,
-                                 const midi::NoteOnMessage &msg,
-                                 Time timestamp)
+/* Minimum change in tempo estimated from midi clock before the engine tempo is updated */
+constexpr float CLOCK_TEMPO_THRESHOLD = 0.01f;
+
+inline RtEvent make_note_on_rt_event(const InputConnection &c,
+                                     const midi::NoteOnMessage &msg,
+                                     int sample_offset)
 {
     if (msg.velocity == 0)
     {
-        return new KeyboardEvent(KeyboardEvent::Subtype::NOTE_OFF, c.target, msg.channel, msg.note, 0.5f, timestamp);
+        return RtEvent::make_note_off_event(c.target, sample_offset, msg.channel, msg.note, 0.5f);
     }
-
     float velocity = msg.velocity / static_cast<float>(midi::MAX_VALUE);
-    return new KeyboardEvent(KeyboardEvent::Subtype::NOTE_ON, c.target, msg.channel, msg.note, velocity, timestamp);
+    return RtEvent::make_note_on_event(c.target, sample_offset, msg.channel, msg.note, velocity);
 }
 
-inline Event* make_note_off_event(const InputConnection &c,
-                                  const midi::NoteOffMessage &msg,
-                                  Time timestamp)
+inline RtEvent make_note_off_rt_event(const InputConnection &c,
+                                      const midi::NoteOffMessage &msg,
+                                      int sample_offset)
 {
     float velocity = msg.velocity / static_cast<float>(midi::MAX_VALUE);
-    return new KeyboardEvent(KeyboardEvent::Subtype::NOTE_OFF, c.target, msg.channel, msg.note, velocity, timestamp);
+    return RtEvent::make_note_off_event(c.target, sample_offset, msg.channel, msg.note, velocity);
 }
 
-inline Event* make_note_aftertouch_event(const InputConnection &c,
-                                         const midi::PolyKeyPressureMessage &msg,
-                                         Time timestamp)
+inline RtEvent make_note_aftertouch_rt_event(const InputConnection &c,
+                                             const midi::PolyKeyPressureMessage &msg,
+                                             int sample_offset)
 {
     float pressure = msg.pressure / static_cast<float>(midi::MAX_VALUE);
-    return new KeyboardEvent(KeyboardEvent::Subtype::NOTE_AFTERTOUCH, c.target, msg.channel, msg.note, pressure, timestamp);
+    return RtEvent::make_note_aftertouch_event(c.target, sample_offset, msg.channel, msg.note, pressure);
 }
 
-inline Event* make_aftertouch_event(const InputConnection &c,
-                                    const midi::ChannelPressureMessage &msg,
-                                    Time timestamp)
+inline RtEvent make_aftertouch_rt_event(const InputConnection &c,
+                                        const midi::ChannelPressureMessage &msg,
+                                        int sample_offset)
 {
     float pressure = msg.pressure / static_cast<float>(midi::MAX_VALUE);
-    return new KeyboardEvent(KeyboardEvent::Subtype::AFTERTOUCH, c.target, msg.channel, pressure, timestamp);
+    return RtEvent::make_aftertouch_event(c.target, sample_offset, msg.channel, pressure);
 }
 
-inline Event* make_modulation_event(const InputConnection &c,
-                                    const midi::ControlChangeMessage &msg,
-                                    Time timestamp)
+inline RtEvent make_modulation_rt_event(const InputConnection &c,
+                                        const midi::ControlChangeMessage &msg,
+                                        int sample_offset)
 {
     float value = msg.value / static_cast<float>(midi::MAX_VALUE);
-    return new KeyboardEvent(KeyboardEvent::Subtype::MODULATION, c.target, msg.channel, value, timestamp);
+    return RtEvent::make_kb_modulation_event(c.target, sample_offset, msg.channel, value);
 }
 
-inline Event* make_pitch_bend_event(const InputConnection &c,
-                                    const midi::PitchBendMessage &msg,
-                                    Time timestamp)
+inline RtEvent make_pitch_bend_rt_event(const InputConnection &c,
+                                        const midi::PitchBendMessage &msg,
+                                        int sample_offset)
 {
     float value = (msg.value / static_cast<float>(midi::PITCH_BEND_MIDDLE)) - 1.0f;
-    return new KeyboardEvent(KeyboardEvent::Subtype::PITCH_BEND, c.target, msg.channel, value, timestamp);
+    return RtEvent::make_pitch_bend_event(c.target, sample_offset, msg.channel, value);
 }
 
-inline Event* make_wrapped_midi_event(const InputConnection &c,
-                                      const uint8_t* data,
-                                      size_t size,
-                                      Time timestamp)
+inline RtEvent make_wrapped_midi_rt_event(const InputConnection &c,
+                                          const uint8_t* data,
+                                          size_t size,
+                                          int sample_offset)
 {
     MidiDataByte midi_data{0};
     std::copy(data, data + size, midi_data.data());
-    return new KeyboardEvent(KeyboardEvent::Subtype::WRAPPED_MIDI, c.target, midi_data, timestamp);
+    return RtEvent::make_wrapped_midi_event(c.target, sample_offset, midi_data);
 }
 
-inline Event* make_param_change_event(InputConnection &c,
-                                      const midi::ControlChangeMessage &msg,
-                                      Time timestamp)
+inline RtEvent make_param_change_rt_event(InputConnection &c,
+                                          const midi::ControlChangeMessage &msg,
+                                          int sample_offset)
 {
     uint8_t abs_value = msg.value;
     // Maybe TODO: currently this is based on a virtual controller absolute value which is
@@ -117,7 +124,87 @@ inline Event* make_param_change_event(InputConnection &c,
         c.virtual_abs_value = abs_value;
     }
     float value = static_cast<float>(abs_value) / midi::MAX_VALUE * (c.max_range - c.min_range) + c.min_range;
-    return new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, c.target, c.parameter, value, timestamp);
+    return RtEvent::make_parameter_change_event(c.target, sample_offset, c.parameter, value);
+}
+
+/* Convert an input RtEvent to an Event for when it can not be sent on the fast path */
+inline Event* make_input_event(RtEvent& rt_event, Time timestamp)
+{
+    if (rt_event.type() == RtEventType::FLOAT_PARAMETER_CHANGE)
+    {
+        auto typed_event = rt_event.parameter_change_event();
+        return new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE,
+                                        typed_event->processor_id(),
+                                        typed_event->param_id(),
+                                        typed_event->value(),
+                                        timestamp);
+    }
+    return Event::from_rt_event(rt_event, timestamp);
+}
+
+inline Event* make_note_on_event(const InputConnection &c,
+                                 const midi::NoteOnMessage &msg,
+                                 Time timestamp)
+{
+    auto rt_event = make_note_on_rt_event(c, msg, 0);
+    return make_input_event(rt_event, timestamp);
+}
+
+inline Event* make_note_off_event(const InputConnection &c,
+                                  const midi::NoteOffMessage &msg,
+                                  Time timestamp)
+{
+    auto rt_event = make_note_off_rt_event(c, msg, 0);
+    return make_input_event(rt_event, timestamp);
+}
+
+inline Event* make_note_aftertouch_event(const InputConnection &c,
+                                         const midi::PolyKeyPressureMessage &msg,
+                                         Time timestamp)
+{
+    auto rt_event = make_note_aftertouch_rt_event(c, msg, 0);
+    return make_input_event(rt_event, timestamp);
+}
+
+inline Event* make_aftertouch_event(const InputConnection &c,
+                                    const midi::ChannelPressureMessage &msg,
+                                    Time timestamp)
+{
+    auto rt_event = make_aftertouch_rt_event(c, msg, 0);
+    return make_input_event(rt_event, timestamp);
+}
+
+inline Event* make_modulation_event(const InputConnection &c,
+                                    const midi::ControlChangeMessage &msg,
+                                    Time timestamp)
+{
+    auto rt_event = make_modulation_rt_event(c, msg, 0);
+    return make_input_event(rt_event, timestamp);
+}
+
+inline Event* make_pitch_bend_event(const InputConnection &c,
+                                    const midi::PitchBendMessage &msg,
+                                    Time timestamp)
+{
+    auto rt_event = make_pitch_bend_rt_event(c, msg, 0);
+    return make_input_event(rt_event, timestamp);
+}
+
+inline Event* make_wrapped_midi_event(const InputConnection &c,
+                                      const uint8_t* data,
+                                      size_t size,
+                                      Time timestamp)
+{
+    auto rt_event = make_wrapped_midi_rt_event(c, data, size, 0);
+    return make_input_event(rt_event, timestamp);
+}
+
+inline Event* make_param_change_event(InputConnection &c,
+                                      const midi::ControlChangeMessage &msg,
+                                      Time timestamp)
+{
+    auto rt_event = make_param_change_rt_event(c, msg, 0);
+    return make_input_event(rt_event, timestamp);
 }
 
 inline Event* make_program_change_event(const InputConnection &c,
@@ -135,12 +222,14 @@ MidiDispatcher::MidiDispatcher(engine::BaseEngine* engine) : _engine(engine),
     _event_dispatcher = _engine->event_dispatcher();
     _event_dispatcher->register_poster(this);
     _event_dispatcher->subscribe_to_keyboard_events(this);
+    _routing_table.store(new RoutingTable(0));
 }
 
 MidiDispatcher::~MidiDispatcher()
 {
     _event_dispatcher->unsubscribe_from_keyboard_events(this);
     _event_dispatcher->deregister_poster(this);
+    delete _routing_table.load();
 }
 
 
@@ -153,6 +242,7 @@ MidiDispatcherStatus MidiDispatcher::connect_cc_to_parameter(int midi_input,
                                                              bool use_relative_mode,
                                                              int channel)
 {
+    std::lock_guard<std::mutex> lock(_config_lock);
     if (midi_input >= _midi_inputs || midi_input < 0 || midi_input > midi::MidiChannel::OMNI)
     {
         return MidiDispatcherStatus ::INVALID_MIDI_INPUT;
@@ -175,7 +265,7 @@ MidiDispatcherStatus MidiDispatcher::connect_cc_to_parameter(int midi_input,
     connection.max_range = max_range;
     connection.relative = use_relative_mode;
     connection.virtual_abs_value = 64;
-    _cc_routes[midi_input][cc_no][channel].push_back(connection);
+    _add_input_route(RouteType::CONTROL_CHANGE, midi_input, channel, cc_no, connection);
     SUSHI_LOG_INFO("Connected parameter \"{}\" "
                            "(cc number \"{}\") to processor \"{}\"", parameter_name, cc_no, processor_name);
     return MidiDispatcherStatus::OK;
@@ -185,6 +275,7 @@ MidiDispatcherStatus MidiDispatcher::connect_pc_to_processor(int midi_input,
                                                              const std::string& processor_name,
                                                              int channel)
 {
+    std::lock_guard<std::mutex> lock(_config_lock);
     if (midi_input >= _midi_inputs || midi_input < 0 || midi_input > midi::MidiChannel::OMNI)
     {
         return MidiDispatcherStatus::INVALID_MIDI_INPUT;
@@ -199,7 +290,7 @@ MidiDispatcherStatus MidiDispatcher::connect_pc_to_processor(int midi_input,
     connection.parameter = 0;
     connection.min_range = 0;
     connection.max_range = 0;
-    _pc_routes[midi_input][channel].push_back(connection);
+    _add_input_route(RouteType::PROGRAM_CHANGE, midi_input, channel, 0, connection);
     SUSHI_LOG_INFO("Connected program changes from MIDI port \"{}\" to processor \"{}\"", midi_input, processor_name);
     return MidiDispatcherStatus::OK;
 }
@@ -208,6 +299,7 @@ MidiDispatcherStatus MidiDispatcher::connect_kb_to_track(int midi_input,
                                                          const std::string &track_name,
                                                          int channel)
 {
+    std::lock_guard<std::mutex> lock(_config_lock);
     if (midi_input >= _midi_inputs || midi_input < 0 || midi_input > midi::MidiChannel::OMNI)
     {
         return MidiDispatcherStatus::INVALID_MIDI_INPUT;
@@ -222,7 +314,7 @@ MidiDispatcherStatus MidiDispatcher::connect_kb_to_track(int midi_input,
     connection.parameter = 0;
     connection.min_range = 0;
     connection.max_range = 0;
-    _kb_routes_in[midi_input][channel].push_back(connection);
+    _add_input_route(RouteType::KEYBOARD, midi_input, channel, 0, connection);
     SUSHI_LOG_INFO("Connected MIDI port \"{}\" to track \"{}\"", midi_input, track_name);
     return MidiDispatcherStatus::OK;
 }
@@ -231,6 +323,7 @@ MidiDispatcherStatus MidiDispatcher::connect_raw_midi_to_track(int midi_input,
                                                                const std::string &track_name,
                                                                int channel)
 {
+    std::lock_guard<std::mutex> lock(_config_lock);
     if (midi_input >= _midi_inputs || midi_input < 0 || midi_input > midi::MidiChannel::OMNI)
     {
         return MidiDispatcherStatus::INVALID_MIDI_INPUT;
@@ -245,13 +338,14 @@ MidiDispatcherStatus MidiDispatcher::connect_raw_midi_to_track(int midi_input,
     connection.parameter = 0;
     connection.min_range = 0;
     connection.max_range = 0;
-    _raw_routes_in[midi_input][channel].push_back(connection);
+    _add_input_route(RouteType::RAW_MIDI, midi_input, channel, 0, connection);
     SUSHI_LOG_INFO("Connected MIDI port \"{}\" to track \"{}\"", midi_input, track_name);
     return MidiDispatcherStatus::OK;
 }
 
 MidiDispatcherStatus MidiDispatcher::connect_track_to_output(int midi_output, const std::string &track_name, int channel)
 {
+    std::lock_guard<std::mutex> lock(_config_lock);
     if (channel >= midi::MidiChannel::OMNI)
     {
         return MidiDispatcherStatus::INVAlID_CHANNEL;
@@ -267,40 +361,202 @@ MidiDispatcherStatus MidiDispatcher::connect_track_to_output(int midi_output, co
     }
     OutputConnection connection;
     connection.channel = channel;
-    connection.output = 0;
+    connection.output = midi_output;
     connection.min_range = 1.234f;
     connection.max_range = 4.5678f;
     connection.cc_number = 123;
-    _kb_routes_out[id].push_back(connection);
+    _output_routes[id].push_back(connection);
+    _publish_routes();
     SUSHI_LOG_INFO("Connected MIDI from track \"{}\" to port \"{}\" with channel {}", midi_output, track_name, channel);
     return MidiDispatcherStatus::OK;
 }
 
+MidiDispatcherStatus MidiDispatcher::connect_clock_to_output(int midi_output)
+{
+    std::lock_guard<std::mutex> lock(_config_lock);
+    if (midi_output >= _midi_outputs || midi_output < 0)
+    {
+        return MidiDispatcherStatus::INVALID_MIDI_OUTPUT;
+    }
+    OutputConnection connection;
+    connection.channel = 0;
+    connection.output = midi_output;
+    connection.min_range = 0;
+    connection.max_range = 0;
+    connection.cc_number = 0;
+    _output_routes[engine::MIDI_CLOCK_SOURCE_ID].push_back(connection);
+    _publish_routes();
+    _engine->enable_midi_clock_output(true);
+    SUSHI_LOG_INFO("Connected MIDI clock to port \"{}\"", midi_output);
+    return MidiDispatcherStatus::OK;
+}
+
 void MidiDispatcher::clear_connections()
 {
-    _cc_routes.clear();
-    _kb_routes_in.clear();
+    std::lock_guard<std::mutex> lock(_config_lock);
+    /* Removed connections may still be referenced from the current table,
+     * so they are only destroyed once a new table has been published */
+    std::vector<InputRoute> removed_routes;
+    auto partition = std::stable_partition(_input_routes.begin(), _input_routes.end(), [](const InputRoute& route)
+    {
+        return route.type != RouteType::CONTROL_CHANGE && route.type != RouteType::KEYBOARD;
+    });
+    std::move(partition, _input_routes.end(), std::back_inserter(removed_routes));
+    _input_routes.erase(partition, _input_routes.end());
+    _publish_routes();
 }
 
 void MidiDispatcher::send_midi(int port, MidiDataByte data, Time timestamp)
 {
-    int channel = midi::decode_channel(data);
-    int size = data.size();
-    /* Dispatch raw midi messages */
+    _send_midi(port, data, timestamp, true);
+}
+
+void MidiDispatcher::send_deferred_midi(int port, MidiDataByte data, Time timestamp)
+{
+    _send_midi(port, data, timestamp, false);
+}
+
+void MidiDispatcher::_send_midi(int port, MidiDataByte data, Time timestamp, bool allow_direct_send)
+{
+    /* Events due in the next chunk skip the event dispatcher and are sent directly to the rt thread */
+    bool send_now = false;
+    int sample_offset = 0;
+    if (allow_direct_send)
     {
-        const auto& cons = _raw_routes_in.find(port);
-        if (cons != _raw_routes_in.end())
+        std::tie(send_now, sample_offset) = _event_dispatcher->sample_offset_from_realtime(timestamp);
+    }
+    auto send_event = [&](RtEvent&& rt_event)
+    {
+        /* Once an event has fallen back to the event dispatcher, the following ones take the
+         * same path until it has been delivered, otherwise they could overtake it */
+        if (send_now && _fallback_events.load() == 0 &&
+            _engine->send_input_event(rt_event) == engine::EngineReturnStatus::OK)
         {
-            for (auto c : cons->second[midi::MidiChannel::OMNI])
-            {
-                _event_dispatcher->post_event(make_wrapped_midi_event(c, data.data(), size, timestamp));
-            }
-            for (auto c : cons->second[channel])
+            return;
+        }
+        auto event = make_input_event(rt_event, timestamp);
+        if (send_now)
+        {
+            _fallback_events.fetch_add(1);
+            event->set_completion_cb(MidiDispatcher::_fallback_event_delivered, this);
+        }
+        _event_dispatcher->post_event(event);
+    };
+    int reader_phase;
+    const RoutingTable* routes = _acquire_routing_table(reader_phase);
+    _dispatch_midi(routes, port, data, sample_offset, send_event);
+
+    /* Program changes have no rt representation and always go through the event dispatcher */
+    auto type = midi::decode_message_type(data);
+    if (type == midi::MessageType::PROGRAM_CHANGE)
+    {
+        midi::ProgramChangeMessage decoded_msg = midi::decode_program_change(data);
+        routes->for_each_route(port, RouteType::PROGRAM_CHANGE, decoded_msg.channel, 0, [&](InputConnection& c)
+        {
+            _event_dispatcher->post_event(make_program_change_event(c, decoded_msg, timestamp));
+        });
+    }
+    _release_routing_table(reader_phase);
+    _handle_sync_message(type, timestamp);
+}
+
+bool MidiDispatcher::send_midi_rt(int port, MidiDataByte data, int sample_offset)
+{
+    switch (midi::decode_message_type(data))
+    {
+        case midi::MessageType::PROGRAM_CHANGE:
+        case midi::MessageType::TIMING_CLOCK:
+        case midi::MessageType::START:
+        case midi::MessageType::CONTINUE:
+        case midi::MessageType::STOP:
+            return false;
+
+        default:
+            break;
+    }
+    auto send_event = [&](RtEvent&& rt_event)
+    {
+        /* Nothing that could be done about a full queue from the rt thread, so the event is dropped */
+        _engine->send_input_event(rt_event);
+    };
+    int reader_phase;
+    const RoutingTable* routes = _acquire_routing_table(reader_phase);
+    _dispatch_midi(routes, port, data, sample_offset, send_event);
+    _release_routing_table(reader_phase);
+    return true;
+}
+
+void MidiDispatcher::send_sysex(int port, const uint8_t* data, int size, Time timestamp)
+{
+    if (size <= 0)
+    {
+        return;
+    }
+    /* Sysex payloads are copied to the rt domain by the event dispatcher, so there is no fast path */
+    int reader_phase;
+    const RoutingTable* routes = _acquire_routing_table(reader_phase);
+    for (auto type : {RouteType::KEYBOARD, RouteType::RAW_MIDI})
+    {
+        routes->for_each_route(port, type, 0, 0, [&](InputConnection& c)
+        {
+            _event_dispatcher->post_event(new SysexEvent(c.target, data, size, timestamp));
+        });
+    }
+    _release_routing_table(reader_phase);
+}
+
+void MidiDispatcher::_handle_sync_message(midi::MessageType type, Time timestamp)
+{
+    auto transport = _engine->transport();
+    if (transport == nullptr || transport->sync_mode() != SyncMode::MIDI_SLAVE)
+    {
+        return;
+    }
+    switch (type)
+    {
+        case midi::MessageType::TIMING_CLOCK:
+        {
+            if (_clock_tempo_estimator.tick(timestamp == IMMEDIATE_PROCESS ? get_current_time() : timestamp))
             {
-                _event_dispatcher->post_event(make_wrapped_midi_event(c, data.data(), size, timestamp));
+                float tempo = _clock_tempo_estimator.tempo();
+                if (std::abs(tempo - _clock_tempo) > CLOCK_TEMPO_THRESHOLD)
+                {
+                    _clock_tempo = tempo;
+                    _event_dispatcher->post_event(new SetEngineTempoEvent(tempo, IMMEDIATE_PROCESS));
+                }
             }
+            break;
         }
+
+        case midi::MessageType::START:
+            _clock_tempo_estimator.reset();
+            [[fallthrough]];
+
+        case midi::MessageType::CONTINUE:
+            _event_dispatcher->post_event(new SetEnginePlayingModeStateEvent(PlayingMode::PLAYING, IMMEDIATE_PROCESS));
+            break;
+
+        case midi::MessageType::STOP:
+            _event_dispatcher->post_event(new SetEnginePlayingModeStateEvent(PlayingMode::STOPPED, IMMEDIATE_PROCESS));
+            break;
+
+        default:
+            break;
     }
+}
+
+template <typename SendFunction>
+void MidiDispatcher::_dispatch_midi(const RoutingTable* routes, int port, MidiDataByte data, int sample_offset,
+                                    SendFunction& send_event)
+{
+    int channel = midi::decode_channel(data);
+    int size = data.size();
+
+    /* Dispatch raw midi messages */
+    routes->for_each_route(port, RouteType::RAW_MIDI, channel, 0, [&](InputConnection& c)
+    {
+        send_event(make_wrapped_midi_rt_event(c, data.data(), size, sample_offset));
+    });
 
     /* Dispatch decoded midi messages */
     midi::MessageType type = midi::decode_message_type(data);
@@ -309,32 +565,17 @@ void MidiDispatcher::send_midi(int port, MidiDataByte data, Time timestamp)
         case midi::MessageType::CONTROL_CHANGE:
         {
             midi::ControlChangeMessage decoded_msg = midi::decode_control_change(data);
-            const auto& cons = _cc_routes.find(port);
-            if (cons != _cc_routes.end())
+            routes->for_each_route(port, RouteType::CONTROL_CHANGE, decoded_msg.channel, decoded_msg.controller,
+                                   [&](InputConnection& c)
             {
-                for (auto& c : cons->second[decoded_msg.controller][midi::MidiChannel::OMNI])
-                {
-                    _event_dispatcher->post_event(make_param_change_event(c, decoded_msg, timestamp));
-                }
-                for (auto& c : cons->second[decoded_msg.controller][decoded_msg.channel])
-                {
-                    _event_dispatcher->post_event(make_param_change_event(c, decoded_msg, timestamp));
-                }
-            }
+                send_event(make_param_change_rt_event(c, decoded_msg, sample_offset));
+            });
             if (decoded_msg.controller == midi::MOD_WHEEL_CONTROLLER_NO)
             {
-                const auto& cons = _kb_routes_in.find(port);
-                if (cons != _kb_routes_in.end())
+                routes->for_each_route(port, RouteType::KEYBOARD, decoded_msg.channel, 0, [&](InputConnection& c)
                 {
-                    for (auto c : cons->second[midi::MidiChannel::OMNI])
-                    {
-                        _event_dispatcher->post_event(make_modulation_event(c, decoded_msg, timestamp));
-                    }
-                    for (auto c : cons->second[decoded_msg.channel])
-                    {
-                        _event_dispatcher->post_event(make_modulation_event(c, decoded_msg, timestamp));
-                    }
-                }
+                    send_event(make_modulation_rt_event(c, decoded_msg, sample_offset));
+                });
             }
             break;
         }
@@ -342,108 +583,50 @@ void MidiDispatcher::send_midi(int port, MidiDataByte data, Time timestamp)
         case midi::MessageType::NOTE_ON:
         {
             midi::NoteOnMessage decoded_msg = midi::decode_note_on(data);
-            const auto& cons = _kb_routes_in.find(port);
-            if (cons != _kb_routes_in.end())
+            routes->for_each_route(port, RouteType::KEYBOARD, decoded_msg.channel, 0, [&](InputConnection& c)
             {
-                for (auto c : cons->second[midi::MidiChannel::OMNI])
-                {
-                    _event_dispatcher->post_event(make_note_on_event(c, decoded_msg, timestamp));
-                }
-                for (auto c : cons->second[decoded_msg.channel])
-                {
-                    _event_dispatcher->post_event(make_note_on_event(c, decoded_msg, timestamp));
-                }
-            }
+                send_event(make_note_on_rt_event(c, decoded_msg, sample_offset));
+            });
             break;
         }
 
         case midi::MessageType::NOTE_OFF:
         {
             midi::NoteOffMessage decoded_msg = midi::decode_note_off(data);
-            const auto& cons = _kb_routes_in.find(port);
-            if (cons != _kb_routes_in.end())
+            routes->for_each_route(port, RouteType::KEYBOARD, decoded_msg.channel, 0, [&](InputConnection& c)
             {
-                for (auto c : cons->second[midi::MidiChannel::OMNI])
-                {
-                    _event_dispatcher->post_event(make_note_off_event(c, decoded_msg, timestamp));
-                }
-                for (auto c : cons->second[decoded_msg.channel])
-                {
-                    _event_dispatcher->post_event(make_note_off_event(c, decoded_msg, timestamp));
-                }
-            }
+                send_event(make_note_off_rt_event(c, decoded_msg, sample_offset));
+            });
             break;
         }
 
         case midi::MessageType::PITCH_BEND:
         {
             midi::PitchBendMessage decoded_msg = midi::decode_pitch_bend(data);
-            const auto& cons = _kb_routes_in.find(port);
-            if (cons != _kb_routes_in.end())
+            routes->for_each_route(port, RouteType::KEYBOARD, decoded_msg.channel, 0, [&](InputConnection& c)
             {
-                for (auto c : cons->second[midi::MidiChannel::OMNI])
-                {
-                    _event_dispatcher->post_event(make_pitch_bend_event(c, decoded_msg, timestamp));
-                }
-                for (auto c : cons->second[decoded_msg.channel])
-                {
-                    _event_dispatcher->post_event(make_pitch_bend_event(c, decoded_msg, timestamp));
-                }
-            }
+                send_event(make_pitch_bend_rt_event(c, decoded_msg, sample_offset));
+            });
             break;
         }
 
         case midi::MessageType::POLY_KEY_PRESSURE:
         {
             midi::PolyKeyPressureMessage decoded_msg = midi::decode_poly_key_pressure(data);
-            const auto& cons = _kb_routes_in.find(port);
-            if (cons != _kb_routes_in.end())
+            routes->for_each_route(port, RouteType::KEYBOARD, decoded_msg.channel, 0, [&](InputConnection& c)
             {
-                for (auto c : cons->second[midi::MidiChannel::OMNI])
-                {
-                    _event_dispatcher->post_event(make_note_aftertouch_event(c, decoded_msg, timestamp));
-                }
-                for (auto c : cons->second[decoded_msg.channel])
-                {
-                    _event_dispatcher->post_event(make_note_aftertouch_event(c, decoded_msg, timestamp));
-                }
-            }
+                send_event(make_note_aftertouch_rt_event(c, decoded_msg, sample_offset));
+            });
             break;
         }
 
         case midi::MessageType::CHANNEL_PRESSURE:
         {
             midi::ChannelPressureMessage decoded_msg = midi::decode_channel_pressure(data);
-            const auto& cons = _kb_routes_in.find(port);
-            if (cons != _kb_routes_in.end())
-            {
-                for (auto c : cons->second[midi::MidiChannel::OMNI])
-                {
-                    _event_dispatcher->post_event(make_aftertouch_event(c, decoded_msg, timestamp));
-                }
-                for (auto c : cons->second[decoded_msg.channel])
-                {
-                    _event_dispatcher->post_event( make_aftertouch_event(c, decoded_msg, timestamp));
-                }
-            }
-            break;
-        }
-
-        case midi::MessageType::PROGRAM_CHANGE:
-        {
-            midi::ProgramChangeMessage decoded_msg = midi::decode_program_change(data);
-            const auto& cons = _pc_routes.find(port);
-            if (cons != _pc_routes.end())
+            routes->for_each_route(port, RouteType::KEYBOARD, decoded_msg.channel, 0, [&](InputConnection& c)
             {
-                for (auto c : cons->second[midi::MidiChannel::OMNI])
-                {
-                    _event_dispatcher->post_event(make_program_change_event(c, decoded_msg, timestamp));
-                }
-                for (auto c : cons->second[decoded_msg.channel])
-                {
-                    _event_dispatcher->post_event(make_program_change_event(c, decoded_msg, timestamp));
-                }
-            }
+                send_event(make_aftertouch_rt_event(c, decoded_msg, sample_offset));
+            });
             break;
         }
 
@@ -457,10 +640,12 @@ int MidiDispatcher::process(Event* event)
     if (event->is_keyboard_event())
     {
         auto typed_event = static_cast<KeyboardEvent*>(event);
-        const auto& cons = _kb_routes_out.find(typed_event->processor_id());
-        if (cons != _kb_routes_out.end())
+        int reader_phase;
+        const RoutingTable* routes = _acquire_routing_table(reader_phase);
+        const auto cons = routes->outputs(typed_event->processor_id());
+        if (cons != nullptr)
         {
-            for (const OutputConnection& c : cons->second)
+            for (const OutputConnection& c : *cons)
             {
                 MidiDataByte midi_data;
                 switch (typed_event->subtype())
@@ -491,10 +676,97 @@ int MidiDispatcher::process(Event* event)
                 _frontend->send_midi(c.output, midi_data, event->time());
             }
         }
+        _release_routing_table(reader_phase);
         return EventStatus::HANDLED_OK;
     }
     return EventStatus::NOT_HANDLED;
 }
 
+void MidiDispatcher::flush()
+{
+    if (_frontend != nullptr)
+    {
+        _frontend->flush();
+    }
+}
+
+void MidiDispatcher::process_deferred_input()
+{
+    if (_frontend != nullptr)
+    {
+        _frontend->process_deferred_input();
+    }
+}
+
+void MidiDispatcher::_add_input_route(RouteType type, int input, int channel, int data, const InputConnection& connection)
+{
+    _input_routes.push_back({type, input, channel, data, std::make_unique<InputConnection>(connection)});
+    _publish_routes();
+}
+
+void MidiDispatcher::_publish_routes()
+{
+    auto table = new RoutingTable(_midi_inputs);
+    /* Collect the connections of every lookup entry, omni connections are expanded to all
+     * channels and go before the channel specific ones, as they are dispatched first */
+    std::vector<std::vector<InputConnection*>> entries(table->_spans.size());
+    for (bool omni : {true, false})
+    {
+        for (auto& route : _input_routes)
+        {
+            if (route.input < 0 || route.input >= _midi_inputs || (route.channel == midi::MidiChannel::OMNI) != omni)
+            {
+                continue;
+            }
+            if (route.channel < 0 || route.channel > midi::MidiChannel::OMNI ||
+                (route.type == RouteType::CONTROL_CHANGE && (route.data < 0 || route.data >= MIDI_CONTROLLERS)))
+            {
+                SUSHI_LOG_WARNING("Ignoring midi connection with invalid channel {} or data {}", route.channel, route.data);
+                continue;
+            }
+            int first_channel = omni ? 0 : route.channel;
+            int last_channel = omni ? MIDI_CHANNELS - 1 : route.channel;
+            for (int channel = first_channel; channel <= last_channel; ++channel)
+            {
+                entries[RoutingTable::_index(route.input, route.type, channel, route.data)].push_back(route.connection.get());
+            }
+        }
+    }
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        table->_spans[i] = {static_cast<int>(table->_connections.size()), static_cast<int>(entries[i].size())};
+        table->_connections.insert(table->_connections.end(), entries[i].begin(), entries[i].end());
+    }
+    table->_outputs = _output_routes;
+
+    /* A reader that got the old table registered in one of the phase counters before the
+     * swap. Flipping the phase twice and waiting for the counter of the previous phase
+     * each time lets all of those readers finish, while readers arriving after a flip
+     * register in the other counter and can't keep the publisher waiting */
+    auto old_table = _routing_table.exchange(table);
+    for (int i = 0; i < 2; ++i)
+    {
+        int phase = _routing_table_phase.load();
+        _routing_table_phase.store(1 - phase);
+        while (_routing_table_readers[phase].load() > 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    delete old_table;
+}
+
+const RoutingTable* MidiDispatcher::_acquire_routing_table(int& phase)
+{
+    phase = _routing_table_phase.load();
+    _routing_table_readers[phase].fetch_add(1);
+    return _routing_table.load();
+}
+
+void MidiDispatcher::_release_routing_table(int phase)
+{
+    _routing_table_readers[phase].fetch_sub(1);
+}
+
 } // end namespace midi_dispatcher
 } // end namespace sushi
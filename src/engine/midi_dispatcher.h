@@ -22,8 +22,11 @@
 #define SUSHI_MIDI_DISPATCHER_H
 
 #include <string>
-#include <map>
 #include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "library/constants.h"
@@ -31,6 +34,7 @@
 #include "library/midi_decoder.h"
 #include "library/event.h"
 #include "library/processor.h"
+#include "library/tempo_estimator.h"
 #include "control_frontends/base_midi_frontend.h"
 #include "base_engine.h"
 #include "base_event_dispatcher.h"
@@ -59,6 +63,75 @@ struct OutputConnection
     float max_range;
 };
 
+/* Number of lookup entries per midi input in the compiled routing tables. Keyboard,
+ * raw midi and program change routes are indexed by channel, cc routes by channel
+ * and controller number. */
+constexpr int MIDI_CHANNELS = midi::MidiChannel::OMNI;
+constexpr int MIDI_CONTROLLERS = 128;
+constexpr int ROUTES_PER_INPUT = 3 * MIDI_CHANNELS + MIDI_CHANNELS * MIDI_CONTROLLERS;
+
+enum class RouteType
+{
+    KEYBOARD,
+    RAW_MIDI,
+    PROGRAM_CHANGE,
+    CONTROL_CHANGE
+};
+
+/**
+ * @brief Immutable, flat lookup table compiled from the configured connections.
+ *        Omni connections are expanded to every channel so that dispatching a
+ *        message is a single lookup regardless of the number of connections.
+ */
+class RoutingTable
+{
+public:
+    RoutingTable(int inputs) : _inputs(inputs), _spans(inputs * ROUTES_PER_INPUT, Span{0, 0}) {}
+
+    template <typename Function>
+    void for_each_route(int input, RouteType type, int channel, int data, Function function) const
+    {
+        if (input < 0 || input >= _inputs)
+        {
+            return;
+        }
+        const auto& span = _spans[_index(input, type, channel, data)];
+        for (int i = span.start; i < span.start + span.count; ++i)
+        {
+            function(*_connections[i]);
+        }
+    }
+
+    const std::vector<OutputConnection>* outputs(ObjectId processor) const
+    {
+        auto outputs = _outputs.find(processor);
+        return outputs != _outputs.end() ? &outputs->second : nullptr;
+    }
+
+private:
+    friend class MidiDispatcher;
+
+    struct Span
+    {
+        int start;
+        int count;
+    };
+
+    static int _index(int input, RouteType type, int channel, int data)
+    {
+        if (type == RouteType::CONTROL_CHANGE)
+        {
+            return input * ROUTES_PER_INPUT + 3 * MIDI_CHANNELS + channel * MIDI_CONTROLLERS + data;
+        }
+        return input * ROUTES_PER_INPUT + static_cast<int>(type) * MIDI_CHANNELS + channel;
+    }
+
+    int _inputs;
+    std::vector<Span> _spans;
+    std::vector<InputConnection*> _connections;
+    std::unordered_map<ObjectId, std::vector<OutputConnection>> _outputs;
+};
+
 enum class MidiDispatcherStatus
 {
     OK,
@@ -91,7 +164,9 @@ public:
  */
     void set_midi_inputs(int no_inputs)
     {
+        std::lock_guard<std::mutex> lock(_config_lock);
         _midi_inputs = no_inputs;
+        _publish_routes();
     }
 
     /**
@@ -169,6 +244,15 @@ public:
     MidiDispatcherStatus connect_track_to_output(int midi_output,
                                                  const std::string &track_name,
                                                  int channel);
+
+    /**
+     * @brief Send midi clock, start and stop messages generated from the engine
+     *        transport to a given midi output
+     * @param midi_output Index of the midi out
+     * @return OK if successfully connected, error status otherwise
+     */
+    MidiDispatcherStatus connect_clock_to_output(int midi_output);
+
     /**
      * @brief Clears all connections made with connect_kb_to_track
      *        and connect_cc_to_parameter.
@@ -185,9 +269,42 @@ public:
      */
     void send_midi(int port, MidiDataByte data, Time timestamp) override;
 
+    /**
+     * @brief Rt safe version of send_midi(). Program changes have no rt representation
+     *        and clock messages need a timestamp, so both are rejected.
+     * @param port Index of the originating midi port.
+     * @param data The raw midi message.
+     * @param sample_offset Offset of the message in the next audio chunk.
+     * @return true if the message was dispatched
+     */
+    bool send_midi_rt(int port, MidiDataByte data, int sample_offset) override;
+
+    /**
+     * @brief Same as send_midi() but all events are passed through the event dispatcher.
+     * @param port Index of the originating midi port.
+     * @param data The raw midi message.
+     * @param timestamp timestamp of the midi event
+     */
+    void send_deferred_midi(int port, MidiDataByte data, Time timestamp) override;
+
+    /**
+     * @brief Send a sysex message to all tracks connected to the port with either a
+     *        keyboard or a raw midi connection. Sysex messages have no channel so
+     *        they are routed as channel 0 messages.
+     * @param port Index of the originating midi port.
+     * @param data Pointer to the complete message.
+     * @param size Length of data in bytes.
+     * @param timestamp timestamp of the midi message
+     */
+    void send_sysex(int port, const uint8_t* data, int size, Time timestamp) override;
+
     /* Inherited from EventPoster */
     int process(Event* /*event*/) override;
 
+    void flush() override;
+
+    void process_deferred_input() override;
+
     /**
      * @brief The unique id of this poster.
      * @return
@@ -196,14 +313,61 @@ public:
 
 private:
 
-    std::map<int, std::array<std::vector<InputConnection>, midi::MidiChannel::OMNI + 1>> _kb_routes_in;
-    std::map<ObjectId, std::vector<OutputConnection>>  _kb_routes_out;
-    std::map<int, std::array<std::array<std::vector<InputConnection>, midi::MidiChannel::OMNI + 1>, midi::MAX_CONTROLLER_NO + 1>> _cc_routes;
-    std::map<int, std::array<std::vector<InputConnection>, midi::MidiChannel::OMNI + 1>> _pc_routes;
-    std::map<int, std::array<std::vector<InputConnection>, midi::MidiChannel::OMNI + 1>> _raw_routes_in;
+    struct InputRoute
+    {
+        RouteType type;
+        int       input;
+        int       channel;
+        int       data;
+        /* Kept on the heap so that published tables can point to it */
+        std::unique_ptr<InputConnection> connection;
+    };
+
+    /* Dispatch a message to all connections that have an rt representation */
+    template <typename SendFunction>
+    void _dispatch_midi(const RoutingTable* routes, int port, MidiDataByte data, int sample_offset,
+                        SendFunction& send_event);
+
+    void _send_midi(int port, MidiDataByte data, Time timestamp, bool allow_direct_send);
+
+    static void _fallback_event_delivered(void* arg, Event* /*event*/, int /*status*/)
+    {
+        reinterpret_cast<MidiDispatcher*>(arg)->_fallback_events.fetch_sub(1);
+    }
+
+    /* Estimate tempo from midi clock and follow start/stop messages when in midi sync mode */
+    void _handle_sync_message(midi::MessageType type, Time timestamp);
+
+    /* Must be called with _config_lock held */
+    void _add_input_route(RouteType type, int input, int channel, int data, const InputConnection& connection);
+
+    /* Compile the configured routes and swap in the new table, must be called with _config_lock held */
+    void _publish_routes();
+
+    /* Get the current table, must be paired with a call to _release_routing_table()
+     * with the reader phase returned in phase */
+    const RoutingTable* _acquire_routing_table(int& phase);
+    void _release_routing_table(int phase);
+
+    std::mutex _config_lock;
+    std::vector<InputRoute> _input_routes;
+    std::unordered_map<ObjectId, std::vector<OutputConnection>> _output_routes;
+    std::atomic<const RoutingTable*> _routing_table{nullptr};
+    /* Readers register in the counter of the current phase, so that a publisher only
+     * has to wait for readers that registered before it flipped the phase */
+    std::atomic<int> _routing_table_phase{0};
+    std::array<std::atomic<int>, 2> _routing_table_readers{};
+
+    /* Events due now that were posted to the event dispatcher because the direct input
+     * lane was full, and that have not been delivered to the rt thread yet */
+    std::atomic<int> _fallback_events{0};
+
     int _midi_inputs{0};
     int _midi_outputs{0};
 
+    TempoEstimator _clock_tempo_estimator{midi::CLOCK_TICKS_PER_QUARTER_NOTE};
+    float _clock_tempo{0};
+
     engine::BaseEngine* _engine;
     midi_frontend::BaseMidiFrontend* _frontend;
     dispatcher::BaseEventDispatcher* _event_dispatcher;
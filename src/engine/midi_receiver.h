@@ -30,6 +30,37 @@ class MidiReceiver
 {
 public:
     virtual void send_midi(int port, MidiDataByte data, Time timestamp) = 0;
+
+    /**
+     * @brief Dispatch a midi message from the audio thread, the resulting events are
+     *        processed in the next audio chunk. Must be rt safe.
+     * @param port Index of the originating midi port.
+     * @param data The midi message.
+     * @param sample_offset Offset of the message in the next audio chunk.
+     * @return false if the message could not be handled in the rt domain and should
+     *         be passed to send_deferred_midi() from a non rt thread instead.
+     */
+    virtual bool send_midi_rt(int /*port*/, MidiDataByte /*data*/, int /*sample_offset*/) {return false;}
+
+    /**
+     * @brief Dispatch a message that was rejected by send_midi_rt(). Unlike send_midi(),
+     *        nothing is sent directly to the engine, since the audio thread is the
+     *        producer of the engine's input lane when send_midi_rt() is used.
+     * @param port Index of the originating midi port.
+     * @param data The midi message.
+     * @param timestamp timestamp of the midi message
+     */
+    virtual void send_deferred_midi(int port, MidiDataByte data, Time timestamp) {send_midi(port, data, timestamp);}
+
+    /**
+     * @brief Dispatch a sysex message, or any other midi message too long to fit in a
+     *        MidiDataByte. The data is copied and need not outlive the call.
+     * @param port Index of the originating midi port.
+     * @param data Pointer to the complete message, including start and end bytes.
+     * @param size Length of data in bytes.
+     * @param timestamp timestamp of the midi message
+     */
+    virtual void send_sysex(int /*port*/, const uint8_t* /*data*/, int /*size*/, Time /*timestamp*/) {}
 };
 
 
@@ -18,47 +18,123 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
-#include <thread>
-
 #include "engine/receiver.h"
 
 namespace sushi {
 namespace receiver {
 
-constexpr int MAX_RETRIES = 100;
-
 bool AsynchronousEventReceiver::wait_for_response(EventId id, std::chrono::milliseconds timeout)
 {
-    int retries = 0;
-    while (retries < MAX_RETRIES)
+    std::vector<Completion> completions;
+    std::unique_lock<std::mutex> lock(_lock);
+    /* Pick up responses that arrived since the queue was last drained, after
+     * that the thread calling process_responses() wakes us up */
+    _drain_queue(completions);
+    bool received = _notifier.wait_for(lock, timeout, [&]() {return _responses.count(id) > 0;});
+    bool status = false;
+    if (received)
     {
-        RtEvent event;
-        while (_queue->pop(event))
+        auto node = _responses.find(id);
+        status = node->second.status;
+        _responses.erase(node);
+    }
+    lock.unlock();
+    _call_callbacks(completions);
+    return status;
+}
+
+void AsynchronousEventReceiver::wait_for_response_async(EventId id, AsyncResponseCallback callback, void* arg)
+{
+    std::vector<Completion> completions;
+    std::unique_lock<std::mutex> lock(_lock);
+    _drain_queue(completions);
+    auto node = _responses.find(id);
+    if (node != _responses.end())
+    {
+        completions.push_back(Completion{Callback{callback, arg, node->second.received}, id, node->second.status});
+        _responses.erase(node);
+    }
+    else
+    {
+        _callbacks[id] = Callback{callback, arg, std::chrono::steady_clock::now()};
+    }
+    lock.unlock();
+    _call_callbacks(completions);
+}
+
+void AsynchronousEventReceiver::process_responses()
+{
+    std::vector<Completion> completions;
+    std::unique_lock<std::mutex> lock(_lock);
+    _drain_queue(completions);
+    lock.unlock();
+    _call_callbacks(completions);
+}
+
+void AsynchronousEventReceiver::_drain_queue(std::vector<Completion>& completions)
+{
+    auto now = std::chrono::steady_clock::now();
+    for (auto i = _responses.begin(); i != _responses.end();)
+    {
+        if (now - i->second.received > MAX_RESPONSE_AGE)
         {
-            if (event.type() >= RtEventType::STOP_ENGINE)
-            {
-                auto typed_event = event.returnable_event();
-                if (typed_event->event_id() == id)
-                {
-                    return (typed_event->status() == ReturnableRtEvent::EventStatus::HANDLED_OK);
-                }
-                bool status = (typed_event->status() == ReturnableRtEvent::EventStatus::HANDLED_OK);
-                _receive_list.push_back(Node{typed_event->event_id(), status});
-            }
+            i = _responses.erase(i);
         }
-        for (auto i = _receive_list.begin(); i != _receive_list.end(); ++i)
+        else
         {
-            if (i->id == id)
+            ++i;
+        }
+    }
+
+    bool received = false;
+    RtEvent event;
+    while (_queue->pop(event))
+    {
+        if (event.type() >= RtEventType::STOP_ENGINE)
+        {
+            auto typed_event = event.returnable_event();
+            EventId id = typed_event->event_id();
+            bool status = (typed_event->status() == ReturnableRtEvent::EventStatus::HANDLED_OK);
+            auto callback = _callbacks.find(id);
+            if (callback != _callbacks.end())
+            {
+                completions.push_back(Completion{callback->second, id, status});
+                _callbacks.erase(callback);
+            }
+            else
             {
-                bool status = i->status;
-                _receive_list.erase(i);
-                return status;
+                _responses[id] = Response{status, now};
+                received = true;
             }
         }
-        std::this_thread::sleep_for(timeout / MAX_RETRIES);
-        retries++;
     }
-    return false;
+    if (received)
+    {
+        _notifier.notify_all();
+    }
+
+    /* Give up on responses that should have arrived long ago */
+    for (auto i = _callbacks.begin(); i != _callbacks.end();)
+    {
+        if (now - i->second.registered > MAX_RESPONSE_AGE)
+        {
+            completions.push_back(Completion{i->second, i->first, false});
+            i = _callbacks.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void AsynchronousEventReceiver::_call_callbacks(const std::vector<Completion>& completions)
+{
+    for (const auto& completion : completions)
+    {
+        completion.callback.function(completion.callback.arg, completion.id, completion.status);
+    }
 }
+
 } // end namespace receiver
 } // end namespace sushi
@@ -23,6 +23,9 @@
 
 #include <vector>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
 
 #include "library/id_generator.h"
 #include "library/rt_event_fifo.h"
@@ -30,6 +33,19 @@
 namespace sushi {
 namespace receiver {
 
+/**
+ * @brief Callback signature for asynchronous completion notifications
+ * @param arg User supplied data
+ * @param id EventId of the completed event
+ * @param status true if the event was handled properly, false otherwise
+ */
+typedef void (*AsyncResponseCallback)(void* arg, EventId id, bool status);
+
+/* Responses nobody waits for, i.e. ones arriving after a wait timed out, are
+ * discarded when they get older than this. Callbacks still waiting for a
+ * response after this time are called with status false. */
+constexpr auto MAX_RESPONSE_AGE = std::chrono::seconds(1);
+
 class AsynchronousEventReceiver
 {
 public:
@@ -43,13 +59,55 @@ public:
      */
     bool wait_for_response(EventId id, std::chrono::milliseconds timeout);
 
+    /**
+     * @brief Register a callback to be called when a response to the given event is
+     *        received, without blocking the calling thread. The callback is called
+     *        from the thread that drains the queue, or directly if the response
+     *        has already arrived.
+     * @param id EventId of the event to wait for
+     * @param callback Function to call on completion
+     * @param arg Data passed to the callback
+     */
+    void wait_for_response_async(EventId id, AsyncResponseCallback callback, void* arg);
+
+    /**
+     * @brief Drain the response queue, wake up waiting threads and call any registered
+     *        callbacks. The rt thread can not signal a condition variable, so this
+     *        should be called periodically from a non-rt thread.
+     */
+    void process_responses();
+
 private:
-    struct Node
+    struct Response
     {
-        EventId id;
-        bool    status;
+        bool status;
+        std::chrono::steady_clock::time_point received;
     };
-    std::vector<Node> _receive_list;
+
+    struct Callback
+    {
+        AsyncResponseCallback function;
+        void* arg;
+        std::chrono::steady_clock::time_point registered;
+    };
+
+    struct Completion
+    {
+        Callback callback;
+        EventId  id;
+        bool     status;
+    };
+
+    /* Must be called with _lock held, completed callbacks are returned in completions */
+    void _drain_queue(std::vector<Completion>& completions);
+
+    /* Must be called without _lock held, as callbacks may send new events */
+    static void _call_callbacks(const std::vector<Completion>& completions);
+
+    std::unordered_map<EventId, Response> _responses;
+    std::unordered_map<EventId, Callback> _callbacks;
+    std::mutex _lock;
+    std::condition_variable _notifier;
     RtSafeRtEventFifo* _queue;
 };
 
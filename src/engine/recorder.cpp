@@ -0,0 +1,315 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Recording of engine and processor audio to file
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "recorder.h"
+#include "logging.h"
+
+namespace sushi {
+namespace engine {
+
+SUSHI_GET_LOGGER_WITH_MODULE_NAME("recorder");
+
+static_assert(RECORDER_BUFFER_FRAMES % AUDIO_CHUNK_SIZE == 0);
+
+int file_format_from_filename(const std::string& filename)
+{
+    auto extension = filename.substr(std::min(filename.find_last_of('.'), filename.size()));
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".flac")
+    {
+        return SF_FORMAT_FLAC | SF_FORMAT_PCM_24;
+    }
+    if (extension == ".aiff" || extension == ".aif")
+    {
+        return SF_FORMAT_AIFF | SF_FORMAT_PCM_24;
+    }
+    return SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+}
+
+RecorderTap::RecorderTap(RecordSource source, ObjectId processor_id, int channels) : _source(source),
+                                                                                     _processor_id(processor_id),
+                                                                                     _channels(channels),
+                                                                                     _buffer(RECORDER_BUFFER_FRAMES * channels, 0.0f)
+{}
+
+RecorderTap::~RecorderTap()
+{
+    if (_file)
+    {
+        sf_close(_file);
+    }
+}
+
+void RecorderTap::record(const ChunkSampleBuffer& buffer)
+{
+    auto state = _state.load(std::memory_order_acquire);
+    if (state == RecordState::STOPPING)
+    {
+        /* Acknowledge that nothing more will be written until the tap is armed again */
+        _state.store(RecordState::STOPPED, std::memory_order_release);
+        return;
+    }
+    if (state != RecordState::RECORDING)
+    {
+        return;
+    }
+    auto write_pos = _write_pos.load(std::memory_order_relaxed);
+    if (write_pos + AUDIO_CHUNK_SIZE - _read_pos.load(std::memory_order_acquire) > RECORDER_BUFFER_FRAMES)
+    {
+        _overruns.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    /* Chunks never wrap around the end of the buffer since its size is a multiple of the chunk size */
+    float* dest = _buffer.data() + (write_pos % RECORDER_BUFFER_FRAMES) * _channels;
+    int channels = std::min(_channels, buffer.channel_count());
+    for (int n = 0; n < AUDIO_CHUNK_SIZE; ++n)
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            dest[c] = buffer.channel(c)[n];
+        }
+        std::fill(dest + channels, dest + _channels, 0.0f);
+        dest += _channels;
+    }
+    _write_pos.store(write_pos + AUDIO_CHUNK_SIZE, std::memory_order_release);
+}
+
+bool RecorderTap::arm(const std::string& filename, float sample_rate)
+{
+    if (_state.load() != RecordState::IDLE)
+    {
+        SUSHI_LOG_WARNING("Tap is already recording to {}", _filename);
+        return false;
+    }
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.samplerate = static_cast<int>(sample_rate);
+    info.channels = _channels;
+    info.format = file_format_from_filename(filename);
+    _file = sf_open(filename.c_str(), SFM_WRITE, &info);
+    if (_file == nullptr)
+    {
+        SUSHI_LOG_ERROR("Failed to open {} for recording: {}", filename, sf_strerror(nullptr));
+        return false;
+    }
+    _filename = filename;
+    _overruns.store(0);
+    /* The audio thread doesn't write to the buffer when idle, so the positions can be reset */
+    _read_pos.store(_write_pos.load());
+    _state.store(RecordState::RECORDING, std::memory_order_release);
+    return true;
+}
+
+void RecorderTap::disarm(bool realtime)
+{
+    if (realtime)
+    {
+        if (_state.load() == RecordState::RECORDING)
+        {
+            _stop_requested = std::chrono::steady_clock::now();
+            _state.store(RecordState::STOPPING, std::memory_order_release);
+        }
+        return;
+    }
+    /* The audio thread is not running and can't acknowledge the stop, this also
+     * completes a stop that was requested just before the engine was stopped */
+    auto expected = RecordState::RECORDING;
+    if (_state.compare_exchange_strong(expected, RecordState::STOPPED) == false)
+    {
+        /* The writer thread may complete a timed out stop concurrently */
+        expected = RecordState::STOPPING;
+        _state.compare_exchange_strong(expected, RecordState::STOPPED);
+    }
+}
+
+void RecorderTap::write_to_file()
+{
+    auto state = _state.load(std::memory_order_acquire);
+    if (state == RecordState::IDLE)
+    {
+        return;
+    }
+    auto read_pos = _read_pos.load(std::memory_order_relaxed);
+    auto write_pos = _write_pos.load(std::memory_order_acquire);
+    while (read_pos < write_pos)
+    {
+        auto start = read_pos % RECORDER_BUFFER_FRAMES;
+        auto frames = std::min(write_pos - read_pos, RECORDER_BUFFER_FRAMES - start);
+        if (sf_writef_float(_file, _buffer.data() + start * _channels, frames) != frames)
+        {
+            SUSHI_LOG_ERROR("Error writing to {}: {}", _filename, sf_strerror(_file));
+        }
+        read_pos += frames;
+    }
+    _read_pos.store(read_pos, std::memory_order_release);
+
+    if (state == RecordState::STOPPED)
+    {
+        sf_close(_file);
+        _file = nullptr;
+        SUSHI_LOG_INFO("Finished recording to {}, {} overruns", _filename, _overruns.load());
+        _state.store(RecordState::IDLE);
+    }
+}
+
+void RecorderTap::check_stop_timeout()
+{
+    if (_state.load(std::memory_order_acquire) == RecordState::STOPPING &&
+        std::chrono::steady_clock::now() - _stop_requested > RECORDER_STOP_TIMEOUT)
+    {
+        /* If the audio thread acknowledged in the meantime, the tap is already STOPPED */
+        auto expected = RecordState::STOPPING;
+        _state.compare_exchange_strong(expected, RecordState::STOPPED, std::memory_order_acq_rel);
+    }
+}
+
+Recorder::~Recorder()
+{
+    _running = false;
+    if (_writer.joinable())
+    {
+        _writer.join();
+    }
+    /* Write whatever is left in the buffers, the tap destructors close the files */
+    for (int i = 0; i < _tap_count.load(); ++i)
+    {
+        _taps[i]->write_to_file();
+    }
+}
+
+int Recorder::add_tap(RecordSource source, ObjectId processor_id, int channels)
+{
+    std::lock_guard<std::mutex> lock(_control_lock);
+    int id = _tap_count.load();
+    if (id >= MAX_RECORDER_TAPS || channels <= 0)
+    {
+        return -1;
+    }
+    if (source != RecordSource::PROCESSOR_OUTPUT)
+    {
+        processor_id = 0;
+    }
+    _taps[id] = std::make_unique<RecorderTap>(source, processor_id, channels);
+    /* Publish the tap to the audio thread only after it is fully constructed */
+    _tap_count.store(id + 1, std::memory_order_release);
+    if (source == RecordSource::ENGINE_INPUT && channels > _engine_input_channels.load())
+    {
+        _engine_input_channels.store(channels, std::memory_order_release);
+    }
+    if (_running == false)
+    {
+        _running = true;
+        _writer = std::thread(&Recorder::_writer_loop, this);
+    }
+    return id;
+}
+
+RecorderTap* Recorder::tap(int id)
+{
+    if (id < 0 || id >= _tap_count.load())
+    {
+        return nullptr;
+    }
+    return _taps[id].get();
+}
+
+bool Recorder::arm(int id, const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(_control_lock);
+    auto recorder_tap = tap(id);
+    if (recorder_tap == nullptr)
+    {
+        return false;
+    }
+    return recorder_tap->arm(filename, _sample_rate);
+}
+
+bool Recorder::disarm(int id, bool realtime)
+{
+    std::lock_guard<std::mutex> lock(_control_lock);
+    auto recorder_tap = tap(id);
+    if (recorder_tap == nullptr)
+    {
+        return false;
+    }
+    recorder_tap->disarm(realtime);
+    return true;
+}
+
+void Recorder::remove_source(ObjectId processor_id)
+{
+    std::lock_guard<std::mutex> lock(_control_lock);
+    for (int i = 0; i < _tap_count.load(); ++i)
+    {
+        auto& recorder_tap = _taps[i];
+        if (recorder_tap->source() == RecordSource::PROCESSOR_OUTPUT && recorder_tap->processor_id() == processor_id)
+        {
+            /* The audio thread won't call record() for this processor anymore */
+            recorder_tap->disarm(false);
+        }
+    }
+}
+
+std::vector<RecorderTapInfo> Recorder::tap_info()
+{
+    std::lock_guard<std::mutex> lock(_control_lock);
+    std::vector<RecorderTapInfo> info;
+    for (int i = 0; i < _tap_count.load(); ++i)
+    {
+        const auto& recorder_tap = _taps[i];
+        info.push_back({recorder_tap->source(), recorder_tap->processor_id(), recorder_tap->channels(),
+                        recorder_tap->armed(), recorder_tap->overruns(), recorder_tap->filename()});
+    }
+    return info;
+}
+
+void Recorder::_record(RecordSource source, ObjectId processor_id, const ChunkSampleBuffer& buffer)
+{
+    int count = _tap_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i)
+    {
+        auto& recorder_tap = _taps[i];
+        if (recorder_tap->source() == source && recorder_tap->processor_id() == processor_id)
+        {
+            recorder_tap->record(buffer);
+        }
+    }
+}
+
+void Recorder::_writer_loop()
+{
+    while (_running)
+    {
+        for (int i = 0; i < _tap_count.load(std::memory_order_acquire); ++i)
+        {
+            _taps[i]->check_stop_timeout();
+            _taps[i]->write_to_file();
+        }
+        std::this_thread::sleep_for(RECORDER_WRITE_INTERVAL);
+    }
+}
+
+} // end namespace engine
+} // end namespace sushi
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Recording of engine and processor audio to file
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_RECORDER_H
+#define SUSHI_RECORDER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sndfile.h>
+
+#include "library/constants.h"
+#include "library/id_generator.h"
+#include "library/sample_buffer.h"
+
+namespace sushi {
+namespace engine {
+
+constexpr int MAX_RECORDER_TAPS = 32;
+/* Size of the buffer of each tap, must be a multiple of AUDIO_CHUNK_SIZE */
+constexpr int RECORDER_BUFFER_FRAMES = 1024 * AUDIO_CHUNK_SIZE;
+constexpr auto RECORDER_WRITE_INTERVAL = std::chrono::milliseconds(20);
+/* A stop not acknowledged by the audio thread within this time is completed by the writer */
+constexpr auto RECORDER_STOP_TIMEOUT = std::chrono::milliseconds(500);
+
+enum class RecordSource
+{
+    ENGINE_INPUT,
+    ENGINE_OUTPUT,
+    PROCESSOR_OUTPUT
+};
+
+enum class RecordState
+{
+    IDLE,
+    RECORDING,
+    STOPPING,
+    STOPPED
+};
+
+struct RecorderTapInfo
+{
+    RecordSource source;
+    ObjectId     processor_id;
+    int          channels;
+    bool         armed;
+    int          overruns;
+    std::string  filename;
+};
+
+/**
+ * @brief A single recording point. Audio is copied to a lock-free single producer,
+ *        single consumer ring buffer from the audio thread, and written to file from
+ *        the Recorder's writer thread. If the writer can't keep up, whole chunks are
+ *        dropped and counted as overruns.
+ *
+ *        When disarming, the tap goes through STOPPING, which is acknowledged by the
+ *        audio thread by setting STOPPED, after which the writer thread can empty the
+ *        buffer, close the file and set the tap to IDLE. If the engine is not running,
+ *        the tap goes directly to STOPPED. Taps on processors that are bypassed, not
+ *        processed or deleted never see the acknowledgement, so the writer thread sets
+ *        STOPPED itself after RECORDER_STOP_TIMEOUT.
+ */
+class RecorderTap
+{
+public:
+    RecorderTap(RecordSource source, ObjectId processor_id, int channels);
+
+    ~RecorderTap();
+
+    /**
+     * @brief Record a chunk of audio if armed. Called from the audio thread.
+     * @param buffer Audio to record, if it has fewer channels than the tap, the
+     *        remaining channels are recorded as silence
+     */
+    void record(const ChunkSampleBuffer& buffer);
+
+    /**
+     * @brief Open a file and start recording. The file type is taken from the extension,
+     *        .flac and .aiff files are written as 24 bit integer, other files as 32 bit
+     *        float wav files. Not safe to call concurrently with disarm() or itself.
+     * @param filename The file to record to
+     * @param sample_rate The sample rate of the file
+     * @return true if the file could be opened and the tap was not already recording
+     */
+    bool arm(const std::string& filename, float sample_rate);
+
+    /**
+     * @brief Stop recording. The file is closed asynchronously by the writer thread.
+     * @param realtime true if the audio thread is running and needs to acknowledge
+     *        the stop, otherwise the tap is stopped directly
+     */
+    void disarm(bool realtime);
+
+    /**
+     * @brief Write all buffered audio to file, called from the writer thread.
+     */
+    void write_to_file();
+
+    /**
+     * @brief Complete a stop that the audio thread has not acknowledged in time.
+     *        Called from the writer thread.
+     */
+    void check_stop_timeout();
+
+    RecordSource source() const {return _source;}
+
+    ObjectId processor_id() const {return _processor_id;}
+
+    int channels() const {return _channels;}
+
+    bool armed() const {return _state.load() == RecordState::RECORDING;}
+
+    /**
+     * @brief Number of chunks dropped since the tap was last armed
+     */
+    int overruns() const {return _overruns.load();}
+
+    const std::string& filename() const {return _filename;}
+
+private:
+    RecordSource _source;
+    ObjectId     _processor_id;
+    int          _channels;
+
+    /* Interleaved audio, positions are in frames and only ever increase */
+    std::vector<float>   _buffer;
+    std::atomic<int64_t> _write_pos{0};
+    std::atomic<int64_t> _read_pos{0};
+
+    std::atomic<RecordState> _state{RecordState::IDLE};
+    std::atomic<int>         _overruns{0};
+    /* Only written before the state is set to STOPPING */
+    std::chrono::steady_clock::time_point _stop_requested;
+    SNDFILE*                 _file{nullptr};
+    std::string              _filename;
+};
+
+/**
+ * @brief Manages a fixed number of recording taps and a thread that writes their
+ *        contents to file. Taps can be added at any time but are only removed when
+ *        the Recorder is destroyed, so the audio thread can access them without locking.
+ */
+class Recorder
+{
+public:
+    Recorder() = default;
+
+    ~Recorder();
+
+    /**
+     * @brief Add a new tap. Not safe to call from the audio thread.
+     * @param source Where to record from
+     * @param processor_id The processor or track to record, only used with PROCESSOR_OUTPUT
+     * @param channels The number of channels to record
+     * @return The id of the new tap, or -1 if the maximum number of taps is reached
+     */
+    int add_tap(RecordSource source, ObjectId processor_id, int channels);
+
+    /**
+     * @brief Get a tap
+     * @param id The id returned from add_tap()
+     * @return A pointer to the tap, nullptr if not found
+     */
+    RecorderTap* tap(int id);
+
+    /**
+     * @brief The number of taps currently added
+     */
+    int tap_count() const {return _tap_count.load();}
+
+    /**
+     * @brief The number of engine input channels that are recorded by any tap, these
+     *        need to be passed to the engine even if no track is connected to them.
+     *        Safe to call from the audio thread.
+     */
+    int engine_input_channels() const {return _engine_input_channels.load(std::memory_order_acquire);}
+
+    /**
+     * @brief Start recording from a tap to a file
+     * @param id The id of the tap
+     * @param filename The file to record to
+     * @return true if recording was started
+     */
+    bool arm(int id, const std::string& filename);
+
+    /**
+     * @brief Stop recording from a tap
+     * @param id The id of the tap
+     * @param realtime true if the engine is running in realtime
+     * @return true if the tap was found
+     */
+    bool disarm(int id, bool realtime);
+
+    /**
+     * @brief Stop all taps recording from a processor, called when the processor is
+     *        deleted. The processor must already be removed from the audio thread.
+     * @param processor_id The id of the deleted processor or track
+     */
+    void remove_source(ObjectId processor_id);
+
+    /**
+     * @brief Get a consistent snapshot of the configuration and state of all taps.
+     *        Unlike accessing the taps through tap(), this is safe to call
+     *        concurrently with arm() and disarm().
+     * @return A list with the state of each tap, indexed by tap id
+     */
+    std::vector<RecorderTapInfo> tap_info();
+
+    void set_sample_rate(float sample_rate) {_sample_rate = sample_rate;}
+
+    /* The functions below are called from the audio thread */
+    void record_engine_input(const ChunkSampleBuffer& buffer)
+    {
+        _record(RecordSource::ENGINE_INPUT, 0, buffer);
+    }
+
+    void record_engine_output(const ChunkSampleBuffer& buffer)
+    {
+        _record(RecordSource::ENGINE_OUTPUT, 0, buffer);
+    }
+
+    void record_processor_output(ObjectId processor_id, const ChunkSampleBuffer& buffer)
+    {
+        _record(RecordSource::PROCESSOR_OUTPUT, processor_id, buffer);
+    }
+
+private:
+    void _record(RecordSource source, ObjectId processor_id, const ChunkSampleBuffer& buffer);
+
+    void _writer_loop();
+
+    std::array<std::unique_ptr<RecorderTap>, MAX_RECORDER_TAPS> _taps;
+    std::atomic<int>  _tap_count{0};
+    std::atomic<int>  _engine_input_channels{0};
+    float             _sample_rate{0};
+
+    std::thread       _writer;
+    std::atomic<bool> _running{false};
+    std::mutex        _control_lock;
+};
+
+} // end namespace engine
+} // end namespace sushi
+
+#endif //SUSHI_RECORDER_H
@@ -21,6 +21,7 @@
 #include <cassert>
 
 #include "track.h"
+#include "recorder.h"
 #include "logging.h"
 
 SUSHI_GET_LOGGER_WITH_MODULE_NAME("track");
@@ -138,6 +139,10 @@ void Track::render()
         auto buffer = ChunkSampleBuffer::create_non_owning_buffer(_output_buffer, bus * 2, 2);
         _apply_pan_and_gain(buffer, bus);
     }
+    if (_recorder)
+    {
+        _recorder->record_processor_output(this->id(), _output_buffer);
+    }
 }
 
 void Track::process_audio(const ChunkSampleBuffer& /*in*/, ChunkSampleBuffer& out)
@@ -164,6 +169,10 @@ void Track::process_audio(const ChunkSampleBuffer& /*in*/, ChunkSampleBuffer& ou
         ChunkSampleBuffer proc_in = ChunkSampleBuffer::create_non_owning_buffer(aliased_in, 0, processor->input_channels());
         ChunkSampleBuffer proc_out = ChunkSampleBuffer::create_non_owning_buffer(aliased_out, 0, processor->output_channels());
         processor->process_audio(proc_in, proc_out);
+        if (_recorder)
+        {
+            _recorder->record_processor_output(processor->id(), proc_out);
+        }
         std::swap(aliased_in, aliased_out);
         _timer->stop_timer_rt_safe(processor_timestamp, processor->id());
     }
@@ -323,6 +332,9 @@ void Track::_process_output_events()
                     output_event(RtEvent::make_wrapped_midi_event(id(), event.sample_offset(),
                                                                   event.wrapped_midi_event()->midi_data()));
                     break;
+                case RtEventType::SYSEX_EVENT:
+                    /* The sysex payload is only valid for the current chunk and is not passed on */
+                    break;
 
                 default:
                     output_event(event);
@@ -41,6 +41,8 @@ namespace engine {
 constexpr int TRACK_MAX_CHANNELS = 10;
 constexpr int TRACK_MAX_BUSSES = TRACK_MAX_CHANNELS / 2;
 
+class Recorder;
+
 class Track : public InternalPlugin, public RtEventPipe
 {
 public:
@@ -126,6 +128,15 @@ public:
         set_event_output(&_output_event_buffer);
     }
 
+    /**
+     * @brief Set a recorder to pass the output of the track and its processors to
+     * @param recorder A Recorder instance, or nullptr to disable recording
+     */
+    void set_recorder(Recorder* recorder)
+    {
+        _recorder = recorder;
+    }
+
     /**
      * @brief Return a SampleBuffer to an input channel
      * @param bus The index of the channel, must not be greater than the number of channels configured
@@ -228,6 +239,7 @@ private:
     std::array<ValueSmootherFilter<float>, TRACK_MAX_BUSSES> _pan_gain_smoothers_left;
 
     performance::PerformanceTimer* _timer;
+    Recorder* _recorder{nullptr};
 
     RtSafeRtEventFifo _kb_event_buffer;
     RtSafeRtEventFifo _output_event_buffer;
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Utility functions for generating a report from a benchmark run.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include "library/benchmark_report.h"
+
+namespace sushi {
+
+rapidjson::Value timings_to_json(std::pair<ext::ControlStatus, ext::CpuTimings> timings,
+                                 rapidjson::Document::AllocatorType& allocator)
+{
+    rapidjson::Value timings_obj(rapidjson::kObjectType);
+    if (timings.first == ext::ControlStatus::OK)
+    {
+        timings_obj.AddMember("average", rapidjson::Value(timings.second.avg * 100.0f).Move(), allocator);
+        timings_obj.AddMember("min", rapidjson::Value(timings.second.min * 100.0f).Move(), allocator);
+        timings_obj.AddMember("max", rapidjson::Value(timings.second.max * 100.0f).Move(), allocator);
+    }
+    return timings_obj;
+}
+
+rapidjson::Document generate_benchmark_document(const audio_frontend::BenchmarkResults& results,
+                                                const sushi::ext::SushiControl* engine_controller)
+{
+    rapidjson::Document document;
+    document.SetObject();
+    rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
+
+    rapidjson::Value benchmark(rapidjson::kObjectType);
+    benchmark.AddMember("chunks", rapidjson::Value(results.chunks).Move(), allocator);
+    benchmark.AddMember("chunk_size", rapidjson::Value(AUDIO_CHUNK_SIZE).Move(), allocator);
+    benchmark.AddMember("sample_rate", rapidjson::Value(results.sample_rate).Move(), allocator);
+    benchmark.AddMember("process_time", rapidjson::Value(results.process_time).Move(), allocator);
+    benchmark.AddMember("chunks_per_second", rapidjson::Value(results.chunks_per_second).Move(), allocator);
+    benchmark.AddMember("realtime_factor", rapidjson::Value(results.realtime_factor).Move(), allocator);
+
+    rapidjson::Value latency(rapidjson::kObjectType);
+    latency.AddMember("average", rapidjson::Value(results.latency_avg).Move(), allocator);
+    latency.AddMember("p50", rapidjson::Value(results.latency_p50).Move(), allocator);
+    latency.AddMember("p90", rapidjson::Value(results.latency_p90).Move(), allocator);
+    latency.AddMember("p99", rapidjson::Value(results.latency_p99).Move(), allocator);
+    latency.AddMember("p99.9", rapidjson::Value(results.latency_p999).Move(), allocator);
+    latency.AddMember("max", rapidjson::Value(results.latency_max).Move(), allocator);
+    benchmark.AddMember("chunk_latency_us", latency.Move(), allocator);
+    document.AddMember("benchmark", benchmark.Move(), allocator);
+
+    document.AddMember("engine", timings_to_json(engine_controller->get_engine_timings(), allocator).Move(), allocator);
+
+    rapidjson::Value tracks(rapidjson::kArrayType);
+    for (auto& track : engine_controller->get_tracks())
+    {
+        rapidjson::Value track_obj(rapidjson::kObjectType);
+        track_obj.AddMember("name", rapidjson::Value(track.name.c_str(), allocator).Move(), allocator);
+        track_obj.AddMember("id", rapidjson::Value(track.id).Move(), allocator);
+        track_obj.AddMember("timings", timings_to_json(engine_controller->get_track_timings(track.id), allocator).Move(), allocator);
+
+        rapidjson::Value processors(rapidjson::kArrayType);
+        for (auto& processor : engine_controller->get_track_processors(track.id).second)
+        {
+            rapidjson::Value processor_obj(rapidjson::kObjectType);
+            processor_obj.AddMember("name", rapidjson::Value(processor.name.c_str(), allocator).Move(), allocator);
+            processor_obj.AddMember("id", rapidjson::Value(processor.id).Move(), allocator);
+            processor_obj.AddMember("timings", timings_to_json(engine_controller->get_processor_timings(processor.id), allocator).Move(), allocator);
+            processors.PushBack(processor_obj.Move(), allocator);
+        }
+        track_obj.AddMember("processors", processors.Move(), allocator);
+        tracks.PushBack(track_obj.Move(), allocator);
+    }
+    document.AddMember("tracks", tracks.Move(), allocator);
+
+    return document;
+}
+
+} // end namespace sushi
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Utility functions for generating a report from a benchmark run.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_BENCHMARK_REPORT_H
+#define SUSHI_BENCHMARK_REPORT_H
+
+#include "engine/controller.h"
+#include "audio_frontends/offline_frontend.h"
+#include "rapidjson/document.h"
+
+namespace sushi {
+
+/**
+ * @brief Generate a json document with the results of a benchmark run together with the
+ *        timings of the engine and all tracks and processors, if timings are enabled.
+ *        Processor timings are given in percent of the time available per chunk.
+ * @param results The results from the benchmark run
+ * @param engine_controller A controller to query tracks, processors and timings from
+ * @return A json document
+ */
+rapidjson::Document generate_benchmark_document(const audio_frontend::BenchmarkResults& results,
+                                                const sushi::ext::SushiControl* engine_controller);
+
+} // end namespace sushi
+
+#endif //SUSHI_BENCHMARK_REPORT_H
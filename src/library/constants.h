@@ -29,9 +29,14 @@ constexpr int AUDIO_CHUNK_SIZE = SUSHI_CUSTOM_AUDIO_CHUNK_SIZE;
 constexpr int AUDIO_CHUNK_SIZE = 64;
 #endif
 
-constexpr int MAX_ENGINE_CV_IO_PORTS = 4;
-constexpr int MAX_ENGINE_GATE_PORTS = 8;
+/* The number of cv and gate ports are set at startup, these are the upper limits */
+constexpr int MAX_ENGINE_CV_IO_PORTS = 64;
+constexpr int MAX_ENGINE_GATE_PORTS = 256;
 constexpr int MAX_ENGINE_GATE_NOTE_NO = 127;
+/* Port counts of default constructed control buffers. Also the number of gates
+ * available when not given by the configuration */
+constexpr int DEFAULT_ENGINE_CV_IO_PORTS = 4;
+constexpr int DEFAULT_ENGINE_GATE_PORTS = 8;
 
 /* Use in class declaration to disallow copying of this class.
  * Note that this marks copy constructor and assignment operator
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Bitset with the number of bits set at runtime, densely packed in 32 bit words.
+ *        Mimics the parts of std::bitset used by the engine. Only resize() allocates,
+ *        all other operations, including copy assignment between bitsets of equal
+ *        size, are safe to use from the realtime thread.
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_DYNAMIC_BITSET_H
+#define SUSHI_DYNAMIC_BITSET_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace sushi {
+
+class DynamicBitSet
+{
+public:
+    static constexpr int BITS_PER_WORD = 32;
+
+    /**
+     * @brief Proxy for assigning single bits through operator[], like std::bitset::reference
+     */
+    class reference
+    {
+    public:
+        reference(DynamicBitSet& set, int pos) : _set(set), _pos(pos) {}
+
+        reference& operator=(bool value)
+        {
+            _set.set(_pos, value);
+            return *this;
+        }
+
+        reference& operator=(const reference& other)
+        {
+            return *this = static_cast<bool>(other);
+        }
+
+        operator bool() const {return _set.test(_pos);}
+
+    private:
+        DynamicBitSet& _set;
+        int _pos;
+    };
+
+    DynamicBitSet() = default;
+
+    explicit DynamicBitSet(int size)
+    {
+        resize(size);
+    }
+
+    /**
+     * @brief Set the number of bits, new bits are cleared. Not safe to call from the rt thread.
+     */
+    void resize(int size)
+    {
+        assert(size >= 0);
+        _size = size;
+        _words.resize(word_count(size), 0);
+        _clear_unused_bits();
+    }
+
+    int size() const {return _size;}
+
+    bool test(int pos) const
+    {
+        assert(pos >= 0 && pos < _size);
+        return _words[pos / BITS_PER_WORD] & (1u << (pos % BITS_PER_WORD));
+    }
+
+    bool operator[](int pos) const {return test(pos);}
+
+    reference operator[](int pos) {return reference(*this, pos);}
+
+    DynamicBitSet& set(int pos, bool value = true)
+    {
+        assert(pos >= 0 && pos < _size);
+        uint32_t mask = 1u << (pos % BITS_PER_WORD);
+        auto& word = _words[pos / BITS_PER_WORD];
+        word = value ? word | mask : word & ~mask;
+        return *this;
+    }
+
+    DynamicBitSet& reset()
+    {
+        std::fill(_words.begin(), _words.end(), 0);
+        return *this;
+    }
+
+    DynamicBitSet& reset(int pos)
+    {
+        return set(pos, false);
+    }
+
+    bool any() const
+    {
+        for (auto word : _words)
+        {
+            if (word)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool none() const {return !any();}
+
+    int count() const
+    {
+        int count = 0;
+        for (auto word : _words)
+        {
+            count += __builtin_popcount(word);
+        }
+        return count;
+    }
+
+    /**
+     * @brief Xor with another bitset of the same size, typically used to find changed bits
+     */
+    DynamicBitSet& operator^=(const DynamicBitSet& other)
+    {
+        assert(other._size == _size);
+        for (size_t i = 0; i < _words.size(); ++i)
+        {
+            _words[i] ^= other._words[i];
+        }
+        return *this;
+    }
+
+    bool operator==(const DynamicBitSet& other) const
+    {
+        return _size == other._size && _words == other._words;
+    }
+
+    bool operator!=(const DynamicBitSet& other) const {return !(*this == other);}
+
+    /**
+     * @brief Raw access to the packed bits, for exchanging gates with hardware or other processes.
+     *        Bit n is found in bit n % 32 of word n / 32.
+     */
+    int words() const {return static_cast<int>(_words.size());}
+
+    uint32_t word(int index) const
+    {
+        assert(index >= 0 && index < words());
+        return _words[index];
+    }
+
+    /**
+     * @brief Set 32 bits at a time, bits outside the size of the set are ignored
+     */
+    void set_word(int index, uint32_t bits)
+    {
+        assert(index >= 0 && index < words());
+        _words[index] = bits;
+        if (index == words() - 1)
+        {
+            _clear_unused_bits();
+        }
+    }
+
+    static int word_count(int bits) {return (bits + BITS_PER_WORD - 1) / BITS_PER_WORD;}
+
+private:
+    void _clear_unused_bits()
+    {
+        int used_bits = _size % BITS_PER_WORD;
+        if (used_bits > 0)
+        {
+            _words.back() &= (1u << used_bits) - 1;
+        }
+    }
+
+    int _size{0};
+    std::vector<uint32_t> _words;
+};
+
+} // end namespace sushi
+
+#endif //SUSHI_DYNAMIC_BITSET_H
@@ -18,6 +18,8 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <memory>
+
 #include "library/event.h"
 #include "engine/base_engine.h"
 
@@ -130,13 +132,20 @@ Event* Event::from_rt_event(RtEvent& rt_event, Time timestamp)
                                                       typed_ev->callback_data(),
                                                       typed_ev->processor_id(),
                                                       typed_ev->event_id(),
-                                                      timestamp);
+                                                      timestamp,
+                                                      typed_ev->priority());
         }
         case RtEventType::BLOB_DELETE:
         {
             auto typed_ev = rt_event.data_payload_event();
             return new AsynchronousBlobDeleteEvent(typed_ev->value(), timestamp);
         }
+        case RtEventType::PARAMETER_BATCH_DELETE:
+        {
+            auto typed_ev = rt_event.data_payload_event();
+            return new AsynchronousParameterBatchDeleteEvent(reinterpret_cast<BatchParameterValue*>(typed_ev->value().data),
+                                                             timestamp);
+        }
         case RtEventType::CLIP_NOTIFICATION:
         {
             auto typed_ev = rt_event.clip_notification_event();
@@ -204,14 +213,85 @@ RtEvent SetProcessorBypassEvent::to_rt_event(int /*sample_offset*/)
 
 RtEvent StringPropertyChangeEvent::to_rt_event(int sample_offset)
 {
-    /* String in RtEvent must be passed as a pointer allocated outside of the event */
-    auto string_value = new std::string(_string_value);
-    return RtEvent::make_string_parameter_change_event(_processor_id, sample_offset, _parameter_id, string_value);
+    /* Deleted by the engine at the end of the audio chunk the event was processed in */
+    auto data = new char[_string_value.size()];
+    std::copy(_string_value.begin(), _string_value.end(), data);
+    return RtEvent::make_string_parameter_change_event(_processor_id, sample_offset, _parameter_id,
+                                                      data, static_cast<int>(_string_value.size()));
+}
+
+RtEvent StringPropertyChangeEvent::to_rt_event_in_ring(int sample_offset, RtTransferRing& ring)
+{
+    auto data = ring.allocate(static_cast<int>(_string_value.size()));
+    if (data == nullptr)
+    {
+        return to_rt_event(sample_offset);
+    }
+    std::copy(_string_value.begin(), _string_value.end(), data);
+    return RtEvent::make_string_parameter_change_event(_processor_id, sample_offset, _parameter_id,
+                                                      reinterpret_cast<const char*>(data),
+                                                      static_cast<int>(_string_value.size()), true);
 }
 
 RtEvent DataPropertyChangeEvent::to_rt_event(int sample_offset)
 {
-    return RtEvent::make_data_parameter_change_event(_processor_id, sample_offset, _parameter_id, _blob_value);
+    /* Deleted by the engine at the end of the audio chunk the event was processed in */
+    auto data = new uint8_t[_blob_value.size];
+    std::copy(_blob_value.data, _blob_value.data + _blob_value.size, data);
+    return RtEvent::make_data_parameter_change_event(_processor_id, sample_offset, _parameter_id,
+                                                    {_blob_value.size, data});
+}
+
+RtEvent DataPropertyChangeEvent::to_rt_event_in_ring(int sample_offset, RtTransferRing& ring)
+{
+    auto data = ring.allocate(_blob_value.size);
+    if (data == nullptr)
+    {
+        return to_rt_event(sample_offset);
+    }
+    std::copy(_blob_value.data, _blob_value.data + _blob_value.size, data);
+    return RtEvent::make_data_parameter_change_event(_processor_id, sample_offset, _parameter_id,
+                                                    {_blob_value.size, data}, true);
+}
+
+RtEvent SysexEvent::to_rt_event(int sample_offset)
+{
+    /* Deleted by the engine at the end of the audio chunk the event was processed in */
+    auto data = new uint8_t[_data.size()];
+    std::copy(_data.begin(), _data.end(), data);
+    return RtEvent::make_sysex_event(_processor_id, sample_offset, data, static_cast<int>(_data.size()));
+}
+
+RtEvent SysexEvent::to_rt_event_in_ring(int sample_offset, RtTransferRing& ring)
+{
+    auto data = ring.allocate(static_cast<int>(_data.size()));
+    if (data == nullptr)
+    {
+        return to_rt_event(sample_offset);
+    }
+    std::copy(_data.begin(), _data.end(), data);
+    return RtEvent::make_sysex_event(_processor_id, sample_offset, data, static_cast<int>(_data.size()), true);
+}
+
+RtEvent ParameterBatchChangeEvent::to_rt_event(int sample_offset)
+{
+    /* Values in RtEvent must be passed as an array allocated outside of the event */
+    auto values = new BatchParameterValue[_values.size()];
+    std::copy(_values.begin(), _values.end(), values);
+    return RtEvent::make_parameter_batch_event(_processor_id, sample_offset, values, static_cast<int>(_values.size()));
+}
+
+RtEvent ParameterBatchChangeEvent::to_rt_event_in_ring(int sample_offset, RtTransferRing& ring)
+{
+    auto data = ring.allocate(static_cast<int>(_values.size() * sizeof(BatchParameterValue)));
+    if (data == nullptr)
+    {
+        return to_rt_event(sample_offset);
+    }
+    auto values = reinterpret_cast<BatchParameterValue*>(data);
+    std::uninitialized_copy(_values.begin(), _values.end(), values);
+    return RtEvent::make_parameter_batch_event(_processor_id, sample_offset, values,
+                                               static_cast<int>(_values.size()), true);
 }
 
 int AddTrackEvent::execute(engine::BaseEngine*engine)
@@ -317,7 +397,13 @@ RtEvent AsynchronousProcessorWorkCompletionEvent::to_rt_event(int /*sample_offse
 
 Event*AsynchronousBlobDeleteEvent::execute()
 {
-    delete(_data.data);
+    delete[] _data.data;
+    return nullptr;
+}
+
+Event*AsynchronousParameterBatchDeleteEvent::execute()
+{
+    delete[] _values;
     return nullptr;
 }
 
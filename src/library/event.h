@@ -21,11 +21,14 @@
 #ifndef SUSHI_CONTROL_EVENT_H
 #define SUSHI_CONTROL_EVENT_H
 
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "types.h"
 #include "id_generator.h"
 #include "library/rt_event.h"
+#include "library/rt_transfer_ring.h"
 #include "library/time.h"
 #include "library/types.h"
 
@@ -103,6 +106,10 @@ public:
     /* Return the RtEvent counterpart of the Event */
     virtual RtEvent to_rt_event(int /*sample_offset*/) {return RtEvent();}
 
+    /* Return the RtEvent counterpart of the Event with any variable size
+     * payload stored in ring, if there is room for it */
+    virtual RtEvent to_rt_event_in_ring(int sample_offset, RtTransferRing& /*ring*/) {return to_rt_event(sample_offset);}
+
     /**
      * @brief Set a callback function that will be called after the event has been handled
      * @param callback A function pointer that will be called on completion
@@ -204,6 +211,33 @@ protected:
     MidiDataByte    _midi_data;
 };
 
+/**
+ * @brief Sysex and other midi messages that are too long to be wrapped in a KeyboardEvent
+ */
+class SysexEvent : public Event
+{
+public:
+    SysexEvent(ObjectId processor_id,
+               const uint8_t* data,
+               int size,
+               Time timestamp) : Event(timestamp),
+                                 _processor_id(processor_id),
+                                 _data(data, data + size) {}
+
+    bool maps_to_rt_event() override {return true;}
+
+    RtEvent to_rt_event(int sample_offset) override;
+
+    RtEvent to_rt_event_in_ring(int sample_offset, RtTransferRing& ring) override;
+
+    ObjectId processor_id() {return _processor_id;}
+    const std::vector<uint8_t>& data() {return _data;}
+
+private:
+    ObjectId             _processor_id;
+    std::vector<uint8_t> _data;
+};
+
 class ParameterChangeEvent : public Event
 {
 public:
@@ -239,6 +273,9 @@ public:
     int                 int_value() {return static_cast<int>(_value);}
     bool                bool_value() {return _value > 0.5f;}
 
+    /* Used to replace a value that has not been sent to the rt domain yet */
+    void                set_value(float value) {_value = value;}
+
 private:
     Subtype             _subtype;
 protected:
@@ -261,6 +298,7 @@ public:
                                                 _string_value(string_value) {}
 
     RtEvent to_rt_event(int sample_offset) override;
+    RtEvent to_rt_event_in_ring(int sample_offset, RtTransferRing& ring) override;
     ObjectId property_id() {return _parameter_id;}
 
 protected:
@@ -280,8 +318,14 @@ public:
                                                                    timestamp),
                                               _blob_value(blob_value) {}
 
+    /* The event takes ownership of the blob, processors receive a copy of the data */
+    ~DataPropertyChangeEvent() override
+    {
+        delete[] _blob_value.data;
+    }
 
     RtEvent to_rt_event(int sample_offset) override;
+    RtEvent to_rt_event_in_ring(int sample_offset, RtTransferRing& ring) override;
     ObjectId property_id() {return _parameter_id;}
     BlobData blob_value() {return _blob_value;}
 
@@ -289,6 +333,33 @@ protected:
     BlobData _blob_value;
 };
 
+/**
+ * @brief Sets several parameters of a processor at once. All values are
+ *        applied within the same audio chunk.
+ */
+class ParameterBatchChangeEvent : public Event
+{
+public:
+    ParameterBatchChangeEvent(ObjectId processor_id,
+                              const std::vector<BatchParameterValue>& values,
+                              Time timestamp) : Event(timestamp),
+                                                _processor_id(processor_id),
+                                                _values(values) {}
+
+    bool maps_to_rt_event() override {return true;}
+
+    RtEvent to_rt_event(int sample_offset) override;
+
+    RtEvent to_rt_event_in_ring(int sample_offset, RtTransferRing& ring) override;
+
+    ObjectId processor_id() {return _processor_id;}
+    const std::vector<BatchParameterValue>& values() {return _values;}
+
+private:
+    ObjectId                         _processor_id;
+    std::vector<BatchParameterValue> _values;
+};
+
 // Inheriting from ParameterChangeEvent because they share the same data members but have
 // different behaviour
 class ParameterChangeNotificationEvent : public ParameterChangeEvent
@@ -354,6 +425,14 @@ public:
 
     virtual bool is_engine_event() override {return true;}
 
+    /* Event must not execute concurrently with any other work, i.e. because
+     * it deletes processors that other work might reference */
+    virtual bool exclusive() {return false;}
+
+    /* Existing processor the event acts on, if any. Asynchronous work for that
+     * processor is ordered with the event, work for other processors is not */
+    virtual std::optional<ObjectId> ordering_processor() {return std::nullopt;}
+
     virtual int execute(engine::BaseEngine* engine) = 0;
 
 protected:
@@ -386,6 +465,8 @@ public:
     };
     RemoveTrackEvent(const std::string& name, Time timestamp) : EngineEvent(timestamp),
                                                                    _name(name) {}
+    bool exclusive() override {return true;}
+
     int execute(engine::BaseEngine* engine) override;
 
 private:
@@ -440,6 +521,8 @@ public:
                                            _name(name),
                                            _track(track) {}
 
+    bool exclusive() override {return true;}
+
     int execute(engine::BaseEngine* engine) override;
 
 private:
@@ -457,6 +540,8 @@ public:
                                          _processor_id(processor_id),
                                          _program_no(program_no) {}
 
+    std::optional<ObjectId> ordering_processor() override {return _processor_id;}
+
     int execute(engine::BaseEngine* engine) override;
 
     ObjectId            processor_id() {return _processor_id;}
@@ -501,6 +586,14 @@ class AsynchronousWorkEvent : public Event
 public:
     virtual bool process_asynchronously() override {return true;}
     virtual bool is_async_work_event() override {return true;}
+
+    /* Work with higher priority is executed before work with lower priority */
+    virtual WorkPriority priority() {return WorkPriority::NORMAL;}
+
+    /* Work for the same processor is executed in the order it was posted,
+     * work without a processor in any order */
+    virtual std::optional<ObjectId> ordering_processor() {return std::nullopt;}
+
     virtual Event* execute() = 0;
 
 protected:
@@ -516,13 +609,19 @@ public:
                                    void* data,
                                    ObjectId processor,
                                    EventId rt_event_id,
-                                   Time timestamp) : AsynchronousWorkEvent(timestamp),
-                                                       _work_callback(callback),
-                                                       _data(data),
-                                                       _rt_processor(processor),
-                                                       _rt_event_id(rt_event_id)
+                                   Time timestamp,
+                                   WorkPriority priority = WorkPriority::NORMAL) : AsynchronousWorkEvent(timestamp),
+                                                                                   _work_callback(callback),
+                                                                                   _data(data),
+                                                                                   _rt_processor(processor),
+                                                                                   _rt_event_id(rt_event_id),
+                                                                                   _priority(priority)
     {}
 
+    WorkPriority priority() override {return _priority;}
+
+    std::optional<ObjectId> ordering_processor() override {return _rt_processor;}
+
     virtual Event* execute() override;
 
 protected:
@@ -530,6 +629,7 @@ protected:
     void*                    _data;
     ObjectId                 _rt_processor;
     EventId                  _rt_event_id;
+    WorkPriority             _priority;
 };
 
 class AsynchronousProcessorWorkCompletionEvent : public Event
@@ -564,6 +664,18 @@ private:
     BlobData _data;
 };
 
+class AsynchronousParameterBatchDeleteEvent : public AsynchronousWorkEvent
+{
+public:
+    AsynchronousParameterBatchDeleteEvent(BatchParameterValue* values,
+                                          Time timestamp) : AsynchronousWorkEvent(timestamp),
+                                                            _values(values) {}
+    virtual Event* execute() override ;
+
+private:
+    BatchParameterValue* _values;
+};
+
 class SetEngineTempoEvent : public Event
 {
 public:
@@ -48,6 +48,19 @@ public:
      */
     virtual int process(Event* /*event*/) {return EventStatus::UNRECOGNIZED_EVENT;};
 
+    /**
+     * @brief Called once after a batch of published events has been delivered to
+     *        the poster. Posters that buffer their output should send it here.
+     */
+    virtual void flush() {}
+
+    /**
+     * @brief Called once per event dispatcher iteration on posters subscribed to
+     *        keyboard events. Posters can pass on input here that was received in
+     *        the rt thread but could not be handled there.
+     */
+    virtual void process_deferred_input() {}
+
     /**
      * @brief The unique id of this poster.
      * @return
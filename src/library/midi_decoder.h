@@ -43,6 +43,13 @@ constexpr int PITCH_BEND_MIDDLE = 8192;
 constexpr int MAX_CONTROLLER_NO = 119;
 /* Modulation wheel controller number */
 constexpr int MOD_WHEEL_CONTROLLER_NO = 1;
+/* Resolution of midi timing clock messages */
+constexpr int CLOCK_TICKS_PER_QUARTER_NOTE = 24;
+/* Longest sysex message accepted from the midi frontends */
+constexpr int MAX_SYSEX_SIZE = 16 * 1024;
+/* Start and end bytes of sysex messages */
+constexpr uint8_t SYSEX_START = 0xF0;
+constexpr uint8_t SYSEX_END = 0xF7;
 
 /**
  * @brief Convert midi data passed in C-array style to internal representation
@@ -196,6 +203,14 @@ struct SongSelectMessage
  */
 MessageType decode_message_type(MidiDataByte data);
 
+/**
+ * @brief Get the length in bytes of a midi message from its status byte.
+ * @param data Midi data.
+ * @return The number of bytes in the message, 0 for system exclusive messages
+ *         and unknown data as their length can not be derived from the status byte.
+ */
+int message_size(MidiDataByte data);
+
 /**
  * @brief Decode the channel number of a channel mode message.
  *        I.e. when the decoded message type is between
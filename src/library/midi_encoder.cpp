@@ -33,6 +33,9 @@ constexpr uint8_t CTRL_CHANGE_PREFIX= 0b10110000;
 constexpr uint8_t CHAN_PRES_PREFIX  = 0b11010000;
 constexpr uint8_t PITCH_BEND_PREFIX = 0b11100000;
 constexpr uint8_t PGM_CHANGE_PREFIX = 0b11000000;
+constexpr uint8_t TIMING_CLOCK      = 0xF8;
+constexpr uint8_t START_MESSAGE     = 0xFA;
+constexpr uint8_t STOP_MESSAGE      = 0xFC;
 
 
 MidiDataByte encode_note_on(int channel, int note, float velocity)
@@ -106,6 +109,21 @@ MidiDataByte encode_program_change(int channel, int program)
     return data;
 }
 
+MidiDataByte encode_timing_clock()
+{
+    return {TIMING_CLOCK, 0, 0, 0};
+}
+
+MidiDataByte encode_start_message()
+{
+    return {START_MESSAGE, 0, 0, 0};
+}
+
+MidiDataByte encode_stop_message()
+{
+    return {STOP_MESSAGE, 0, 0, 0};
+}
+
 
 } // end namespace midi
 } // end namespace sushi
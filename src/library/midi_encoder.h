@@ -86,6 +86,24 @@ MidiDataByte encode_pitch_bend(int channel, float value);
  */
 MidiDataByte encode_program_change(int channel, int program);
 
+/**
+ * @brief Encode a timing clock message, sent 24 times per quarter note
+ * @return A MidiDataByte containing the encoded message
+ */
+MidiDataByte encode_timing_clock();
+
+/**
+ * @brief Encode a start message
+ * @return A MidiDataByte containing the encoded message
+ */
+MidiDataByte encode_start_message();
+
+/**
+ * @brief Encode a stop message
+ * @return A MidiDataByte containing the encoded message
+ */
+MidiDataByte encode_stop_message();
+
 } // end namespace midi
 } // end namespace sushi
 
@@ -285,6 +285,7 @@ public:
     ParameterDescriptor* descriptor() const {return _descriptor;}
 
     void set_values(T value, T raw_value) {_value = value; _raw_value = raw_value;}
+    T process(T raw_value) const {return _pre_processor->process(raw_value);}
     void set(T value)
     {
         _raw_value = value;
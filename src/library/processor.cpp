@@ -7,8 +7,7 @@ namespace sushi {
 
 ProcessorReturnCode Processor::connect_cv_from_parameter(ObjectId parameter_id, int cv_output_id)
 {
-    if (cv_output_id >= static_cast<int>(_cv_out_connections.size()) ||
-        _outgoing_cv_connections >= static_cast<int>(_cv_out_connections.size()))
+    if (cv_output_id < 0 || cv_output_id >= MAX_ENGINE_CV_IO_PORTS)
     {
         return ProcessorReturnCode::ERROR;
     }
@@ -26,15 +25,13 @@ ProcessorReturnCode Processor::connect_cv_from_parameter(ObjectId parameter_id,
     {
         return ProcessorReturnCode::PARAMETER_NOT_FOUND;
     }
-    _cv_out_connections[_outgoing_cv_connections].parameter_id = parameter_id;
-    _cv_out_connections[_outgoing_cv_connections].cv_id = cv_output_id;
-    _outgoing_cv_connections++;
+    _cv_out_connections.push_back({parameter_id, cv_output_id});
     return ProcessorReturnCode::OK;
 }
 
 ProcessorReturnCode Processor::connect_gate_from_processor(int gate_output_id, int channel, int note_no)
 {
-    assert(gate_output_id < MAX_ENGINE_GATE_PORTS || note_no <= MAX_ENGINE_GATE_NOTE_NO);
+    assert(gate_output_id < MAX_ENGINE_GATE_PORTS && note_no <= MAX_ENGINE_GATE_NOTE_NO);
     GateKey key = to_gate_key(channel, note_no);
     if (_outgoing_gate_connections.count(key) > 0)
     {
@@ -70,9 +67,8 @@ bool Processor::maybe_output_cv_value(ObjectId parameter_id, float value)
 {
     // Linear complexity lookup, though the number of outgoing connections are a handful at max
     // and this is in memory which should already be cached, so very efficient
-    for (int i = 0; i < _outgoing_cv_connections; ++i)
+    for (const auto& connection : _cv_out_connections)
     {
-        auto& connection = _cv_out_connections[i];
         if (parameter_id == connection.parameter_id)
         {
             output_event(RtEvent::make_cv_event(this->id(), 0, connection.cv_id, value));
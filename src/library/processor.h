@@ -89,6 +89,20 @@ public:
      */
     virtual void process_audio(const ChunkSampleBuffer& in_buffer, ChunkSampleBuffer& out_buffer) = 0;
 
+    /**
+     * @brief Pass a full chunk of values for a parameter, to be applied sample accurately
+     *        during the next call to process_audio() only. Values are in the same range
+     *        as those of parameter change events. Called from the realtime thread when
+     *        a cv input with audio rate cv enabled is connected to the parameter.
+     * @param parameter_id The id of the parameter to modulate
+     * @param values AUDIO_CHUNK_SIZE values, valid until process_audio() returns
+     * @return true if the parameter supports sample accurate modulation, false otherwise
+     */
+    virtual bool set_parameter_modulation(ObjectId /*parameter_id*/, const float* /*values*/)
+    {
+        return false;
+    }
+
     /**
      * @brief Returns a unique name for this processor
      * @return A string that uniquely identifies this processor
@@ -418,8 +432,7 @@ private:
         int cv_id;
     };
 
-    std::array<CvOutConnection, MAX_ENGINE_CV_IO_PORTS> _cv_out_connections;
-    int _outgoing_cv_connections{0};
+    std::vector<CvOutConnection> _cv_out_connections;
 
     using GateKey = int;
     GateKey to_gate_key(int8_t channel, int8_t note)
@@ -22,6 +22,7 @@
 #define SUSHI_RT_EVENTS_H
 
 #include <string>
+#include <string_view>
 #include <cassert>
 
 #include "id_generator.h"
@@ -49,11 +50,13 @@ enum class RtEventType
     AFTERTOUCH,
     MODULATION,
     WRAPPED_MIDI_EVENT,
+    SYSEX_EVENT,
     GATE_EVENT,
     CV_EVENT,
     INT_PARAMETER_CHANGE,
     FLOAT_PARAMETER_CHANGE,
     BOOL_PARAMETER_CHANGE,
+    PARAMETER_CHANGE_BATCH,
     /* Complex parameters like those below should only be updated through events
      * since a change should always be handled and could be expensive to handle */
     DATA_PROPERTY_CHANGE,
@@ -78,6 +81,7 @@ enum class RtEventType
     STRING_DELETE,
     BLOB_DELETE,
     VOID_DELETE,
+    PARAMETER_BATCH_DELETE,
     /* Synchronisation events */
     SYNC,
     /* Engine notification events */
@@ -187,6 +191,37 @@ protected:
     MidiDataByte _midi_data;
 };
 
+/**
+ * @brief Event class for sysex and other midi messages too long to be wrapped.
+ *        The data is only guaranteed to be valid until the end of the audio chunk
+ *        in which the event is processed, so receivers need to copy it if needed
+ *        longer than that.
+ */
+class SysexRtEvent : public BaseRtEvent
+{
+public:
+    SysexRtEvent(ObjectId target,
+                 int offset,
+                 const uint8_t* data,
+                 int size,
+                 bool in_transfer_ring) : BaseRtEvent(RtEventType::SYSEX_EVENT, target, offset),
+                                          _size(size),
+                                          _in_transfer_ring(in_transfer_ring),
+                                          _data(data) {}
+
+    const uint8_t* data() const {return _data;}
+
+    int size() const {return _size;}
+
+    /* If true, data should be released to the RtTransferRing, otherwise deleted outside the rt thread */
+    bool in_transfer_ring() const {return _in_transfer_ring;}
+
+protected:
+    int _size;
+    bool _in_transfer_ring;
+    const uint8_t* _data;
+};
+
 class GateRtEvent : public BaseRtEvent
 {
 public:
@@ -251,6 +286,44 @@ protected:
     float _value;
 };
 
+/**
+ * @brief Parameter id and value pair used when setting several parameters at once.
+ */
+struct BatchParameterValue
+{
+    ObjectId parameter_id;
+    float    value;
+};
+
+/**
+ * @brief Class for setting several parameters of a processor within the same chunk.
+ *        The array of values is allocated outside the rt thread and must be returned
+ *        for deletion once the event has been handled.
+ */
+class ParameterBatchRtEvent : public BaseRtEvent
+{
+public:
+    ParameterBatchRtEvent(ObjectId target,
+                          int offset,
+                          BatchParameterValue* values,
+                          int count,
+                          bool in_transfer_ring) : BaseRtEvent(RtEventType::PARAMETER_CHANGE_BATCH, target, offset),
+                                                   _count(count),
+                                                   _in_transfer_ring(in_transfer_ring),
+                                                   _values(values) {}
+
+    int count() const {return _count;}
+
+    BatchParameterValue* values() const {return _values;}
+
+    /* If true, values should be released to the RtTransferRing, otherwise deleted outside the rt thread */
+    bool in_transfer_ring() const {return _in_transfer_ring;}
+
+protected:
+    int _count;
+    bool _in_transfer_ring;
+    BatchParameterValue* _values;
+};
 
 /**
  * @brief Baseclass for events that need to carry a larger payload of data.
@@ -280,7 +353,9 @@ protected:
 };
 
 /**
- * @brief Class for string parameter changes
+ * @brief Class for string parameter changes. The characters are only valid until the
+ *        end of the audio chunk the event was processed in, processors that need to
+ *        keep the value must copy it.
  */
 class StringParameterChangeRtEvent : public BaseRtEvent
 {
@@ -288,24 +363,34 @@ public:
     StringParameterChangeRtEvent(ObjectId processor,
                                  int offset,
                                  ObjectId param_id,
-                                 std::string* value) : BaseRtEvent(RtEventType::STRING_PROPERTY_CHANGE,
-                                                                   processor,
-                                                                   offset),
-                                                       _data(value),
-                                                       _param_id(param_id) {}
+                                 const char* data,
+                                 int size,
+                                 bool in_transfer_ring) : BaseRtEvent(RtEventType::STRING_PROPERTY_CHANGE,
+                                                                      processor,
+                                                                      offset),
+                                                          _size(size),
+                                                          _data(data),
+                                                          _param_id(param_id),
+                                                          _in_transfer_ring(in_transfer_ring) {}
 
     ObjectId param_id() const {return _param_id;}
 
-    std::string* value() const {return _data;}
+    std::string_view value() const {return std::string_view(_data, _size);}
+
+    /* If true, data should be released to the RtTransferRing, otherwise deleted outside the rt thread */
+    bool in_transfer_ring() const {return _in_transfer_ring;}
 
 protected:
-    std::string* _data;
+    int _size;
+    const char* _data;
     ObjectId _param_id;
+    bool _in_transfer_ring;
 };
 
 
 /**
- * @brief Class for binarydata parameter changes
+ * @brief Class for binarydata parameter changes. As for strings, the data is only
+ *        valid until the end of the audio chunk the event was processed in.
  */
 class DataParameterChangeRtEvent : public DataPayloadRtEvent
 {
@@ -313,16 +398,22 @@ public:
     DataParameterChangeRtEvent(ObjectId processor,
                                int offset,
                                ObjectId param_id,
-                               BlobData value) : DataPayloadRtEvent(RtEventType::DATA_PROPERTY_CHANGE,
-                                                                    processor,
-                                                                    offset,
-                                                                    value),
-                                                 _param_id(param_id) {}
+                               BlobData value,
+                               bool in_transfer_ring) : DataPayloadRtEvent(RtEventType::DATA_PROPERTY_CHANGE,
+                                                                           processor,
+                                                                           offset,
+                                                                           value),
+                                                        _param_id(param_id),
+                                                        _in_transfer_ring(in_transfer_ring) {}
 
     ObjectId param_id() const {return _param_id;}
 
+    /* If true, data should be released to the RtTransferRing, otherwise deleted outside the rt thread */
+    bool in_transfer_ring() const {return _in_transfer_ring;}
+
 protected:
     ObjectId _param_id;
+    bool _in_transfer_ring;
 };
 
 /**
@@ -343,6 +434,18 @@ public:
 private:
     int _value;
 };
+/**
+ * @brief Scheduling priority for non-rt work requested from the rt thread.
+ */
+enum class WorkPriority : uint8_t
+{
+    HIGH,   // Latency sensitive callbacks, i.e. parameter updates
+    NORMAL,
+    LOW     // Bulk work, i.e. reading files from disk
+};
+
+constexpr int WORK_PRIORITY_LEVELS = 3;
+
 /**
  * @brief Baseclass for events that can be returned with a status code.
  */
@@ -365,6 +468,8 @@ public:
 
 protected:
     EventStatus _status;
+    /* Only used by AsyncWorkRtEvent, but kept here as it fits in the padding before _event_id */
+    WorkPriority _priority{WorkPriority::NORMAL};
     uint16_t _event_id;
 };
 
@@ -399,12 +504,18 @@ typedef int (*AsyncWorkCallback)(void* data, EventId id);
 class AsyncWorkRtEvent: public ReturnableRtEvent
 {
 public:
-    AsyncWorkRtEvent(AsyncWorkCallback callback, ObjectId processor, void* data) : ReturnableRtEvent(RtEventType::ASYNC_WORK,
-                                                                                                     processor),
-                                                                                   _callback{callback},
-                                                                                   _data{data} {}
+    AsyncWorkRtEvent(AsyncWorkCallback callback,
+                     ObjectId processor,
+                     void* data,
+                     WorkPriority priority) : ReturnableRtEvent(RtEventType::ASYNC_WORK, processor),
+                                              _callback{callback},
+                                              _data{data}
+    {
+        _priority = priority;
+    }
     AsyncWorkCallback callback() const {return _callback;}
     void*             callback_data() const {return _data;}
+    WorkPriority      priority() const {return _priority;}
 private:
     AsyncWorkCallback _callback;
     void*             _data;
@@ -569,6 +680,12 @@ public:
         return &_wrapped_midi_event;
     }
 
+    const SysexRtEvent* sysex_event() const
+    {
+        assert(_sysex_event.type() == RtEventType::SYSEX_EVENT);
+        return &_sysex_event;
+    }
+
     const GateRtEvent* gate_event() const
     {
         assert(_gate_event.type() == RtEventType::GATE_EVENT);
@@ -586,6 +703,12 @@ public:
         assert(_keyboard_event.type() == RtEventType::FLOAT_PARAMETER_CHANGE);
         return &_parameter_change_event;
     }
+    const ParameterBatchRtEvent* parameter_batch_event() const
+    {
+        assert(_parameter_batch_event.type() == RtEventType::PARAMETER_CHANGE_BATCH);
+        return &_parameter_batch_event;
+    }
+
     const StringParameterChangeRtEvent* string_parameter_change_event() const
     {
         assert(_string_parameter_change_event.type() == RtEventType::STRING_PROPERTY_CHANGE);
@@ -674,7 +797,8 @@ public:
     {
         assert(_data_payload_event.type() == RtEventType::STRING_DELETE ||
                _data_payload_event.type() == RtEventType::BLOB_DELETE ||
-               _data_payload_event.type() == RtEventType::VOID_DELETE );
+               _data_payload_event.type() == RtEventType::VOID_DELETE ||
+               _data_payload_event.type() == RtEventType::PARAMETER_BATCH_DELETE);
         return &_data_payload_event;
 
     }
@@ -777,21 +901,37 @@ public:
         return RtEvent(typed_event);
     }
 
+    static RtEvent make_parameter_batch_event(ObjectId target, int offset, BatchParameterValue* values, int count,
+                                              bool in_transfer_ring = false)
+    {
+        ParameterBatchRtEvent typed_event(target, offset, values, count, in_transfer_ring);
+        return RtEvent(typed_event);
+    }
+
     static RtEvent make_wrapped_midi_event(ObjectId target, int offset, MidiDataByte data)
     {
         WrappedMidiRtEvent typed_event(offset, target, data);
         return RtEvent(typed_event);
     }
 
-    static RtEvent make_string_parameter_change_event(ObjectId target, int offset, ObjectId param_id, std::string* value)
+    static RtEvent make_sysex_event(ObjectId target, int offset, const uint8_t* data, int size,
+                                    bool in_transfer_ring = false)
     {
-        StringParameterChangeRtEvent typed_event(target, offset, param_id, value);
+        SysexRtEvent typed_event(target, offset, data, size, in_transfer_ring);
         return RtEvent(typed_event);
     }
 
-    static RtEvent make_data_parameter_change_event(ObjectId target, int offset, ObjectId param_id, BlobData data)
+    static RtEvent make_string_parameter_change_event(ObjectId target, int offset, ObjectId param_id,
+                                                      const char* data, int size, bool in_transfer_ring = false)
     {
-        DataParameterChangeRtEvent typed_event(target, offset, param_id, data);
+        StringParameterChangeRtEvent typed_event(target, offset, param_id, data, size, in_transfer_ring);
+        return RtEvent(typed_event);
+    }
+
+    static RtEvent make_data_parameter_change_event(ObjectId target, int offset, ObjectId param_id, BlobData data,
+                                                    bool in_transfer_ring = false)
+    {
+        DataParameterChangeRtEvent typed_event(target, offset, param_id, data, in_transfer_ring);
         return RtEvent(typed_event);
     }
 
@@ -843,9 +983,10 @@ public:
         return RtEvent(typed_event);
     }
 
-    static RtEvent make_async_work_event(AsyncWorkCallback callback, ObjectId processor, void* data)
+    static RtEvent make_async_work_event(AsyncWorkCallback callback, ObjectId processor, void* data,
+                                         WorkPriority priority = WorkPriority::NORMAL)
     {
-        AsyncWorkRtEvent typed_event(callback, processor, data);
+        AsyncWorkRtEvent typed_event(callback, processor, data, priority);
         return typed_event;
     }
 
@@ -873,6 +1014,12 @@ public:
         return typed_event;
     }
 
+    static RtEvent make_delete_parameter_batch_event(BatchParameterValue* values)
+    {
+        DataPayloadRtEvent typed_event(RtEventType::PARAMETER_BATCH_DELETE, 0, 0, {0, reinterpret_cast<uint8_t*>(values)});
+        return typed_event;
+    }
+
     static RtEvent make_synchronisation_event(Time timestamp)
     {
         SynchronisationRtEvent typed_event(timestamp);
@@ -915,9 +1062,11 @@ private:
     RtEvent(const KeyboardRtEvent& e) : _keyboard_event(e) {}
     RtEvent(const KeyboardCommonRtEvent& e) : _keyboard_common_event(e) {}
     RtEvent(const WrappedMidiRtEvent& e) : _wrapped_midi_event(e) {}
+    RtEvent(const SysexRtEvent& e) : _sysex_event(e) {}
     RtEvent(const GateRtEvent& e) : _gate_event(e) {}
     RtEvent(const CvRtEvent& e) : _cv_event(e) {}
     RtEvent(const ParameterChangeRtEvent& e) : _parameter_change_event(e) {}
+    RtEvent(const ParameterBatchRtEvent& e) : _parameter_batch_event(e) {}
     RtEvent(const StringParameterChangeRtEvent& e) : _string_parameter_change_event(e) {}
     RtEvent(const DataParameterChangeRtEvent& e) : _data_parameter_change_event(e) {}
     RtEvent(const ProcessorCommandRtEvent& e) : _processor_command_event(e) {}
@@ -940,9 +1089,11 @@ private:
         KeyboardRtEvent               _keyboard_event;
         KeyboardCommonRtEvent         _keyboard_common_event;
         WrappedMidiRtEvent            _wrapped_midi_event;
+        SysexRtEvent                  _sysex_event;
         GateRtEvent                   _gate_event;
         CvRtEvent                     _cv_event;
         ParameterChangeRtEvent        _parameter_change_event;
+        ParameterBatchRtEvent         _parameter_batch_event;
         StringParameterChangeRtEvent  _string_parameter_change_event;
         DataParameterChangeRtEvent    _data_parameter_change_event;
         ProcessorCommandRtEvent       _processor_command_event;
@@ -974,7 +1125,7 @@ static_assert(std::is_trivially_copyable<RtEvent>::value);
  */
 static inline bool is_keyboard_event(const RtEvent event)
 {
-    if (event.type() >= RtEventType::NOTE_ON && event.type() <= RtEventType::WRAPPED_MIDI_EVENT)
+    if (event.type() >= RtEventType::NOTE_ON && event.type() <= RtEventType::SYSEX_EVENT)
     {
         return true;
     }
@@ -46,6 +46,8 @@ public:
 
     inline bool empty() {return _fifo.wasEmpty();}
 
+    inline bool full() {return _fifo.wasFull();}
+
     void send_event(const RtEvent &event) override {push(event);}
 
 private:
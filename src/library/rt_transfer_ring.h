@@ -0,0 +1,154 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Preallocated ring buffer for passing variable size payloads to the rt domain
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_RT_TRANSFER_RING_H
+#define SUSHI_RT_TRANSFER_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace sushi {
+
+constexpr int RT_TRANSFER_RING_SIZE = 64 * 1024;
+
+/**
+ * @brief Byte ring for variable size payloads, i.e. strings, blobs or sysex data, sent
+ *        from a single non-rt thread to the rt thread. RtEvents reference slices of the
+ *        ring and the rt thread marks them as consumed with release() once it is done
+ *        with the data. Consumed slices are reclaimed, in order, by the producer on the
+ *        next allocation, so neither side allocates memory or needs a delete round trip.
+ */
+class RtTransferRing
+{
+public:
+    explicit RtTransferRing(int size = RT_TRANSFER_RING_SIZE) : _blocks((size + BLOCK_SIZE - 1) / BLOCK_SIZE) {}
+
+    /**
+     * @brief Allocate a slice of the ring. Must only be called from the producer thread.
+     * @param size Size of the slice in bytes
+     * @return A pointer to the slice, aligned for any scalar type, or nullptr if
+     *         there is not enough free room in the ring.
+     */
+    uint8_t* allocate(int size)
+    {
+        _reclaim();
+        int capacity = static_cast<int>(_blocks.size());
+        int needed = 1 + (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        bool wrapped = _head < _tail || (_head == _tail && _used > 0);
+        if (wrapped)
+        {
+            if (_tail - _head < needed)
+            {
+                return nullptr;
+            }
+        }
+        else if (capacity - _head < needed)
+        {
+            /* Pad until the end of the ring so the slice can be contiguous */
+            if (_tail < needed)
+            {
+                return nullptr;
+            }
+            int padding = capacity - _head;
+            _write_header(_head, padding, true);
+            _used += padding;
+            _head = 0;
+        }
+        _write_header(_head, needed, false);
+        uint8_t* data = _blocks[_head + 1].data;
+        _head = (_head + needed) % capacity;
+        _used += needed;
+        return data;
+    }
+
+    /**
+     * @brief Mark a slice as consumed. Safe to call from the rt thread.
+     * @param data A pointer previously returned from allocate()
+     */
+    static void release(void* data)
+    {
+        auto header = reinterpret_cast<SliceHeader*>(static_cast<uint8_t*>(data) - BLOCK_SIZE);
+        header->consumed.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Number of bytes currently in use, including slices not yet reclaimed
+     */
+    int used_bytes() const {return _used * BLOCK_SIZE;}
+
+private:
+    static constexpr int BLOCK_SIZE = 16;
+
+    struct alignas(BLOCK_SIZE) Block
+    {
+        uint8_t data[BLOCK_SIZE];
+    };
+
+    struct SliceHeader
+    {
+        std::atomic<bool> consumed;
+        int               blocks;
+    };
+
+    static_assert(sizeof(SliceHeader) <= sizeof(Block));
+
+    SliceHeader* _header(int block)
+    {
+        return reinterpret_cast<SliceHeader*>(_blocks[block].data);
+    }
+
+    void _write_header(int block, int blocks, bool consumed)
+    {
+        auto header = new (_blocks[block].data) SliceHeader;
+        header->blocks = blocks;
+        header->consumed.store(consumed, std::memory_order_relaxed);
+    }
+
+    void _reclaim()
+    {
+        int capacity = static_cast<int>(_blocks.size());
+        while (_used > 0)
+        {
+            auto header = _header(_tail);
+            if (header->consumed.load(std::memory_order_acquire) == false)
+            {
+                break;
+            }
+            _tail = (_tail + header->blocks) % capacity;
+            _used -= header->blocks;
+        }
+        if (_used == 0)
+        {
+            _head = 0;
+            _tail = 0;
+        }
+    }
+
+    std::vector<Block> _blocks;
+    int _head{0};
+    int _tail{0};
+    int _used{0};
+};
+
+} // end namespace sushi
+
+#endif //SUSHI_RT_TRANSFER_RING_H
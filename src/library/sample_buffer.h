@@ -265,7 +265,7 @@ public:
                 {
                     for (int c = 0; c < _channel_count; ++c)
                     {
-                        _buffer[n + c * _channel_count] = *interleaved_buf++;
+                        _buffer[n + c * size] = *interleaved_buf++;
                     }
                 }
             }
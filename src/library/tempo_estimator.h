@@ -0,0 +1,150 @@
+/*
+ * Copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Tempo estimation from external clock ticks
+ * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_TEMPO_ESTIMATOR_H
+#define SUSHI_TEMPO_ESTIMATOR_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "library/time.h"
+
+namespace sushi {
+
+/* Loop bandwidth in relation to the rate of quarter notes, lower values give a more
+ * stable tempo at the expense of slower tracking of tempo changes */
+constexpr double TEMPO_ESTIMATOR_BANDWIDTH = 0.25;
+/* Upper limit of the bandwidth in relation to the tick rate, for the loop to stay stable
+ * with low resolution clocks */
+constexpr double TEMPO_ESTIMATOR_MAX_TICK_BANDWIDTH = 0.1;
+/* Longest accepted time between two ticks before the clock is considered stopped */
+constexpr auto TEMPO_ESTIMATOR_TIMEOUT = std::chrono::seconds(2);
+
+/**
+ * @brief Estimates tempo from the timestamps of a periodic clock, i.e. midi clock or
+ *        sync pulses on a gate input, using a second order delay locked loop. The loop
+ *        filters out timing jitter while still following tempo changes. Ticks that
+ *        deviate more than half a period from the predicted time, or that arrive after
+ *        a long pause, restart the estimation. Does not allocate and is rt safe.
+ */
+class TempoEstimator
+{
+public:
+    explicit TempoEstimator(int ticks_per_quarter_note)
+    {
+        set_ticks_per_quarter_note(ticks_per_quarter_note);
+    }
+
+    /**
+     * @brief Set the resolution of the incoming clock. Resets the estimator.
+     * @param ticks_per_quarter_note Number of clock ticks per beat, i.e. 24 for midi clock
+     */
+    void set_ticks_per_quarter_note(int ticks_per_quarter_note)
+    {
+        _ticks_per_quarter_note = std::max(1, ticks_per_quarter_note);
+        double bandwidth = std::min(TEMPO_ESTIMATOR_BANDWIDTH / _ticks_per_quarter_note,
+                                    TEMPO_ESTIMATOR_MAX_TICK_BANDWIDTH);
+        double omega = 2.0 * M_PI * bandwidth;
+        _b = std::sqrt(2.0) * omega;
+        _c = omega * omega;
+        reset();
+    }
+
+    /**
+     * @brief Discard the current estimate and restart from the next tick
+     */
+    void reset()
+    {
+        _intervals = -1;
+    }
+
+    /**
+     * @brief Register a clock tick.
+     * @param timestamp The time at which the tick occurred
+     * @return true if a valid tempo estimate is available
+     */
+    bool tick(Time timestamp)
+    {
+        double time = static_cast<double>(timestamp.count());
+        if (_intervals >= 0 && timestamp - _last_tick > TEMPO_ESTIMATOR_TIMEOUT)
+        {
+            reset();
+        }
+        if (_intervals < 0)
+        {
+            _intervals = 0;
+        }
+        else if (_intervals == 0)
+        {
+            _period = time - static_cast<double>(_last_tick.count());
+            _predicted_tick = time + _period;
+            _intervals = 1;
+        }
+        else
+        {
+            double error = time - _predicted_tick;
+            if (std::abs(error) > _period / 2)
+            {
+                /* Missed ticks or a jump in tempo, start over with this tick as reference */
+                _intervals = 0;
+            }
+            else
+            {
+                _predicted_tick += _b * error + _period;
+                _period += _c * error;
+                _intervals++;
+            }
+        }
+        _last_tick = timestamp;
+        return valid();
+    }
+
+    /**
+     * @brief Whether enough ticks have been received for the estimate to have settled
+     * @return true if tempo() returns a valid estimate
+     */
+    bool valid() const
+    {
+        return _intervals >= std::max(2, _ticks_per_quarter_note) && _period > 0;
+    }
+
+    /**
+     * @brief Get the estimated tempo. Only meaningful if valid() returns true.
+     * @return The tempo in beats (quarter notes) per minute
+     */
+    float tempo() const
+    {
+        return static_cast<float>(60'000'000.0 / (_period * _ticks_per_quarter_note));
+    }
+
+private:
+    int    _ticks_per_quarter_note;
+    int    _intervals{-1};
+    double _b{0};
+    double _c{0};
+    /* Period and predicted tick time in microseconds */
+    double _period{0};
+    double _predicted_tick{0};
+    Time   _last_tick{0};
+};
+
+} // end namespace sushi
+
+#endif //SUSHI_TEMPO_ESTIMATOR_H
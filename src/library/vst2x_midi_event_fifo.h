@@ -54,18 +54,14 @@ public:
      */
     Vst2xMidiEventFIFO()
     {
-        _midi_data = new VstMidiEvent[capacity];
+        _midi_data = new VstEventStorage[capacity];
         _vst_events = new VstEventsExtended();
         _vst_events->numEvents = 0;
         _vst_events->reserved = 0;
 
         for (int i=0; i<capacity; i++)
         {
-            auto midi_ev_p = &_midi_data[i];
-            midi_ev_p->type = kVstMidiType;
-            midi_ev_p->byteSize = sizeof(VstMidiEvent);
-            midi_ev_p->flags = kVstMidiEventIsRealtime;
-            _vst_events->events[i] = reinterpret_cast<VstEvent*>(midi_ev_p);
+            _vst_events->events[i] = reinterpret_cast<VstEvent*>(&_midi_data[i]);
         }
     }
 
@@ -129,13 +125,31 @@ private:
         VstEvent* events[capacity];
     };
 
+    /**
+     * Every slot can hold either a regular midi event or a sysex event, the sysex
+     * payload itself is not copied but referenced from the RtEvent.
+     */
+    union VstEventStorage
+    {
+        VstMidiEvent      midi;
+        VstMidiSysexEvent sysex;
+    };
+
     /**
     * @brief Helper to initialize VstMidiEvent inside the buffer from Event
     *
     */
     void _fill_vst_event(const int idx, RtEvent event)
     {
-        auto midi_ev_p = &_midi_data[idx];
+        if (event.type() == RtEventType::SYSEX_EVENT)
+        {
+            _fill_vst_sysex_event(idx, event);
+            return;
+        }
+        auto midi_ev_p = &_midi_data[idx].midi;
+        midi_ev_p->type = kVstMidiType;
+        midi_ev_p->byteSize = sizeof(VstMidiEvent);
+        midi_ev_p->flags = kVstMidiEventIsRealtime;
         midi_ev_p->deltaFrames = static_cast<VstInt32>(event.sample_offset());
         MidiDataByte midi_data;
 
@@ -191,11 +205,29 @@ private:
         std::copy(midi_data.begin(), midi_data.end(), midi_ev_p->midiData);
     }
 
+    /**
+    * @brief Helper to initialize VstMidiSysexEvent inside the buffer from a sysex Event
+    *
+    */
+    void _fill_vst_sysex_event(const int idx, RtEvent event)
+    {
+        auto typed_event = event.sysex_event();
+        auto sysex_ev_p = &_midi_data[idx].sysex;
+        sysex_ev_p->type = kVstSysExType;
+        sysex_ev_p->byteSize = sizeof(VstMidiSysexEvent);
+        sysex_ev_p->deltaFrames = static_cast<VstInt32>(event.sample_offset());
+        sysex_ev_p->flags = 0;
+        sysex_ev_p->dumpBytes = typed_event->size();
+        sysex_ev_p->resvd1 = 0;
+        sysex_ev_p->sysexDump = reinterpret_cast<char*>(const_cast<uint8_t*>(typed_event->data()));
+        sysex_ev_p->resvd2 = 0;
+    }
+
     int _size{0};
     int _write_idx{0};
     bool _limit_reached{false};
 
-    VstMidiEvent* _midi_data;
+    VstEventStorage* _midi_data;
     VstEventsExtended* _vst_events;
 };
 
@@ -91,5 +91,20 @@ Steinberg::Vst::Event convert_aftertouch_event(const KeyboardRtEvent* event)
     return vst_event;
 }
 
+Steinberg::Vst::Event convert_sysex_event(const SysexRtEvent* event)
+{
+    assert(event->type() == RtEventType::SYSEX_EVENT);
+    Steinberg::Vst::Event vst_event;
+    vst_event.busIndex = 0;
+    vst_event.sampleOffset = event->sample_offset();
+    vst_event.ppqPosition = 0;
+    vst_event.flags = 0;
+    vst_event.type = Steinberg::Vst::Event::kDataEvent;
+    vst_event.data.size = static_cast<Steinberg::uint32>(event->size());
+    vst_event.data.type = Steinberg::Vst::DataEvent::kMidiSysEx;
+    vst_event.data.bytes = event->data();
+    return vst_event;
+}
+
 } // end namespace vst3
 } // end namespace sushi
@@ -123,6 +123,14 @@ Steinberg::Vst::Event convert_note_off_event(const KeyboardRtEvent* event);
  */
 Steinberg::Vst::Event convert_aftertouch_event(const KeyboardRtEvent* event);
 
+/**
+ * @brief Convert a Sushi Sysex event to a Vst3 data event. The data is not copied
+ *        and is only valid as long as the Sushi event payload is.
+ * @param event A Sushi Sysex event
+ * @return a Vst3 data event of midi sysex type
+ */
+Steinberg::Vst::Event convert_sysex_event(const SysexRtEvent* event);
+
 
 } // end namespace vst3
 } // end namespace sushi
@@ -251,6 +251,12 @@ void Vst3xWrapper::process_event(const RtEvent& event)
             _in_event_list.addEvent(vst_event);
             break;
         }
+        case RtEventType::SYSEX_EVENT:
+        {
+            auto vst_event = convert_sysex_event(event.sysex_event());
+            _in_event_list.addEvent(vst_event);
+            break;
+        }
         case RtEventType::MODULATION:
         {
             if (_mod_wheel_parameter.supported)
@@ -294,7 +300,8 @@ void Vst3xWrapper::process_audio(const ChunkSampleBuffer &in_buffer, ChunkSample
 {
     if (_process_data.inputParameterChanges->getParameterCount() > 0)
     {
-        auto e = RtEvent::make_async_work_event(&Vst3xWrapper::parameter_update_callback, this->id(), this);
+        auto e = RtEvent::make_async_work_event(&Vst3xWrapper::parameter_update_callback, this->id(), this,
+                                                WorkPriority::HIGH);
         output_event(e);
     }
     if(_bypass_parameter.supported == false && _bypass_manager.should_process() == false)
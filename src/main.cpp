@@ -34,11 +34,15 @@
 #include "engine/audio_engine.h"
 #include "audio_frontends/offline_frontend.h"
 #include "audio_frontends/jack_frontend.h"
+#include "audio_frontends/alsa_frontend.h"
+#include "audio_frontends/shm_frontend.h"
+#include "audio_frontends/network_frontend.h"
 #include "audio_frontends/xenomai_raspa_frontend.h"
 #include "engine/json_configurator.h"
 #include "control_frontends/osc_frontend.h"
 #include "control_frontends/alsa_midi_frontend.h"
 #include "library/parameter_dump.h"
+#include "library/benchmark_report.h"
 
 #ifdef SUSHI_BUILD_WITH_RPC_INTERFACE
 #include "sushi_rpc/grpc_server.h"
@@ -49,6 +53,9 @@ enum class FrontendType
     OFFLINE,
     DUMMY,
     JACK,
+    ALSA,
+    SHM,
+    NETWORK,
     XENOMAI_RASPA,
     NONE
 };
@@ -63,6 +70,9 @@ constexpr std::array SUSHI_ENABLED_BUILD_OPTIONS = {
 #ifdef SUSHI_BUILD_WITH_JACK
         "jack",
 #endif
+#ifdef SUSHI_BUILD_WITH_ALSA
+        "alsa",
+#endif
 #ifdef SUSHI_BUILD_WITH_XENOMAI
         "xenomai",
 #endif
@@ -93,6 +103,25 @@ void error_exit(const std::string& message)
     std::exit(1);
 }
 
+// Parse a comma separated list of channel indices
+std::vector<int> parse_channel_map(const std::string& list)
+{
+    std::vector<int> channels;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        char* end;
+        long channel = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != 0 || channel < 0)
+        {
+            error_exit("Invalid channel map: " + list);
+        }
+        channels.push_back(static_cast<int>(channel));
+    }
+    return channels;
+}
+
 void print_version_and_build_info()
 {
     std::cout << "\nVersion "   << SUSHI__VERSION_MAJ << "."
@@ -156,22 +185,41 @@ int main(int argc, char* argv[])
 
     std::string input_filename;
     std::string output_filename;
+    std::string output_format;
+    std::string output_sample_format;
+    int output_channels = 0;
+    std::vector<int> output_channel_map;
 
     std::string log_level = std::string(SUSHI_LOG_LEVEL_DEFAULT);
     std::string log_filename = std::string(SUSHI_LOG_FILENAME_DEFAULT);
     std::string config_filename = std::string(SUSHI_JSON_FILENAME_DEFAULT);
     std::string jack_client_name = std::string(SUSHI_JACK_CLIENT_NAME_DEFAULT);
     std::string jack_server_name = std::string("");
+    std::string alsa_device = std::string(SUSHI_ALSA_DEVICE_DEFAULT);
+    int alsa_period_size = AUDIO_CHUNK_SIZE;
+    int alsa_periods = SUSHI_ALSA_PERIODS_DEFAULT;
+    std::string shm_name = std::string(SUSHI_SHM_NAME_DEFAULT);
+    int shm_channels = SUSHI_SHM_CHANNELS_DEFAULT;
+    std::string net_listen;
+    std::string net_send;
+    int net_channels = SUSHI_NET_CHANNELS_DEFAULT;
+    int net_buffer = SUSHI_NET_BUFFER_DEFAULT;
     int osc_server_port = SUSHI_OSC_SERVER_PORT;
     int osc_send_port = SUSHI_OSC_SEND_PORT;
     std::string grpc_listening_address = std::string(SUSHI_GRPC_LISTENING_PORT);
     FrontendType frontend_type = FrontendType::NONE;
     bool connect_ports = false;
+    bool use_jack_midi = false;
     bool debug_mode_switches = false;
     int  rt_cpu_cores = 1;
     bool enable_timings = false;
+    bool audio_rate_cv = false;
     bool enable_flush_interval = false;
     bool enable_parameter_dump = false;
+    int benchmark_duration = 0;
+    int benchmark_warmup = SUSHI_BENCHMARK_WARMUP_DEFAULT;
+    std::string benchmark_report_filename;
+    bool realtime_pacing = false;
     std::chrono::seconds log_flush_interval = std::chrono::seconds(0);
 
     for (int i=0; i<cl_parser.optionsCount(); i++)
@@ -225,10 +273,44 @@ int main(int argc, char* argv[])
             output_filename.assign(opt.arg);
             break;
 
+        case OPT_IDX_OUTPUT_FORMAT:
+            output_format.assign(opt.arg);
+            break;
+
+        case OPT_IDX_OUTPUT_SAMPLE_FORMAT:
+            output_sample_format.assign(opt.arg);
+            break;
+
+        case OPT_IDX_OUTPUT_CHANNELS:
+            output_channels = atoi(opt.arg);
+            break;
+
+        case OPT_IDX_OUTPUT_CHANNEL_MAP:
+            output_channel_map = parse_channel_map(opt.arg);
+            break;
+
         case OPT_IDX_USE_DUMMY:
             frontend_type = FrontendType::DUMMY;
             break;
 
+        case OPT_IDX_BENCHMARK:
+            frontend_type = FrontendType::DUMMY;
+            benchmark_duration = atoi(opt.arg);
+            enable_timings = true;
+            break;
+
+        case OPT_IDX_BENCHMARK_WARMUP:
+            benchmark_warmup = atoi(opt.arg);
+            break;
+
+        case OPT_IDX_BENCHMARK_REPORT:
+            benchmark_report_filename.assign(opt.arg);
+            break;
+
+        case OPT_IDX_REALTIME_PACING:
+            realtime_pacing = true;
+            break;
+
         case OPT_IDX_USE_JACK:
             frontend_type = FrontendType::JACK;
             break;
@@ -245,6 +327,10 @@ int main(int argc, char* argv[])
             jack_server_name.assign(opt.arg);
             break;
 
+        case OPT_IDX_JACK_MIDI:
+            use_jack_midi = true;
+            break;
+
         case OPT_IDX_USE_XENOMAI_RASPA:
             frontend_type = FrontendType::XENOMAI_RASPA;
             break;
@@ -253,6 +339,54 @@ int main(int argc, char* argv[])
             debug_mode_switches = true;
             break;
 
+        case OPT_IDX_USE_ALSA:
+            frontend_type = FrontendType::ALSA;
+            break;
+
+        case OPT_IDX_ALSA_DEVICE:
+            alsa_device.assign(opt.arg);
+            break;
+
+        case OPT_IDX_ALSA_PERIOD_SIZE:
+            alsa_period_size = atoi(opt.arg);
+            break;
+
+        case OPT_IDX_ALSA_PERIODS:
+            alsa_periods = atoi(opt.arg);
+            break;
+
+        case OPT_IDX_USE_SHM:
+            frontend_type = FrontendType::SHM;
+            break;
+
+        case OPT_IDX_SHM_NAME:
+            shm_name.assign(opt.arg);
+            break;
+
+        case OPT_IDX_SHM_CHANNELS:
+            shm_channels = atoi(opt.arg);
+            break;
+
+        case OPT_IDX_USE_NET:
+            frontend_type = FrontendType::NETWORK;
+            break;
+
+        case OPT_IDX_NET_LISTEN:
+            net_listen.assign(opt.arg);
+            break;
+
+        case OPT_IDX_NET_SEND:
+            net_send.assign(opt.arg);
+            break;
+
+        case OPT_IDX_NET_CHANNELS:
+            net_channels = atoi(opt.arg);
+            break;
+
+        case OPT_IDX_NET_BUFFER:
+            net_buffer = atoi(opt.arg);
+            break;
+
         case OPT_IDX_MULTICORE_PROCESSING:
             rt_cpu_cores = atoi(opt.arg);
             break;
@@ -261,6 +395,10 @@ int main(int argc, char* argv[])
             enable_timings = true;
             break;
 
+        case OPT_IDX_AUDIO_RATE_CV:
+            audio_rate_cv = true;
+            break;
+
         case OPT_IDX_OSC_RECEIVE_PORT:
             osc_server_port = atoi(opt.arg);
             break;
@@ -279,7 +417,8 @@ int main(int argc, char* argv[])
         }
     }
 
-    if (enable_parameter_dump == false)
+    // Keep stdout clean for json output
+    if (enable_parameter_dump == false && benchmark_duration == 0)
     {
         print_sushi_headline();
     }
@@ -313,14 +452,12 @@ int main(int argc, char* argv[])
         twine::init_xenomai(); // must be called before setting up any worker pools
     }
     auto engine = std::make_unique<sushi::engine::AudioEngine>(SUSHI_SAMPLE_RATE_DEFAULT, rt_cpu_cores);
+    engine->enable_audio_rate_cv(audio_rate_cv);
     auto midi_dispatcher = std::make_unique<sushi::midi_dispatcher::MidiDispatcher>(engine.get());
     auto configurator = std::make_unique<sushi::jsonconfig::JsonConfigurator>(engine.get(),
                                                                               midi_dispatcher.get(),
                                                                               config_filename);
 
-    midi_dispatcher->set_midi_inputs(1);
-    midi_dispatcher->set_midi_outputs(1);
-
 #ifdef SUSHI_BUILD_WITH_RPC_INTERFACE
     auto rpc_server = std::make_unique<sushi_rpc::GrpcServer>(grpc_listening_address, engine->controller());
 #endif
@@ -341,6 +478,10 @@ int main(int argc, char* argv[])
     }
     int cv_inputs = audio_config.cv_inputs.value_or(0);
     int cv_outputs = audio_config.cv_outputs.value_or(0);
+    int midi_inputs = audio_config.midi_inputs.value_or(1);
+    int midi_outputs = audio_config.midi_outputs.value_or(1);
+    midi_dispatcher->set_midi_inputs(midi_inputs);
+    midi_dispatcher->set_midi_outputs(midi_outputs);
 
     switch (frontend_type)
     {
@@ -351,11 +492,47 @@ int main(int argc, char* argv[])
                                                                                                  jack_server_name,
                                                                                                  connect_ports,
                                                                                                  cv_inputs,
-                                                                                                 cv_outputs);
+                                                                                                 cv_outputs,
+                                                                                                 use_jack_midi ? midi_inputs : 0,
+                                                                                                 use_jack_midi ? midi_outputs : 0);
             audio_frontend = std::make_unique<sushi::audio_frontend::JackFrontend>(engine.get());
             break;
         }
 
+        case FrontendType::ALSA:
+        {
+            SUSHI_LOG_INFO("Setting up Alsa audio frontend");
+            frontend_config = std::make_unique<sushi::audio_frontend::AlsaFrontendConfiguration>(alsa_device,
+                                                                                                 alsa_period_size,
+                                                                                                 alsa_periods,
+                                                                                                 cv_inputs,
+                                                                                                 cv_outputs);
+            audio_frontend = std::make_unique<sushi::audio_frontend::AlsaFrontend>(engine.get());
+            break;
+        }
+
+        case FrontendType::SHM:
+        {
+            SUSHI_LOG_INFO("Setting up shared memory audio frontend");
+            frontend_config = std::make_unique<sushi::audio_frontend::ShmFrontendConfiguration>(shm_name,
+                                                                                                shm_channels,
+                                                                                                cv_inputs,
+                                                                                                cv_outputs);
+            audio_frontend = std::make_unique<sushi::audio_frontend::ShmFrontend>(engine.get());
+            break;
+        }
+
+        case FrontendType::NETWORK:
+        {
+            SUSHI_LOG_INFO("Setting up network audio frontend");
+            frontend_config = std::make_unique<sushi::audio_frontend::NetworkFrontendConfiguration>(net_listen,
+                                                                                                    net_send,
+                                                                                                    net_channels,
+                                                                                                    net_buffer);
+            audio_frontend = std::make_unique<sushi::audio_frontend::NetworkFrontend>(engine.get());
+            break;
+        }
+
         case FrontendType::XENOMAI_RASPA:
         {
             SUSHI_LOG_INFO("Setting up Xenomai RASPA frontend");
@@ -383,7 +560,15 @@ int main(int argc, char* argv[])
                                                                                                     output_filename,
                                                                                                     dummy,
                                                                                                     cv_inputs,
-                                                                                                    cv_outputs);
+                                                                                                    cv_outputs,
+                                                                                                    output_format,
+                                                                                                    output_sample_format,
+                                                                                                    output_channels,
+                                                                                                    output_channel_map);
+            auto offline_config = static_cast<sushi::audio_frontend::OfflineFrontendConfiguration*>(frontend_config.get());
+            offline_config->benchmark_duration = static_cast<float>(benchmark_duration);
+            offline_config->benchmark_warmup = static_cast<float>(benchmark_warmup);
+            offline_config->realtime_pacing = realtime_pacing;
             audio_frontend = std::make_unique<sushi::audio_frontend::OfflineFrontend>(engine.get());
             break;
         }
@@ -391,6 +576,8 @@ int main(int argc, char* argv[])
         default:
             error_exit("No audio frontend selected.");
     }
+    frontend_config->gate_inputs = audio_config.gate_inputs.value_or(sushi::DEFAULT_ENGINE_GATE_PORTS);
+    frontend_config->gate_outputs = audio_config.gate_outputs.value_or(sushi::DEFAULT_ENGINE_GATE_PORTS);
 
     auto audio_frontend_status = audio_frontend->init(frontend_config.get());
     if (audio_frontend_status != sushi::audio_frontend::AudioFrontendStatus::OK)
@@ -452,14 +639,28 @@ int main(int argc, char* argv[])
         engine->performance_timer()->enable(true);
     }
 
-    if (frontend_type == FrontendType::JACK || frontend_type == FrontendType::XENOMAI_RASPA)
+    if (frontend_type == FrontendType::JACK || frontend_type == FrontendType::ALSA ||
+        frontend_type == FrontendType::XENOMAI_RASPA)
     {
-        midi_frontend = std::make_unique<sushi::midi_frontend::AlsaMidiFrontend>(midi_dispatcher.get());
-
-        auto midi_ok = midi_frontend->init();
-        if (!midi_ok)
+        if (use_jack_midi && frontend_type == FrontendType::JACK)
         {
-            error_exit("Failed to setup Alsa midi frontend");
+            auto jack_frontend = static_cast<sushi::audio_frontend::JackFrontend*>(audio_frontend.get());
+            midi_frontend = std::make_unique<sushi::audio_frontend::JackMidiFrontend>(midi_dispatcher.get(), jack_frontend);
+            if (!midi_frontend->init())
+            {
+                error_exit("Failed to setup Jack midi frontend");
+            }
+        }
+        else
+        {
+            midi_frontend = std::make_unique<sushi::midi_frontend::AlsaMidiFrontend>(midi_inputs,
+                                                                                     midi_outputs,
+                                                                                     midi_dispatcher.get());
+            auto midi_ok = midi_frontend->init();
+            if (!midi_ok)
+            {
+                error_exit("Failed to setup Alsa midi frontend");
+            }
         }
         midi_dispatcher->set_frontend(midi_frontend.get());
 
@@ -478,7 +679,8 @@ int main(int argc, char* argv[])
 
     audio_frontend->run();
 
-    if (frontend_type == FrontendType::JACK || frontend_type == FrontendType::XENOMAI_RASPA)
+    if (frontend_type == FrontendType::JACK || frontend_type == FrontendType::ALSA ||
+        frontend_type == FrontendType::XENOMAI_RASPA)
     {
         midi_frontend->run();
         osc_frontend->run();
@@ -489,7 +691,30 @@ int main(int argc, char* argv[])
     rpc_server->start();
 #endif
 
-    if (frontend_type != FrontendType::OFFLINE)
+    bool benchmark = frontend_type == FrontendType::DUMMY && benchmark_duration > 0;
+    if (benchmark)
+    {
+        // Disabling the timer processes all timing records that are still queued
+        engine->performance_timer()->enable(false);
+        engine->performance_timer()->enable(true);
+        auto offline_frontend = static_cast<sushi::audio_frontend::OfflineFrontend*>(audio_frontend.get());
+        auto report = sushi::generate_benchmark_document(offline_frontend->benchmark_results(), engine->controller());
+        if (benchmark_report_filename.empty())
+        {
+            std::cout << report << std::endl;
+        }
+        else
+        {
+            std::ofstream report_file(benchmark_report_filename);
+            report_file << report << std::endl;
+            if (!report_file.good())
+            {
+                SUSHI_LOG_ERROR("Failed to write benchmark report to {}", benchmark_report_filename);
+            }
+        }
+    }
+
+    if (frontend_type != FrontendType::OFFLINE && !benchmark)
     {
         std::mutex m;
         std::unique_lock<std::mutex> lock(m);
@@ -500,7 +725,8 @@ int main(int argc, char* argv[])
     // Cleanup before exiting! //
     ////////////////////////////////////////////////////////////////////////////////
 
-    if (frontend_type == FrontendType::JACK || frontend_type == FrontendType::XENOMAI_RASPA)
+    if (frontend_type == FrontendType::JACK || frontend_type == FrontendType::ALSA ||
+        frontend_type == FrontendType::XENOMAI_RASPA)
     {
         osc_frontend->stop();
         midi_frontend->stop();
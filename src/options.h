@@ -32,6 +32,13 @@
 #define SUSHI_JSON_FILENAME_DEFAULT "config.json"
 #define SUSHI_SAMPLE_RATE_DEFAULT 48000
 #define SUSHI_JACK_CLIENT_NAME_DEFAULT "sushi"
+#define SUSHI_ALSA_DEVICE_DEFAULT "hw:0"
+#define SUSHI_ALSA_PERIODS_DEFAULT 2
+#define SUSHI_SHM_NAME_DEFAULT "/sushi"
+#define SUSHI_SHM_CHANNELS_DEFAULT 2
+#define SUSHI_NET_CHANNELS_DEFAULT 2
+#define SUSHI_NET_BUFFER_DEFAULT 2
+#define SUSHI_BENCHMARK_WARMUP_DEFAULT 1
 #define SUSHI_OSC_SERVER_PORT 24024
 #define SUSHI_OSC_SEND_PORT 24023
 #define SUSHI_GRPC_LISTENING_PORT "[::]:51051"
@@ -110,15 +117,37 @@ enum OptionIndex
     OPT_IDX_USE_OFFLINE,
     OPT_IDX_INPUT_FILE,
     OPT_IDX_OUTPUT_FILE,
+    OPT_IDX_OUTPUT_FORMAT,
+    OPT_IDX_OUTPUT_SAMPLE_FORMAT,
+    OPT_IDX_OUTPUT_CHANNELS,
+    OPT_IDX_OUTPUT_CHANNEL_MAP,
     OPT_IDX_USE_DUMMY,
+    OPT_IDX_BENCHMARK,
+    OPT_IDX_BENCHMARK_WARMUP,
+    OPT_IDX_BENCHMARK_REPORT,
+    OPT_IDX_REALTIME_PACING,
     OPT_IDX_USE_JACK,
     OPT_IDX_CONNECT_PORTS,
     OPT_IDX_JACK_CLIENT,
     OPT_IDX_JACK_SERVER,
+    OPT_IDX_JACK_MIDI,
     OPT_IDX_USE_XENOMAI_RASPA,
     OPT_IDX_XENOMAI_DEBUG_MODE_SW,
+    OPT_IDX_USE_ALSA,
+    OPT_IDX_ALSA_DEVICE,
+    OPT_IDX_ALSA_PERIOD_SIZE,
+    OPT_IDX_ALSA_PERIODS,
+    OPT_IDX_USE_SHM,
+    OPT_IDX_SHM_NAME,
+    OPT_IDX_SHM_CHANNELS,
+    OPT_IDX_USE_NET,
+    OPT_IDX_NET_LISTEN,
+    OPT_IDX_NET_SEND,
+    OPT_IDX_NET_CHANNELS,
+    OPT_IDX_NET_BUFFER,
     OPT_IDX_MULTICORE_PROCESSING,
     OPT_IDX_TIMINGS_STATISTICS,
+    OPT_IDX_AUDIO_RATE_CV,
     OPT_IDX_OSC_RECEIVE_PORT,
     OPT_IDX_OSC_SEND_PORT,
     OPT_IDX_GRPC_LISTEN_ADDRESS
@@ -223,6 +252,38 @@ const optionparser::Descriptor usage[] =
         SushiArg::NonEmpty,
         "\t\t-O <filename>, --output=<filename> \tSpecify output file [default= (input_file).proc.wav]."
     },
+    {
+        OPT_IDX_OUTPUT_FORMAT,
+        OPT_TYPE_UNUSED,
+        "",
+        "output-format",
+        SushiArg::NonEmpty,
+        "\t\t--output-format=<wav|aiff|flac|caf|w64|rf64> \tFile type of the output file [default=same as input file]."
+    },
+    {
+        OPT_IDX_OUTPUT_SAMPLE_FORMAT,
+        OPT_TYPE_UNUSED,
+        "",
+        "output-sample-format",
+        SushiArg::NonEmpty,
+        "\t\t--output-sample-format=<int16|int24|int32|float|double> \tSample format of the output file [default=same as input file]."
+    },
+    {
+        OPT_IDX_OUTPUT_CHANNELS,
+        OPT_TYPE_UNUSED,
+        "",
+        "output-channels",
+        SushiArg::Numeric,
+        "\t\t--output-channels=<n> \tNumber of channels in the output file [default=same as input file]."
+    },
+    {
+        OPT_IDX_OUTPUT_CHANNEL_MAP,
+        OPT_TYPE_UNUSED,
+        "",
+        "output-channel-map",
+        SushiArg::NonEmpty,
+        "\t\t--output-channel-map=<c0,c1,...> \tEngine output channel to write to each channel of the output file [default=0,1,2...]."
+    },
     {
         OPT_IDX_USE_DUMMY,
         OPT_TYPE_DISABLED,
@@ -231,6 +292,38 @@ const optionparser::Descriptor usage[] =
         SushiArg::Optional,
         "\t\t-d --dummy \tUse dummy audio frontend. Useful for debugging."
     },
+    {
+        OPT_IDX_BENCHMARK,
+        OPT_TYPE_UNUSED,
+        "",
+        "benchmark",
+        SushiArg::Numeric,
+        "\t\t--benchmark=<seconds> \tRun the dummy audio frontend for the given number of seconds of audio, then print a json report with timings and exit."
+    },
+    {
+        OPT_IDX_BENCHMARK_WARMUP,
+        OPT_TYPE_UNUSED,
+        "",
+        "benchmark-warmup",
+        SushiArg::Numeric,
+        "\t\t--benchmark-warmup=<seconds> \tSeconds of audio to process before measuring in benchmark mode [default=" SUSHI_QUOTE(SUSHI_BENCHMARK_WARMUP_DEFAULT) "]."
+    },
+    {
+        OPT_IDX_BENCHMARK_REPORT,
+        OPT_TYPE_UNUSED,
+        "",
+        "benchmark-report",
+        SushiArg::NonEmpty,
+        "\t\t--benchmark-report=<filename> \tWrite the benchmark report to a file instead of stdout."
+    },
+    {
+        OPT_IDX_REALTIME_PACING,
+        OPT_TYPE_DISABLED,
+        "",
+        "realtime-pacing",
+        SushiArg::Optional,
+        "\t\t--realtime-pacing \tProcess audio in realtime with the dummy frontend instead of as fast as possible."
+    },
     {
         OPT_IDX_USE_JACK,
         OPT_TYPE_DISABLED,
@@ -263,6 +356,14 @@ const optionparser::Descriptor usage[] =
         SushiArg::NonEmpty,
         "\t\t--server-name=<jack server name> \tSpecify name of Jack server to connect to [determined by jack if empty]."
     },
+    {
+        OPT_IDX_JACK_MIDI,
+        OPT_TYPE_DISABLED,
+        "",
+        "jack-midi",
+        SushiArg::Optional,
+        "\t\t--jack-midi \tUse Jack midi ports instead of Alsa midi for sample accurate timing (Jack only)."
+    },
     {
         OPT_IDX_USE_XENOMAI_RASPA,
         OPT_TYPE_DISABLED,
@@ -279,6 +380,102 @@ const optionparser::Descriptor usage[] =
         SushiArg::Optional,
         "\t\t--debug-mode-sw \tBreak to debugger if a mode switch is detected (Xenomai only)."
     },
+    {
+        OPT_IDX_USE_ALSA,
+        OPT_TYPE_DISABLED,
+        "a",
+        "alsa",
+        SushiArg::Optional,
+        "\t\t-a --alsa \tUse Alsa realtime audio frontend, without a sound server."
+    },
+    {
+        OPT_IDX_ALSA_DEVICE,
+        OPT_TYPE_UNUSED,
+        "",
+        "alsa-device",
+        SushiArg::NonEmpty,
+        "\t\t--alsa-device=<device> \tAlsa pcm device to use [default=" SUSHI_ALSA_DEVICE_DEFAULT "]."
+    },
+    {
+        OPT_IDX_ALSA_PERIOD_SIZE,
+        OPT_TYPE_UNUSED,
+        "",
+        "alsa-period",
+        SushiArg::Numeric,
+        "\t\t--alsa-period=<frames> \tAlsa period size, must be a multiple of the audio buffer size [default=audio buffer size]."
+    },
+    {
+        OPT_IDX_ALSA_PERIODS,
+        OPT_TYPE_UNUSED,
+        "",
+        "alsa-periods",
+        SushiArg::Numeric,
+        "\t\t--alsa-periods=<n> \tNumber of periods in the Alsa buffer [default=" SUSHI_QUOTE(SUSHI_ALSA_PERIODS_DEFAULT) "]."
+    },
+    {
+        OPT_IDX_USE_SHM,
+        OPT_TYPE_DISABLED,
+        "",
+        "shm",
+        SushiArg::Optional,
+        "\t\t--shm \tUse shared memory audio frontend, driven by a client process on the same machine."
+    },
+    {
+        OPT_IDX_SHM_NAME,
+        OPT_TYPE_UNUSED,
+        "",
+        "shm-name",
+        SushiArg::NonEmpty,
+        "\t\t--shm-name=<name> \tName of the shared memory segment clients connect to [default=" SUSHI_SHM_NAME_DEFAULT "]."
+    },
+    {
+        OPT_IDX_SHM_CHANNELS,
+        OPT_TYPE_UNUSED,
+        "",
+        "shm-channels",
+        SushiArg::Numeric,
+        "\t\t--shm-channels=<n> \tNumber of audio input and output channels of the shared memory frontend [default=" SUSHI_QUOTE(SUSHI_SHM_CHANNELS_DEFAULT) "]."
+    },
+    {
+        OPT_IDX_USE_NET,
+        OPT_TYPE_DISABLED,
+        "",
+        "net",
+        SushiArg::Optional,
+        "\t\t--net \tUse network audio frontend, streaming audio to and from other hosts over UDP."
+    },
+    {
+        OPT_IDX_NET_LISTEN,
+        OPT_TYPE_UNUSED,
+        "",
+        "net-listen",
+        SushiArg::NonEmpty,
+        "\t\t--net-listen=<[address:]port> \tPort to receive audio on, a multicast address joins that group [default=no input]."
+    },
+    {
+        OPT_IDX_NET_SEND,
+        OPT_TYPE_UNUSED,
+        "",
+        "net-send",
+        SushiArg::NonEmpty,
+        "\t\t--net-send=<address:port> \tUnicast or multicast address to send audio to [default=no output]."
+    },
+    {
+        OPT_IDX_NET_CHANNELS,
+        OPT_TYPE_UNUSED,
+        "",
+        "net-channels",
+        SushiArg::Numeric,
+        "\t\t--net-channels=<n> \tNumber of audio input and output channels of the network frontend [default=" SUSHI_QUOTE(SUSHI_NET_CHANNELS_DEFAULT) "]."
+    },
+    {
+        OPT_IDX_NET_BUFFER,
+        OPT_TYPE_UNUSED,
+        "",
+        "net-buffer",
+        SushiArg::Numeric,
+        "\t\t--net-buffer=<n> \tMinimum latency of the network jitter buffer in chunks, increased automatically on jitter [default=" SUSHI_QUOTE(SUSHI_NET_BUFFER_DEFAULT) "]."
+    },
     {
         OPT_IDX_MULTICORE_PROCESSING,
         OPT_TYPE_UNUSED,
@@ -295,6 +492,14 @@ const optionparser::Descriptor usage[] =
         SushiArg::Optional,
         "\t\t--timing-statistics \tEnable performance timings on all audio processors."
     },
+    {
+        OPT_IDX_AUDIO_RATE_CV,
+        OPT_TYPE_DISABLED,
+        "",
+        "audio-rate-cv",
+        SushiArg::Optional,
+        "\t\t--audio-rate-cv \tPass full chunks of cv data to and from the engine for sample accurate modulation of parameters that support it."
+    },
     {
         OPT_IDX_OSC_RECEIVE_PORT,
         OPT_TYPE_UNUSED,
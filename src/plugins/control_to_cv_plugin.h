@@ -32,7 +32,8 @@
 namespace sushi {
 namespace control_to_cv_plugin {
 
-constexpr int MAX_CV_VOICES = MAX_ENGINE_CV_IO_PORTS;
+constexpr int MAX_CV_VOICES = 4;
+constexpr int MAX_GATE_EVENTS = 8;
 
 class ControlToCvPlugin : public InternalPlugin
 {
@@ -78,8 +79,8 @@ private:
 
     int                                             _last_voice{0};
     std::array<ControlVoice, MAX_CV_VOICES>         _voices;
-    RtEventFifo<MAX_ENGINE_GATE_PORTS>              _kb_events;
-    SimpleFifo<int, MAX_ENGINE_GATE_PORTS>          _deferred_gate_highs;
+    RtEventFifo<MAX_GATE_EVENTS>                    _kb_events;
+    SimpleFifo<int, MAX_GATE_EVENTS>                _deferred_gate_highs;
 };
 
 float pitch_to_cv(float value);
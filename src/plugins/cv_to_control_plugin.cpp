@@ -54,7 +54,7 @@ CvToControlPlugin::CvToControlPlugin(HostControl host_control) : InternalPlugin(
     }
     _max_input_channels = 0;
     _max_output_channels = 0;
-    _deferred_note_offs.reserve(MAX_ENGINE_CV_IO_PORTS);
+    _deferred_note_offs.reserve(MAX_CV_VOICES);
 }
 
 ProcessorReturnCode CvToControlPlugin::init(float sample_rate)
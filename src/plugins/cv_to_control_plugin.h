@@ -32,7 +32,8 @@
 namespace sushi {
 namespace cv_to_control_plugin {
 
-constexpr int MAX_CV_VOICES = MAX_ENGINE_CV_IO_PORTS;
+constexpr int MAX_CV_VOICES = 4;
+constexpr int MAX_GATE_EVENTS = 8;
 
 class CvToControlPlugin : public InternalPlugin
 {
@@ -72,7 +73,7 @@ private:
 
     std::array<ControlVoice, MAX_CV_VOICES>         _voices;
     std::vector<int>                                _deferred_note_offs;
-    RtEventFifo<MAX_ENGINE_GATE_PORTS>              _gate_events;
+    RtEventFifo<MAX_GATE_EVENTS>                    _gate_events;
 };
 
 std::pair<int, float> cv_to_pitch(float value);
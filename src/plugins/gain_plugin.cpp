@@ -18,6 +18,7 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <array>
 #include <cassert>
 
 #include "gain_plugin.h"
@@ -49,14 +50,43 @@ void GainPlugin::set_input_channels(int channels)
 void GainPlugin::process_audio(const ChunkSampleBuffer &in_buffer, ChunkSampleBuffer &out_buffer)
 {
     float gain = _gain_parameter->value();
-    if (!_bypassed)
+    if (_bypassed)
+    {
+        bypass_process(in_buffer, out_buffer);
+    }
+    else if (_gain_modulation)
+    {
+        std::array<float, AUDIO_CHUNK_SIZE> gains;
+        for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+        {
+            gains[i] = _gain_parameter->process(_gain_modulation[i]);
+        }
+        for (int c = 0; c < out_buffer.channel_count(); ++c)
+        {
+            const float* in = in_buffer.channel(in_buffer.channel_count() == 1 ? 0 : c);
+            float* out = out_buffer.channel(c);
+            for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+            {
+                out[i] = in[i] * gains[i];
+            }
+        }
+    }
+    else
     {
         out_buffer.clear();
         out_buffer.add_with_gain(in_buffer, gain);
-    } else
+    }
+    _gain_modulation = nullptr;
+}
+
+bool GainPlugin::set_parameter_modulation(ObjectId parameter_id, const float* values)
+{
+    if (parameter_id != _gain_parameter->descriptor()->id())
     {
-        bypass_process(in_buffer, out_buffer);
+        return false;
     }
+    _gain_modulation = values;
+    return true;
 }
 
 
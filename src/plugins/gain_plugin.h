@@ -41,8 +41,11 @@ public:
 
     void process_audio(const ChunkSampleBuffer &in_buffer, ChunkSampleBuffer &out_buffer) override;
 
+    bool set_parameter_modulation(ObjectId parameter_id, const float* values) override;
+
 private:
     FloatParameterValue* _gain_parameter;
+    const float* _gain_modulation{nullptr};
 };
 
 }// namespace gain_plugin
@@ -40,6 +40,8 @@ SamplePlayerPlugin::SamplePlayerPlugin(HostControl host_control) : InternalPlugi
     _release_parameter = register_float_parameter("release", "Release", "s", 0.0f, 0.0f, 10.0f, new FloatParameterPreProcessor(0.0f, 10.0f));
     [[maybe_unused]] bool str_pr_ok = register_string_property("sample_file", "Sample File", "");
     assert(_volume_parameter && _attack_parameter && _decay_parameter && _sustain_parameter && _release_parameter && str_pr_ok);
+    /* Reserved so the file name can be copied from the rt thread without allocating */
+    _sample_file_property.reserve(MAX_SAMPLE_FILE_PATH);
 }
 
 ProcessorReturnCode SamplePlayerPlugin::init(float sample_rate)
@@ -79,7 +81,6 @@ void SamplePlayerPlugin::set_bypassed(bool bypassed)
 SamplePlayerPlugin::~SamplePlayerPlugin()
 {
     delete _sample_buffer;
-    delete _sample_file_property;
 }
 
 void SamplePlayerPlugin::process_event(const RtEvent& event)
@@ -143,13 +144,21 @@ void SamplePlayerPlugin::process_event(const RtEvent& event)
             /* Currently there is only 1 string parameter and it's for changing the sample
              * file, hence no need to check the parameter id */
             auto typed_event = event.string_parameter_change_event();
+            auto file_name = typed_event->value();
+            if (file_name.size() > _sample_file_property.capacity())
+            {
+                SUSHI_LOG_WARNING("Sample file path too long, ignoring");
+                break;
+            }
             for (auto& voice : _voices)
             {
                 voice.note_off(1.0f, 0);
             }
-            _sample_file_property = typed_event->value();
+            /* The event only holds the file name until the end of the chunk, so keep a copy */
+            _sample_file_property.assign(file_name.data(), file_name.size());
             /* Schedule a non-rt callback to handle sample loading */
-            auto e = RtEvent::make_async_work_event(&SamplePlayerPlugin::non_rt_callback, this->id(), this);
+            auto e = RtEvent::make_async_work_event(&SamplePlayerPlugin::non_rt_callback, this->id(), this,
+                                                    WorkPriority::LOW);
             _pending_event_id = e.async_work_event()->event_id();
             output_event(e);
             break;
@@ -221,11 +230,9 @@ int SamplePlayerPlugin::_non_rt_callback(EventId id)
 {
     if (id == _pending_event_id)
     {
-        /* Note that this doesn't handle multiple requests at once, several outstanding work
-         * requests can leak the address string */
-        auto sample_data = load_sample_file(*_sample_file_property);
-        delete _sample_file_property;
-        _sample_file_property = nullptr;
+        /* Note that this doesn't handle multiple requests at once, the file name
+         * could be changed from the rt thread while loading */
+        auto sample_data = load_sample_file(_sample_file_property);
         if (sample_data.size > 0)
         {
             _pending_sample = sample_data;
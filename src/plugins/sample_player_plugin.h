@@ -30,6 +30,7 @@ namespace sushi {
 namespace sample_player_plugin {
 
 constexpr size_t TOTAL_POLYPHONY = 8;
+constexpr size_t MAX_SAMPLE_FILE_PATH = 1024;
 
 static const std::string DEFAULT_NAME = "sushi.testing.sampleplayer";
 static const std::string DEFAULT_LABEL = "Sample player";
@@ -78,7 +79,7 @@ private:
     FloatParameterValue* _sustain_parameter;
     FloatParameterValue* _release_parameter;
 
-    std::string*         _sample_file_property{nullptr};
+    std::string          _sample_file_property;
     EventId              _pending_event_id{0};
     BlobData             _pending_sample{0, 0};
 
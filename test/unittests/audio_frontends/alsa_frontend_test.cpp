@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+
+#define private public
+#include "test_utils/alsa_mockup.cpp"
+#include "test_utils/engine_mockup.h"
+#include "audio_frontends/alsa_frontend.cpp"
+
+using namespace sushi;
+using namespace sushi::audio_frontend;
+
+constexpr float SAMPLE_RATE = 48000;
+constexpr int PERIOD_SIZE = AUDIO_CHUNK_SIZE * 4;
+constexpr int PERIODS = 2;
+
+class TestAlsaFrontend : public ::testing::Test
+{
+protected:
+    TestAlsaFrontend()
+    {
+    }
+
+    void SetUp()
+    {
+        alsa_mock_device = AlsaMockDevice();
+        _module_under_test = new AlsaFrontend(&_engine);
+    }
+
+    void TearDown()
+    {
+        _module_under_test->cleanup();
+        delete _module_under_test;
+    }
+
+    AudioFrontendStatus init(int period_size)
+    {
+        AlsaFrontendConfiguration config("default", period_size, PERIODS, 0, 0);
+        return _module_under_test->init(&config);
+    }
+
+    EngineMockup _engine{SAMPLE_RATE};
+    AlsaFrontend* _module_under_test;
+};
+
+TEST_F(TestAlsaFrontend, TestConfiguration)
+{
+    ASSERT_EQ(AudioFrontendStatus::OK, init(PERIOD_SIZE));
+    auto& capture = _module_under_test->_capture;
+    auto& playback = _module_under_test->_playback;
+    EXPECT_EQ(SND_PCM_FORMAT_FLOAT_LE, capture.format);
+    EXPECT_EQ(2, capture.channels);
+    EXPECT_EQ(2, playback.channels);
+    EXPECT_EQ(static_cast<snd_pcm_uframes_t>(PERIOD_SIZE), capture.period_size);
+    EXPECT_EQ(static_cast<snd_pcm_uframes_t>(PERIOD_SIZE * PERIODS), playback.buffer_size);
+    EXPECT_EQ(2, _module_under_test->_in_buffer.channel_count());
+    EXPECT_EQ(2, _module_under_test->_out_buffer.channel_count());
+    EXPECT_TRUE(_module_under_test->_linked);
+}
+
+TEST_F(TestAlsaFrontend, TestInvalidPeriodSize)
+{
+    EXPECT_EQ(AudioFrontendStatus::INVALID_CHUNK_SIZE, init(AUDIO_CHUNK_SIZE + AUDIO_CHUNK_SIZE / 2));
+    EXPECT_EQ(AudioFrontendStatus::INVALID_CHUNK_SIZE, init(AUDIO_CHUNK_SIZE / 2));
+}
+
+TEST_F(TestAlsaFrontend, TestInvalidBufferSize)
+{
+    /* A device that does not give the requested buffer size must be rejected,
+     * as chunks would otherwise wrap around the end of the buffer */
+    alsa_mock_device.forced_buffer_size = PERIOD_SIZE * PERIODS + AUDIO_CHUNK_SIZE / 2;
+    EXPECT_EQ(AudioFrontendStatus::INVALID_CHUNK_SIZE, init(PERIOD_SIZE));
+    EXPECT_EQ(nullptr, _module_under_test->_capture.handle);
+    EXPECT_EQ(nullptr, _module_under_test->_playback.handle);
+}
+
+TEST_F(TestAlsaFrontend, TestProcessChunk)
+{
+    ASSERT_EQ(AudioFrontendStatus::OK, init(PERIOD_SIZE));
+    ASSERT_TRUE(_module_under_test->_start_streams());
+    auto capture = _module_under_test->_capture.handle;
+    auto playback = _module_under_test->_playback.handle;
+    EXPECT_TRUE(capture->running);
+    /* The playback buffer is filled with silence when starting */
+    EXPECT_EQ(0, playback->avail);
+
+    for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+    {
+        capture->data[0][i] = 0.5f;
+        capture->data[1][i] = -0.5f;
+    }
+    capture->avail = AUDIO_CHUNK_SIZE;
+    playback->avail = AUDIO_CHUNK_SIZE;
+    ASSERT_EQ(1, _module_under_test->_available_chunks());
+    ASSERT_TRUE(_module_under_test->_process_chunk());
+    EXPECT_TRUE(_engine.process_called);
+    EXPECT_EQ(0, capture->avail);
+    EXPECT_EQ(0, playback->avail);
+    /* The engine mockup copies its input to its output */
+    for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+    {
+        ASSERT_FLOAT_EQ(0.5f, playback->data[0][i]);
+        ASSERT_FLOAT_EQ(-0.5f, playback->data[1][i]);
+    }
+    EXPECT_EQ(0, _module_under_test->xruns());
+}
+
+TEST_F(TestAlsaFrontend, TestUnevenAvail)
+{
+    alsa_mock_device.link_supported = false;
+    ASSERT_EQ(AudioFrontendStatus::OK, init(PERIOD_SIZE));
+    EXPECT_FALSE(_module_under_test->_linked);
+    ASSERT_TRUE(_module_under_test->_start_streams());
+    auto capture = _module_under_test->_capture.handle;
+    auto playback = _module_under_test->_playback.handle;
+
+    /* Playback lagging behind capture is not an xrun, nothing should be processed until both are ready */
+    capture->avail = AUDIO_CHUNK_SIZE * 2;
+    playback->avail = AUDIO_CHUNK_SIZE / 2;
+    EXPECT_EQ(0, _module_under_test->_available_chunks());
+    playback->avail = AUDIO_CHUNK_SIZE * 3;
+    EXPECT_EQ(2, _module_under_test->_available_chunks());
+    EXPECT_FALSE(_engine.process_called);
+    EXPECT_EQ(0, _module_under_test->xruns());
+}
+
+TEST_F(TestAlsaFrontend, TestXrunRecovery)
+{
+    ASSERT_EQ(AudioFrontendStatus::OK, init(PERIOD_SIZE));
+    ASSERT_TRUE(_module_under_test->_start_streams());
+    auto capture = _module_under_test->_capture.handle;
+    auto playback = _module_under_test->_playback.handle;
+
+    playback->error = -EPIPE;
+    EXPECT_EQ(-EPIPE, _module_under_test->_available_chunks());
+
+    /* An error when processing restarts the streams */
+    capture->avail = AUDIO_CHUNK_SIZE;
+    capture->error = -EPIPE;
+    EXPECT_FALSE(_module_under_test->_process_chunk());
+    EXPECT_EQ(1, _module_under_test->xruns());
+    EXPECT_FALSE(_engine.process_called);
+    EXPECT_EQ(2, capture->prepare_count);
+    EXPECT_EQ(2, playback->prepare_count);
+    EXPECT_TRUE(capture->running);
+    EXPECT_TRUE(playback->running);
+    EXPECT_EQ(0, capture->error);
+    EXPECT_EQ(0, playback->error);
+
+    /* After recovery, chunks are aligned to the start of the buffer again */
+    capture->avail = AUDIO_CHUNK_SIZE;
+    playback->avail = AUDIO_CHUNK_SIZE;
+    EXPECT_TRUE(_module_under_test->_process_chunk());
+    EXPECT_EQ(1, _module_under_test->xruns());
+}
@@ -36,6 +36,38 @@ protected:
         delete _module_under_test;
     }
 
+    /* Runs a number of periods of the given size through the frontend with a passthrough
+     * engine and checks that the output is the input delayed by expected_delay samples */
+    void verify_passthrough(int buffer_size, int expected_delay)
+    {
+        JackFrontendConfiguration config("Jack Client", "Jack Server", false, CV_CHANNELS, CV_CHANNELS);
+        ASSERT_EQ(AudioFrontendStatus::OK, _module_under_test->init(&config));
+        /* Normally done in run() */
+        _module_under_test->_engine_input_routed.fill(true);
+        _module_under_test->_engine_output_routed.fill(true);
+        _module_under_test->_client->buffer_size = buffer_size;
+        _module_under_test->internal_buffer_size_callback(buffer_size);
+        ASSERT_EQ(expected_delay, _module_under_test->extra_latency());
+
+        float* in_data = static_cast<float*>(jack_port_get_buffer(_module_under_test->_input_ports[0], buffer_size));
+        float* out_data = static_cast<float*>(jack_port_get_buffer(_module_under_test->_output_ports[0], buffer_size));
+        int sample = 0;
+        for (int period = 0; period < 8; ++period)
+        {
+            for (int i = 0; i < buffer_size; ++i)
+            {
+                in_data[i] = static_cast<float>(sample + i + 1);
+            }
+            _module_under_test->internal_process_callback(buffer_size);
+            for (int i = 0; i < buffer_size; ++i)
+            {
+                float expected = std::max(0, sample + i + 1 - expected_delay);
+                ASSERT_FLOAT_EQ(expected, out_data[i]) << "at sample " << sample + i;
+            }
+            sample += buffer_size;
+        }
+    }
+
     EngineMockup _engine{SAMPLE_RATE};
     JackFrontend* _module_under_test;
 };
@@ -53,3 +85,55 @@ TEST_F(TestJackFrontend, TestOperation)
 }
 
 
+
+TEST_F(TestJackFrontend, TestPeriodSmallerThanChunk)
+{
+    verify_passthrough(AUDIO_CHUNK_SIZE / 2, AUDIO_CHUNK_SIZE);
+}
+
+TEST_F(TestJackFrontend, TestPeriodEqualToChunk)
+{
+    verify_passthrough(AUDIO_CHUNK_SIZE, 0);
+}
+
+TEST_F(TestJackFrontend, TestPeriodMultipleOfChunk)
+{
+    verify_passthrough(AUDIO_CHUNK_SIZE * 4, 0);
+}
+
+TEST_F(TestJackFrontend, TestPeriodLargerThanChunk)
+{
+    verify_passthrough(AUDIO_CHUNK_SIZE + AUDIO_CHUNK_SIZE / 2 + 3, AUDIO_CHUNK_SIZE);
+}
+
+TEST_F(TestJackFrontend, TestReblockingLatency)
+{
+    JackFrontendConfiguration config("Jack Client", "Jack Server", false, CV_CHANNELS, CV_CHANNELS);
+    ASSERT_EQ(AudioFrontendStatus::OK, _module_under_test->init(&config));
+    jack_latency_range_t range{0, 0};
+    range.max = 256;
+    jack_port_set_latency_range(_module_under_test->_output_ports[0], JackPlaybackLatency, &range);
+
+    /* No latency is reported on the input ports when not reblocking */
+    _module_under_test->internal_buffer_size_callback(AUDIO_CHUNK_SIZE * 2);
+    _module_under_test->internal_latency_callback(JackPlaybackLatency);
+    jack_port_get_latency_range(_module_under_test->_input_ports[0], JackPlaybackLatency, &range);
+    EXPECT_EQ(0u, range.max);
+
+    _module_under_test->internal_buffer_size_callback(AUDIO_CHUNK_SIZE + 1);
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, _module_under_test->extra_latency());
+    _module_under_test->internal_latency_callback(JackPlaybackLatency);
+    for (auto port : _module_under_test->_input_ports)
+    {
+        jack_port_get_latency_range(port, JackPlaybackLatency, &range);
+        EXPECT_EQ(static_cast<jack_nframes_t>(AUDIO_CHUNK_SIZE), range.min);
+        EXPECT_EQ(static_cast<jack_nframes_t>(256 + AUDIO_CHUNK_SIZE), range.max);
+    }
+
+    _module_under_test->internal_latency_callback(JackCaptureLatency);
+    for (auto port : _module_under_test->_output_ports)
+    {
+        jack_port_get_latency_range(port, JackCaptureLatency, &range);
+        EXPECT_EQ(static_cast<jack_nframes_t>(AUDIO_CHUNK_SIZE), range.max);
+    }
+}
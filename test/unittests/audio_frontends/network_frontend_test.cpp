@@ -0,0 +1,381 @@
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "test_utils/engine_mockup.h"
+
+#define private public
+#include "audio_frontends/jitter_buffer.cpp"
+#include "audio_frontends/network_frontend.cpp"
+
+using namespace sushi;
+using namespace sushi::audio_frontend;
+
+constexpr float SAMPLE_RATE = 44000;
+constexpr int TEST_CHANNELS = 2;
+constexpr int TEST_LATENCY = 2;
+
+class TestJitterBuffer : public ::testing::Test
+{
+protected:
+    TestJitterBuffer()
+    {
+    }
+
+    /* Push a chunk where every sample of channel 0 is value, and of channel 1 is -value.
+     * The timestamp follows the sequence number, but continues past its wrap around */
+    void push_chunk(uint32_t sequence, float value, double arrival_time)
+    {
+        std::fill_n(_data.begin(), AUDIO_CHUNK_SIZE, value);
+        std::fill_n(_data.begin() + AUDIO_CHUNK_SIZE, AUDIO_CHUNK_SIZE, -value);
+        int64_t timestamp = static_cast<int64_t>(static_cast<int32_t>(sequence)) * AUDIO_CHUNK_SIZE;
+        _module_under_test.push(sequence, timestamp, arrival_time, _data.data(), TEST_CHANNELS);
+    }
+
+    JitterBuffer _module_under_test{TEST_CHANNELS, TEST_LATENCY};
+    std::array<float, TEST_CHANNELS * AUDIO_CHUNK_SIZE> _data;
+    ChunkSampleBuffer _buffer{TEST_CHANNELS};
+};
+
+TEST_F(TestJitterBuffer, TestInOrderPlayback)
+{
+    EXPECT_DOUBLE_EQ((TEST_LATENCY + 1) * AUDIO_CHUNK_SIZE, _module_under_test.latency());
+    for (int i = 0; i < 20; ++i)
+    {
+        push_chunk(i, static_cast<float>(i), i * AUDIO_CHUNK_SIZE);
+        _module_under_test.pop(_buffer);
+        if (i < TEST_LATENCY)
+        {
+            ASSERT_FALSE(_module_under_test.playing());
+            ASSERT_FLOAT_EQ(0.0f, _buffer.channel(0)[0]);
+            continue;
+        }
+        /* The chunk received TEST_LATENCY chunks ago should be output */
+        ASSERT_TRUE(_module_under_test.playing());
+        float expected = static_cast<float>(i - TEST_LATENCY);
+        ASSERT_FLOAT_EQ(expected, _buffer.channel(0)[0]);
+        ASSERT_FLOAT_EQ(expected, _buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+        ASSERT_FLOAT_EQ(-expected, _buffer.channel(1)[AUDIO_CHUNK_SIZE / 2]);
+    }
+    EXPECT_DOUBLE_EQ(1.0, _module_under_test.playback_rate());
+    EXPECT_EQ(20, _module_under_test.received_chunks());
+    EXPECT_EQ(0, _module_under_test.concealed_chunks());
+}
+
+TEST_F(TestJitterBuffer, TestReordering)
+{
+    push_chunk(0, 0.0f, 0);
+    push_chunk(1, 1.0f, AUDIO_CHUNK_SIZE);
+    _module_under_test.pop(_buffer);
+    EXPECT_FALSE(_module_under_test.playing());
+
+    /* Out of order and duplicated chunks */
+    push_chunk(3, 3.0f, 2 * AUDIO_CHUNK_SIZE);
+    push_chunk(2, 2.0f, 2 * AUDIO_CHUNK_SIZE);
+    push_chunk(3, 3.0f, 2 * AUDIO_CHUNK_SIZE);
+    /* Playback starts at the target latency behind the newest chunk */
+    for (int i = 1; i < 3; ++i)
+    {
+        _module_under_test.pop(_buffer);
+        ASSERT_FLOAT_EQ(static_cast<float>(i), _buffer.channel(0)[AUDIO_CHUNK_SIZE / 2]);
+    }
+    EXPECT_EQ(4, _module_under_test.received_chunks());
+    EXPECT_EQ(0, _module_under_test.concealed_chunks());
+
+    /* Chunks arriving after they should have been played are dropped */
+    push_chunk(2, 2.0f, 3 * AUDIO_CHUNK_SIZE);
+    EXPECT_EQ(1, _module_under_test.late_chunks());
+}
+
+TEST_F(TestJitterBuffer, TestLossConcealment)
+{
+    constexpr int LOST_CHUNK = 5;
+    for (int i = 0; i < 10; ++i)
+    {
+        if (i != LOST_CHUNK)
+        {
+            push_chunk(i, 1.0f + i, i * AUDIO_CHUNK_SIZE);
+        }
+        _module_under_test.pop(_buffer);
+        if (i == LOST_CHUNK + TEST_LATENCY)
+        {
+            /* The previous chunk should be repeated while fading out */
+            float previous = static_cast<float>(LOST_CHUNK);
+            EXPECT_FLOAT_EQ(previous, _buffer.channel(0)[0]);
+            EXPECT_GT(previous, _buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+            EXPECT_LT(previous * JITTER_BUFFER_CONCEALMENT_DECAY, _buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+            EXPECT_FLOAT_EQ(-_buffer.channel(0)[AUDIO_CHUNK_SIZE / 2], _buffer.channel(1)[AUDIO_CHUNK_SIZE / 2]);
+        }
+    }
+    EXPECT_EQ(1, _module_under_test.concealed_chunks());
+    EXPECT_FLOAT_EQ(8.0f, _buffer.channel(0)[AUDIO_CHUNK_SIZE / 2]);
+
+    push_chunk(LOST_CHUNK, 1.0f + LOST_CHUNK, 10 * AUDIO_CHUNK_SIZE);
+    EXPECT_EQ(1, _module_under_test.late_chunks());
+}
+
+TEST_F(TestJitterBuffer, TestUnderrun)
+{
+    for (int i = 0; i < TEST_LATENCY + 1; ++i)
+    {
+        push_chunk(i, 1.0f, i * AUDIO_CHUNK_SIZE);
+    }
+    _module_under_test.pop(_buffer);
+    ASSERT_TRUE(_module_under_test.playing());
+
+    /* Nothing more is received, the buffered chunks should be played before fading out */
+    for (int i = 0; i < TEST_LATENCY; ++i)
+    {
+        _module_under_test.pop(_buffer);
+        ASSERT_FLOAT_EQ(1.0f, _buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+    }
+    for (int i = 0; i < JITTER_BUFFER_MAX_CONCEALED_CHUNKS; ++i)
+    {
+        ASSERT_TRUE(_module_under_test.playing());
+        _module_under_test.pop(_buffer);
+        ASSERT_GT(1.0f, _buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+    }
+    EXPECT_EQ(JITTER_BUFFER_MAX_CONCEALED_CHUNKS, _module_under_test.concealed_chunks());
+    EXPECT_FALSE(_module_under_test.playing());
+    _module_under_test.pop(_buffer);
+    EXPECT_FLOAT_EQ(0.0f, _buffer.channel(0)[0]);
+
+    /* And start again when enough data is buffered */
+    for (int i = 20; i < 20 + TEST_LATENCY + 1; ++i)
+    {
+        push_chunk(i, 2.0f, i * AUDIO_CHUNK_SIZE);
+    }
+    _module_under_test.pop(_buffer);
+    EXPECT_TRUE(_module_under_test.playing());
+    EXPECT_FLOAT_EQ(2.0f, _buffer.channel(0)[0]);
+}
+
+TEST_F(TestJitterBuffer, TestSequenceWrapAround)
+{
+    uint32_t sequence = std::numeric_limits<uint32_t>::max() - 4;
+    for (int i = 0; i < 10; ++i)
+    {
+        push_chunk(sequence++, 1.0f, i * AUDIO_CHUNK_SIZE);
+        _module_under_test.pop(_buffer);
+    }
+    EXPECT_EQ(0, _module_under_test.concealed_chunks());
+    EXPECT_EQ(0, _module_under_test.late_chunks());
+    EXPECT_FLOAT_EQ(1.0f, _buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+
+    /* A sender jumping far ahead should be picked up again */
+    for (uint32_t i = 0; i < TEST_LATENCY + 1; ++i)
+    {
+        push_chunk(i + 1000, 3.0f, (i + 10) * AUDIO_CHUNK_SIZE);
+    }
+    _module_under_test.pop(_buffer);
+    EXPECT_TRUE(_module_under_test.playing());
+    EXPECT_FLOAT_EQ(3.0f, _buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+}
+
+TEST_F(TestJitterBuffer, TestClockDrift)
+{
+    /* Chunks are sent with a clock that runs 0.3% fast, then 0.3% slow */
+    for (double drift : {1.003, 0.997})
+    {
+        _module_under_test.reset();
+        int64_t sent = 0;
+        double average_rate = 0;
+        for (int chunk = 0; chunk < 20000; ++chunk)
+        {
+            double now = static_cast<double>(chunk) * AUDIO_CHUNK_SIZE;
+            while (sent * AUDIO_CHUNK_SIZE <= now * drift)
+            {
+                push_chunk(static_cast<uint32_t>(sent), 1.0f, now);
+                sent++;
+            }
+            _module_under_test.pop(_buffer);
+            if (chunk > 100)
+            {
+                ASSERT_TRUE(_module_under_test.playing());
+                ASSERT_FLOAT_EQ(1.0f, _buffer.channel(0)[0]);
+            }
+            if (chunk >= 18000)
+            {
+                average_rate += _module_under_test.playback_rate() / 2000;
+            }
+        }
+        EXPECT_NEAR(drift, average_rate, 0.0005);
+        EXPECT_NEAR(_module_under_test.latency(), _module_under_test.fill(), AUDIO_CHUNK_SIZE);
+        EXPECT_EQ(0, _module_under_test.late_chunks());
+        EXPECT_EQ(0, _module_under_test.concealed_chunks());
+    }
+}
+
+TEST_F(TestJitterBuffer, TestAdaptiveLatency)
+{
+    std::ranlux24 rand_gen;
+    std::uniform_real_distribution<double> jitter(0, 4 * AUDIO_CHUNK_SIZE);
+    /* Chunks are delayed by a random amount, and popped when the arrival time has passed */
+    std::vector<std::pair<double, int>> in_flight;
+    for (int chunk = 0; chunk < 2000; ++chunk)
+    {
+        double now = static_cast<double>(chunk) * AUDIO_CHUNK_SIZE;
+        in_flight.push_back({now + jitter(rand_gen), chunk});
+        for (auto i = in_flight.begin(); i != in_flight.end();)
+        {
+            if (i->first <= now)
+            {
+                push_chunk(i->second, 1.0f, i->first);
+                i = in_flight.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        _module_under_test.pop(_buffer);
+    }
+    EXPECT_GT(_module_under_test.latency(), 2 * AUDIO_CHUNK_SIZE * TEST_LATENCY);
+    EXPECT_LE(_module_under_test.latency(), JITTER_BUFFER_MAX_CHUNKS * AUDIO_CHUNK_SIZE);
+
+    /* Once the latency has adapted, chunks should no longer be lost */
+    auto concealed = _module_under_test.concealed_chunks();
+    for (int chunk = 2000; chunk < 3000; ++chunk)
+    {
+        double now = static_cast<double>(chunk) * AUDIO_CHUNK_SIZE;
+        in_flight.push_back({now + jitter(rand_gen), chunk});
+        for (auto i = in_flight.begin(); i != in_flight.end();)
+        {
+            if (i->first <= now)
+            {
+                push_chunk(i->second, 1.0f, i->first);
+                i = in_flight.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        _module_under_test.pop(_buffer);
+    }
+    EXPECT_EQ(concealed, _module_under_test.concealed_chunks());
+}
+
+class TestNetworkFrontend : public ::testing::Test
+{
+protected:
+    TestNetworkFrontend()
+    {
+    }
+
+    void SetUp()
+    {
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(_socket, 0);
+        sockaddr_in address;
+        ASSERT_TRUE(parse_socket_address("127.0.0.1:0", address));
+        ASSERT_EQ(0, bind(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+        socklen_t length = sizeof(address);
+        getsockname(_socket, reinterpret_cast<sockaddr*>(&address), &length);
+        _port = ntohs(address.sin_port);
+    }
+
+    void TearDown()
+    {
+        close(_socket);
+    }
+
+    EngineMockup _engine{SAMPLE_RATE};
+    EngineMockup _second_engine{SAMPLE_RATE};
+    int _socket;
+    int _port;
+};
+
+TEST_F(TestNetworkFrontend, TestInitialization)
+{
+    NetworkFrontend frontend(&_engine);
+    NetworkFrontendConfiguration config("127.0.0.1:0", "127.0.0.1:" + std::to_string(_port), TEST_CHANNELS, TEST_LATENCY);
+    ASSERT_EQ(AudioFrontendStatus::OK, frontend.init(&config));
+    EXPECT_EQ(TEST_CHANNELS, _engine.audio_input_channels());
+    EXPECT_EQ(TEST_CHANNELS, _engine.audio_output_channels());
+    EXPECT_NE(0, frontend._listen_port);
+    EXPECT_GE(frontend._send_socket, 0);
+
+    NetworkFrontend invalid_frontend(&_engine);
+    NetworkFrontendConfiguration invalid_config("127.0.0.1:0", "", MAX_FRONTEND_CHANNELS + 1, TEST_LATENCY);
+    EXPECT_EQ(AudioFrontendStatus::INVALID_N_CHANNELS, invalid_frontend.init(&invalid_config));
+    invalid_config = NetworkFrontendConfiguration("127.0.0.1:0", "", TEST_CHANNELS, JITTER_BUFFER_MAX_CHUNKS);
+    EXPECT_EQ(AudioFrontendStatus::INVALID_CHUNK_SIZE, invalid_frontend.init(&invalid_config));
+    invalid_config = NetworkFrontendConfiguration("localhost:abc", "", TEST_CHANNELS, TEST_LATENCY);
+    EXPECT_EQ(AudioFrontendStatus::AUDIO_HW_ERROR, invalid_frontend.init(&invalid_config));
+    invalid_config = NetworkFrontendConfiguration("", "127.0.0.1", TEST_CHANNELS, TEST_LATENCY);
+    EXPECT_EQ(AudioFrontendStatus::AUDIO_HW_ERROR, invalid_frontend.init(&invalid_config));
+}
+
+TEST_F(TestNetworkFrontend, TestChainedEngines)
+{
+    /* Audio is sent from the test to the first engine, from there to the second, and then back */
+    NetworkFrontend last(&_second_engine);
+    NetworkFrontendConfiguration last_config("127.0.0.1:0", "127.0.0.1:" + std::to_string(_port), TEST_CHANNELS, TEST_LATENCY);
+    ASSERT_EQ(AudioFrontendStatus::OK, last.init(&last_config));
+    NetworkFrontend first(&_engine);
+    NetworkFrontendConfiguration first_config("127.0.0.1:0", "127.0.0.1:" + std::to_string(last._listen_port), TEST_CHANNELS, TEST_LATENCY);
+    ASSERT_EQ(AudioFrontendStatus::OK, first.init(&first_config));
+    first.run();
+    last.run();
+
+    sockaddr_in destination;
+    ASSERT_TRUE(parse_socket_address("127.0.0.1:" + std::to_string(first._listen_port), destination));
+    std::array<uint8_t, NETWORK_AUDIO_MAX_PACKET_SIZE> packet{};
+    auto header = reinterpret_cast<NetworkAudioHeader*>(packet.data());
+    header->magic = NETWORK_AUDIO_MAGIC;
+    header->version = NETWORK_AUDIO_VERSION;
+    header->channels = TEST_CHANNELS;
+    header->chunk_size = AUDIO_CHUNK_SIZE;
+    header->sample_rate = static_cast<uint32_t>(SAMPLE_RATE);
+    std::fill_n(reinterpret_cast<float*>(packet.data() + sizeof(NetworkAudioHeader)), TEST_CHANNELS * AUDIO_CHUNK_SIZE, 0.5f);
+    size_t packet_size = sizeof(NetworkAudioHeader) + TEST_CHANNELS * AUDIO_CHUNK_SIZE * sizeof(float);
+
+    /* Send in realtime until the audio comes back, for at most 2 seconds */
+    auto chunk_period = std::chrono::nanoseconds(static_cast<int64_t>(AUDIO_CHUNK_SIZE * 1'000'000'000.0 / SAMPLE_RATE));
+    auto next_chunk = std::chrono::steady_clock::now();
+    int returned_at = -1;
+    int64_t received = 0;
+    uint32_t last_sequence = 0;
+    int sequence_gaps = 0;
+    std::array<uint8_t, NETWORK_AUDIO_MAX_PACKET_SIZE> received_packet;
+    auto received_header = reinterpret_cast<const NetworkAudioHeader*>(received_packet.data());
+    int sent;
+    for (sent = 0; sent < 2 * SAMPLE_RATE / AUDIO_CHUNK_SIZE && returned_at < 0; ++sent)
+    {
+        header->sequence = sent;
+        header->timestamp = static_cast<uint64_t>(sent) * AUDIO_CHUNK_SIZE;
+        ASSERT_EQ(static_cast<ssize_t>(packet_size), sendto(_socket, packet.data(), packet_size, 0,
+                                                            reinterpret_cast<sockaddr*>(&destination), sizeof(destination)));
+        while (recv(_socket, received_packet.data(), received_packet.size(), MSG_DONTWAIT) > 0)
+        {
+            ASSERT_EQ(NETWORK_AUDIO_MAGIC, received_header->magic);
+            ASSERT_EQ(TEST_CHANNELS, received_header->channels);
+            /* Udp on a loaded machine may drop or reorder packets, so gaps are only counted */
+            if (received > 0 && received_header->sequence != last_sequence + 1)
+            {
+                sequence_gaps++;
+            }
+            last_sequence = received_header->sequence;
+            received++;
+            auto data = reinterpret_cast<const float*>(received_packet.data() + sizeof(NetworkAudioHeader));
+            if (data[AUDIO_CHUNK_SIZE - 1] == 0.5f && data[2 * AUDIO_CHUNK_SIZE - 1] == 0.5f)
+            {
+                returned_at = sent;
+            }
+        }
+        next_chunk += chunk_period;
+        std::this_thread::sleep_until(next_chunk);
+    }
+    first.cleanup();
+    last.cleanup();
+
+    RecordProperty("sequence_gaps", sequence_gaps);
+    ASSERT_GE(returned_at, 0);
+    /* The latency through both engines should be bounded by their jitter buffers */
+    EXPECT_LE(returned_at, 2 * JITTER_BUFFER_MAX_CHUNKS);
+    EXPECT_TRUE(_engine.process_called);
+    EXPECT_TRUE(_second_engine.process_called);
+    EXPECT_GT(first._jitter_buffer->received_chunks(), 0);
+    EXPECT_GT(last._jitter_buffer->received_chunks(), 0);
+}
@@ -110,6 +110,123 @@ TEST_F(TestOfflineFrontend, TestMonoMode)
     _module_under_test->run();
 }
 
+TEST_F(TestOfflineFrontend, TestMultichannelProcessing)
+{
+    // Create an 8 channel file where every channel has a unique value, and with a length
+    // that is not a multiple of the chunk or file block size
+    constexpr int INPUT_CHANNELS = 8;
+    constexpr int FRAMES = OFFLINE_FRONTEND_BLOCK_SIZE + AUDIO_CHUNK_SIZE / 2;
+    std::string input_file_name("./test_multichannel_in.wav");
+    std::string output_file_name("./test_multichannel_out.wav");
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.samplerate = SAMPLE_RATE;
+    info.channels = INPUT_CHANNELS;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_24;
+    SNDFILE* input_file = sf_open(input_file_name.c_str(), SFM_WRITE, &info);
+    ASSERT_NE(nullptr, input_file);
+    std::vector<float> frame_data(INPUT_CHANNELS);
+    for (int c = 0; c < INPUT_CHANNELS; ++c)
+    {
+        frame_data[c] = 0.1f * (c + 1);
+    }
+    for (int i = 0; i < FRAMES; ++i)
+    {
+        sf_writef_float(input_file, frame_data.data(), 1);
+    }
+    sf_close(input_file);
+
+    // Write 3 of the channels in reverse order to a float file
+    OfflineFrontendConfiguration config(input_file_name, output_file_name, false, CV_CHANNELS, CV_CHANNELS,
+                                        "", "float", 0, {7, 2, 0});
+    auto ret_code = _module_under_test->init(&config);
+    ASSERT_EQ(AudioFrontendStatus::OK, ret_code);
+    _module_under_test->run();
+    _module_under_test->cleanup();
+
+    SNDFILE* output_file = sf_open(output_file_name.c_str(), SFM_READ, &info);
+    ASSERT_NE(nullptr, output_file);
+    EXPECT_EQ(3, info.channels);
+    EXPECT_EQ(FRAMES, info.frames);
+    EXPECT_EQ(SF_FORMAT_WAV | SF_FORMAT_FLOAT, info.format);
+    float output_frame[3];
+    while (sf_readf_float(output_file, output_frame, 1) == 1)
+    {
+        ASSERT_NEAR(0.8f, output_frame[0], 1.0e-6f);
+        ASSERT_NEAR(0.3f, output_frame[1], 1.0e-6f);
+        ASSERT_NEAR(0.1f, output_frame[2], 1.0e-6f);
+    }
+    sf_close(output_file);
+}
+
+TEST_F(TestOfflineFrontend, TestInvalidOutputConfig)
+{
+    char const* test_data_dir = GetEnv("SUSHI_TEST_DATA_DIR");
+    ASSERT_NE(nullptr, test_data_dir);
+    std::string test_data_file(test_data_dir);
+    test_data_file.append("/test_sndfile_05.wav");
+
+    OfflineFrontendConfiguration map_config(test_data_file, "./test_out.wav", false, CV_CHANNELS, CV_CHANNELS,
+                                            "", "", 4, {0, 1});
+    EXPECT_EQ(AudioFrontendStatus::INVALID_N_CHANNELS, _module_under_test->init(&map_config));
+
+    OfflineFrontendConfiguration format_config(test_data_file, "./test_out.flac", false, CV_CHANNELS, CV_CHANNELS,
+                                               "flac", "double");
+    EXPECT_EQ(AudioFrontendStatus::INVALID_OUTPUT_FILE, _module_under_test->init(&format_config));
+}
+
+TEST_F(TestOfflineFrontend, TestBenchmarkMode)
+{
+    OfflineFrontendConfiguration config("", "", true, CV_CHANNELS, CV_CHANNELS);
+    config.benchmark_duration = 0.1f;
+    config.benchmark_warmup = 0.05f;
+    auto ret_code = _module_under_test->init(&config);
+    ASSERT_EQ(AudioFrontendStatus::OK, ret_code);
+
+    // Should run to completion and return
+    _module_under_test->run();
+    ASSERT_TRUE(_engine.process_called);
+    const auto& results = _module_under_test->benchmark_results();
+    EXPECT_EQ(static_cast<int>(0.1f * SAMPLE_RATE / AUDIO_CHUNK_SIZE), results.chunks);
+    EXPECT_GT(results.realtime_factor, 0.0);
+    EXPECT_LE(results.latency_p50, results.latency_p99);
+    EXPECT_LE(results.latency_p99, results.latency_max);
+}
+
+TEST(TestOfflineFrontendInternals, TestBenchmarkResults)
+{
+    std::vector<float> latencies;
+    for (int i = 1000; i > 0; --i)
+    {
+        latencies.push_back(static_cast<float>(i));
+    }
+    auto results = calculate_benchmark_results(latencies, 0.5, SAMPLE_RATE);
+    EXPECT_EQ(1000, results.chunks);
+    EXPECT_DOUBLE_EQ(2000.0, results.chunks_per_second);
+    EXPECT_DOUBLE_EQ(2000.0 * AUDIO_CHUNK_SIZE / SAMPLE_RATE, results.realtime_factor);
+    EXPECT_FLOAT_EQ(500.5f, results.latency_avg);
+    EXPECT_FLOAT_EQ(501.0f, results.latency_p50);
+    EXPECT_FLOAT_EQ(901.0f, results.latency_p90);
+    EXPECT_FLOAT_EQ(991.0f, results.latency_p99);
+    EXPECT_FLOAT_EQ(1000.0f, results.latency_p999);
+    EXPECT_FLOAT_EQ(1000.0f, results.latency_max);
+
+    latencies.clear();
+    results = calculate_benchmark_results(latencies, 0.5, SAMPLE_RATE);
+    EXPECT_EQ(0, results.chunks);
+}
+
+TEST(TestOfflineFrontendInternals, TestFormatFromNames)
+{
+    int wav_16 = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    EXPECT_EQ(wav_16, sndfile_format_from_names(wav_16, "", ""));
+    EXPECT_EQ(SF_FORMAT_FLAC | SF_FORMAT_PCM_16, sndfile_format_from_names(wav_16, "flac", ""));
+    EXPECT_EQ(SF_FORMAT_WAV | SF_FORMAT_PCM_24, sndfile_format_from_names(wav_16, "", "int24"));
+    EXPECT_EQ(SF_FORMAT_AIFF | SF_FORMAT_FLOAT, sndfile_format_from_names(wav_16, "aiff", "float"));
+    EXPECT_EQ(0, sndfile_format_from_names(wav_16, "mp4", ""));
+    EXPECT_EQ(0, sndfile_format_from_names(wav_16, "wav", "int12"));
+}
+
 TEST_F(TestOfflineFrontend, TestAddSequencerEvents)
 {
     char const* test_data_dir = GetEnv("SUSHI_TEST_DATA_DIR");
@@ -0,0 +1,189 @@
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "test_utils/engine_mockup.h"
+
+#define private public
+#include "audio_frontends/shm_frontend.cpp"
+
+#include "sushi_shm_client.h"
+
+using namespace sushi;
+using namespace sushi::audio_frontend;
+
+constexpr float SAMPLE_RATE = 44000;
+constexpr int TEST_CHANNELS = 2;
+constexpr int CV_CHANNELS = 0;
+constexpr int TIMEOUT_MS = 1000;
+const std::string TEST_SHM_NAME = "/sushi_unittest_" + std::to_string(getpid());
+
+class TestShmFrontend : public ::testing::Test
+{
+protected:
+    TestShmFrontend()
+    {
+    }
+
+    void SetUp()
+    {
+        _module_under_test = new ShmFrontend(&_engine);
+        ShmFrontendConfiguration config(TEST_SHM_NAME, TEST_CHANNELS, CV_CHANNELS, CV_CHANNELS);
+        ASSERT_EQ(AudioFrontendStatus::OK, _module_under_test->init(&config));
+    }
+
+    void TearDown()
+    {
+        _module_under_test->cleanup();
+        delete _module_under_test;
+    }
+
+    EngineMockup _engine{SAMPLE_RATE};
+    ShmFrontend* _module_under_test;
+};
+
+TEST_F(TestShmFrontend, TestInitialization)
+{
+    auto header = _module_under_test->_header;
+    ASSERT_NE(nullptr, header);
+    EXPECT_EQ(SUSHI_SHM_MAGIC, header->magic);
+    EXPECT_EQ(static_cast<uint32_t>(SAMPLE_RATE), header->sample_rate);
+    EXPECT_EQ(static_cast<uint32_t>(AUDIO_CHUNK_SIZE), header->chunk_size);
+    EXPECT_EQ(static_cast<uint32_t>(TEST_CHANNELS), header->input_channels);
+    EXPECT_EQ(static_cast<uint32_t>(TEST_CHANNELS), header->output_channels);
+    EXPECT_EQ(TEST_CHANNELS, _engine.audio_input_channels());
+    EXPECT_EQ(TEST_CHANNELS, _engine.audio_output_channels());
+    EXPECT_EQ(static_cast<uint32_t>(DEFAULT_ENGINE_GATE_PORTS), header->gate_inputs);
+    EXPECT_EQ(1u, header->gate_words);
+
+    ShmFrontend invalid_frontend(&_engine);
+    ShmFrontendConfiguration config(TEST_SHM_NAME + "_invalid", MAX_FRONTEND_CHANNELS + 1, CV_CHANNELS, CV_CHANNELS);
+    EXPECT_EQ(AudioFrontendStatus::INVALID_N_CHANNELS, invalid_frontend.init(&config));
+
+    /* The segment should be removed when the frontend is cleaned up */
+    _module_under_test->cleanup();
+    EXPECT_EQ(nullptr, sushi_shm_client_open(TEST_SHM_NAME.c_str()));
+}
+
+TEST_F(TestShmFrontend, TestGateChannels)
+{
+    ShmFrontend frontend(&_engine);
+    ShmFrontendConfiguration config(TEST_SHM_NAME + "_gates", TEST_CHANNELS, CV_CHANNELS, CV_CHANNELS);
+    config.gate_inputs = 40;
+    config.gate_outputs = 16;
+    ASSERT_EQ(AudioFrontendStatus::OK, frontend.init(&config));
+    EXPECT_EQ(40, _engine.gate_input_channels());
+    EXPECT_EQ(16, _engine.gate_output_channels());
+    EXPECT_EQ(2u, frontend._header->gate_words);
+    EXPECT_EQ(40, frontend._in_controls.gate_values.size());
+
+    SushiShmClient* client = sushi_shm_client_open((TEST_SHM_NAME + "_gates").c_str());
+    ASSERT_NE(nullptr, client);
+    EXPECT_EQ(40, sushi_shm_client_gate_inputs(client));
+    EXPECT_EQ(16, sushi_shm_client_gate_outputs(client));
+    sushi_shm_client_close(client);
+    frontend.cleanup();
+}
+
+TEST_F(TestShmFrontend, TestProcessing)
+{
+    _module_under_test->run();
+    SushiShmClient* client = sushi_shm_client_open(TEST_SHM_NAME.c_str());
+    ASSERT_NE(nullptr, client);
+    EXPECT_EQ(static_cast<int>(SAMPLE_RATE), sushi_shm_client_sample_rate(client));
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, sushi_shm_client_chunk_size(client));
+    EXPECT_EQ(TEST_CHANNELS, sushi_shm_client_input_channels(client));
+    EXPECT_EQ(TEST_CHANNELS, sushi_shm_client_output_channels(client));
+
+    /* Only one client can be connected at a time */
+    EXPECT_EQ(nullptr, sushi_shm_client_open(TEST_SHM_NAME.c_str()));
+    EXPECT_EQ(EBUSY, errno);
+
+    /* The engine mockup copies the input to the output */
+    for (int chunk = 0; chunk < 10; ++chunk)
+    {
+        for (int c = 0; c < TEST_CHANNELS; ++c)
+        {
+            std::fill_n(sushi_shm_client_input(client, c), AUDIO_CHUNK_SIZE, static_cast<float>(chunk + c));
+        }
+        ASSERT_EQ(0, sushi_shm_client_process(client, TIMEOUT_MS));
+        for (int c = 0; c < TEST_CHANNELS; ++c)
+        {
+            ASSERT_FLOAT_EQ(static_cast<float>(chunk + c), sushi_shm_client_output(client, c)[0]);
+            ASSERT_FLOAT_EQ(static_cast<float>(chunk + c), sushi_shm_client_output(client, c)[AUDIO_CHUNK_SIZE - 1]);
+        }
+    }
+    sushi_shm_client_close(client);
+
+    _module_under_test->cleanup();
+    EXPECT_TRUE(_engine.process_called);
+    EXPECT_EQ(10 * AUDIO_CHUNK_SIZE, _module_under_test->_sample_count);
+}
+
+TEST_F(TestShmFrontend, TestQueuedChunks)
+{
+    _module_under_test->run();
+    SushiShmClient* client = sushi_shm_client_open(TEST_SHM_NAME.c_str());
+    ASSERT_NE(nullptr, client);
+    EXPECT_EQ(-1, sushi_shm_client_receive(client, TIMEOUT_MS));
+    EXPECT_EQ(EAGAIN, errno);
+
+    for (uint32_t chunk = 0; chunk < SUSHI_SHM_SLOT_COUNT; ++chunk)
+    {
+        std::fill_n(sushi_shm_client_input(client, 0), AUDIO_CHUNK_SIZE, static_cast<float>(chunk));
+        ASSERT_EQ(0, sushi_shm_client_send(client));
+    }
+    EXPECT_EQ(-1, sushi_shm_client_send(client));
+    EXPECT_EQ(EAGAIN, errno);
+
+    for (uint32_t chunk = 0; chunk < SUSHI_SHM_SLOT_COUNT; ++chunk)
+    {
+        ASSERT_EQ(0, sushi_shm_client_receive(client, TIMEOUT_MS));
+        EXPECT_FLOAT_EQ(static_cast<float>(chunk), sushi_shm_client_output(client, 0)[0]);
+    }
+
+    /* A new client should be able to take over where the previous one left */
+    sushi_shm_client_close(client);
+    client = sushi_shm_client_open(TEST_SHM_NAME.c_str());
+    ASSERT_NE(nullptr, client);
+    std::fill_n(sushi_shm_client_input(client, 0), AUDIO_CHUNK_SIZE, 0.5f);
+    ASSERT_EQ(0, sushi_shm_client_process(client, TIMEOUT_MS));
+    EXPECT_FLOAT_EQ(0.5f, sushi_shm_client_output(client, 0)[0]);
+    sushi_shm_client_close(client);
+}
+
+TEST_F(TestShmFrontend, TestSegmentInUse)
+{
+    _module_under_test->run();
+    SushiShmClient* client = sushi_shm_client_open(TEST_SHM_NAME.c_str());
+    ASSERT_NE(nullptr, client);
+    /* Wait until the audio thread has marked the segment as running */
+    std::fill_n(sushi_shm_client_input(client, 0), AUDIO_CHUNK_SIZE, 0.5f);
+    ASSERT_EQ(0, sushi_shm_client_process(client, TIMEOUT_MS));
+
+    /* A second instance must not replace the segment of a running one */
+    ShmFrontend second_frontend(&_engine);
+    ShmFrontendConfiguration config(TEST_SHM_NAME, TEST_CHANNELS, CV_CHANNELS, CV_CHANNELS);
+    EXPECT_EQ(AudioFrontendStatus::AUDIO_HW_ERROR, second_frontend.init(&config));
+    std::fill_n(sushi_shm_client_input(client, 0), AUDIO_CHUNK_SIZE, 0.5f);
+    ASSERT_EQ(0, sushi_shm_client_process(client, TIMEOUT_MS));
+    EXPECT_FLOAT_EQ(0.5f, sushi_shm_client_output(client, 0)[0]);
+    sushi_shm_client_close(client);
+}
+
+TEST_F(TestShmFrontend, TestCorruptedHeader)
+{
+    _module_under_test->run();
+    SushiShmClient* client = sushi_shm_client_open(TEST_SHM_NAME.c_str());
+    ASSERT_NE(nullptr, client);
+
+    /* The geometry written by the client is ignored when processing */
+    auto header = _module_under_test->_header;
+    header->input_channels = 1000;
+    header->cv_inputs = 1000;
+    header->cv_outputs = 1000;
+    std::fill_n(sushi_shm_client_input(client, 0), AUDIO_CHUNK_SIZE, 0.5f);
+    ASSERT_EQ(0, sushi_shm_client_process(client, TIMEOUT_MS));
+    EXPECT_FLOAT_EQ(0.5f, sushi_shm_client_output(client, 0)[0]);
+    sushi_shm_client_close(client);
+}
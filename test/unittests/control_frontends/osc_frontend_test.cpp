@@ -89,6 +89,28 @@ TEST_F(TestOSCFrontend, TestSendParameterChangeEvent)
     ASSERT_FALSE(_test_dispatcher->got_event());
 }
 
+TEST_F(TestOSCFrontend, TestSendParameterBatchChangeEvent)
+{
+    ASSERT_TRUE(_module_under_test.connect_to_parameter_batch("sampler"));
+    lo_send(_address, "/parameters/sampler", "ifif", 1, 0.25f, 2, 0.5f);
+
+    auto event = wait_for_event();
+    ASSERT_NE(nullptr, event);
+    EXPECT_TRUE(event->maps_to_rt_event());
+    auto typed_event = static_cast<ParameterBatchChangeEvent*>(event.get());
+    EXPECT_EQ(0u, typed_event->processor_id());
+    ASSERT_EQ(2u, typed_event->values().size());
+    EXPECT_EQ(1u, typed_event->values()[0].parameter_id);
+    EXPECT_FLOAT_EQ(0.25f, typed_event->values()[0].value);
+    EXPECT_EQ(2u, typed_event->values()[1].parameter_id);
+    EXPECT_FLOAT_EQ(0.5f, typed_event->values()[1].value);
+
+    /* Malformed batches should be ignored */
+    lo_send(_address, "/parameters/sampler", "ifi", 1, 0.25f, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_FALSE(_test_dispatcher->got_event());
+}
+
 TEST_F(TestOSCFrontend, TestSendNoteOnEvent)
 {
     ASSERT_TRUE(_module_under_test.connect_kb_to_track("sampler"));
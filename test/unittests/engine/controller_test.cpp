@@ -238,4 +238,22 @@ TEST_F(ControllerTest, TestParameterControls)
     auto [str_value_status, str_value] = _module_under_test->get_parameter_value_as_string(proc_id, id);
     ASSERT_EQ(ext::ControlStatus::OK, str_value_status);
     EXPECT_EQ("1000.000000", str_value);
-}
\ No newline at end of file
+}
+
+TEST_F(ControllerTest, TestSetParameterValues)
+{
+    auto [status, proc_id] = _module_under_test->get_processor_id("equalizer_0_l");
+    ASSERT_EQ(ext::ControlStatus::OK, status);
+    auto [found_status, id] = _module_under_test->get_parameter_id(proc_id, "frequency");
+    ASSERT_EQ(ext::ControlStatus::OK, found_status);
+
+    EXPECT_EQ(ext::ControlStatus::OK, _module_under_test->set_parameter_value(proc_id, id, 500.0f));
+    EXPECT_EQ(ext::ControlStatus::OK, _module_under_test->set_parameter_values(proc_id, {{id, 500.0f}}));
+
+    EXPECT_EQ(ext::ControlStatus::NOT_FOUND, _module_under_test->set_parameter_values(12345, {{id, 500.0f}}));
+    EXPECT_EQ(ext::ControlStatus::NOT_FOUND, _module_under_test->set_parameter_values(proc_id, {{id, 500.0f}, {12345, 0.5f}}));
+    /* Only batches are validated, single values are passed on as before */
+    EXPECT_EQ(ext::ControlStatus::OK, _module_under_test->set_parameter_value(proc_id, id, 30000.0f));
+    EXPECT_EQ(ext::ControlStatus::OUT_OF_RANGE, _module_under_test->set_parameter_values(proc_id, {{id, 30000.0f}}));
+    EXPECT_EQ(ext::ControlStatus::OUT_OF_RANGE, _module_under_test->set_parameter_values(proc_id, {{id, 500.0f}, {id, 10.0f}}));
+}
@@ -159,6 +159,60 @@ TEST_F(TestEngine, TestOutputMixing)
     test_utils::assert_buffer_value(2.0f, main_bus);
 }
 
+TEST_F(TestEngine, TestChannelConnectionQueries)
+{
+    _module_under_test->create_track("1", 2);
+    _module_under_test->connect_audio_input_bus(1, 0, "1");
+    _module_under_test->connect_audio_output_channel(0, 1, "1");
+
+    EXPECT_FALSE(_module_under_test->audio_input_channel_connected(0));
+    EXPECT_FALSE(_module_under_test->audio_input_channel_connected(1));
+    EXPECT_TRUE(_module_under_test->audio_input_channel_connected(2));
+    EXPECT_TRUE(_module_under_test->audio_input_channel_connected(3));
+    EXPECT_TRUE(_module_under_test->audio_output_channel_connected(0));
+    EXPECT_FALSE(_module_under_test->audio_output_channel_connected(1));
+}
+
+TEST_F(TestEngine, TestRecordedInputIsConnected)
+{
+    /* Inputs that are only recorded must still be passed to the engine by the frontend */
+    EXPECT_FALSE(_module_under_test->audio_input_channel_connected(0));
+    ASSERT_EQ(0, _module_under_test->recorder()->add_tap(RecordSource::ENGINE_INPUT, 0, 2));
+    EXPECT_TRUE(_module_under_test->audio_input_channel_connected(0));
+    EXPECT_TRUE(_module_under_test->audio_input_channel_connected(1));
+    EXPECT_FALSE(_module_under_test->audio_input_channel_connected(2));
+
+    /* Recording other sources doesn't affect the inputs */
+    ASSERT_EQ(1, _module_under_test->recorder()->add_tap(RecordSource::ENGINE_OUTPUT, 0, 4));
+    EXPECT_FALSE(_module_under_test->audio_input_channel_connected(2));
+}
+
+TEST_F(TestEngine, TestRecordDeletedProcessor)
+{
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->create_track("main", 2));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track("main", "sushi.testing.gain", "gain",
+                                                                              "", PluginType::INTERNAL));
+    auto recorder = _module_under_test->recorder();
+    auto [status, processor_id] = _module_under_test->processor_id_from_name("gain");
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    int id = recorder->add_tap(RecordSource::PROCESSOR_OUTPUT, processor_id, 2);
+    ASSERT_EQ(0, id);
+    ASSERT_TRUE(recorder->arm(id, "./test_engine_recording.wav"));
+
+    /* A stop requested while running is never acknowledged once the processor is gone */
+    ASSERT_TRUE(recorder->disarm(id, true));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track("main", "gain"));
+    auto tap = recorder->tap(id);
+    for (int i = 0; i < 100 && tap->_state.load() != RecordState::IDLE; ++i)
+    {
+        std::this_thread::sleep_for(RECORDER_WRITE_INTERVAL);
+    }
+    ASSERT_EQ(RecordState::IDLE, tap->_state.load());
+    EXPECT_TRUE(recorder->arm(id, "./test_engine_recording.wav"));
+    EXPECT_TRUE(recorder->disarm(id, false));
+    std::remove("./test_engine_recording.wav");
+}
+
 
 TEST_F(TestEngine, TestUidNameMapping)
 {
@@ -364,8 +418,8 @@ TEST_F(TestEngine, TestSetCvChannels)
     EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->set_cv_input_channels(2));
     EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->set_cv_output_channels(2));
     // Set too many or route to non-existing inputs/processors
-    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->set_cv_input_channels(20));
-    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->set_cv_output_channels(20));
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->set_cv_input_channels(MAX_ENGINE_CV_IO_PORTS + 1));
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->set_cv_output_channels(MAX_ENGINE_CV_IO_PORTS + 1));
 
     EXPECT_NE(EngineReturnStatus::OK, _module_under_test->connect_cv_to_parameter("proc", "param", 1));
     EXPECT_NE(EngineReturnStatus::OK, _module_under_test->connect_cv_from_parameter("proc", "param", 1));
@@ -407,6 +461,60 @@ TEST_F(TestEngine, TestCvRouting)
     // We should have a non-zero value in this slot
     ASSERT_NE(0.0f, out_controls.cv_values[1]);
 }
+
+TEST_F(TestEngine, TestAudioRateCvRouting)
+{
+    _module_under_test->enable_audio_rate_cv(true);
+    _module_under_test->create_track("gain_track", 2);
+    auto status = _module_under_test->connect_audio_input_bus(0, 0, "gain_track");
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    status = _module_under_test->connect_audio_output_bus(0, 0, "gain_track");
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    status = _module_under_test->add_plugin_to_track("gain_track", "sushi.testing.gain",
+                                                     "gain", "", PluginType::INTERNAL);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    _module_under_test->create_track("lfo_track", 0);
+    status = _module_under_test->add_plugin_to_track("lfo_track", "sushi.testing.lfo",
+                                                     "lfo", "", PluginType::INTERNAL);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_cv_input_channels(1));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_cv_output_channels(1));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_cv_to_parameter("gain", "gain", 0));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_cv_from_parameter("lfo", "out", 0));
+
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(TEST_CHANNEL_COUNT);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer in_controls;
+    ControlBuffer out_controls;
+    test_utils::fill_sample_buffer(in_buffer, 1.0f);
+
+    /* A gain step in the middle of the chunk, 0 dB followed by 6 dB */
+    auto& cv = in_controls.cv_samples[0];
+    std::fill(cv.begin(), cv.begin() + AUDIO_CHUNK_SIZE / 2, 0.0f);
+    std::fill(cv.begin() + AUDIO_CHUNK_SIZE / 2, cv.end(), 6.0f);
+    in_controls.cv_values[0] = cv.back();
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &in_controls, &out_controls);
+
+    EXPECT_NEAR(1.0f, out_buffer.channel(0)[0], test_utils::DECIBEL_ERROR);
+    EXPECT_NEAR(1.0f, out_buffer.channel(1)[AUDIO_CHUNK_SIZE / 2 - 1], test_utils::DECIBEL_ERROR);
+    EXPECT_NEAR(2.0f, out_buffer.channel(0)[AUDIO_CHUNK_SIZE / 2], test_utils::DECIBEL_ERROR);
+    EXPECT_NEAR(2.0f, out_buffer.channel(1)[AUDIO_CHUNK_SIZE - 1], test_utils::DECIBEL_ERROR);
+
+    /* Cv outputs should be held for the entire chunk */
+    ASSERT_NE(0.0f, out_controls.cv_values[0]);
+    for (auto value : out_controls.cv_samples[0])
+    {
+        ASSERT_FLOAT_EQ(out_controls.cv_values[0], value);
+    }
+
+    /* Modulation only applies to the chunk it was passed with */
+    auto gain = _module_under_test->mutable_processor(_module_under_test->processor_id_from_name("gain").second);
+    ASSERT_TRUE(gain);
+    test_utils::fill_sample_buffer(out_buffer, 0.0f);
+    gain->process_audio(in_buffer, out_buffer);
+    test_utils::assert_buffer_value(2.0f, out_buffer, test_utils::DECIBEL_ERROR);
+}
 TEST_F(TestEngine, TestGateRouting)
 {
     /* Build a cv/gate to midi to cv/gate chain and verify gate changes travel through it*/
@@ -446,5 +554,163 @@ TEST_F(TestEngine, TestGateRouting)
     _module_under_test->process_chunk(&in_buffer, &out_buffer, &in_controls, &out_controls);
     // A gate high event on gate input 1 should result in a gate high on gate output 0
     ASSERT_TRUE(out_controls.gate_values[0]);
-    ASSERT_EQ(1u, out_controls.gate_values.count());
-}
\ No newline at end of file
+    ASSERT_EQ(1, out_controls.gate_values.count());
+}
+
+TEST_F(TestEngine, TestSetGateChannels)
+{
+    EXPECT_EQ(DEFAULT_ENGINE_GATE_PORTS, _module_under_test->gate_input_channels());
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->set_gate_input_channels(MAX_ENGINE_GATE_PORTS + 1));
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->set_gate_output_channels(-1));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_gate_input_channels(32));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_gate_output_channels(40));
+    EXPECT_EQ(32, _module_under_test->gate_input_channels());
+    EXPECT_EQ(40, _module_under_test->gate_output_channels());
+
+    /* Route a gate beyond the default port count through a cv/gate to midi to cv/gate chain */
+    _module_under_test->create_track("cv", 0);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track("cv", "sushi.testing.cv_to_control",
+                                                                              "cv_ctrl", "", PluginType::INTERNAL));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track("cv", "sushi.testing.control_to_cv",
+                                                                              "ctrl_cv", "", PluginType::INTERNAL));
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->connect_gate_to_processor("cv_ctrl", 32, 0, 0));
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->connect_gate_from_processor("ctrl_cv", 40, 0, 0));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_gate_to_processor("cv_ctrl", 20, 0, 0));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_gate_from_processor("ctrl_cv", 35, 0, 0));
+
+    ChunkSampleBuffer in_buffer(1);
+    ChunkSampleBuffer out_buffer(1);
+    ControlBuffer in_controls(0, 32);
+    ControlBuffer out_controls(0, 40);
+    in_controls.gate_values[20] = true;
+
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &in_controls, &out_controls);
+    ASSERT_TRUE(out_controls.gate_values[35]);
+    ASSERT_EQ(1, out_controls.gate_values.count());
+
+    in_controls.gate_values[20] = false;
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &in_controls, &out_controls);
+    ASSERT_TRUE(out_controls.gate_values.none());
+}
+
+TEST_F(TestEngine, TestGateSyncInput)
+{
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->connect_gate_to_sync(MAX_ENGINE_GATE_PORTS, 4));
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->connect_gate_to_sync(0, 0));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_cv_input_channels(1));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_gate_to_sync(0, 4));
+    _module_under_test->_transport.set_sync_mode(SyncMode::GATE_INPUT);
+
+    ChunkSampleBuffer in_buffer(TEST_CHANNEL_COUNT);
+    ChunkSampleBuffer out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer in_controls;
+    ControlBuffer out_controls;
+
+    /* Send 4 pulses per quarter note at 90 bpm for 4 beats */
+    double pulse_length = 60.0 * SAMPLE_RATE / (90.0 * 4);
+    for (int64_t samples = 0; samples < 4 * 4 * pulse_length; samples += AUDIO_CHUNK_SIZE)
+    {
+        in_controls.gate_values[0] = std::fmod(static_cast<double>(samples), pulse_length) < pulse_length / 2;
+        _module_under_test->update_time(Time(samples * 1'000'000 / SAMPLE_RATE), samples);
+        _module_under_test->process_chunk(&in_buffer, &out_buffer, &in_controls, &out_controls);
+    }
+    /* Pulses are only detected with chunk resolution */
+    EXPECT_NEAR(90.0f, _module_under_test->_transport.current_tempo(), 1.0f);
+}
+
+TEST_F(TestEngine, TestSyncOutputs)
+{
+    EXPECT_NE(EngineReturnStatus::OK, _module_under_test->connect_sync_to_gate(-1, 1));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_sync_to_gate(1, 1));
+    _module_under_test->enable_midi_clock_output(true);
+    /* Otherwise the dispatcher thread would consume some of the clock events */
+    _module_under_test->_event_dispatcher.stop();
+
+    ChunkSampleBuffer in_buffer(TEST_CHANNEL_COUNT);
+    ChunkSampleBuffer out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer in_controls;
+    ControlBuffer out_controls;
+    int gate_pulses = 0;
+    int clock_ticks = 0;
+    int start_messages = 0;
+    bool prev_gate = false;
+    int64_t last_tick_sample = -1;
+
+    /* Run for 2 seconds, i.e. 4 beats at the default tempo */
+    for (int64_t samples = 0; samples < 2 * SAMPLE_RATE; samples += AUDIO_CHUNK_SIZE)
+    {
+        _module_under_test->update_time(Time(samples * 1'000'000 / SAMPLE_RATE), samples);
+        _module_under_test->process_chunk(&in_buffer, &out_buffer, &in_controls, &out_controls);
+        if (out_controls.gate_values[1] && prev_gate == false)
+        {
+            gate_pulses++;
+        }
+        prev_gate = out_controls.gate_values[1];
+
+        RtEvent event;
+        while (_module_under_test->_main_out_queue.pop(event))
+        {
+            if (event.type() == RtEventType::WRAPPED_MIDI_EVENT &&
+                event.wrapped_midi_event()->processor_id() == MIDI_CLOCK_SOURCE_ID)
+            {
+                auto data = event.wrapped_midi_event()->midi_data();
+                if (data[0] == 0xF8)
+                {
+                    /* Ticks should be evenly spaced within a sample */
+                    int64_t tick_sample = samples + event.sample_offset();
+                    if (last_tick_sample >= 0)
+                    {
+                        EXPECT_NEAR(SAMPLE_RATE / 48.0, tick_sample - last_tick_sample, 1.0);
+                    }
+                    last_tick_sample = tick_sample;
+                    clock_ticks++;
+                }
+                else if (data[0] == 0xFA)
+                {
+                    start_messages++;
+                }
+            }
+        }
+    }
+    EXPECT_EQ(1, start_messages);
+    EXPECT_NEAR(4 * midi::CLOCK_TICKS_PER_QUARTER_NOTE, clock_ticks, 1);
+    EXPECT_NEAR(4, gate_pulses, 1);
+}
+
+TEST_F(TestEngine, TestPropertyPayloadRelease)
+{
+    _module_under_test->create_track("test_track", 2);
+    auto [status, track_id] = _module_under_test->processor_id_from_name("test_track");
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    /* Otherwise the dispatcher thread would consume the delete events */
+    _module_under_test->_event_dispatcher.stop();
+
+    RtTransferRing ring(256);
+    auto string_event = StringPropertyChangeEvent(track_id, 0, "sample.wav", IMMEDIATE_PROCESS);
+    ASSERT_TRUE(_module_under_test->_main_in_queue.push(string_event.to_rt_event_in_ring(0, ring)));
+    auto blob_event = DataPropertyChangeEvent(track_id, 0, {3, new uint8_t[3]{1, 2, 3}}, IMMEDIATE_PROCESS);
+    ASSERT_TRUE(_module_under_test->_main_in_queue.push(blob_event.to_rt_event(0)));
+
+    ChunkSampleBuffer in_buffer(TEST_CHANNEL_COUNT);
+    ChunkSampleBuffer out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer control_buffer;
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer);
+
+    /* The string was released to the ring, so its room can be reused */
+    ASSERT_NE(nullptr, ring.allocate(0));
+    EXPECT_EQ(16, ring.used_bytes());
+
+    /* While the heap allocated blob is returned for deletion outside the rt thread */
+    int delete_events = 0;
+    RtEvent event;
+    while (_module_under_test->_main_out_queue.pop(event))
+    {
+        if (event.type() == RtEventType::BLOB_DELETE)
+        {
+            EXPECT_EQ(3, event.data_payload_event()->value().size);
+            delete[] event.data_payload_event()->value().data;
+            delete_events++;
+        }
+    }
+    EXPECT_EQ(1, delete_events);
+}
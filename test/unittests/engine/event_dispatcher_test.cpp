@@ -1,3 +1,6 @@
+#include <deque>
+#include <future>
+
 #include "gtest/gtest.h"
 
 #include "test_utils/test_utils.h"
@@ -35,9 +38,14 @@ public:
     int process(Event* /*event*/) override
     {
         _received = true;
+        _received_count++;
         return 100;
     };
 
+    void flush() override {_flush_count++;}
+
+    void process_deferred_input() override {_deferred_input_count++;}
+
     int poster_id() override {return DUMMY_POSTER_ID;}
 
     bool event_received()
@@ -50,8 +58,18 @@ public:
         return false;
     }
 
+    int received_count()
+    {
+        int count = _received_count;
+        _received_count = 0;
+        return count;
+    }
+
 private:
     bool _received{false};
+    int  _received_count{0};
+    int  _flush_count{0};
+    int  _deferred_input_count{0};
 };
 
 class TestEventDispatcher : public ::testing::Test
@@ -150,6 +168,20 @@ TEST_F(TestEventDispatcher, TestFromRtEventNoteOnEvent)
     ASSERT_TRUE(_poster.event_received());
 }
 
+TEST_F(TestEventDispatcher, TestKeyboardListenerHooks)
+{
+    _module_under_test->subscribe_to_keyboard_events(&_poster);
+    crank_event_loop_once();
+    /* Deferred input is picked up every iteration, output only flushed after events */
+    EXPECT_EQ(1, _poster._deferred_input_count);
+    EXPECT_EQ(0, _poster._flush_count);
+
+    _in_rt_queue.push(RtEvent::make_note_on_event(10, 0, 0, 50, 10.f));
+    crank_event_loop_once();
+    EXPECT_EQ(2, _poster._deferred_input_count);
+    EXPECT_EQ(1, _poster._flush_count);
+}
+
 TEST_F(TestEventDispatcher, TestFromRtEventParameterChangeNotification)
 {
     RtEvent rt_event = RtEvent::make_parameter_change_event(10, 0, 10, 5.f);
@@ -203,6 +235,183 @@ TEST_F(TestEventDispatcher, TestAsyncCallbackFromProcessor)
     EXPECT_EQ(123u, typed_event->processor_id());
 }
 
+TEST_F(TestEventDispatcher, TestQueueingOfFutureEvents)
+{
+    using namespace std::chrono_literals;
+    _module_under_test->set_time(1s);
+    /* Post events out of order, they should come out in timestamp order
+     * and events with equal timestamps in the order they were posted */
+    auto late_event = new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 3, 0.3f, 3s);
+    auto early_event = new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 1, 0.1f, 2s);
+    auto second_early_event = new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 2, 0.2f, 2s);
+    _module_under_test->post_event(late_event);
+    _module_under_test->post_event(early_event);
+    _module_under_test->post_event(second_early_event);
+    crank_event_loop_once();
+
+    ASSERT_TRUE(_out_rt_queue.empty());
+    ASSERT_EQ(3u, _module_under_test->_waiting_list.size());
+
+    /* Advance time so that the first 2 events are due */
+    _module_under_test->set_time(2s);
+    crank_event_loop_once();
+    RtEvent rt_event;
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(1u, rt_event.parameter_change_event()->param_id());
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(2u, rt_event.parameter_change_event()->param_id());
+    ASSERT_TRUE(_out_rt_queue.empty());
+    ASSERT_EQ(1u, _module_under_test->_waiting_list.size());
+
+    _module_under_test->set_time(3s);
+    crank_event_loop_once();
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(3u, rt_event.parameter_change_event()->param_id());
+    ASSERT_TRUE(_module_under_test->_waiting_list.empty());
+}
+
+TEST_F(TestEventDispatcher, TestParameterChangeCoalescing)
+{
+    int completed_count = 0;
+    auto count_callback = [](void* arg, Event* /*event*/, int status)
+    {
+        EXPECT_EQ(EventStatus::HANDLED_OK, status);
+        (*static_cast<int*>(arg))++;
+    };
+    for (int i = 0; i < 10; ++i)
+    {
+        auto event = new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 2,
+                                              static_cast<float>(i), IMMEDIATE_PROCESS);
+        event->set_completion_cb(count_callback, &completed_count);
+        _module_under_test->post_event(event);
+    }
+    auto other_event = new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 3,
+                                                0.5f, IMMEDIATE_PROCESS);
+    _module_under_test->post_event(other_event);
+    crank_event_loop_once();
+
+    /* All events should be completed, but only the last value of each parameter sent */
+    EXPECT_EQ(10, completed_count);
+    RtEvent rt_event;
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(2u, rt_event.parameter_change_event()->param_id());
+    EXPECT_FLOAT_EQ(9.0f, rt_event.parameter_change_event()->value());
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(3u, rt_event.parameter_change_event()->param_id());
+    EXPECT_FLOAT_EQ(0.5f, rt_event.parameter_change_event()->value());
+    ASSERT_TRUE(_out_rt_queue.empty());
+}
+
+TEST_F(TestEventDispatcher, TestCoalescingKeepsEventOrder)
+{
+    _module_under_test->post_event(new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 3,
+                                                            0.5f, IMMEDIATE_PROCESS));
+    _module_under_test->post_event(new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 2,
+                                                            0.1f, IMMEDIATE_PROCESS));
+    _module_under_test->post_event(new KeyboardEvent(KeyboardEvent::Subtype::NOTE_ON, 1, 0, 48, 1.0f, IMMEDIATE_PROCESS));
+    _module_under_test->post_event(new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 2,
+                                                            0.2f, IMMEDIATE_PROCESS));
+    crank_event_loop_once();
+
+    /* The last value of a parameter is sent in the position it was posted */
+    RtEvent rt_event;
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(3u, rt_event.parameter_change_event()->param_id());
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(RtEventType::NOTE_ON, rt_event.type());
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(2u, rt_event.parameter_change_event()->param_id());
+    EXPECT_FLOAT_EQ(0.2f, rt_event.parameter_change_event()->value());
+    ASSERT_TRUE(_out_rt_queue.empty());
+}
+
+TEST_F(TestEventDispatcher, TestWaitingParameterChangeReplaced)
+{
+    int completed_count = 0;
+    auto count_callback = [](void* arg, Event* /*event*/, int /*status*/)
+    {
+        (*static_cast<int*>(arg))++;
+    };
+    /* Fill up the rt queue so that parameter changes have to wait */
+    while (_out_rt_queue.full() == false)
+    {
+        _out_rt_queue.push(RtEvent::make_note_on_event(1, 0, 0, 48, 1.0f));
+    }
+    auto stale_event = new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 2,
+                                                0.1f, IMMEDIATE_PROCESS);
+    stale_event->set_completion_cb(count_callback, &completed_count);
+    _module_under_test->post_event(stale_event);
+    crank_event_loop_once();
+    ASSERT_EQ(1u, _module_under_test->_waiting_list.size());
+    ASSERT_EQ(1u, _module_under_test->_waiting_parameter_changes.size());
+
+    /* Newer values are written to the waiting slot instead of being queued */
+    for (float value : {0.2f, 0.3f})
+    {
+        auto new_event = new ParameterChangeEvent(ParameterChangeEvent::Subtype::FLOAT_PARAMETER_CHANGE, 1, 2,
+                                                  value, IMMEDIATE_PROCESS);
+        new_event->set_completion_cb(count_callback, &completed_count);
+        _module_under_test->post_event(new_event);
+    }
+    crank_event_loop_once();
+    EXPECT_EQ(2, completed_count);
+    EXPECT_EQ(1u, _module_under_test->_waiting_list.size());
+
+    /* Only the newest value should be sent once there is room */
+    RtEvent rt_event;
+    while (_out_rt_queue.pop(rt_event)) {}
+    crank_event_loop_once();
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    EXPECT_EQ(2u, rt_event.parameter_change_event()->param_id());
+    EXPECT_FLOAT_EQ(0.3f, rt_event.parameter_change_event()->value());
+    ASSERT_TRUE(_out_rt_queue.empty());
+    EXPECT_TRUE(_module_under_test->_waiting_list.empty());
+    EXPECT_TRUE(_module_under_test->_waiting_parameter_changes.empty());
+    EXPECT_EQ(3, completed_count);
+}
+
+TEST_F(TestEventDispatcher, TestPayloadInTransferRing)
+{
+    _module_under_test->post_event(new ParameterBatchChangeEvent(1, {{2, 0.5f}, {3, 0.25f}}, IMMEDIATE_PROCESS));
+    crank_event_loop_once();
+
+    RtEvent rt_event;
+    ASSERT_TRUE(_out_rt_queue.pop(rt_event));
+    auto typed_event = rt_event.parameter_batch_event();
+    ASSERT_TRUE(typed_event->in_transfer_ring());
+    ASSERT_EQ(2, typed_event->count());
+    EXPECT_FLOAT_EQ(0.25f, typed_event->values()[1].value);
+    EXPECT_GT(_module_under_test->_transfer_ring.used_bytes(), 0);
+}
+
+TEST_F(TestEventDispatcher, TestParameterNotificationCoalescing)
+{
+    for (int i = 0; i < 10; ++i)
+    {
+        _in_rt_queue.push(RtEvent::make_parameter_change_event(10, 0, 10, static_cast<float>(i)));
+    }
+    _in_rt_queue.push(RtEvent::make_parameter_change_event(10, 0, 11, 1.0f));
+
+    _module_under_test->subscribe_to_parameter_change_notifications(&_poster);
+    crank_event_loop_once();
+
+    EXPECT_EQ(2, _poster.received_count());
+}
+
+/* Argument to the recording callback, the fixture keeps track of execution order */
+struct RecordedWork
+{
+    std::vector<int>* execution_order;
+    int               value;
+};
+
+int recording_processor_callback(void* arg, EventId /*id*/)
+{
+    auto work = static_cast<RecordedWork*>(arg);
+    work->execution_order->push_back(work->value);
+    return 0;
+}
+
 class TestWorker : public ::testing::Test
 {
 public:
@@ -211,6 +420,29 @@ public:
         _module_under_test->_running = false;
         _module_under_test->_worker();
     }
+
+    /* Pick the next task as a worker thread would, without executing it */
+    bool next_task(Worker::Task& task)
+    {
+        std::lock_guard<std::mutex> lock(_module_under_test->_queue_lock);
+        return _module_under_test->_next_task(task);
+    }
+
+    void run_task(const Worker::Task& task)
+    {
+        _module_under_test->_execute(task.event);
+        std::lock_guard<std::mutex> lock(_module_under_test->_queue_lock);
+        _module_under_test->_finish_task(task);
+    }
+
+    void post_work(int value, ObjectId processor, WorkPriority priority)
+    {
+        _recorded_work.push_back({&_execution_order, value});
+        _module_under_test->process(new AsynchronousProcessorWorkEvent(recording_processor_callback,
+                                                                       &_recorded_work.back(), processor, 0,
+                                                                       IMMEDIATE_PROCESS, priority));
+    }
+
 protected:
     TestWorker()
     {
@@ -229,6 +461,9 @@ protected:
     }
     Worker*          _module_under_test;
     EngineMockup     _test_engine{44100};
+    std::vector<int> _execution_order;
+    /* Deque so that posted work keeps valid pointers to its arguments */
+    std::deque<RecordedWork> _recorded_work;
 };
 
 TEST_F(TestWorker, TestEventQueueingAndProcessing)
@@ -244,3 +479,154 @@ TEST_F(TestWorker, TestEventQueueingAndProcessing)
     ASSERT_TRUE(completed);
     ASSERT_EQ(EventStatus::HANDLED_OK, completion_status);
 }
+
+TEST_F(TestWorker, TestPriorityScheduling)
+{
+    int low = 1;
+    int high = 2;
+    int normal = 3;
+    post_work(low, 10, WorkPriority::LOW);
+    post_work(high, 11, WorkPriority::HIGH);
+    post_work(normal, 12, WorkPriority::NORMAL);
+    auto stats = _module_under_test->statistics();
+    EXPECT_EQ(1, stats.queue_depth[static_cast<int>(WorkPriority::HIGH)]);
+    EXPECT_EQ(1, stats.max_queue_depth[static_cast<int>(WorkPriority::LOW)]);
+
+    crank_event_loop_once();
+    ASSERT_EQ(std::vector<int>({high, normal, low}), _execution_order);
+    stats = _module_under_test->statistics();
+    EXPECT_EQ(0, stats.queue_depth[static_cast<int>(WorkPriority::HIGH)]);
+    EXPECT_EQ(3u, stats.completed);
+}
+
+TEST_F(TestWorker, TestPerProcessorOrdering)
+{
+    int first = 1;
+    int second = 2;
+    int other = 3;
+    /* Work for the same processor must run in posting order regardless of priority */
+    post_work(first, 10, WorkPriority::LOW);
+    post_work(second, 10, WorkPriority::HIGH);
+    post_work(other, 11, WorkPriority::NORMAL);
+    crank_event_loop_once();
+    ASSERT_EQ(std::vector<int>({other, first, second}), _execution_order);
+}
+
+TEST_F(TestWorker, TestExclusiveEvents)
+{
+    int before = 1;
+    int after = 2;
+    completed = false;
+    post_work(before, 10, WorkPriority::LOW);
+    auto event = new RemoveProcessorEvent("plugin", "track", IMMEDIATE_PROCESS);
+    event->set_completion_cb(dummy_callback, nullptr);
+    _module_under_test->process(event);
+    post_work(after, 11, WorkPriority::HIGH);
+
+    /* Simulate the low priority work being executed by another worker */
+    Worker::Task task;
+    ASSERT_TRUE(next_task(task));
+    EXPECT_EQ(WorkPriority::LOW, task.priority);
+    Worker::Task blocked;
+    EXPECT_FALSE(next_task(blocked));
+    run_task(task);
+
+    crank_event_loop_once();
+    ASSERT_TRUE(completed);
+    ASSERT_EQ(std::vector<int>({before, after}), _execution_order);
+}
+
+TEST_F(TestWorker, TestEngineEventsOrderedWithTheirProcessor)
+{
+    int before = 1;
+    int other = 2;
+    int after = 3;
+    completed = false;
+    post_work(before, 10, WorkPriority::HIGH);
+    auto event = new ProgramChangeEvent(10, 1, IMMEDIATE_PROCESS);
+    event->set_completion_cb(dummy_callback, nullptr);
+    _module_under_test->process(event);
+    post_work(other, 11, WorkPriority::HIGH);
+    post_work(after, 10, WorkPriority::HIGH);
+
+    /* While work for processor 10 is running, the program change for it must wait and
+     * so must work for processor 10 posted after it, work for processor 11 can run */
+    Worker::Task task;
+    ASSERT_TRUE(next_task(task));
+    EXPECT_EQ(10u, task.ordering_key);
+    Worker::Task unrelated;
+    ASSERT_TRUE(next_task(unrelated));
+    EXPECT_EQ(11u, unrelated.ordering_key);
+    Worker::Task blocked;
+    EXPECT_FALSE(next_task(blocked));
+    run_task(task);
+    run_task(unrelated);
+
+    /* And work for processor 10 can't start while the program change is running */
+    ASSERT_TRUE(next_task(task));
+    EXPECT_EQ(ENGINE_ORDERING_KEY, task.ordering_key);
+    EXPECT_EQ(10u, task.processor_key);
+    EXPECT_FALSE(next_task(blocked));
+    run_task(task);
+    ASSERT_TRUE(completed);
+
+    crank_event_loop_once();
+    ASSERT_EQ(std::vector<int>({before, other, after}), _execution_order);
+}
+
+/* Stands in for a sample load, blocks until the plugin has been added or a timeout */
+class LongRunningWork : public AsynchronousWorkEvent
+{
+public:
+    LongRunningWork(ObjectId processor, std::future<void> plugin_added) : AsynchronousWorkEvent(IMMEDIATE_PROCESS),
+                                                                           _processor(processor),
+                                                                           _plugin_added(std::move(plugin_added)) {}
+
+    std::optional<ObjectId> ordering_processor() override {return _processor;}
+
+    Event* execute() override
+    {
+        finished_concurrently = _plugin_added.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+        return nullptr;
+    }
+
+    bool finished_concurrently{false};
+
+private:
+    ObjectId _processor;
+    std::future<void> _plugin_added;
+};
+
+void signal_plugin_added(void* arg, Event* /*event*/, int /*status*/)
+{
+    static_cast<std::promise<void>*>(arg)->set_value();
+}
+
+void signal_work_done(void* arg, Event* event, int /*status*/)
+{
+    auto work = static_cast<LongRunningWork*>(event);
+    static_cast<std::promise<bool>*>(arg)->set_value(work->finished_concurrently);
+}
+
+TEST_F(TestWorker, TestEngineEventsRunAlongsideLongWork)
+{
+    std::promise<void> plugin_added;
+    std::promise<bool> work_done;
+    auto work_result = work_done.get_future();
+
+    auto work = new LongRunningWork(10, plugin_added.get_future());
+    work->set_completion_cb(signal_work_done, &work_done);
+    _module_under_test->process(work);
+    auto event = new AddProcessorEvent("track", "sushi.testing.gain", "gain", "",
+                                       AddProcessorEvent::ProcessorType::INTERNAL, IMMEDIATE_PROCESS);
+    event->set_completion_cb(signal_plugin_added, &plugin_added);
+    _module_under_test->process(event);
+
+    /* The work only finishes in time if the plugin is added while it is running */
+    _module_under_test->run();
+    bool work_finished = work_result.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    /* Stop before the promises go out of scope */
+    _module_under_test->stop();
+    ASSERT_TRUE(work_finished);
+    EXPECT_TRUE(work_result.get());
+}
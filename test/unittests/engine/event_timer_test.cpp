@@ -51,7 +51,7 @@ TEST_F(TestEventTimer, TestToOffsetConversion)
     Time timestamp = 1s + chunk_time + chunk_time / 2;
     std::tie(send_now, offset) = _module_under_test.sample_offset_from_realtime(timestamp);
     ASSERT_TRUE(send_now);
-    ASSERT_EQ(AUDIO_CHUNK_SIZE / 2 - 1, offset);
+    ASSERT_NEAR(AUDIO_CHUNK_SIZE / 2, offset, 1);
 }
 
 TEST_F(TestEventTimer, TestToRealTimesConversion)
@@ -64,4 +64,46 @@ TEST_F(TestEventTimer, TestToRealTimesConversion)
 
     timestamp = _module_under_test.real_time_from_sample_offset(AUDIO_CHUNK_SIZE / 2);
     ASSERT_EQ((1s + chunk_time + chunk_time / 2).count(), timestamp.count());
-}
\ No newline at end of file
+}
+
+TEST_F(TestEventTimer, TestJitterFiltering)
+{
+    /* Feed the timer with timestamps that have +/- 200us alternating jitter,
+     * the filtered time should end up much closer to the ideal time */
+    const double ideal_period = 1000000.0 * AUDIO_CHUNK_SIZE / TEST_SAMPLE_RATE;
+    const double start = 1000000.0;
+    int chunks = 2000;
+    for (int i = 0; i < chunks; ++i)
+    {
+        double jitter = i % 2 == 0 ? 200.0 : -200.0;
+        _module_under_test.set_incoming_time(Time(static_cast<int64_t>(start + i * ideal_period + jitter)));
+    }
+    double ideal_next_chunk = start + chunks * ideal_period;
+    EXPECT_NEAR(ideal_next_chunk, _module_under_test._incoming_chunk_time.load().count(), 30.0);
+    EXPECT_NEAR(ideal_period, _module_under_test._chunk_period.load(), 0.5);
+}
+
+TEST_F(TestEventTimer, TestSampleRateTracking)
+{
+    /* Simulate an audio interface running 0.1% fast */
+    const float real_sample_rate = TEST_SAMPLE_RATE * 1.001f;
+    const double real_period = 1000000.0 * AUDIO_CHUNK_SIZE / real_sample_rate;
+    for (int i = 0; i < 10000; ++i)
+    {
+        _module_under_test.set_incoming_time(Time(static_cast<int64_t>(1000000.0 + i * real_period)));
+    }
+    EXPECT_NEAR(real_period, _module_under_test._chunk_period.load(), 0.1);
+
+    /* Sample offsets of outgoing events should follow the measured rate */
+    _module_under_test.set_outgoing_time(1s);
+    Time timestamp = _module_under_test.real_time_from_sample_offset(AUDIO_CHUNK_SIZE);
+    EXPECT_NEAR(1000000.0 + 2 * real_period, timestamp.count(), 2.0);
+
+    /* A large jump in time should reset the filter to the new time */
+    _module_under_test.set_incoming_time(100s);
+    auto [send_now, offset] = _module_under_test.sample_offset_from_realtime(100s);
+    EXPECT_TRUE(send_now);
+    EXPECT_EQ(0, offset);
+    std::tie(send_now, offset) = _module_under_test.sample_offset_from_realtime(100s + 2 * calc_chunk_time(TEST_SAMPLE_RATE));
+    EXPECT_FALSE(send_now);
+}
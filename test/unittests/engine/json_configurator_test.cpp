@@ -68,6 +68,14 @@ TEST_F(TestJsonConfigurator, TestLoadAudioConfig)
     ASSERT_EQ(1, audio_config.cv_inputs.value());
     ASSERT_TRUE(audio_config.cv_outputs.has_value());
     ASSERT_EQ(2, audio_config.cv_outputs.value());
+    ASSERT_TRUE(audio_config.gate_inputs.has_value());
+    ASSERT_EQ(2, audio_config.gate_inputs.value());
+    ASSERT_TRUE(audio_config.gate_outputs.has_value());
+    ASSERT_EQ(1, audio_config.gate_outputs.value());
+    ASSERT_TRUE(audio_config.midi_inputs.has_value());
+    ASSERT_EQ(4, audio_config.midi_inputs.value());
+    ASSERT_TRUE(audio_config.midi_outputs.has_value());
+    ASSERT_EQ(2, audio_config.midi_outputs.value());
 }
 
 TEST_F(TestJsonConfigurator, TestLoadHostConfig)
@@ -111,10 +119,15 @@ TEST_F(TestJsonConfigurator, TestLoadMidi)
 
     status = _module_under_test->load_midi();
     ASSERT_EQ(JsonConfigReturnStatus::OK, status);
-    ASSERT_EQ(1u, _midi_dispatcher->_kb_routes_in.size());
-    ASSERT_EQ(1u, _midi_dispatcher->_cc_routes.size());
-    ASSERT_EQ(1u, _midi_dispatcher->_raw_routes_in.size());
-    ASSERT_EQ(1u, _midi_dispatcher->_pc_routes.size());
+    auto routes = [&](midi_dispatcher::RouteType type)
+    {
+        const auto& input_routes = _midi_dispatcher->_input_routes;
+        return std::count_if(input_routes.begin(), input_routes.end(), [&](const auto& r) {return r.type == type;});
+    };
+    ASSERT_EQ(1, routes(midi_dispatcher::RouteType::KEYBOARD));
+    ASSERT_EQ(1, routes(midi_dispatcher::RouteType::CONTROL_CHANGE));
+    ASSERT_EQ(1, routes(midi_dispatcher::RouteType::RAW_MIDI));
+    ASSERT_EQ(1, routes(midi_dispatcher::RouteType::PROGRAM_CHANGE));
 }
 
 TEST_F(TestJsonConfigurator, TestLoadCvGateControl)
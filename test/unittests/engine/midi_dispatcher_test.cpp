@@ -1,3 +1,5 @@
+#include <thread>
+
 #include "gtest/gtest.h"
 
 #include "test_utils/engine_mockup.h"
@@ -24,6 +26,20 @@ public:
     {
         _sent = true;
     }
+    void flush() override
+    {
+        _flushed = true;
+    }
+    void process_deferred_input() override
+    {
+        _deferred_input_processed = true;
+    }
+    bool flushed()
+    {
+        bool flushed = _flushed;
+        _flushed = false;
+        return flushed;
+    }
     bool midi_sent()
     {
         if (_sent)
@@ -35,6 +51,8 @@ public:
     }
     private:
     bool _sent{false};
+    bool _flushed{false};
+    bool _deferred_input_processed{false};
 };
 
 const MidiDataByte TEST_NOTE_ON_MSG   = {0x92, 62, 55, 0}; /* Channel 2 */
@@ -44,6 +62,9 @@ const MidiDataByte TEST_CTRL_CH_MSG_2 = {0xB5, 40, 75, 0}; /* Channel 5, cc 40 *
 const MidiDataByte TEST_CTRL_CH_MSG_3 = {0xB5, 39, 75, 0}; /* Channel 5, cc 39 */
 const MidiDataByte TEST_PRG_CH_MSG   =  {0xC5, 40, 0, 0};  /* Channel 5, prg 40 */
 const MidiDataByte TEST_PRG_CH_MSG_2  = {0xC4, 45, 0, 0};  /* Channel 4, prg 45 */
+const MidiDataByte TEST_CLOCK_MSG     = {0xF8, 0, 0, 0};
+const MidiDataByte TEST_START_MSG     = {0xFA, 0, 0, 0};
+const MidiDataByte TEST_STOP_MSG      = {0xFC, 0, 0, 0};
 
 
 TEST(TestMidiDispatcherEventCreation, TestMakeNoteOnEvent)
@@ -184,6 +205,92 @@ TEST_F(TestMidiDispatcher, TestKeyboardDataConnection)
     EXPECT_FALSE(_test_dispatcher->got_event());
 }
 
+TEST_F(TestMidiDispatcher, TestInputFastPath)
+{
+    _module_under_test.set_midi_inputs(5);
+    _module_under_test.connect_kb_to_track(1, "processor");
+    _module_under_test.connect_cc_to_parameter(1, "processor", "parameter", 67, 0, 100, false);
+
+    /* Events due in the next chunk should go straight to the engine */
+    _test_dispatcher->events_due_now = true;
+    _module_under_test.send_midi(1, TEST_NOTE_ON_MSG, IMMEDIATE_PROCESS);
+    EXPECT_TRUE(_test_engine.got_input_event);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+
+    _test_engine.got_input_event = false;
+    _module_under_test.send_midi(1, TEST_CTRL_CH_MSG, IMMEDIATE_PROCESS);
+    EXPECT_TRUE(_test_engine.got_input_event);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+
+    /* Later events still go through the event dispatcher */
+    _test_engine.got_input_event = false;
+    _test_dispatcher->events_due_now = false;
+    _module_under_test.send_midi(1, TEST_NOTE_ON_MSG, IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_engine.got_input_event);
+    EXPECT_TRUE(_test_dispatcher->got_event());
+}
+
+TEST_F(TestMidiDispatcher, TestInputFastPathOrdering)
+{
+    _module_under_test.set_midi_inputs(5);
+    _module_under_test.connect_kb_to_track(1, "processor");
+    _test_dispatcher->events_due_now = true;
+
+    /* An event that doesn't fit in the direct lane falls back to the event dispatcher */
+    _test_engine.input_queue_full = true;
+    _module_under_test.send_midi(1, TEST_NOTE_ON_MSG, IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_engine.got_input_event);
+    auto first_event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(first_event);
+
+    /* Later events must follow it until it has been delivered, even if there is room again */
+    _test_engine.input_queue_full = false;
+    _module_under_test.send_midi(1, TEST_NOTE_OFF_MSG, IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_engine.got_input_event);
+    auto second_event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(second_event);
+
+    /* Direct sending resumes once all of them have been delivered */
+    first_event->completion_cb()(first_event->callback_arg(), first_event.get(), EventStatus::HANDLED_OK);
+    _module_under_test.send_midi(1, TEST_NOTE_OFF_MSG, IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_engine.got_input_event);
+    auto third_event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(third_event);
+    second_event->completion_cb()(second_event->callback_arg(), second_event.get(), EventStatus::HANDLED_OK);
+    third_event->completion_cb()(third_event->callback_arg(), third_event.get(), EventStatus::HANDLED_OK);
+    _module_under_test.send_midi(1, TEST_NOTE_ON_MSG, IMMEDIATE_PROCESS);
+    EXPECT_TRUE(_test_engine.got_input_event);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+}
+
+TEST_F(TestMidiDispatcher, TestSendMidiFromRtThread)
+{
+    _module_under_test.set_midi_inputs(5);
+    _module_under_test.connect_kb_to_track(1, "processor");
+    _module_under_test.connect_pc_to_processor(1, "processor");
+
+    EXPECT_TRUE(_module_under_test.send_midi_rt(1, TEST_NOTE_ON_MSG, 10));
+    EXPECT_TRUE(_test_engine.got_input_event);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+
+    /* Program changes need to be deferred to a non rt thread */
+    _test_engine.got_input_event = false;
+    EXPECT_FALSE(_module_under_test.send_midi_rt(1, TEST_PRG_CH_MSG, 10));
+    EXPECT_FALSE(_test_engine.got_input_event);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+
+    /* Deferred messages must never be sent directly to the engine, as the rt
+     * thread is the producer of its input lane */
+    _module_under_test.connect_raw_midi_to_track(1, "processor");
+    _test_dispatcher->events_due_now = true;
+    _module_under_test.send_deferred_midi(1, TEST_PRG_CH_MSG, IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_engine.got_input_event);
+    EXPECT_TRUE(_test_dispatcher->got_event());
+
+    _module_under_test.process_deferred_input();
+    EXPECT_TRUE(_test_frontend._deferred_input_processed);
+}
+
 TEST_F(TestMidiDispatcher, TestKeyboardDataOutConnection)
 {
     KeyboardEvent event(KeyboardEvent::Subtype::NOTE_ON, 0, 12, 48, 0.5f, IMMEDIATE_PROCESS);
@@ -199,6 +306,79 @@ TEST_F(TestMidiDispatcher, TestKeyboardDataOutConnection)
     ASSERT_EQ(MidiDispatcherStatus::OK, ret);
 }
 
+TEST_F(TestMidiDispatcher, TestFlushOutput)
+{
+    KeyboardEvent event(KeyboardEvent::Subtype::NOTE_ON, 0, 12, 48, 0.5f, IMMEDIATE_PROCESS);
+    _module_under_test.set_midi_outputs(1);
+    ASSERT_EQ(MidiDispatcherStatus::OK, _module_under_test.connect_track_to_output(0, "processor", 5));
+
+    _module_under_test.process(&event);
+    _module_under_test.process(&event);
+    EXPECT_TRUE(_test_frontend.midi_sent());
+    EXPECT_FALSE(_test_frontend.flushed());
+
+    /* Buffered output is only sent once per batch */
+    _module_under_test.flush();
+    EXPECT_TRUE(_test_frontend.flushed());
+}
+
+TEST_F(TestMidiDispatcher, TestMidiClockInput)
+{
+    _module_under_test.set_midi_inputs(1);
+    constexpr auto PERIOD = std::chrono::microseconds(60'000'000 / (100 * midi::CLOCK_TICKS_PER_QUARTER_NOTE));
+
+    /* Clock messages are ignored unless synced to midi */
+    _module_under_test.send_midi(0, TEST_START_MSG, IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+    EXPECT_FALSE(_module_under_test.send_midi_rt(0, TEST_CLOCK_MSG, 0));
+
+    _test_engine.transport()->set_sync_mode(SyncMode::MIDI_SLAVE);
+    _module_under_test.send_midi(0, TEST_START_MSG, IMMEDIATE_PROCESS);
+    auto event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(event);
+    EXPECT_EQ(RtEventType::PLAYING_MODE, event->to_rt_event(0).type());
+    EXPECT_EQ(PlayingMode::PLAYING, event->to_rt_event(0).playing_mode_event()->mode());
+
+    /* The tempo is only updated once the estimate has settled, i.e. after one quarter note */
+    Time timestamp(1'000'000);
+    for (int i = 0; i < midi::CLOCK_TICKS_PER_QUARTER_NOTE; ++i)
+    {
+        _module_under_test.send_midi(0, TEST_CLOCK_MSG, timestamp);
+        timestamp += PERIOD;
+        EXPECT_FALSE(_test_dispatcher->got_event());
+    }
+    _module_under_test.send_midi(0, TEST_CLOCK_MSG, timestamp);
+    event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(event);
+    auto rt_event = event->to_rt_event(0);
+    ASSERT_EQ(RtEventType::TEMPO, rt_event.type());
+    EXPECT_NEAR(100.0f, rt_event.tempo_event()->tempo(), 0.01f);
+
+    /* Unchanged tempo should not generate new events */
+    timestamp += PERIOD;
+    _module_under_test.send_midi(0, TEST_CLOCK_MSG, timestamp);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+
+    _module_under_test.send_midi(0, TEST_STOP_MSG, timestamp);
+    event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(event);
+    EXPECT_EQ(PlayingMode::STOPPED, event->to_rt_event(0).playing_mode_event()->mode());
+}
+
+TEST_F(TestMidiDispatcher, TestMidiClockOutput)
+{
+    _module_under_test.set_midi_outputs(2);
+    EXPECT_EQ(MidiDispatcherStatus::INVALID_MIDI_OUTPUT, _module_under_test.connect_clock_to_output(2));
+    EXPECT_FALSE(_test_engine.midi_clock_output_enabled);
+    ASSERT_EQ(MidiDispatcherStatus::OK, _module_under_test.connect_clock_to_output(1));
+    EXPECT_TRUE(_test_engine.midi_clock_output_enabled);
+
+    /* Clock messages from the engine are passed on unchanged */
+    KeyboardEvent event(KeyboardEvent::Subtype::WRAPPED_MIDI, engine::MIDI_CLOCK_SOURCE_ID, TEST_CLOCK_MSG, IMMEDIATE_PROCESS);
+    _module_under_test.process(&event);
+    EXPECT_TRUE(_test_frontend.midi_sent());
+}
+
 TEST_F(TestMidiDispatcher, TestRawDataConnection)
 {
     /* Send midi message without connections */
@@ -225,6 +405,26 @@ TEST_F(TestMidiDispatcher, TestRawDataConnection)
     EXPECT_FALSE(_test_dispatcher->got_event());
 }
 
+TEST_F(TestMidiDispatcher, TestSysexConnection)
+{
+    const uint8_t sysex[] = {0xF0, 0x43, 0x10, 0x4C, 0x00, 0x00, 0x7E, 0x00, 0xF7};
+    _module_under_test.send_sysex(1, sysex, sizeof(sysex), IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+
+    /* Sysex is passed to both raw midi and keyboard connections */
+    _module_under_test.set_midi_inputs(5);
+    _module_under_test.connect_raw_midi_to_track(1, "processor");
+    _module_under_test.send_sysex(1, sysex, sizeof(sysex), IMMEDIATE_PROCESS);
+    EXPECT_TRUE(_test_dispatcher->got_event());
+    _module_under_test.send_sysex(0, sysex, sizeof(sysex), IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+    _module_under_test.clear_connections();
+
+    _module_under_test.connect_kb_to_track(2, "processor");
+    _module_under_test.send_sysex(2, sysex, sizeof(sysex), IMMEDIATE_PROCESS);
+    EXPECT_TRUE(_test_dispatcher->got_event());
+}
+
 TEST_F(TestMidiDispatcher, TestCCDataConnection)
 {
     /* Test with no connections set */
@@ -282,3 +482,68 @@ TEST_F(TestMidiDispatcher, TestProgramChangeConnection)
     _module_under_test.send_midi(2, TEST_PRG_CH_MSG, IMMEDIATE_PROCESS);
     EXPECT_FALSE(_test_dispatcher->got_event());
 }
+
+TEST_F(TestMidiDispatcher, TestRoutingTableRebuild)
+{
+    const MidiDataByte RELATIVE_INC_MSG = {0xB4, 67, 1, 0}; /* Channel 4, cc 67, +1 */
+    _module_under_test.set_midi_inputs(2);
+    _module_under_test.connect_cc_to_parameter(1, "processor", "parameter", 67, 0, 127, true);
+
+    _module_under_test.send_midi(1, RELATIVE_INC_MSG, IMMEDIATE_PROCESS);
+    auto event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(event);
+    ASSERT_TRUE(event->is_parameter_change_event());
+    EXPECT_FLOAT_EQ(65.0f, static_cast<ParameterChangeEvent*>(event.get())->float_value());
+
+    /* Relative controller state should survive the table being recompiled,
+     * and both omni and channel specific connections should be dispatched */
+    _module_under_test.connect_cc_to_parameter(1, "processor", "parameter", 67, 0, 127, false, 4);
+    _module_under_test.send_midi(1, RELATIVE_INC_MSG, IMMEDIATE_PROCESS);
+    event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(event);
+    EXPECT_FLOAT_EQ(66.0f, static_cast<ParameterChangeEvent*>(event.get())->float_value());
+    event = _test_dispatcher->retrieve_event();
+    ASSERT_TRUE(event);
+    EXPECT_FLOAT_EQ(1.0f, static_cast<ParameterChangeEvent*>(event.get())->float_value());
+    EXPECT_FALSE(_test_dispatcher->got_event());
+
+    /* Inputs outside of the configured range should not be dispatched */
+    _module_under_test.set_midi_inputs(1);
+    _module_under_test.send_midi(1, RELATIVE_INC_MSG, IMMEDIATE_PROCESS);
+    EXPECT_FALSE(_test_dispatcher->got_event());
+}
+
+TEST_F(TestMidiDispatcher, TestRoutingTableOverlappingReaders)
+{
+    /* Readers that overlap each other must not keep a new table from being published */
+    int first_phase;
+    auto old_table = _module_under_test._acquire_routing_table(first_phase);
+    std::atomic<bool> published{false};
+    std::thread publisher([&]()
+    {
+        _module_under_test.set_midi_inputs(2);
+        published = true;
+    });
+
+    int second_phase;
+    while (_module_under_test._routing_table_phase.load() == first_phase)
+    {
+        std::this_thread::yield();
+    }
+    _module_under_test._acquire_routing_table(second_phase);
+    _module_under_test._release_routing_table(first_phase);
+
+    int third_phase;
+    while (_module_under_test._routing_table_phase.load() == second_phase)
+    {
+        std::this_thread::yield();
+    }
+    auto new_table = _module_under_test._acquire_routing_table(third_phase);
+    _module_under_test._release_routing_table(second_phase);
+
+    /* The publisher only waits for readers that registered before it flipped the phase */
+    publisher.join();
+    EXPECT_TRUE(published);
+    EXPECT_NE(old_table, new_table);
+    _module_under_test._release_routing_table(third_phase);
+}
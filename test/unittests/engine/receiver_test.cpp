@@ -1,3 +1,5 @@
+#include <thread>
+
 #include "gtest/gtest.h"
 
 #define private public
@@ -52,4 +54,87 @@ TEST_F(TestAsyncReceiver, TestMultipleEvents)
     // Get the acks in the reverse order to exercise more of the code
     ASSERT_TRUE(_module_under_test.wait_for_response(id2, ZERO_TIMEOUT));
     ASSERT_TRUE(_module_under_test.wait_for_response(id1, ZERO_TIMEOUT));
-}
\ No newline at end of file
+    ASSERT_TRUE(_module_under_test._responses.empty());
+}
+
+TEST_F(TestAsyncReceiver, TestAsyncCallback)
+{
+    std::vector<std::pair<EventId, bool>> responses;
+    auto callback = [](void* arg, EventId id, bool status)
+    {
+        static_cast<std::vector<std::pair<EventId, bool>>*>(arg)->push_back({id, status});
+    };
+    auto event1 = RtEvent::make_insert_processor_event(nullptr);
+    auto event2 = RtEvent::make_add_processor_to_track_event(123, 234);
+    event1.returnable_event()->set_handled(true);
+    event2.returnable_event()->set_handled(false);
+    EventId id1 = event1.returnable_event()->event_id();
+    EventId id2 = event2.returnable_event()->event_id();
+
+    _module_under_test.wait_for_response_async(id1, callback, &responses);
+    _queue.push(event1);
+    _queue.push(event2);
+    _module_under_test.process_responses();
+    ASSERT_EQ(1u, responses.size());
+    EXPECT_EQ(id1, responses[0].first);
+    EXPECT_TRUE(responses[0].second);
+
+    // Already received responses should trigger the callback directly
+    _module_under_test.wait_for_response_async(id2, callback, &responses);
+    ASSERT_EQ(2u, responses.size());
+    EXPECT_EQ(id2, responses[1].first);
+    EXPECT_FALSE(responses[1].second);
+    EXPECT_TRUE(_module_under_test._responses.empty());
+    EXPECT_TRUE(_module_under_test._callbacks.empty());
+}
+
+TEST_F(TestAsyncReceiver, TestAsyncCallbackTimeout)
+{
+    std::vector<std::pair<EventId, bool>> responses;
+    auto callback = [](void* arg, EventId id, bool status)
+    {
+        static_cast<std::vector<std::pair<EventId, bool>>*>(arg)->push_back({id, status});
+    };
+    _module_under_test.wait_for_response_async(123u, callback, &responses);
+    _module_under_test.process_responses();
+    ASSERT_TRUE(responses.empty());
+
+    // Callbacks that never get a response are called with false once they are too old
+    _module_under_test._callbacks[123u].registered -= MAX_RESPONSE_AGE * 2;
+    _module_under_test.process_responses();
+    ASSERT_EQ(1u, responses.size());
+    EXPECT_EQ(123u, responses[0].first);
+    EXPECT_FALSE(responses[0].second);
+    EXPECT_TRUE(_module_under_test._callbacks.empty());
+}
+
+TEST_F(TestAsyncReceiver, TestWakeUpFromOtherThread)
+{
+    auto event = RtEvent::make_insert_processor_event(nullptr);
+    EventId id = event.returnable_event()->event_id();
+    event.returnable_event()->set_handled(true);
+    std::thread pusher([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        _queue.push(event);
+        _module_under_test.process_responses();
+    });
+    ASSERT_TRUE(_module_under_test.wait_for_response(id, std::chrono::milliseconds(500)));
+    pusher.join();
+}
+
+TEST_F(TestAsyncReceiver, TestLateResponseIsDiscarded)
+{
+    auto event = RtEvent::make_insert_processor_event(nullptr);
+    EventId id = event.returnable_event()->event_id();
+    event.returnable_event()->set_handled(true);
+    ASSERT_FALSE(_module_under_test.wait_for_response(id, ZERO_TIMEOUT));
+    _queue.push(event);
+    _module_under_test.process_responses();
+    ASSERT_EQ(1u, _module_under_test._responses.size());
+
+    // Age the response, it should be removed on the next drain
+    _module_under_test._responses[id].received -= MAX_RESPONSE_AGE * 2;
+    _module_under_test.process_responses();
+    ASSERT_TRUE(_module_under_test._responses.empty());
+}
@@ -0,0 +1,242 @@
+#include <cstdio>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "engine/recorder.cpp"
+#undef private
+
+#include "test_utils/test_utils.h"
+
+using namespace sushi;
+using namespace sushi::engine;
+
+constexpr float TEST_SAMPLE_RATE = 48000;
+constexpr int TEST_CHANNELS = 2;
+constexpr ObjectId TEST_PROCESSOR_ID = 12;
+constexpr int TEST_CHUNKS = 10;
+const std::string TEST_FILE = "./test_recording.wav";
+
+TEST(TestRecorderFileFormat, TestFormatFromFilename)
+{
+    EXPECT_EQ(SF_FORMAT_WAV | SF_FORMAT_FLOAT, file_format_from_filename("recording.wav"));
+    EXPECT_EQ(SF_FORMAT_FLAC | SF_FORMAT_PCM_24, file_format_from_filename("recording.FLAC"));
+    EXPECT_EQ(SF_FORMAT_AIFF | SF_FORMAT_PCM_24, file_format_from_filename("/tmp/recording.aif"));
+    EXPECT_EQ(SF_FORMAT_WAV | SF_FORMAT_FLOAT, file_format_from_filename("recording"));
+}
+
+class TestRecorderTap : public ::testing::Test
+{
+protected:
+    TestRecorderTap() {}
+
+    void TearDown()
+    {
+        std::remove(TEST_FILE.c_str());
+    }
+
+    RecorderTap _module_under_test{RecordSource::ENGINE_OUTPUT, 0, TEST_CHANNELS};
+};
+
+TEST_F(TestRecorderTap, TestRecordToFile)
+{
+    ChunkSampleBuffer buffer(1);
+    test_utils::fill_sample_buffer(buffer, 0.5f);
+
+    /* Nothing should be recorded before the tap is armed */
+    _module_under_test.record(buffer);
+    EXPECT_EQ(0, _module_under_test._write_pos.load());
+
+    ASSERT_TRUE(_module_under_test.arm(TEST_FILE, TEST_SAMPLE_RATE));
+    EXPECT_TRUE(_module_under_test.armed());
+    EXPECT_EQ(TEST_FILE, _module_under_test.filename());
+    EXPECT_FALSE(_module_under_test.arm(TEST_FILE, TEST_SAMPLE_RATE));
+
+    for (int i = 0; i < TEST_CHUNKS; ++i)
+    {
+        _module_under_test.record(buffer);
+    }
+    _module_under_test.write_to_file();
+    EXPECT_EQ(TEST_CHUNKS * AUDIO_CHUNK_SIZE, _module_under_test._read_pos.load());
+
+    /* The audio thread needs to acknowledge the stop before the file is closed */
+    _module_under_test.disarm(true);
+    EXPECT_FALSE(_module_under_test.armed());
+    _module_under_test.write_to_file();
+    EXPECT_EQ(RecordState::STOPPING, _module_under_test._state.load());
+    _module_under_test.record(buffer);
+    EXPECT_EQ(RecordState::STOPPED, _module_under_test._state.load());
+    _module_under_test.write_to_file();
+    EXPECT_EQ(RecordState::IDLE, _module_under_test._state.load());
+    EXPECT_EQ(nullptr, _module_under_test._file);
+
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* file = sf_open(TEST_FILE.c_str(), SFM_READ, &info);
+    ASSERT_NE(nullptr, file);
+    EXPECT_EQ(TEST_CHANNELS, info.channels);
+    EXPECT_EQ(static_cast<int>(TEST_SAMPLE_RATE), info.samplerate);
+    ASSERT_EQ(TEST_CHUNKS * AUDIO_CHUNK_SIZE, info.frames);
+
+    std::vector<float> data(info.frames * info.channels);
+    sf_readf_float(file, data.data(), info.frames);
+    sf_close(file);
+    /* The buffer only had 1 channel, the second should be silent */
+    for (int n = 0; n < info.frames; ++n)
+    {
+        ASSERT_FLOAT_EQ(0.5f, data[n * TEST_CHANNELS]);
+        ASSERT_FLOAT_EQ(0.0f, data[n * TEST_CHANNELS + 1]);
+    }
+}
+
+TEST_F(TestRecorderTap, TestDisarmWhenNotRunning)
+{
+    ChunkSampleBuffer buffer(TEST_CHANNELS);
+    ASSERT_TRUE(_module_under_test.arm(TEST_FILE, TEST_SAMPLE_RATE));
+    _module_under_test.record(buffer);
+
+    /* Without a running audio thread the tap should stop without an acknowledgement */
+    _module_under_test.disarm(false);
+    EXPECT_EQ(RecordState::STOPPED, _module_under_test._state.load());
+    _module_under_test.write_to_file();
+    EXPECT_EQ(RecordState::IDLE, _module_under_test._state.load());
+    EXPECT_EQ(nullptr, _module_under_test._file);
+
+    /* A stop requested just before the engine was stopped should also complete */
+    ASSERT_TRUE(_module_under_test.arm(TEST_FILE, TEST_SAMPLE_RATE));
+    _module_under_test.disarm(true);
+    EXPECT_EQ(RecordState::STOPPING, _module_under_test._state.load());
+    _module_under_test.disarm(false);
+    EXPECT_EQ(RecordState::STOPPED, _module_under_test._state.load());
+    _module_under_test.write_to_file();
+    EXPECT_EQ(RecordState::IDLE, _module_under_test._state.load());
+}
+
+TEST_F(TestRecorderTap, TestStopTimeout)
+{
+    /* A tap on a processor that is never processed doesn't get any acknowledgement */
+    ASSERT_TRUE(_module_under_test.arm(TEST_FILE, TEST_SAMPLE_RATE));
+    _module_under_test.disarm(true);
+    _module_under_test.check_stop_timeout();
+    EXPECT_EQ(RecordState::STOPPING, _module_under_test._state.load());
+
+    _module_under_test._stop_requested -= RECORDER_STOP_TIMEOUT * 2;
+    _module_under_test.check_stop_timeout();
+    EXPECT_EQ(RecordState::STOPPED, _module_under_test._state.load());
+    _module_under_test.write_to_file();
+    EXPECT_EQ(RecordState::IDLE, _module_under_test._state.load());
+    EXPECT_TRUE(_module_under_test.arm(TEST_FILE, TEST_SAMPLE_RATE));
+}
+
+TEST_F(TestRecorderTap, TestOverruns)
+{
+    ChunkSampleBuffer buffer(TEST_CHANNELS);
+    ASSERT_TRUE(_module_under_test.arm(TEST_FILE, TEST_SAMPLE_RATE));
+    for (int i = 0; i < RECORDER_BUFFER_FRAMES / AUDIO_CHUNK_SIZE + 2; ++i)
+    {
+        _module_under_test.record(buffer);
+    }
+    EXPECT_EQ(2, _module_under_test.overruns());
+
+    /* When the buffer has been emptied there should be room for more */
+    _module_under_test.write_to_file();
+    _module_under_test.record(buffer);
+    EXPECT_EQ(2, _module_under_test.overruns());
+}
+
+class TestRecorder : public ::testing::Test
+{
+protected:
+    TestRecorder() {}
+
+    void SetUp()
+    {
+        _module_under_test.set_sample_rate(TEST_SAMPLE_RATE);
+    }
+
+    void TearDown()
+    {
+        std::remove(TEST_FILE.c_str());
+    }
+
+    Recorder _module_under_test;
+};
+
+TEST_F(TestRecorder, TestAddTaps)
+{
+    EXPECT_EQ(nullptr, _module_under_test.tap(0));
+    EXPECT_EQ(-1, _module_under_test.add_tap(RecordSource::ENGINE_INPUT, 0, 0));
+
+    EXPECT_EQ(0, _module_under_test.add_tap(RecordSource::ENGINE_INPUT, TEST_PROCESSOR_ID, TEST_CHANNELS));
+    EXPECT_EQ(1, _module_under_test.add_tap(RecordSource::PROCESSOR_OUTPUT, TEST_PROCESSOR_ID, TEST_CHANNELS));
+    EXPECT_EQ(2, _module_under_test.tap_count());
+
+    /* The processor id is only relevant for processor taps */
+    EXPECT_EQ(0u, _module_under_test.tap(0)->processor_id());
+    EXPECT_EQ(TEST_PROCESSOR_ID, _module_under_test.tap(1)->processor_id());
+    EXPECT_EQ(RecordSource::PROCESSOR_OUTPUT, _module_under_test.tap(1)->source());
+
+    for (int i = _module_under_test.tap_count(); i < MAX_RECORDER_TAPS; ++i)
+    {
+        EXPECT_EQ(i, _module_under_test.add_tap(RecordSource::ENGINE_OUTPUT, 0, TEST_CHANNELS));
+    }
+    EXPECT_EQ(-1, _module_under_test.add_tap(RecordSource::ENGINE_OUTPUT, 0, TEST_CHANNELS));
+
+    EXPECT_FALSE(_module_under_test.arm(MAX_RECORDER_TAPS, TEST_FILE));
+    EXPECT_FALSE(_module_under_test.disarm(MAX_RECORDER_TAPS, true));
+}
+
+TEST_F(TestRecorder, TestRouting)
+{
+    ChunkSampleBuffer buffer(TEST_CHANNELS);
+    int id = _module_under_test.add_tap(RecordSource::PROCESSOR_OUTPUT, TEST_PROCESSOR_ID, TEST_CHANNELS);
+    ASSERT_EQ(0, id);
+    auto tap = _module_under_test.tap(id);
+    ASSERT_TRUE(_module_under_test.arm(id, TEST_FILE));
+
+    _module_under_test.record_engine_input(buffer);
+    _module_under_test.record_engine_output(buffer);
+    _module_under_test.record_processor_output(TEST_PROCESSOR_ID + 1, buffer);
+    EXPECT_EQ(0, tap->_write_pos.load());
+
+    _module_under_test.record_processor_output(TEST_PROCESSOR_ID, buffer);
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, tap->_write_pos.load());
+
+    EXPECT_TRUE(_module_under_test.disarm(id, true));
+    EXPECT_FALSE(tap->armed());
+}
+
+TEST_F(TestRecorder, TestRemoveSource)
+{
+    ASSERT_EQ(0, _module_under_test.add_tap(RecordSource::PROCESSOR_OUTPUT, TEST_PROCESSOR_ID, TEST_CHANNELS));
+    ASSERT_EQ(1, _module_under_test.add_tap(RecordSource::PROCESSOR_OUTPUT, TEST_PROCESSOR_ID + 1, TEST_CHANNELS));
+    ASSERT_TRUE(_module_under_test.arm(0, TEST_FILE));
+    ASSERT_TRUE(_module_under_test.disarm(0, true));
+    EXPECT_EQ(RecordState::STOPPING, _module_under_test.tap(0)->_state.load());
+
+    /* Taps on a deleted processor are stopped without waiting for the audio thread */
+    _module_under_test.remove_source(TEST_PROCESSOR_ID + 1);
+    EXPECT_EQ(RecordState::STOPPING, _module_under_test.tap(0)->_state.load());
+    _module_under_test.remove_source(TEST_PROCESSOR_ID);
+    /* The writer thread may already have closed the file */
+    EXPECT_NE(RecordState::STOPPING, _module_under_test.tap(0)->_state.load());
+}
+
+TEST_F(TestRecorder, TestTapInfo)
+{
+    ASSERT_EQ(0, _module_under_test.add_tap(RecordSource::ENGINE_INPUT, 0, TEST_CHANNELS));
+    ASSERT_EQ(1, _module_under_test.add_tap(RecordSource::PROCESSOR_OUTPUT, TEST_PROCESSOR_ID, 1));
+    ASSERT_TRUE(_module_under_test.arm(1, TEST_FILE));
+
+    auto info = _module_under_test.tap_info();
+    ASSERT_EQ(2u, info.size());
+    EXPECT_EQ(RecordSource::ENGINE_INPUT, info[0].source);
+    EXPECT_FALSE(info[0].armed);
+    EXPECT_EQ("", info[0].filename);
+    EXPECT_EQ(RecordSource::PROCESSOR_OUTPUT, info[1].source);
+    EXPECT_EQ(TEST_PROCESSOR_ID, info[1].processor_id);
+    EXPECT_EQ(1, info[1].channels);
+    EXPECT_TRUE(info[1].armed);
+    EXPECT_EQ(TEST_FILE, info[1].filename);
+    EXPECT_TRUE(_module_under_test.disarm(1, false));
+}
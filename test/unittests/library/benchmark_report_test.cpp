@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+#include "library/benchmark_report.cpp"
+#include "test_utils/control_mockup.h"
+
+using namespace sushi;
+
+TEST(TestBenchmarkReport, TestBenchmarkDocumentGeneration)
+{
+    sushi::ext::ControlMockup controller;
+    audio_frontend::BenchmarkResults results;
+    results.chunks = 1000;
+    results.sample_rate = 48000;
+    results.realtime_factor = 20.0;
+    results.latency_p99 = 150.0f;
+
+    rapidjson::Document document = sushi::generate_benchmark_document(results, &controller);
+
+    ASSERT_TRUE(document.HasMember("benchmark"));
+    const auto& benchmark = document["benchmark"];
+    EXPECT_EQ(1000, benchmark["chunks"].GetInt());
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, benchmark["chunk_size"].GetInt());
+    EXPECT_DOUBLE_EQ(20.0, benchmark["realtime_factor"].GetDouble());
+    EXPECT_FLOAT_EQ(150.0f, benchmark["chunk_latency_us"]["p99"].GetFloat());
+
+    // Timings are reported in percent
+    EXPECT_FLOAT_EQ(100.0f, document["engine"]["average"].GetFloat());
+    EXPECT_FLOAT_EQ(150.0f, document["engine"]["max"].GetFloat());
+
+    auto expected_tracks = controller.get_tracks();
+    const auto& tracks = document["tracks"];
+    ASSERT_TRUE(tracks.IsArray());
+    ASSERT_EQ(expected_tracks.size(), tracks.Size());
+    const auto& track = tracks[0];
+    EXPECT_STREQ(expected_tracks[0].name.c_str(), track["name"].GetString());
+    EXPECT_FLOAT_EQ(50.0f, track["timings"]["min"].GetFloat());
+    const auto& processors = track["processors"];
+    ASSERT_TRUE(processors.IsArray());
+    ASSERT_EQ(2u, processors.Size());
+    EXPECT_STREQ("proc 1", processors[0]["name"].GetString());
+    EXPECT_FLOAT_EQ(100.0f, processors[0]["timings"]["average"].GetFloat());
+}
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include "library/dynamic_bitset.h"
+
+using namespace sushi;
+
+constexpr int TEST_BITS = 40;
+
+class TestDynamicBitSet : public ::testing::Test
+{
+protected:
+    TestDynamicBitSet() {}
+
+    DynamicBitSet _module_under_test{TEST_BITS};
+};
+
+TEST_F(TestDynamicBitSet, TestOperation)
+{
+    EXPECT_EQ(TEST_BITS, _module_under_test.size());
+    EXPECT_EQ(2, _module_under_test.words());
+    EXPECT_TRUE(_module_under_test.none());
+
+    _module_under_test[3] = true;
+    _module_under_test.set(35);
+    EXPECT_TRUE(_module_under_test[3]);
+    EXPECT_TRUE(_module_under_test.test(35));
+    EXPECT_FALSE(_module_under_test[4]);
+    EXPECT_TRUE(_module_under_test.any());
+    EXPECT_EQ(2, _module_under_test.count());
+    EXPECT_EQ(1u << 3, _module_under_test.word(0));
+    EXPECT_EQ(1u << 3, _module_under_test.word(1));
+
+    _module_under_test.reset(3);
+    EXPECT_FALSE(_module_under_test[3]);
+    EXPECT_EQ(1, _module_under_test.count());
+    _module_under_test.reset();
+    EXPECT_TRUE(_module_under_test.none());
+}
+
+TEST_F(TestDynamicBitSet, TestXor)
+{
+    DynamicBitSet other(TEST_BITS);
+    other[1] = true;
+    other[33] = true;
+    _module_under_test[1] = true;
+    _module_under_test[2] = true;
+    EXPECT_NE(other, _module_under_test);
+
+    DynamicBitSet diff = other;
+    diff ^= _module_under_test;
+    EXPECT_EQ(2, diff.count());
+    EXPECT_TRUE(diff[2]);
+    EXPECT_TRUE(diff[33]);
+
+    diff ^= diff;
+    EXPECT_TRUE(diff.none());
+}
+
+TEST_F(TestDynamicBitSet, TestWordAccess)
+{
+    /* Bits outside the size of the set should be ignored */
+    _module_under_test.set_word(0, 0xffffffff);
+    _module_under_test.set_word(1, 0xffffffff);
+    EXPECT_EQ(TEST_BITS, _module_under_test.count());
+    EXPECT_EQ(0xffu, _module_under_test.word(1));
+
+    /* Resizing keeps existing bits and clears new ones */
+    _module_under_test.resize(36);
+    EXPECT_EQ(36, _module_under_test.count());
+    _module_under_test.resize(64);
+    EXPECT_EQ(36, _module_under_test.count());
+    EXPECT_FALSE(_module_under_test[40]);
+    _module_under_test.resize(0);
+    EXPECT_EQ(0, _module_under_test.words());
+    EXPECT_TRUE(_module_under_test.none());
+
+    EXPECT_EQ(0, DynamicBitSet::word_count(0));
+    EXPECT_EQ(1, DynamicBitSet::word_count(32));
+    EXPECT_EQ(2, DynamicBitSet::word_count(33));
+}
@@ -82,9 +82,11 @@ TEST(EventTest, TestToRtEvent)
     EXPECT_EQ(10, rt_event.sample_offset());
     EXPECT_EQ(7u, rt_event.string_parameter_change_event()->processor_id());
     EXPECT_EQ(51u, rt_event.string_parameter_change_event()->param_id());
-    EXPECT_STREQ("Hello", rt_event.string_parameter_change_event()->value()->c_str());
+    EXPECT_EQ("Hello", rt_event.string_parameter_change_event()->value());
+    EXPECT_FALSE(rt_event.string_parameter_change_event()->in_transfer_ring());
+    delete[] rt_event.string_parameter_change_event()->value().data();
 
-    BlobData testdata = {0, nullptr};
+    BlobData testdata = {3, new uint8_t[3]{1, 2, 3}};
     auto data_pro_ch_event = DataPropertyChangeEvent(8, 52, testdata, IMMEDIATE_PROCESS);
     EXPECT_TRUE(data_pro_ch_event.is_parameter_change_event());
     EXPECT_TRUE(data_pro_ch_event.maps_to_rt_event());
@@ -93,8 +95,59 @@ TEST(EventTest, TestToRtEvent)
     EXPECT_EQ(10, rt_event.sample_offset());
     EXPECT_EQ(8u, rt_event.data_parameter_change_event()->processor_id());
     EXPECT_EQ(52u, rt_event.data_parameter_change_event()->param_id());
-    EXPECT_EQ(0, rt_event.data_parameter_change_event()->value().size);
-    EXPECT_EQ(nullptr, rt_event.data_parameter_change_event()->value().data);
+    EXPECT_EQ(3, rt_event.data_parameter_change_event()->value().size);
+    EXPECT_EQ(3, rt_event.data_parameter_change_event()->value().data[2]);
+    /* The rt event gets a copy, the original blob is owned by the event */
+    EXPECT_NE(testdata.data, rt_event.data_parameter_change_event()->value().data);
+    EXPECT_FALSE(rt_event.data_parameter_change_event()->in_transfer_ring());
+    delete[] rt_event.data_parameter_change_event()->value().data;
+
+    auto param_batch_event = ParameterBatchChangeEvent(8, {{1, 0.25f}, {2, 0.5f}}, IMMEDIATE_PROCESS);
+    EXPECT_TRUE(param_batch_event.maps_to_rt_event());
+    rt_event = param_batch_event.to_rt_event(11);
+    EXPECT_EQ(RtEventType::PARAMETER_CHANGE_BATCH, rt_event.type());
+    EXPECT_EQ(11, rt_event.sample_offset());
+    EXPECT_EQ(8u, rt_event.parameter_batch_event()->processor_id());
+    ASSERT_EQ(2, rt_event.parameter_batch_event()->count());
+    EXPECT_EQ(2u, rt_event.parameter_batch_event()->values()[1].parameter_id);
+    EXPECT_FLOAT_EQ(0.5f, rt_event.parameter_batch_event()->values()[1].value);
+    EXPECT_FALSE(rt_event.parameter_batch_event()->in_transfer_ring());
+    delete[] rt_event.parameter_batch_event()->values();
+
+    RtTransferRing ring;
+    rt_event = param_batch_event.to_rt_event_in_ring(11, ring);
+    EXPECT_EQ(RtEventType::PARAMETER_CHANGE_BATCH, rt_event.type());
+    ASSERT_EQ(2, rt_event.parameter_batch_event()->count());
+    EXPECT_TRUE(rt_event.parameter_batch_event()->in_transfer_ring());
+    EXPECT_FLOAT_EQ(0.25f, rt_event.parameter_batch_event()->values()[0].value);
+    EXPECT_GT(ring.used_bytes(), 0);
+
+    const uint8_t SYSEX_DATA[] = {0xF0, 0x01, 0x02, 0xF7};
+    auto sysex_event = SysexEvent(14, SYSEX_DATA, sizeof(SYSEX_DATA), IMMEDIATE_PROCESS);
+    EXPECT_TRUE(sysex_event.maps_to_rt_event());
+    rt_event = sysex_event.to_rt_event(12);
+    EXPECT_EQ(RtEventType::SYSEX_EVENT, rt_event.type());
+    EXPECT_EQ(12, rt_event.sample_offset());
+    EXPECT_EQ(14u, rt_event.sysex_event()->processor_id());
+    ASSERT_EQ(4, rt_event.sysex_event()->size());
+    EXPECT_EQ(0x02, rt_event.sysex_event()->data()[2]);
+    EXPECT_FALSE(rt_event.sysex_event()->in_transfer_ring());
+    delete[] rt_event.sysex_event()->data();
+
+    rt_event = sysex_event.to_rt_event_in_ring(12, ring);
+    EXPECT_EQ(RtEventType::SYSEX_EVENT, rt_event.type());
+    EXPECT_TRUE(rt_event.sysex_event()->in_transfer_ring());
+    EXPECT_EQ(0xF7, rt_event.sysex_event()->data()[3]);
+
+    rt_event = string_pro_ch_event.to_rt_event_in_ring(10, ring);
+    EXPECT_EQ(RtEventType::STRING_PROPERTY_CHANGE, rt_event.type());
+    EXPECT_TRUE(rt_event.string_parameter_change_event()->in_transfer_ring());
+    EXPECT_EQ("Hello", rt_event.string_parameter_change_event()->value());
+
+    rt_event = data_pro_ch_event.to_rt_event_in_ring(10, ring);
+    EXPECT_EQ(RtEventType::DATA_PROPERTY_CHANGE, rt_event.type());
+    EXPECT_TRUE(rt_event.data_parameter_change_event()->in_transfer_ring());
+    EXPECT_EQ(2, rt_event.data_parameter_change_event()->value().data[1]);
 
     auto async_comp_not = AsynchronousProcessorWorkCompletionEvent(123, 9, 53, IMMEDIATE_PROCESS);
     rt_event = async_comp_not.to_rt_event(11);
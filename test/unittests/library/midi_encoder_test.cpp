@@ -70,4 +70,12 @@ TEST(TestMidiEncoder, EncodeProgramChange)
     EXPECT_EQ(53u, midi_msg[1]);
     EXPECT_EQ(0u, midi_msg[2]);
     EXPECT_EQ(0u, midi_msg[3]);
-}
\ No newline at end of file
+}
+
+TEST(TestMidiEncoder, EncodeRealtimeMessages)
+{
+    EXPECT_EQ(MessageType::TIMING_CLOCK, decode_message_type(encode_timing_clock()));
+    EXPECT_EQ(MessageType::START, decode_message_type(encode_start_message()));
+    EXPECT_EQ(MessageType::STOP, decode_message_type(encode_stop_message()));
+    EXPECT_EQ(1, message_size(encode_timing_clock()));
+}
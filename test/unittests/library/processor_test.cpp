@@ -138,6 +138,17 @@ TEST_F(TestProcessor, TestCvOutput)
     EXPECT_EQ(RtEventType::CV_EVENT, cv_event.type());
     EXPECT_EQ(1, cv_event.cv_event()->cv_id());
     EXPECT_FLOAT_EQ(0.25f, cv_event.cv_event()->value());
+
+    // Cv outputs beyond the default port count can be connected too
+    _module_under_test->register_parameter(new FloatParameterDescriptor("param_2", "Float", "", 0, 1, nullptr));
+    auto param_2 = _module_under_test->parameter_from_name("param_2");
+    ASSERT_TRUE(param_2);
+    EXPECT_NE(ProcessorReturnCode::OK, _module_under_test->connect_cv_from_parameter(param_2->id(), MAX_ENGINE_CV_IO_PORTS));
+    ASSERT_EQ(ProcessorReturnCode::OK, _module_under_test->connect_cv_from_parameter(param_2->id(), 12));
+    ASSERT_TRUE(_module_under_test->maybe_output_cv_value(param_2->id(), 0.75f));
+    cv_event = _event_queue.pop();
+    EXPECT_EQ(12, cv_event.cv_event()->cv_id());
+    EXPECT_FLOAT_EQ(0.75f, cv_event.cv_event()->value());
 }
 
 TEST_F(TestProcessor, TestGateOutput)
@@ -86,13 +86,14 @@ TEST (TestRealtimeEvents, TestFactoryFunction)
     EXPECT_FLOAT_EQ(0.5, cv_event->value());
 
     std::string str("Hej");
-    event = RtEvent::make_string_parameter_change_event(129, 8, 65, &str);
+    event = RtEvent::make_string_parameter_change_event(129, 8, 65, str.data(), static_cast<int>(str.size()));
     EXPECT_EQ(RtEventType::STRING_PROPERTY_CHANGE, event.type());
     auto spc_event = event.string_parameter_change_event();
     EXPECT_EQ(ObjectId(129), spc_event->processor_id());
     EXPECT_EQ(8, spc_event->sample_offset());
     EXPECT_EQ(ObjectId(65), spc_event->param_id());
-    EXPECT_EQ("Hej", *spc_event->value());
+    EXPECT_EQ("Hej", spc_event->value());
+    EXPECT_FALSE(spc_event->in_transfer_ring());
 
     uint8_t TEST_DATA[3] = {1,2,3};
     BlobData data{sizeof(TEST_DATA), TEST_DATA};
@@ -103,6 +104,17 @@ TEST (TestRealtimeEvents, TestFactoryFunction)
     EXPECT_EQ(9, dpc_event->sample_offset());
     EXPECT_EQ(ObjectId(66), dpc_event->param_id());
     EXPECT_EQ(3, dpc_event->value().data[2]);
+    EXPECT_FALSE(dpc_event->in_transfer_ring());
+
+    event = RtEvent::make_sysex_event(131, 10, TEST_DATA, sizeof(TEST_DATA));
+    EXPECT_EQ(RtEventType::SYSEX_EVENT, event.type());
+    auto sysex_event = event.sysex_event();
+    EXPECT_EQ(ObjectId(131), sysex_event->processor_id());
+    EXPECT_EQ(10, sysex_event->sample_offset());
+    EXPECT_EQ(3, sysex_event->size());
+    EXPECT_EQ(TEST_DATA, sysex_event->data());
+    EXPECT_FALSE(sysex_event->in_transfer_ring());
+    EXPECT_TRUE(is_keyboard_event(event));
 
     event = RtEvent::make_bypass_processor_event(131, true);
     EXPECT_EQ(RtEventType::SET_BYPASS, event.type());
@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+
+#define private public
+#include "library/rt_transfer_ring.h"
+
+using namespace sushi;
+
+constexpr int RING_SIZE = 128;
+
+class TestRtTransferRing : public ::testing::Test
+{
+protected:
+    TestRtTransferRing() {}
+
+    RtTransferRing _module_under_test{RING_SIZE};
+};
+
+TEST_F(TestRtTransferRing, TestAllocationAndRelease)
+{
+    /* Each slice uses one extra block for its header */
+    uint8_t* first = _module_under_test.allocate(40);
+    uint8_t* second = _module_under_test.allocate(40);
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first) % alignof(double));
+    EXPECT_EQ(RING_SIZE, _module_under_test.used_bytes());
+    std::fill(first, first + 40, 1);
+    std::fill(second, second + 40, 2);
+
+    // Ring is now full
+    ASSERT_EQ(nullptr, _module_under_test.allocate(1));
+
+    // Slices are reclaimed on the next allocation after being released
+    RtTransferRing::release(first);
+    uint8_t* third = _module_under_test.allocate(40);
+    ASSERT_EQ(first, third);
+    EXPECT_EQ(2, second[39]);
+
+    RtTransferRing::release(second);
+    RtTransferRing::release(third);
+    ASSERT_NE(nullptr, _module_under_test.allocate(1));
+    EXPECT_EQ(32, _module_under_test.used_bytes());
+}
+
+TEST_F(TestRtTransferRing, TestWrapAround)
+{
+    uint8_t* first = _module_under_test.allocate(50);
+    uint8_t* second = _module_under_test.allocate(20);
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    RtTransferRing::release(first);
+
+    // Does not fit before the end of the ring, so it should wrap around
+    uint8_t* third = _module_under_test.allocate(40);
+    ASSERT_EQ(first, third);
+
+    // Only 16 bytes left at the end have been used as padding
+    ASSERT_EQ(nullptr, _module_under_test.allocate(1));
+    RtTransferRing::release(second);
+    RtTransferRing::release(third);
+    ASSERT_NE(nullptr, _module_under_test.allocate(100));
+}
+
+TEST_F(TestRtTransferRing, TestReleaseOutOfOrder)
+{
+    uint8_t* first = _module_under_test.allocate(16);
+    uint8_t* second = _module_under_test.allocate(16);
+    ASSERT_NE(nullptr, second);
+    RtTransferRing::release(second);
+    // First slice is still in use so nothing can be reclaimed
+    uint8_t* empty = _module_under_test.allocate(0);
+    EXPECT_EQ(RING_SIZE / 2 + 16, _module_under_test.used_bytes());
+    RtTransferRing::release(first);
+    RtTransferRing::release(empty);
+    ASSERT_EQ(nullptr, _module_under_test.allocate(RING_SIZE));
+    EXPECT_EQ(0, _module_under_test.used_bytes());
+}
@@ -154,6 +154,20 @@ TEST(TestSampleBuffer, TestDeinterleaving)
         ASSERT_FLOAT_EQ(2.0f, buffer_3ch.channel(1)[n]);
         ASSERT_FLOAT_EQ(3.0f, buffer_3ch.channel(2)[n]);
     }
+
+    float interleaved_chunk[AUDIO_CHUNK_SIZE * 3];
+    for (unsigned int n = 0; n < AUDIO_CHUNK_SIZE * 3; ++n)
+    {
+        interleaved_chunk[n] = static_cast<float>(n % 3);
+    }
+    SampleBuffer<AUDIO_CHUNK_SIZE> chunk_3ch(3);
+    chunk_3ch.from_interleaved(interleaved_chunk);
+    for (unsigned int n = 0; n < AUDIO_CHUNK_SIZE; ++n)
+    {
+        ASSERT_FLOAT_EQ(0.0f, chunk_3ch.channel(0)[n]);
+        ASSERT_FLOAT_EQ(1.0f, chunk_3ch.channel(1)[n]);
+        ASSERT_FLOAT_EQ(2.0f, chunk_3ch.channel(2)[n]);
+    }
 }
 
 TEST(TestSampleBuffer, TestInterleaving)
@@ -0,0 +1,123 @@
+#include <random>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "library/tempo_estimator.h"
+
+using namespace sushi;
+
+constexpr int TEST_PPQN = 24;
+
+/* Period in microseconds of a clock with the given tempo and resolution */
+double tick_period(float tempo, int ppqn)
+{
+    return 60'000'000.0 / (tempo * ppqn);
+}
+
+class TestTempoEstimator : public ::testing::Test
+{
+protected:
+    TestTempoEstimator() {}
+
+    /* Feed ticks with an optional random timing error, returns the time of the last tick */
+    double send_ticks(double start, float tempo, int ticks, double jitter = 0.0)
+    {
+        std::uniform_real_distribution<double> dist(-jitter, jitter);
+        double period = tick_period(tempo, TEST_PPQN);
+        double time = start;
+        for (int i = 0; i < ticks; ++i)
+        {
+            time += period;
+            _module_under_test.tick(Time(static_cast<int64_t>(time + dist(_random_engine))));
+        }
+        return time;
+    }
+
+    std::mt19937 _random_engine{1234};
+    TempoEstimator _module_under_test{TEST_PPQN};
+};
+
+TEST_F(TestTempoEstimator, TestSteadyClock)
+{
+    EXPECT_FALSE(_module_under_test.valid());
+    _module_under_test.tick(Time(1'000'000));
+    EXPECT_FALSE(_module_under_test.valid());
+
+    // Not valid until a full quarter note has passed
+    double time = send_ticks(1'000'000, 120, TEST_PPQN - 1);
+    EXPECT_FALSE(_module_under_test.valid());
+    send_ticks(time, 120, 1);
+    ASSERT_TRUE(_module_under_test.valid());
+    EXPECT_NEAR(120.0f, _module_under_test.tempo(), 0.01f);
+}
+
+TEST_F(TestTempoEstimator, TestJitteryClock)
+{
+    // +-1 ms of jitter is typical for usb midi interfaces
+    double time = send_ticks(0, 97.5, 8 * TEST_PPQN, 1000.0);
+    ASSERT_TRUE(_module_under_test.valid());
+    EXPECT_NEAR(97.5f, _module_under_test.tempo(), 0.5f);
+
+    // The estimate should stay stable from tick to tick
+    float min_tempo = _module_under_test.tempo();
+    float max_tempo = min_tempo;
+    for (int i = 0; i < 4 * TEST_PPQN; ++i)
+    {
+        time = send_ticks(time, 97.5, 1, 1000.0);
+        min_tempo = std::min(min_tempo, _module_under_test.tempo());
+        max_tempo = std::max(max_tempo, _module_under_test.tempo());
+    }
+    EXPECT_LT(max_tempo - min_tempo, 0.5f);
+}
+
+TEST_F(TestTempoEstimator, TestTempoChange)
+{
+    double time = send_ticks(0, 120, 4 * TEST_PPQN);
+    EXPECT_NEAR(120.0f, _module_under_test.tempo(), 0.01f);
+
+    // A gradual change should be tracked without restarting
+    for (int i = 0; i < 20; ++i)
+    {
+        time = send_ticks(time, 120 + i, TEST_PPQN);
+        EXPECT_TRUE(_module_under_test.valid());
+    }
+    send_ticks(time, 140, 16 * TEST_PPQN);
+    EXPECT_NEAR(140.0f, _module_under_test.tempo(), 0.1f);
+}
+
+TEST_F(TestTempoEstimator, TestRestart)
+{
+    double time = send_ticks(0, 120, 4 * TEST_PPQN);
+    ASSERT_TRUE(_module_under_test.valid());
+
+    // A pause in the clock restarts the estimation
+    time += 5'000'000;
+    _module_under_test.tick(Time(static_cast<int64_t>(time)));
+    EXPECT_FALSE(_module_under_test.valid());
+    time = send_ticks(time, 90, TEST_PPQN);
+    ASSERT_TRUE(_module_under_test.valid());
+    EXPECT_NEAR(90.0f, _module_under_test.tempo(), 0.01f);
+
+    // As does a sudden doubling of the tempo
+    send_ticks(time, 180, 2);
+    EXPECT_FALSE(_module_under_test.valid());
+
+    // And a reset
+    send_ticks(time, 90, 2 * TEST_PPQN);
+    _module_under_test.reset();
+    EXPECT_FALSE(_module_under_test.valid());
+}
+
+TEST_F(TestTempoEstimator, TestLowResolution)
+{
+    // i.e. 1 pulse per quarter note on a gate input
+    _module_under_test.set_ticks_per_quarter_note(1);
+    EXPECT_FALSE(_module_under_test.valid());
+    for (int i = 0; i < 3; ++i)
+    {
+        _module_under_test.tick(Time(i * 400'000));
+    }
+    ASSERT_TRUE(_module_under_test.valid());
+    EXPECT_NEAR(150.0f, _module_under_test.tempo(), 0.01f);
+}
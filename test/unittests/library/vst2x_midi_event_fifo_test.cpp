@@ -155,3 +155,28 @@ TEST_F(TestVst2xMidiEventFIFO, TestWrappedMidiCreation)
 
 
 
+
+TEST_F(TestVst2xMidiEventFIFO, TestSysexCreation)
+{
+    _module_under_test.flush();
+    const uint8_t sysex[] = {0xF0, 0x43, 0x10, 0x4C, 0xF7};
+    _module_under_test.push(RtEvent::make_note_on_event(0, 0, 0, 60, 1.0f));
+    _module_under_test.push(RtEvent::make_sysex_event(0, 12, sysex, sizeof(sysex)));
+    auto vst_events = _module_under_test.flush();
+    ASSERT_EQ(2, vst_events->numEvents);
+    EXPECT_EQ(kVstMidiType, vst_events->events[0]->type);
+
+    auto sysex_ev = reinterpret_cast<VstMidiSysexEvent*>(vst_events->events[1]);
+    EXPECT_EQ(kVstSysExType, sysex_ev->type);
+    EXPECT_EQ(static_cast<int>(sizeof(VstMidiSysexEvent)), sysex_ev->byteSize);
+    EXPECT_EQ(12, sysex_ev->deltaFrames);
+    EXPECT_EQ(5, sysex_ev->dumpBytes);
+    EXPECT_EQ(reinterpret_cast<const char*>(sysex), sysex_ev->sysexDump);
+
+    // The slot is reused as a regular midi event
+    _module_under_test.push(RtEvent::make_note_on_event(0, 0, 0, 60, 1.0f));
+    _module_under_test.push(RtEvent::make_note_off_event(0, 0, 0, 60, 1.0f));
+    vst_events = _module_under_test.flush();
+    EXPECT_EQ(kVstMidiType, vst_events->events[1]->type);
+    EXPECT_EQ(static_cast<int>(sizeof(VstMidiEvent)), vst_events->events[1]->byteSize);
+}
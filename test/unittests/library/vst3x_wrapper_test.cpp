@@ -363,4 +363,17 @@ TEST_F(TestVst3xUtils, TestAftertouchConversion)
     EXPECT_EQ(45, vst_event.polyPressure.pitch);
     EXPECT_FLOAT_EQ(0.5f, vst_event.polyPressure.pressure);
     EXPECT_EQ(-1, vst_event.polyPressure.noteId);
-}
\ No newline at end of file
+}
+TEST_F(TestVst3xUtils, TestSysexConversion)
+{
+    const uint8_t sysex[] = {0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7};
+    auto event = RtEvent::make_sysex_event(ObjectId(0), 12, sysex, sizeof(sysex));
+    auto vst_event = convert_sysex_event(event.sysex_event());
+    EXPECT_EQ(0, vst_event.busIndex);
+    EXPECT_EQ(12, vst_event.sampleOffset);
+    EXPECT_EQ(0, vst_event.flags);
+    EXPECT_EQ(Steinberg::Vst::Event::kDataEvent, vst_event.type);
+    EXPECT_EQ(Steinberg::Vst::DataEvent::kMidiSysEx, vst_event.data.type);
+    EXPECT_EQ(6u, vst_event.data.size);
+    EXPECT_EQ(sysex, vst_event.data.bytes);
+}
@@ -121,6 +121,29 @@ TEST_F(TestGainPlugin, TestProcess)
     test_utils::assert_buffer_value(2.0f, out_buffer, test_utils::DECIBEL_ERROR);
 }
 
+TEST_F(TestGainPlugin, TestParameterModulation)
+{
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(2);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(2);
+    test_utils::fill_sample_buffer(in_buffer, 1.0f);
+    _module_under_test->set_input_channels(2);
+    std::array<float, AUDIO_CHUNK_SIZE> modulation;
+    modulation.fill(-6.0f);
+    modulation[0] = 6.0f;
+
+    auto gain_id = _module_under_test->parameter_from_name("gain")->id();
+    EXPECT_FALSE(_module_under_test->set_parameter_modulation(gain_id + 1, modulation.data()));
+    ASSERT_TRUE(_module_under_test->set_parameter_modulation(gain_id, modulation.data()));
+    _module_under_test->process_audio(in_buffer, out_buffer);
+    EXPECT_NEAR(2.0f, out_buffer.channel(0)[0], test_utils::DECIBEL_ERROR);
+    EXPECT_NEAR(0.5f, out_buffer.channel(1)[1], test_utils::DECIBEL_ERROR);
+    EXPECT_NEAR(0.5f, out_buffer.channel(0)[AUDIO_CHUNK_SIZE - 1], test_utils::DECIBEL_ERROR);
+
+    /* The next chunk should use the parameter value again */
+    _module_under_test->process_audio(in_buffer, out_buffer);
+    test_utils::assert_buffer_value(1.0f, out_buffer, test_utils::DECIBEL_ERROR);
+}
+
 
 class TestEqualizerPlugin : public ::testing::Test
 {
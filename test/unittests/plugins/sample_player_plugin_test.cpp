@@ -112,11 +112,13 @@ TEST_F(TestSamplePlayerPlugin, TestSampleLoading)
 {
     RtSafeRtEventFifo queue;
     _module_under_test->set_event_output(&queue);
-    std::string* path = new std::string(test_utils::get_data_dir_path());
-    path->append(SAMPLE_FILE);
-    auto sample_ev = RtEvent::make_string_parameter_change_event(0,0,5,path);
+    std::string path(test_utils::get_data_dir_path());
+    path.append(SAMPLE_FILE);
+    auto sample_ev = RtEvent::make_string_parameter_change_event(0, 0, 5, path.data(), static_cast<int>(path.size()));
     ASSERT_EQ(nullptr, _module_under_test->_sample_buffer);
     _module_under_test->process_event(sample_ev);
+    /* The plugin must keep its own copy of the file name */
+    path.assign(path.size(), 'x');
 
     /* Simulate an event dispatcher receieving the event and calling the non-rt callback */
     RtEvent async_event;
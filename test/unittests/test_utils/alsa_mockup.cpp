@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cerrno>
+
+#include <alsa/asoundlib.h>
+
+/**
+ * @brief Alsa pcm mockup of a non-interleaved float device with mmap access.
+ *        Avail counts and errors are set directly by the tests.
+ */
+
+constexpr int ALSA_MOCK_CHANNELS = 16;
+constexpr int ALSA_MOCK_MAX_FRAMES = 4096;
+
+struct AlsaMockDevice
+{
+    unsigned int max_channels{2};
+    unsigned int sample_rate{48000};
+    /* Overrides the negotiated buffer size if not 0 */
+    snd_pcm_uframes_t forced_buffer_size{0};
+    bool link_supported{true};
+};
+
+AlsaMockDevice alsa_mock_device;
+
+struct _snd_pcm_hw_params
+{
+    unsigned int channels;
+    snd_pcm_uframes_t period_size;
+    unsigned int periods;
+    snd_pcm_uframes_t buffer_size;
+};
+
+struct _snd_pcm_sw_params
+{
+    snd_pcm_uframes_t boundary;
+};
+
+struct _snd_pcm
+{
+    snd_pcm_stream_t stream;
+    /* Linked streams are prepared, started and stopped together */
+    snd_pcm_t* linked{nullptr};
+    snd_pcm_hw_params_t hw_params{};
+    snd_pcm_channel_area_t areas[ALSA_MOCK_CHANNELS]{};
+    float data[ALSA_MOCK_CHANNELS][ALSA_MOCK_MAX_FRAMES]{};
+    snd_pcm_uframes_t position{0};
+    snd_pcm_sframes_t avail{0};
+    /* Returned from wait, avail_update and mmap_begin if set, cleared by prepare */
+    int error{0};
+    int prepare_count{0};
+    bool running{false};
+};
+
+int snd_pcm_open(snd_pcm_t** pcm, const char* /*name*/, snd_pcm_stream_t stream, int /*mode*/)
+{
+    *pcm = new snd_pcm_t;
+    (*pcm)->stream = stream;
+    return 0;
+}
+
+int snd_pcm_close(snd_pcm_t* pcm)
+{
+    delete pcm;
+    return 0;
+}
+
+int snd_pcm_link(snd_pcm_t* pcm1, snd_pcm_t* pcm2)
+{
+    if (alsa_mock_device.link_supported == false)
+    {
+        return -ENOSYS;
+    }
+    pcm1->linked = pcm2;
+    pcm2->linked = pcm1;
+    return 0;
+}
+
+int snd_pcm_unlink(snd_pcm_t* pcm)
+{
+    if (pcm->linked)
+    {
+        pcm->linked->linked = nullptr;
+        pcm->linked = nullptr;
+    }
+    return 0;
+}
+
+void mock_prepare(snd_pcm_t* pcm)
+{
+    pcm->position = 0;
+    pcm->avail = pcm->stream == SND_PCM_STREAM_PLAYBACK ? pcm->hw_params.buffer_size : 0;
+    pcm->error = 0;
+    pcm->running = false;
+    pcm->prepare_count++;
+}
+
+int snd_pcm_prepare(snd_pcm_t* pcm)
+{
+    mock_prepare(pcm);
+    if (pcm->linked)
+    {
+        mock_prepare(pcm->linked);
+    }
+    return 0;
+}
+
+int snd_pcm_start(snd_pcm_t* pcm)
+{
+    pcm->running = true;
+    if (pcm->linked)
+    {
+        pcm->linked->running = true;
+    }
+    return 0;
+}
+
+int snd_pcm_drop(snd_pcm_t* pcm)
+{
+    pcm->running = false;
+    if (pcm->linked)
+    {
+        pcm->linked->running = false;
+    }
+    return 0;
+}
+
+int snd_pcm_wait(snd_pcm_t* pcm, int /*timeout*/)
+{
+    return pcm->error < 0 ? pcm->error : 1;
+}
+
+snd_pcm_sframes_t snd_pcm_avail_update(snd_pcm_t* pcm)
+{
+    return pcm->error < 0 ? pcm->error : pcm->avail;
+}
+
+int snd_pcm_mmap_begin(snd_pcm_t* pcm, const snd_pcm_channel_area_t** areas,
+                       snd_pcm_uframes_t* offset, snd_pcm_uframes_t* frames)
+{
+    if (pcm->error < 0)
+    {
+        return pcm->error;
+    }
+    *areas = pcm->areas;
+    *offset = pcm->position % pcm->hw_params.buffer_size;
+    *frames = std::min({*frames, static_cast<snd_pcm_uframes_t>(pcm->avail), pcm->hw_params.buffer_size - *offset});
+    return 0;
+}
+
+snd_pcm_sframes_t snd_pcm_mmap_commit(snd_pcm_t* pcm, snd_pcm_uframes_t /*offset*/, snd_pcm_uframes_t frames)
+{
+    pcm->position += frames;
+    pcm->avail -= frames;
+    return frames;
+}
+
+int snd_pcm_areas_silence(const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset,
+                          unsigned int channels, snd_pcm_uframes_t frames, snd_pcm_format_t /*format*/)
+{
+    for (unsigned int c = 0; c < channels; ++c)
+    {
+        float* data = static_cast<float*>(areas[c].addr) + offset;
+        std::fill(data, data + frames, 0.0f);
+    }
+    return 0;
+}
+
+size_t snd_pcm_hw_params_sizeof()
+{
+    return sizeof(snd_pcm_hw_params_t);
+}
+
+size_t snd_pcm_sw_params_sizeof()
+{
+    return sizeof(snd_pcm_sw_params_t);
+}
+
+int snd_pcm_hw_params_any(snd_pcm_t* /*pcm*/, snd_pcm_hw_params_t* params)
+{
+    *params = {alsa_mock_device.max_channels, 0, 0, 0};
+    return 0;
+}
+
+int snd_pcm_hw_params_set_access(snd_pcm_t* /*pcm*/, snd_pcm_hw_params_t* /*params*/, snd_pcm_access_t access)
+{
+    return access == SND_PCM_ACCESS_MMAP_NONINTERLEAVED ? 0 : -EINVAL;
+}
+
+int snd_pcm_hw_params_set_format(snd_pcm_t* /*pcm*/, snd_pcm_hw_params_t* /*params*/, snd_pcm_format_t format)
+{
+    return format == SND_PCM_FORMAT_FLOAT_LE ? 0 : -EINVAL;
+}
+
+int snd_pcm_hw_params_get_channels_max(const snd_pcm_hw_params_t* /*params*/, unsigned int* val)
+{
+    *val = alsa_mock_device.max_channels;
+    return 0;
+}
+
+int snd_pcm_hw_params_set_channels_near(snd_pcm_t* /*pcm*/, snd_pcm_hw_params_t* params, unsigned int* val)
+{
+    *val = std::min(*val, alsa_mock_device.max_channels);
+    params->channels = *val;
+    return 0;
+}
+
+int snd_pcm_hw_params_set_rate_near(snd_pcm_t* /*pcm*/, snd_pcm_hw_params_t* /*params*/, unsigned int* val, int* /*dir*/)
+{
+    *val = alsa_mock_device.sample_rate;
+    return 0;
+}
+
+int snd_pcm_hw_params_set_period_size_near(snd_pcm_t* /*pcm*/, snd_pcm_hw_params_t* params,
+                                           snd_pcm_uframes_t* val, int* /*dir*/)
+{
+    params->period_size = *val;
+    return 0;
+}
+
+int snd_pcm_hw_params_set_periods_near(snd_pcm_t* /*pcm*/, snd_pcm_hw_params_t* params, unsigned int* val, int* /*dir*/)
+{
+    params->periods = *val;
+    return 0;
+}
+
+int snd_pcm_hw_params(snd_pcm_t* pcm, snd_pcm_hw_params_t* params)
+{
+    params->buffer_size = alsa_mock_device.forced_buffer_size > 0 ? alsa_mock_device.forced_buffer_size :
+                                                                    params->period_size * params->periods;
+    if (params->buffer_size > ALSA_MOCK_MAX_FRAMES)
+    {
+        return -EINVAL;
+    }
+    pcm->hw_params = *params;
+    for (int c = 0; c < ALSA_MOCK_CHANNELS; ++c)
+    {
+        pcm->areas[c] = {pcm->data[c], 0, sizeof(float) * 8};
+    }
+    return 0;
+}
+
+int snd_pcm_hw_params_get_period_size(const snd_pcm_hw_params_t* params, snd_pcm_uframes_t* val, int* /*dir*/)
+{
+    *val = params->period_size;
+    return 0;
+}
+
+int snd_pcm_hw_params_get_buffer_size(const snd_pcm_hw_params_t* params, snd_pcm_uframes_t* val)
+{
+    *val = params->buffer_size;
+    return 0;
+}
+
+int snd_pcm_sw_params_current(snd_pcm_t* /*pcm*/, snd_pcm_sw_params_t* params)
+{
+    params->boundary = ALSA_MOCK_MAX_FRAMES * 1024;
+    return 0;
+}
+
+int snd_pcm_sw_params_get_boundary(const snd_pcm_sw_params_t* params, snd_pcm_uframes_t* val)
+{
+    *val = params->boundary;
+    return 0;
+}
+
+int snd_pcm_sw_params_set_avail_min(snd_pcm_t* /*pcm*/, snd_pcm_sw_params_t* /*params*/, snd_pcm_uframes_t /*val*/)
+{
+    return 0;
+}
+
+int snd_pcm_sw_params_set_start_threshold(snd_pcm_t* /*pcm*/, snd_pcm_sw_params_t* /*params*/, snd_pcm_uframes_t /*val*/)
+{
+    return 0;
+}
+
+int snd_pcm_sw_params(snd_pcm_t* /*pcm*/, snd_pcm_sw_params_t* /*params*/)
+{
+    return 0;
+}
@@ -159,6 +159,12 @@ public:
     virtual ControlStatus                              set_parameter_value(int /* processor_id */, int /* parameter_id */, float /* value */) override { return default_control_status; };
     virtual ControlStatus                              set_parameter_value_normalised(int /* processor_id */, int /* parameter_id */, float /* value */) override { return default_control_status; };
     virtual ControlStatus                              set_string_property_value(int /* processor_id */, int /* parameter_id */, const std::string& /* value */) override { return default_control_status; };
+    virtual ControlStatus                              set_parameter_values(int /* processor_id */, const std::vector<ParameterValue>& /* values */) override { return default_control_status; };
+
+    virtual std::pair<ControlStatus, int>              create_recording_tap(RecordingSource /* source */, int /* processor_id */) override { return {default_control_status, 0}; };
+    virtual std::vector<RecordingTapInfo>              get_recording_taps() const override { return {}; };
+    virtual ControlStatus                              arm_recording_tap(int /* tap_id */, const std::string& /* filename */) override { return default_control_status; };
+    virtual ControlStatus                              disarm_recording_tap(int /* tap_id */) override { return default_control_status; };
 };
 
 } // ext
@@ -3,6 +3,7 @@
 
 #include "engine/base_engine.h"
 #include "engine/base_event_dispatcher.h"
+#include "engine/transport.h"
 
 using namespace sushi;
 using namespace sushi::engine;
@@ -34,6 +35,11 @@ public:
         _queue.push_front(event);
     }
 
+    std::pair<bool, int> sample_offset_from_realtime(Time /*timestamp*/) override
+    {
+        return {events_due_now, 0};
+    }
+
     bool got_event()
     {
         if (_queue.empty())
@@ -61,6 +67,8 @@ public:
         }
     }
 
+    bool events_due_now{false};
+
 private:
     std::deque<Event*> _queue;
 };
@@ -109,16 +117,40 @@ public:
         return EngineReturnStatus::OK;
     }
 
+    EngineReturnStatus send_input_event(const RtEvent& /*event*/) override
+    {
+        if (input_queue_full)
+        {
+            return EngineReturnStatus::QUEUE_FULL;
+        }
+        got_input_event = true;
+        return EngineReturnStatus::OK;
+    }
+
     dispatcher::BaseEventDispatcher* event_dispatcher() override
     {
         return &_event_dispatcher;
     }
 
+    Transport* transport() override
+    {
+        return &_transport;
+    }
+
+    void enable_midi_clock_output(bool enabled) override
+    {
+        midi_clock_output_enabled = enabled;
+    }
+
     bool process_called{false};
     bool got_event{false};
     bool got_rt_event{false};
+    bool got_input_event{false};
+    bool input_queue_full{false};
+    bool midi_clock_output_enabled{false};
 private:
     EventDispatcherMockup _event_dispatcher;
+    Transport _transport{_sample_rate};
 };
 
 #endif //SUSHI_ENGINE_MOCKUP_H
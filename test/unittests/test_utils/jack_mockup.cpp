@@ -6,20 +6,25 @@
  */
 
 constexpr int JACK_NFRAMES = 128;
+constexpr int JACK_MAX_NFRAMES = 1024;
+constexpr int JACK_MAX_PORTS = 64;
 constexpr uint64_t FRAMETIME_64_SMP_44100 = 64 * 1000000 / 48000;
 uint8_t midi_buffer[3] = {0x81, 60, 45};
-float buffer[JACK_NFRAMES];
 
 struct _jack_port
 {
     int no{0};
+    float buffer[JACK_MAX_NFRAMES]{};
+    jack_latency_range_t latency[2]{}; // Capture and playback
 };
 
 struct _jack_client
 {
     JackProcessCallback callback_function;
     void* instance;
-    _jack_port mocked_ports[10];
+    jack_nframes_t buffer_size{JACK_NFRAMES};
+    int port_count{0};
+    _jack_port mocked_ports[JACK_MAX_PORTS];
 };
 
 
@@ -48,8 +53,13 @@ jack_port_t * jack_port_register (jack_client_t* client,
                                   unsigned long /*flags*/,
                                   unsigned long /*buffer_size*/)
 {
-    static int i = 0;
-    return &client->mocked_ports[i++];
+    if (client->port_count >= JACK_MAX_PORTS)
+    {
+        return nullptr;
+    }
+    auto port = &client->mocked_ports[client->port_count];
+    port->no = client->port_count++;
+    return port;
 }
 
 int jack_set_process_callback (jack_client_t* client,
@@ -76,15 +86,32 @@ int jack_set_latency_callback (jack_client_t* /*client*/,
     return 0;
 }
 
+int jack_set_buffer_size_callback (jack_client_t* /*client*/,
+                                   JackBufferSizeCallback /*bufsize_callback*/,
+                                   void* /*arg*/)
+{
+    return 0;
+}
+
+jack_nframes_t jack_get_buffer_size (jack_client_t* client)
+{
+    return client->buffer_size;
+}
+
 int jack_activate (jack_client_t* client)
 {
-    client->callback_function(JACK_NFRAMES, client->instance);
+    client->callback_function(client->buffer_size, client->instance);
     return 0;
 }
 
-void * jack_port_get_buffer (jack_port_t* /*port*/, jack_nframes_t)
+void * jack_port_get_buffer (jack_port_t* port, jack_nframes_t)
 {
-    return buffer;
+    return port->buffer;
+}
+
+int jack_port_connected (const jack_port_t* /*port*/)
+{
+    return 1;
 }
 
 uint32_t jack_midi_get_event_count(void* /*port_buffer*/)
@@ -101,6 +128,16 @@ int jack_midi_event_get(jack_midi_event_t *event,
     return 0;
 }
 
+void jack_midi_clear_buffer(void* /*port_buffer*/) {}
+
+int jack_midi_event_write(void* /*port_buffer*/,
+                          jack_nframes_t /*time*/,
+                          const jack_midi_data_t* /*data*/,
+                          size_t /*data_size*/)
+{
+    return 0;
+}
+
 
 int jack_get_cycle_times(const jack_client_t* /*client*/, jack_nframes_t* current_frames,
                          jack_time_t* current_usecs, jack_time_t* next_usecs, float* period_usecs)
@@ -112,12 +149,16 @@ int jack_get_cycle_times(const jack_client_t* /*client*/, jack_nframes_t* curren
     return 0;
 }
 
-void jack_port_get_latency_range (jack_port_t* /*port*/, jack_latency_callback_mode_t /*mode*/,
+void jack_port_get_latency_range (jack_port_t* port, jack_latency_callback_mode_t mode,
+                                  jack_latency_range_t* range)
+{
+    *range = port->latency[mode];
+}
+
+void jack_port_set_latency_range (jack_port_t* port, jack_latency_callback_mode_t mode,
                                   jack_latency_range_t* range)
 {
-    range->min = 0;
-    range->max = 0;
-    return;
+    port->latency[mode] = *range;
 }
 
 